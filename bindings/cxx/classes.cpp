@@ -543,6 +543,30 @@ vector<shared_ptr<Channel>> Device::channels()
 	return result;
 }
 
+vector<shared_ptr<Channel>> Device::enabled_channels()
+{
+	vector<shared_ptr<Channel>> result;
+	for (auto channel = sr_dev_inst_channels_get(_structure); channel; channel = channel->next) {
+		auto ch = (struct sr_channel *) channel->data;
+		if (ch->enabled)
+			result.push_back(
+				_channels[ch]->get_shared_pointer(
+					get_shared_from_this()));
+	}
+	return result;
+}
+
+vector<int> Device::enabled_logic_indices()
+{
+	vector<int> result;
+	for (auto channel = sr_dev_inst_channels_get(_structure); channel; channel = channel->next) {
+		auto ch = (struct sr_channel *) channel->data;
+		if (ch->enabled && ch->type == SR_CHANNEL_LOGIC)
+			result.push_back(ch->index);
+	}
+	return result;
+}
+
 shared_ptr<Channel> Device::get_channel(struct sr_channel *ptr)
 {
 	return _channels[ptr]->get_shared_pointer(get_shared_from_this());
@@ -1147,11 +1171,111 @@ string Session::filename()
 	return _filename;
 }
 
+shared_ptr<SessionStatistics> Session::statistics(shared_ptr<Device> device)
+{
+	struct sr_session_stats stats;
+
+	check(sr_session_stats_get(_structure,
+		device ? device->_structure : NULL, &stats));
+	return shared_ptr<SessionStatistics>(
+		new SessionStatistics(&stats), SessionStatistics::Deleter());
+}
+
+void Session::reset_statistics()
+{
+	check(sr_session_stats_reset(_structure));
+}
+
+void Session::set_statistics_timing(bool enable)
+{
+	check(sr_session_stats_timing_set(_structure, enable));
+}
+
 shared_ptr<Context> Session::context()
 {
 	return _context;
 }
 
+SessionStatistics::SessionStatistics(const struct sr_session_stats *structure) :
+	UserOwned((struct sr_session_stats *) g_memdup(structure,
+		sizeof(struct sr_session_stats)))
+{
+}
+
+SessionStatistics::~SessionStatistics()
+{
+	g_free(_structure);
+}
+
+map<const PacketType *, uint64_t> SessionStatistics::packets()
+{
+	map<const PacketType *, uint64_t> result;
+	for (int type = SR_DF_HEADER; type <= SR_DF_ANALOG2; type++)
+		result[PacketType::get(type)] =
+			_structure->packets[type - SR_DF_HEADER];
+	return result;
+}
+
+map<const PacketType *, uint64_t> SessionStatistics::bytes()
+{
+	map<const PacketType *, uint64_t> result;
+	for (int type = SR_DF_HEADER; type <= SR_DF_ANALOG2; type++)
+		result[PacketType::get(type)] =
+			_structure->bytes[type - SR_DF_HEADER];
+	return result;
+}
+
+uint64_t SessionStatistics::callback_time()
+{
+	return _structure->callback_usec;
+}
+
+uint64_t SessionStatistics::callback_time_max()
+{
+	return _structure->callback_max_usec;
+}
+
+uint64_t SessionStatistics::iterations()
+{
+	return _structure->iterations;
+}
+
+vector<uint64_t> SessionStatistics::latency_histogram()
+{
+	return vector<uint64_t>(_structure->latency,
+		_structure->latency + SR_STATS_LATENCY_BUCKETS);
+}
+
+uint64_t SessionStatistics::overruns()
+{
+	return _structure->overruns;
+}
+
+uint64_t SessionStatistics::empty_transfers()
+{
+	return _structure->empty_transfers;
+}
+
+uint64_t SessionStatistics::lost_samples()
+{
+	return _structure->lost_samples;
+}
+
+uint64_t SessionStatistics::download_size()
+{
+	return _structure->download_size;
+}
+
+uint64_t SessionStatistics::download_bytes()
+{
+	return _structure->download_bytes;
+}
+
+uint64_t SessionStatistics::download_time()
+{
+	return _structure->download_usec;
+}
+
 Packet::Packet(shared_ptr<Device> device,
 	const struct sr_datafeed_packet *structure) :
 	UserOwned(structure),
@@ -93,6 +93,7 @@ class SR_API HardwareDevice;
 class SR_API Channel;
 class SR_API EventSource;
 class SR_API Session;
+class SR_API SessionStatistics;
 class SR_API ConfigKey;
 class SR_API InputFormat;
 class SR_API OutputFormat;
@@ -381,6 +382,10 @@ public:
 	string connection_id();
 	/** List of the channels available on this device. */
 	vector<shared_ptr<Channel> > channels();
+	/** List of the enabled channels of this device. */
+	vector<shared_ptr<Channel> > enabled_channels();
+	/** Indices of the enabled logic channels of this device. */
+	vector<int> enabled_logic_indices();
 	/** Channel groups available on this device, indexed by name. */
 	map<string, shared_ptr<ChannelGroup> > channel_groups();
 	/** Open device. */
@@ -713,6 +718,16 @@ public:
 	void set_trigger(shared_ptr<Trigger> trigger);
 	/** Get filename this session was loaded from. */
 	string filename();
+	/** Get acquisition statistics. Reset when the session is started.
+	 * @param device Device to get the statistics of, or nullptr for the
+	 * whole session. */
+	shared_ptr<SessionStatistics> statistics(
+		shared_ptr<Device> device = nullptr);
+	/** Reset acquisition statistics. */
+	void reset_statistics();
+	/** Enable timing of datafeed callbacks and event loop iterations.
+	 * @param enable True to enable timing, off by default. */
+	void set_statistics_timing(bool enable);
 protected:
 	Session(shared_ptr<Context> context);
 	Session(shared_ptr<Context> context, string filename);
@@ -735,6 +750,43 @@ protected:
 	friend class SessionDevice;
 };
 
+/** Acquisition statistics of a session, or of one of its devices */
+class SR_API SessionStatistics :
+	public UserOwned<SessionStatistics, struct sr_session_stats>
+{
+public:
+	/** Number of packets sent, by type. */
+	map<const PacketType *, uint64_t> packets();
+	/** Number of payload bytes sent, by type. */
+	map<const PacketType *, uint64_t> bytes();
+	/** Time spent in datafeed callbacks, in microseconds. */
+	uint64_t callback_time();
+	/** Longest time spent in datafeed callbacks for a packet. */
+	uint64_t callback_time_max();
+	/** Number of event loop iterations. */
+	uint64_t iterations();
+	/** Histogram of event loop iteration times. Bucket 0 counts those
+	 * under 1us, bucket n those from 2^(n-1) up to 2^n us. */
+	vector<uint64_t> latency_histogram();
+	/** Number of hardware buffer overruns. */
+	uint64_t overruns();
+	/** Number of transfers which returned no data. */
+	uint64_t empty_transfers();
+	/** Number of samples known to be lost. */
+	uint64_t lost_samples();
+	/** Number of bytes to be read by bulk downloads. */
+	uint64_t download_size();
+	/** Number of bytes received by bulk downloads so far. */
+	uint64_t download_bytes();
+	/** Time taken by bulk downloads, in microseconds. */
+	uint64_t download_time();
+protected:
+	SessionStatistics(const struct sr_session_stats *structure);
+	~SessionStatistics();
+	friend class Deleter;
+	friend class Session;
+};
+
 /** A packet on the session datafeed */
 class SR_API Packet : public UserOwned<Packet, const struct sr_datafeed_packet>
 {
@@ -68,6 +68,7 @@ template< class T > class enable_shared_from_this;
 %shared_ptr(sigrok::ChannelGroup);
 %shared_ptr(sigrok::EventSource);
 %shared_ptr(sigrok::Session);
+%shared_ptr(sigrok::SessionStatistics);
 %shared_ptr(sigrok::SessionDevice);
 %shared_ptr(sigrok::Packet);
 %shared_ptr(sigrok::PacketPayload);
@@ -134,6 +135,12 @@ template< class T > class enable_shared_from_this;
 %template(TriggerMatchVector)
  std::vector<std::shared_ptr<sigrok::TriggerMatch> >;
 
+%template(PacketTypeCountMap)
+    std::map<const sigrok::PacketType *, uint64_t>;
+
+%template(CountVector)
+    std::vector<uint64_t>;
+
 #define SR_API
 #define SR_PRIV
 
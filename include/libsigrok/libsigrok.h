@@ -539,6 +539,37 @@ struct sr_channel {
 	void *priv;
 };
 
+/**
+ * Table of the enabled channels of a device instance.
+ *
+ * Built from the device's channel list when the device is added to a
+ * session and when an acquisition is started. This saves code on the data
+ * path from walking the channel list over and over.
+ */
+struct sr_channel_table {
+	/** Number of channels of the device, enabled or not. */
+	unsigned int num_channels;
+	/** Number of enabled channels. */
+	unsigned int num_enabled;
+	/** The enabled channels, in channel list order. */
+	struct sr_channel **enabled;
+	/** Number of enabled logic channels. */
+	unsigned int num_logic;
+	/** Indices of the enabled logic channels, in channel list order. */
+	int *logic_index;
+	/** Number of enabled analog channels. */
+	unsigned int num_analog;
+	/** The enabled analog channels, in channel list order. */
+	struct sr_channel **analog;
+	/** Number of 64-bit words in enabled_mask. */
+	unsigned int mask_words;
+	/**
+	 * Bit (i % 64) of word (i / 64) is set if the channel with index i
+	 * is enabled.
+	 */
+	uint64_t *enabled_mask;
+};
+
 /** Structure for groups of channels that have common properties. */
 struct sr_channel_group {
 	/** Name of the channel group. */
@@ -930,6 +961,13 @@ enum sr_configkey {
 
 	/** Self test mode. */
 	SR_CONF_TEST_MODE,
+
+	/**
+	 * Pace data to wall-clock time according to the samplerate. If
+	 * disabled, data is sent out as fast as the device (or file, for
+	 * virtual devices) can produce it.
+	 */
+	SR_CONF_REALTIME,
 };
 
 /**
@@ -1017,6 +1055,20 @@ struct sr_dev_driver {
 	int (*config_list) (uint32_t key, GVariant **data,
 			const struct sr_dev_inst *sdi,
 			const struct sr_channel_group *cg);
+	/** Query the values of several configuration keys at once, e.g. in a
+	 *  single instrument transaction. Optional.
+	 *  @see sr_config_get_multi(). */
+	int (*config_get_multi) (GSList *configs,
+			const struct sr_dev_inst *sdi,
+			const struct sr_channel_group *cg);
+	/** Set the values of several configuration keys at once. Optional.
+	 *  @see sr_config_set_multi(). */
+	int (*config_set_multi) (GSList *configs,
+			const struct sr_dev_inst *sdi,
+			const struct sr_channel_group *cg);
+	/** Values from config_get() only change through config_set(), so
+	 *  they may be cached. @see sr_config_get(). */
+	gboolean config_cache;
 
 	/* Device-specific */
 	/** Open device */
@@ -1043,6 +1095,56 @@ struct sr_dev_driver {
  */
 struct sr_session;
 
+/**
+ * Size of the per packet type arrays in struct sr_session_stats. This
+ * leaves room for packet types added later, so the size of the struct
+ * doesn't change with them.
+ */
+#define SR_STATS_PACKET_TYPES 32
+/** Number of buckets in the event loop latency histogram. */
+#define SR_STATS_LATENCY_BUCKETS 24
+
+/**
+ * Acquisition statistics of a session, or of one device in it.
+ *
+ * Counters are reset when the session is started. Timings are only
+ * collected once enabled with sr_session_stats_timing_set().
+ *
+ * @see sr_session_stats_get().
+ */
+struct sr_session_stats {
+	/** Packets sent, indexed by packet type minus SR_DF_HEADER. */
+	uint64_t packets[SR_STATS_PACKET_TYPES];
+	/** Payload bytes sent, indexed like packets. */
+	uint64_t bytes[SR_STATS_PACKET_TYPES];
+	/** Time spent in datafeed callbacks, in microseconds. */
+	uint64_t callback_usec;
+	/** Longest time spent in the datafeed callbacks for one packet. */
+	uint64_t callback_max_usec;
+	/** Event loop iterations. Not counted per device. */
+	uint64_t iterations;
+	/**
+	 * Histogram of the time taken to run the event sources of an
+	 * iteration. Bucket 0 counts iterations under 1us, bucket n those
+	 * from 2^(n-1) up to 2^n us. The last bucket counts everything longer.
+	 */
+	uint64_t latency[SR_STATS_LATENCY_BUCKETS];
+	/** Hardware buffer overruns reported by the driver. */
+	uint64_t overruns;
+	/** Transfers which returned no data, as reported by the driver. */
+	uint64_t empty_transfers;
+	/** Samples the driver knows were lost. */
+	uint64_t lost_samples;
+	/**
+	 * Bytes to be read by bulk downloads, and those received so far.
+	 * Both are updated while a download runs.
+	 */
+	uint64_t download_size;
+	uint64_t download_bytes;
+	/** Time taken by bulk downloads so far, in microseconds. */
+	uint64_t download_usec;
+};
+
 #include "proto.h"
 #include "version.h"
 
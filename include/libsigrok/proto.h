@@ -50,6 +50,7 @@ SR_API int sr_log_callback_set(sr_log_callback cb, void *cb_data);
 SR_API int sr_log_callback_set_default(void);
 SR_API int sr_log_logdomain_set(const char *logdomain);
 SR_API char *sr_log_logdomain_get(void);
+SR_API int sr_log_async_set(gboolean enable);
 
 /*--- device.c --------------------------------------------------------------*/
 
@@ -70,6 +71,8 @@ SR_API const char *sr_dev_inst_version_get(const struct sr_dev_inst *sdi);
 SR_API const char *sr_dev_inst_sernum_get(const struct sr_dev_inst *sdi);
 SR_API const char *sr_dev_inst_connid_get(const struct sr_dev_inst *sdi);
 SR_API GSList *sr_dev_inst_channels_get(const struct sr_dev_inst *sdi);
+SR_API const struct sr_channel_table *sr_dev_inst_channel_table_get(
+		const struct sr_dev_inst *sdi);
 SR_API GSList *sr_dev_inst_channel_groups_get(const struct sr_dev_inst *sdi);
 
 SR_API struct sr_dev_inst *sr_dev_inst_user_new(const char *vendor,
@@ -89,6 +92,11 @@ SR_API int sr_config_get(const struct sr_dev_driver *driver,
 SR_API int sr_config_set(const struct sr_dev_inst *sdi,
 		const struct sr_channel_group *cg,
 		uint32_t key, GVariant *data);
+SR_API int sr_config_get_multi(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg, GSList *configs);
+SR_API int sr_config_set_multi(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg, GSList *configs);
+SR_API void sr_config_cache_clear(const struct sr_dev_inst *sdi);
 SR_API int sr_config_commit(const struct sr_dev_inst *sdi);
 SR_API int sr_config_list(const struct sr_dev_driver *driver,
 		const struct sr_dev_inst *sdi,
@@ -129,6 +137,9 @@ SR_API int sr_session_save_init(struct sr_session *session,
 		const char *filename, uint64_t samplerate, char **channels);
 SR_API int sr_session_append(struct sr_session *session,
 		const char *filename, unsigned char *buf, int unitsize, int units);
+SR_API int sr_session_read_samples(const char *filename,
+		uint64_t start_sample, uint64_t num_samples, uint8_t **buf,
+		uint64_t *samples_read, int *unitsize);
 SR_API int sr_session_source_add(struct sr_session *session, int fd,
 		int events, int timeout, sr_receive_data_callback cb, void *cb_data);
 SR_API int sr_session_source_add_pollfd(struct sr_session *session,
@@ -143,6 +154,16 @@ SR_API int sr_session_source_remove_pollfd(struct sr_session *session,
 SR_API int sr_session_source_remove_channel(struct sr_session *session,
 		GIOChannel *channel);
 
+/* Statistics */
+SR_API int sr_session_stats_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi, struct sr_session_stats *stats);
+SR_API int sr_session_stats_reset(struct sr_session *session);
+SR_API int sr_session_stats_timing_set(struct sr_session *session,
+		gboolean enable);
+SR_API int sr_session_datafeed_callback_stats_get(struct sr_session *session,
+		sr_datafeed_callback cb, void *cb_data, uint64_t *num_calls,
+		uint64_t *usec);
+
 /*--- input/input.c ---------------------------------------------------------*/
 
 SR_API const struct sr_input_module **sr_input_list(void);
@@ -176,6 +197,12 @@ SR_API int sr_output_send(const struct sr_output *o,
 		const struct sr_datafeed_packet *packet, GString **out);
 SR_API int sr_output_free(const struct sr_output *o);
 
+/*--- planar.c --------------------------------------------------------------*/
+
+SR_API int sr_planar_read_channel(const char *filename, int channel_index,
+		uint64_t start_sample, uint64_t num_samples, uint8_t **plane,
+		uint64_t *samples_read);
+
 /*--- trigger.c -------------------------------------------------------------*/
 
 SR_API struct sr_trigger *sr_trigger_new(const char *name);
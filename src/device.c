@@ -104,6 +104,9 @@ SR_API int sr_dev_channel_name_set(const struct sr_dev_inst *sdi,
 		}
 	}
 
+	if (ret == SR_OK)
+		sr_dev_inst_channel_table_update((struct sr_dev_inst *)sdi);
+
 	return ret;
 }
 
@@ -150,6 +153,9 @@ SR_API int sr_dev_channel_enable(const struct sr_dev_inst *sdi, int channelnum,
 		}
 	}
 
+	if (ret == SR_OK)
+		sr_dev_inst_channel_table_update((struct sr_dev_inst *)sdi);
+
 	return ret;
 }
 
@@ -234,10 +240,67 @@ SR_API int sr_dev_inst_channel_add(struct sr_dev_inst *sdi, int index, int type,
 
 	ch = sr_channel_new(index, type, TRUE, name);
 	sdi->channels = g_slist_append(sdi->channels, ch);
+	sr_dev_inst_channel_table_update(sdi);
 
 	return SR_OK;
 }
 
+static void channel_table_free(struct sr_channel_table *table)
+{
+	if (!table)
+		return;
+
+	g_free(table->enabled);
+	g_free(table->logic_index);
+	g_free(table->analog);
+	g_free(table->enabled_mask);
+	g_free(table);
+}
+
+/** @private
+ *  (Re)build the table of enabled channels from the channel list. This is
+ *  done whenever channels are added, renamed or enabled/disabled through
+ *  the API, and again when the device is added to a session and when an
+ *  acquisition is started, in case drivers changed channels directly.
+ *  @param sdi device instance whose table to build.
+ */
+SR_PRIV void sr_dev_inst_channel_table_update(struct sr_dev_inst *sdi)
+{
+	struct sr_channel_table *table;
+	struct sr_channel *ch;
+	GSList *l;
+	int max_index;
+
+	table = g_malloc0(sizeof(struct sr_channel_table));
+	max_index = -1;
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		table->num_channels++;
+		max_index = MAX(max_index, ch->index);
+	}
+
+	table->enabled = g_malloc0(sizeof(struct sr_channel *) * (table->num_channels + 1));
+	table->logic_index = g_malloc0(sizeof(int) * (table->num_channels + 1));
+	table->analog = g_malloc0(sizeof(struct sr_channel *) * (table->num_channels + 1));
+	table->mask_words = max_index / 64 + 1;
+	table->enabled_mask = g_malloc0(sizeof(uint64_t) * table->mask_words);
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (!ch->enabled)
+			continue;
+		table->enabled[table->num_enabled++] = ch;
+		if (ch->type == SR_CHANNEL_LOGIC)
+			table->logic_index[table->num_logic++] = ch->index;
+		else if (ch->type == SR_CHANNEL_ANALOG)
+			table->analog[table->num_analog++] = ch;
+		if (ch->index >= 0)
+			table->enabled_mask[ch->index / 64] |= 1ULL << (ch->index % 64);
+	}
+
+	channel_table_free(sdi->channel_table);
+	sdi->channel_table = table;
+}
+
 /** @private
  *  Free device instance struct created by sr_dev_inst().
  *  @param sdi device instance to free.
@@ -265,6 +328,10 @@ SR_PRIV void sr_dev_inst_free(struct sr_dev_inst *sdi)
 	}
 	g_slist_free(sdi->channel_groups);
 
+	channel_table_free(sdi->channel_table);
+	if (sdi->config_cache)
+		g_hash_table_destroy(sdi->config_cache);
+
 	g_free(sdi->vendor);
 	g_free(sdi->model);
 	g_free(sdi->version);
@@ -476,6 +543,8 @@ SR_API int sr_dev_close(struct sr_dev_inst *sdi)
 		return SR_ERR;
 
 	ret = sdi->driver->dev_close(sdi);
+	/* Whatever is cached may change before the device is opened again. */
+	sr_config_cache_clear(sdi);
 
 	return ret;
 }
@@ -643,6 +712,30 @@ SR_API GSList *sr_dev_inst_channels_get(const struct sr_dev_inst *sdi)
 	return sdi->channels;
 }
 
+/**
+ * Queries a device instance's table of enabled channels.
+ *
+ * The table is rebuilt whenever channels are added, renamed or enabled
+ * and disabled through the API, and again when the device is added to a
+ * session and when an acquisition is started. The returned pointer is
+ * only valid until the next rebuild.
+ *
+ * @param sdi Device instance to use. Must not be NULL.
+ *
+ * @return The table of enabled channels, or NULL on invalid arguments or
+ *         if no table was built for the device yet.
+ *
+ * @since 0.4.0
+ */
+SR_API const struct sr_channel_table *sr_dev_inst_channel_table_get(
+		const struct sr_dev_inst *sdi)
+{
+	if (!sdi)
+		return NULL;
+
+	return sdi->channel_table;
+}
+
 /**
  * Queries a device instances' channel groups list.
  *
@@ -212,8 +212,12 @@ static int sigma_read_pos(uint32_t *stoppos, uint32_t *triggerpos,
 	return 1;
 }
 
-static int sigma_read_dram(uint16_t startchunk, size_t numchunks,
-			   uint8_t *data, struct dev_context *devc)
+/*
+ * Ask for DRAM lines, without waiting for them. They are read with
+ * sigma_read(), numchunks * CHUNK_SIZE bytes.
+ */
+static int sigma_request_dram(uint16_t startchunk, size_t numchunks,
+			      struct dev_context *devc)
 {
 	size_t i;
 	uint8_t buf[4096];
@@ -239,9 +243,7 @@ static int sigma_read_dram(uint16_t startchunk, size_t numchunks,
 			buf[idx++] = REG_DRAM_WAIT_ACK;
 	}
 
-	sigma_write(buf, idx, devc);
-
-	return sigma_read(data, numchunks * CHUNK_SIZE, devc);
+	return sigma_write(buf, idx, devc);
 }
 
 /* Upload trigger look-up tables to Sigma. */
@@ -962,6 +964,59 @@ static uint16_t sigma_dram_cluster_ts(struct sigma_dram_cluster *cluster)
 	return (cluster->timestamp_hi << 8) | cluster->timestamp_lo;
 }
 
+/* Send the decoded samples collected so far. */
+static void sigma_flush_samples(struct sr_dev_inst *sdi, unsigned int num_samples)
+{
+	struct dev_context *devc = sdi->priv;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+
+	if (num_samples == 0)
+		return;
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = 2;
+	logic.length = num_samples * logic.unitsize;
+	logic.data = devc->samples;
+	sr_session_send(sdi, &packet);
+
+	devc->num_samples -= num_samples;
+	memmove(devc->samples, devc->samples + logic.length,
+		devc->num_samples * logic.unitsize);
+}
+
+/*
+ * Send the last sample as many times as needed to fill a timestamp gap,
+ * as a single packet. The padding buffer only gets (re)filled as far as
+ * needed when the sample or gap differs from before.
+ */
+static void sigma_send_padding(struct sr_dev_inst *sdi, uint32_t num_samples)
+{
+	struct dev_context *devc = sdi->priv;
+	struct sigma_state *ss = &devc->state;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint32_t i;
+
+	if (devc->pad_value != ss->lastsample) {
+		devc->pad_value = ss->lastsample;
+		devc->pad_len = 0;
+	}
+	for (i = devc->pad_len; i < num_samples; i++) {
+		devc->pad[2 * i + 0] = devc->pad_value & 0xff;
+		devc->pad[2 * i + 1] = devc->pad_value >> 8;
+	}
+	devc->pad_len = MAX(devc->pad_len, num_samples);
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = 2;
+	logic.length = num_samples * logic.unitsize;
+	logic.data = devc->pad;
+	sr_session_send(sdi, &packet);
+}
+
 static void sigma_decode_dram_cluster(struct sigma_dram_cluster *dram_cluster,
 				      unsigned int events_in_cluster,
 				      unsigned int triggered,
@@ -970,20 +1025,15 @@ static void sigma_decode_dram_cluster(struct sigma_dram_cluster *dram_cluster,
 	struct dev_context *devc = sdi->priv;
 	struct sigma_state *ss = &devc->state;
 	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
 	uint16_t tsdiff, ts;
-	uint8_t samples[2048];
+	uint8_t *samples;
 	unsigned int i;
+	int trigger_offset;
 
 	ts = sigma_dram_cluster_ts(dram_cluster);
 	tsdiff = ts - ss->lastts;
 	ss->lastts = ts;
 
-	packet.type = SR_DF_LOGIC;
-	packet.payload = &logic;
-	logic.unitsize = 2;
-	logic.data = samples;
-
 	/*
 	 * First of all, send Sigrok a copy of the last sample from
 	 * previous cluster as many times as needed to make up for
@@ -995,33 +1045,28 @@ static void sigma_decode_dram_cluster(struct sigma_dram_cluster *dram_cluster,
 	 * sample in the cluster happens at the time of the timestamp
 	 * and the remaining samples happen at timestamp +1...+6 .
 	 */
-	for (ts = 0; ts < tsdiff - (EVENTS_PER_CLUSTER - 1); ts++) {
-		i = ts % 1024;
-		samples[2 * i + 0] = ss->lastsample & 0xff;
-		samples[2 * i + 1] = ss->lastsample >> 8;
-
-		/*
-		 * If we have 1024 samples ready or we're at the
-		 * end of submitting the padding samples, submit
-		 * the packet to Sigrok.
-		 */
-		if ((i == 1023) || (ts == (tsdiff - EVENTS_PER_CLUSTER))) {
-			logic.length = (i + 1) * logic.unitsize;
-			sr_session_send(sdi, &packet);
-		}
+	if (tsdiff > EVENTS_PER_CLUSTER - 1) {
+		sigma_flush_samples(sdi, devc->num_samples);
+		sigma_send_padding(sdi, tsdiff - (EVENTS_PER_CLUSTER - 1));
 	}
 
+	/* A triggered cluster starts at the beginning of the buffer. */
+	if (triggered
+	    || devc->num_samples + EVENTS_PER_CLUSTER > SAMPLE_BUFSIZE)
+		sigma_flush_samples(sdi, devc->num_samples);
+
 	/*
-	 * Parse the samples in current cluster and prepare them
-	 * to be submitted to Sigrok.
+	 * Parse the samples in current cluster and queue them to be
+	 * submitted to Sigrok.
 	 */
+	samples = devc->samples + 2 * devc->num_samples;
 	for (i = 0; i < events_in_cluster; i++) {
 		samples[2 * i + 1] = dram_cluster->samples[i].sample_lo;
 		samples[2 * i + 0] = dram_cluster->samples[i].sample_hi;
 	}
+	devc->num_samples += events_in_cluster;
 
 	/* Send data up to trigger point (if triggered). */
-	int trigger_offset = 0;
 	if (triggered) {
 		/*
 		 * Trigger is not always accurate to sample because of
@@ -1031,32 +1076,21 @@ static void sigma_decode_dram_cluster(struct sigma_dram_cluster *dram_cluster,
 		 */
 		trigger_offset = get_trigger_offset(samples,
 					ss->lastsample, &devc->trigger);
-
-		if (trigger_offset > 0) {
-			packet.type = SR_DF_LOGIC;
-			logic.length = trigger_offset * logic.unitsize;
-			sr_session_send(sdi, &packet);
-			events_in_cluster -= trigger_offset;
-		}
+		sigma_flush_samples(sdi, MIN((unsigned int)trigger_offset,
+					     events_in_cluster));
 
 		/* Only send trigger if explicitly enabled. */
 		if (devc->use_triggers) {
 			packet.type = SR_DF_TRIGGER;
+			packet.payload = NULL;
 			sr_session_send(sdi, &packet);
 		}
 	}
 
-	if (events_in_cluster > 0) {
-		packet.type = SR_DF_LOGIC;
-		logic.length = events_in_cluster * logic.unitsize;
-		logic.data = samples + (trigger_offset * logic.unitsize);
-		sr_session_send(sdi, &packet);
-	}
-
-	ss->lastsample =
-		samples[2 * (events_in_cluster - 1) + 0] |
-		(samples[2 * (events_in_cluster - 1) + 1] << 8);
-
+	if (events_in_cluster > 0)
+		ss->lastsample =
+			samples[2 * (events_in_cluster - 1) + 0] |
+			(samples[2 * (events_in_cluster - 1) + 1] << 8);
 }
 
 /*
@@ -1112,25 +1146,44 @@ static int decode_chunk_ts(struct sigma_dram_line *dram_line,
 	return SR_OK;
 }
 
-static int download_capture(struct sr_dev_inst *sdi)
+static void download_free(struct dev_context *devc)
+{
+	g_free(devc->dram_lines);
+	devc->dram_lines = NULL;
+	g_free(devc->samples);
+	devc->samples = NULL;
+	g_free(devc->pad);
+	devc->pad = NULL;
+}
+
+/* Ask for the next DRAM lines, if there are any left. */
+static int download_request(struct dev_context *devc)
+{
+	struct sigma_state *ss = &devc->state;
+
+	ss->lines_requested = MIN(DRAM_LINES_PER_READ,
+				  ss->lines_total - ss->lines_done);
+	if (ss->lines_requested == 0)
+		return SR_OK;
+
+	if (sigma_request_dram(ss->lines_done, ss->lines_requested, devc) < 0)
+		return SR_ERR;
+
+	return SR_OK;
+}
+
+/*
+ * Stop capturing and set up the download of the sample data. The
+ * download itself happens a few DRAM lines at a time in download_step(),
+ * so the session keeps running in between.
+ */
+static int download_start(struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc = sdi->priv;
-	const uint32_t chunks_per_read = 32;
-	struct sigma_dram_line *dram_line;
-	int bufsz;
+	struct sigma_state *ss = &devc->state;
 	uint32_t stoppos, triggerpos;
-	struct sr_datafeed_packet packet;
 	uint8_t modestatus;
 
-	uint32_t i;
-	uint32_t dl_lines_total, dl_lines_curr, dl_lines_done;
-	uint32_t dl_events_in_line = 64 * 7;
-	uint32_t trg_line = ~0, trg_event = ~0;
-
-	dram_line = g_try_malloc0(chunks_per_read * sizeof(*dram_line));
-	if (!dram_line)
-		return FALSE;
-
 	sr_info("Downloading sample data.");
 
 	/* Stop acquisition. */
@@ -1143,10 +1196,11 @@ static int download_capture(struct sr_dev_inst *sdi)
 	sigma_read_pos(&stoppos, &triggerpos, devc);
 
 	/* Check if trigger has fired. */
+	ss->trg_line = ss->trg_event = ~0;
 	modestatus = sigma_get_register(READ_MODE, devc);
 	if (modestatus & 0x20) {
-		trg_line = triggerpos >> 9;
-		trg_event = triggerpos & 0x1ff;
+		ss->trg_line = triggerpos >> 9;
+		ss->trg_event = triggerpos & 0x1ff;
 	}
 
 	/*
@@ -1154,50 +1208,105 @@ static int download_capture(struct sr_dev_inst *sdi)
 	 * Sigma so we have a complete set of samples. Note that the last
 	 * line can be only partial, containing less than 64 clusters.
 	 */
-	dl_lines_total = (stoppos >> 9) + 1;
+	ss->stoppos = stoppos;
+	ss->lines_total = (stoppos >> 9) + 1;
+	ss->lines_done = 0;
+
+	devc->dram_lines = g_try_malloc(DRAM_LINES_PER_READ * CHUNK_SIZE);
+	/* Timestamp gaps are 16 bits wide. */
+	devc->pad = g_try_malloc(2 * 65536);
+	devc->samples = g_try_malloc(2 * (SAMPLE_BUFSIZE + 1));
+	if (!devc->dram_lines || !devc->pad || !devc->samples) {
+		sr_err("Download buffer malloc failed.");
+		download_free(devc);
+		return SR_ERR_MALLOC;
+	}
+	devc->num_samples = 0;
+	devc->pad_len = 0;
 
-	dl_lines_done = 0;
+	if (download_request(devc) != SR_OK) {
+		download_free(devc);
+		return SR_ERR;
+	}
+	devc->state.state = SIGMA_DOWNLOAD;
 
-	while (dl_lines_total > dl_lines_done) {
-		/* We can download only up-to 32 DRAM lines in one go! */
-		dl_lines_curr = MIN(chunks_per_read, dl_lines_total);
+	return SR_OK;
+}
 
-		bufsz = sigma_read_dram(dl_lines_done, dl_lines_curr,
-					(uint8_t *)dram_line, devc);
-		/* TODO: Check bufsz. For now, just avoid compiler warnings. */
-		(void)bufsz;
+static void download_finish(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc = sdi->priv;
+	struct sr_datafeed_packet packet;
 
-		/* This is the first DRAM line, so find the initial timestamp. */
-		if (dl_lines_done == 0) {
-			devc->state.lastts =
-				sigma_dram_cluster_ts(&dram_line[0].cluster[0]);
-			devc->state.lastsample = 0;
-		}
+	if (devc->samples)
+		sigma_flush_samples(sdi, devc->num_samples);
 
-		for (i = 0; i < dl_lines_curr; i++) {
-			uint32_t trigger_event = ~0;
-			/* The last "DRAM line" can be only partially full. */
-			if (dl_lines_done + i == dl_lines_total - 1)
-				dl_events_in_line = stoppos & 0x1ff;
+	/* All done. */
+	packet.type = SR_DF_END;
+	sr_session_send(sdi, &packet);
 
-			/* Test if the trigger happened on this line. */
-			if (dl_lines_done + i == trg_line)
-				trigger_event = trg_event;
+	dev_acquisition_stop(sdi, sdi);
+}
 
-			decode_chunk_ts(dram_line + i, dl_events_in_line,
-					trigger_event, sdi);
-		}
+/*
+ * Read the DRAM lines requested last time, and request the next ones
+ * before decoding these, so the Sigma can get them ready meanwhile.
+ */
+static int download_step(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc = sdi->priv;
+	struct sigma_state *ss = &devc->state;
+	uint32_t i, line, num_lines, events_in_line, trigger_event;
+	int ret;
 
-		dl_lines_done += dl_lines_curr;
+	num_lines = ss->lines_requested;
+	ret = sigma_read(devc->dram_lines, num_lines * CHUNK_SIZE, devc);
+	if (ret != (int)(num_lines * CHUNK_SIZE)) {
+		sr_err("Short DRAM read: %d bytes.", ret);
+		download_finish(sdi);
+		return TRUE;
 	}
 
-	/* All done. */
-	packet.type = SR_DF_END;
-	sr_session_send(sdi, &packet);
+	/* This is the first DRAM line, so find the initial timestamp. */
+	if (ss->lines_done == 0) {
+		ss->lastts = sigma_dram_cluster_ts(&devc->dram_lines[0].cluster[0]);
+		ss->lastsample = 0;
+	}
 
-	dev_acquisition_stop(sdi, sdi);
+	line = ss->lines_done;
+	ss->lines_done += num_lines;
+	if (download_request(devc) != SR_OK) {
+		download_finish(sdi);
+		return TRUE;
+	}
+
+	for (i = 0; i < num_lines; i++, line++) {
+		events_in_line = 64 * 7;
+		trigger_event = ~0;
+
+		/* The last "DRAM line" can be only partially full. */
+		if (line == ss->lines_total - 1)
+			events_in_line = ss->stoppos & 0x1ff;
+
+		/* Test if the trigger happened on this line. */
+		if (line == ss->trg_line)
+			trigger_event = ss->trg_event;
+
+		decode_chunk_ts(devc->dram_lines + i, events_in_line,
+				trigger_event, sdi);
+	}
+	sigma_flush_samples(sdi, devc->num_samples);
+
+	if (ss->lines_done == ss->lines_total)
+		download_finish(sdi);
 
-	g_free(dram_line);
+	return TRUE;
+}
+
+static int download_capture(struct sr_dev_inst *sdi)
+{
+	if (download_start(sdi) != SR_OK)
+		download_finish(sdi);
 
 	return TRUE;
 }
@@ -1251,6 +1360,9 @@ static int receive_data(int fd, int revents, void *cb_data)
 	if (devc->state.state == SIGMA_CAPTURE)
 		return sigma_capture_mode(sdi);
 
+	if (devc->state.state == SIGMA_DOWNLOAD)
+		return download_step(sdi);
+
 	return TRUE;
 }
 
@@ -1529,6 +1641,11 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi, void *cb_data)
 	(void)cb_data;
 
 	devc = sdi->priv;
+
+	/* Drop DRAM lines still on their way, when aborting a download. */
+	if (devc->state.state == SIGMA_DOWNLOAD)
+		ftdi_usb_purge_buffers(&devc->ftdic);
+	download_free(devc);
 	devc->state.state = SIGMA_IDLE;
 
 	sr_session_source_remove(sdi->session, 0);
@@ -76,6 +76,12 @@ enum sigma_read_register {
 
 #define CHUNK_SIZE		1024
 
+/* DRAM lines read from the Sigma in one go, at most 32. */
+#define DRAM_LINES_PER_READ	32
+
+/* Decoded samples collected before they're sent. */
+#define SAMPLE_BUFSIZE		4096
+
 /*
  * The entire ASIX Sigma DRAM is an array of struct sigma_dram_line[1024];
  */
@@ -188,6 +194,14 @@ struct sigma_state {
 
 	uint16_t lastts;
 	uint16_t lastsample;
+
+	/* Download progress, in DRAM lines. */
+	uint32_t stoppos;
+	uint32_t lines_total;
+	uint32_t lines_done;
+	uint32_t lines_requested;
+	uint32_t trg_line;
+	uint32_t trg_event;
 };
 
 /* Private, per-device-instance driver context. */
@@ -206,6 +220,15 @@ struct dev_context {
 	int use_triggers;
 	struct sigma_state state;
 	void *cb_data;
+	/* Download buffers, only allocated while downloading. */
+	struct sigma_dram_line *dram_lines;
+	/* Decoded samples waiting to be sent, with room for one more. */
+	uint8_t *samples;
+	unsigned int num_samples;
+	/* Repeats of pad_value, sent to fill timestamp gaps. */
+	uint8_t *pad;
+	uint32_t pad_len;
+	uint16_t pad_value;
 };
 
 #endif
@@ -459,6 +459,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 		sr_err("Invalid divcount/samplerate.");
 		return SR_ERR;
 	}
+	cv_init_demangle(devc);
 
 	if (cv_convert_trigger(sdi) != SR_OK) {
 		sr_err("Failed to configure trigger.");
@@ -342,6 +342,30 @@ SR_PRIV int cv_set_samplerate(const struct sr_dev_inst *sdi, uint64_t samplerate
 	return SR_OK;
 }
 
+/**
+ * Precompute where each byte of a block ends up in final_buf, relative to
+ * the start of the block's destination area. Done once per acquisition,
+ * since the layout only depends on the model and on whether divcount is 0.
+ *
+ * @param devc The struct containing private per-device-instance data. Must not
+ *             be NULL.
+ */
+SR_PRIV void cv_init_demangle(struct dev_context *devc)
+{
+	int i, p, q;
+
+	for (i = 0; i < BS; i++) {
+		p = i & (1 << 0);
+		if (devc->prof->model == CHRONOVU_LA8) {
+			devc->demangle_map[i] = (i / 2) * 16;
+			devc->demangle_map[i] += (devc->divcount == 0) ? p : (1 - p);
+		} else {
+			q = i & (1 << 1);
+			devc->demangle_map[i] = (i / 4) * 32 + q + (1 - p);
+		}
+	}
+}
+
 /**
  * Get a block of data from the device.
  *
@@ -352,7 +376,8 @@ SR_PRIV int cv_set_samplerate(const struct sr_dev_inst *sdi, uint64_t samplerate
  */
 SR_PRIV int cv_read_block(struct dev_context *devc)
 {
-	int i, byte_offset, m, mi, p, q, index, bytes_read;
+	int i, byte_offset, m, mi, bytes_read;
+	uint8_t *dst;
 	gint64 now;
 
 	/* Note: Caller checked that devc and devc->ftdic != NULL. */
@@ -383,27 +408,53 @@ SR_PRIV int cv_read_block(struct dev_context *devc)
 	byte_offset = devc->block_counter * BS;
 	m = byte_offset / (1024 * 1024);
 	mi = m * (1024 * 1024);
-	for (i = 0; i < BS; i++) {
-		if (devc->prof->model == CHRONOVU_LA8) {
-			p = i & (1 << 0);
-			index = m * 2 + (((byte_offset + i) - mi) / 2) * 16;
-			index += (devc->divcount == 0) ? p : (1 - p);
-		} else {
-			p = i & (1 << 0);
-			q = i & (1 << 1);
-			index = m * 4 + (((byte_offset + i) - mi) / 4) * 32;
-			index += q + (1 - p);
+	if (devc->prof->model == CHRONOVU_LA8)
+		dst = devc->final_buf + m * 2 + ((byte_offset - mi) / 2) * 16;
+	else
+		dst = devc->final_buf + m * 4 + ((byte_offset - mi) / 4) * 32;
+	for (i = 0; i < BS; i++)
+		dst[devc->demangle_map[i]] = devc->mangled_buf[i];
+
+	return SR_OK;
+}
+
+/*
+ * Find the first byte of buf for which (byte & mask) == expected, or -1.
+ * Eight bytes are checked at once; a word containing a match is then
+ * searched byte by byte.
+ */
+static int find_trigger(const uint8_t *buf, int len, uint8_t mask,
+			uint8_t expected)
+{
+	const uint64_t ones = 0x0101010101010101ULL;
+	uint64_t w, mask64, expected64;
+	int i, j;
+
+	mask64 = mask * ones;
+	expected64 = expected * ones;
+	for (i = 0; i + 8 <= len; i += 8) {
+		memcpy(&w, buf + i, sizeof(w));
+		w = (w & mask64) ^ expected64;
+		/* Non-zero iff one of the bytes of w is zero. */
+		if (((w - ones) & ~w & (ones << 7)) == 0)
+			continue;
+		for (j = i; j < i + 8; j++) {
+			if ((buf[j] & mask) == expected)
+				return j;
 		}
-		devc->final_buf[index] = devc->mangled_buf[i];
+	}
+	for (; i < len; i++) {
+		if ((buf[i] & mask) == expected)
+			return i;
 	}
 
-	return SR_OK;
+	return -1;
 }
 
 SR_PRIV void cv_send_block_to_session_bus(struct dev_context *devc, int block)
 {
 	int i, idx;
-	uint8_t sample, expected_sample, tmp8;
+	uint8_t expected_sample, tmp8;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
 	int trigger_point; /* Relative trigger point (in this block). */
@@ -415,26 +466,18 @@ SR_PRIV void cv_send_block_to_session_bus(struct dev_context *devc, int block)
 	/* Check if we can find the trigger condition in this block. */
 	trigger_point = -1;
 	expected_sample = devc->trigger_pattern & devc->trigger_mask;
-	for (i = 0; i < BS; i++) {
-		/* Don't continue if the trigger was found previously. */
-		if (devc->trigger_found)
-			break;
-
-		/*
-		 * Also, don't continue if triggers are "don't care", i.e. if
-		 * no trigger conditions were specified by the user. In that
-		 * case we don't want to send an SR_DF_TRIGGER packet at all.
-		 */
-		if (devc->trigger_mask == 0x0000)
-			break;
-
-		sample = *(devc->final_buf + (block * BS) + i);
-
-		if ((sample & devc->trigger_mask) == expected_sample) {
-			trigger_point = i;
+
+	/*
+	 * Don't search if the trigger was found previously, or if triggers
+	 * are "don't care", i.e. if no trigger conditions were specified by
+	 * the user. In that case we don't want to send an SR_DF_TRIGGER
+	 * packet at all.
+	 */
+	if (!devc->trigger_found && devc->trigger_mask != 0x0000) {
+		trigger_point = find_trigger(devc->final_buf + (block * BS), BS,
+				devc->trigger_mask & 0xff, expected_sample);
+		if (trigger_point >= 0)
 			devc->trigger_found = 1;
-			break;
-		}
 	}
 
 	/* Swap low and high bytes of the 16-bit LA16 samples. */
@@ -76,6 +76,12 @@ struct dev_context {
 	 */
 	uint8_t mangled_buf[BS];
 
+	/**
+	 * Destination offset of every byte of mangled_buf, relative to the
+	 * start of the block within final_buf. See cv_init_demangle().
+	 */
+	uint16_t demangle_map[BS];
+
 	/**
 	 * An 8MB buffer where we'll store the de-mangled samples.
 	 * LA8: Each sample is 1 byte, MSB is channel 7, LSB is channel 0.
@@ -135,6 +141,7 @@ SR_PRIV uint8_t cv_samplerate_to_divcount(const struct sr_dev_inst *sdi,
 SR_PRIV int cv_write(struct dev_context *devc, uint8_t *buf, int size);
 SR_PRIV int cv_convert_trigger(const struct sr_dev_inst *sdi);
 SR_PRIV int cv_set_samplerate(const struct sr_dev_inst *sdi, uint64_t samplerate);
+SR_PRIV void cv_init_demangle(struct dev_context *devc);
 SR_PRIV int cv_read_block(struct dev_context *devc);
 SR_PRIV void cv_send_block_to_session_bus(struct dev_context *devc, int block);
 
@@ -37,10 +37,13 @@
 #define DEFAULT_NUM_LOGIC_CHANNELS     8
 #define DEFAULT_NUM_ANALOG_CHANNELS    4
 
-/* The size in bytes of chunks to send through the session bus. */
-#define LOGIC_BUFSIZE        4096
-/* Size of the analog pattern space per channel. */
-#define ANALOG_BUFSIZE       4096
+/* Number of samples per packet sent through the session bus. */
+#define DEFAULT_BUFFERSIZE   4096
+#define MAX_BUFFERSIZE       (4 * 1024 * 1024)
+/* Packets per channel type sent per callback without real-time pacing. */
+#define MAX_RATE_PACKETS     16
+/* Every logic pattern except "random" repeats after this many samples. */
+#define LOGIC_PATTERN_PERIOD 256
 
 #define DEFAULT_ANALOG_AMPLITUDE 25
 #define ANALOG_SAMPLES_PER_PERIOD 20
@@ -100,9 +103,8 @@ static const char *analog_pattern_str[] = {
 struct analog_gen {
 	int pattern;
 	float amplitude;
-	float pattern_data[ANALOG_BUFSIZE];
-	unsigned int num_samples;
-	struct sr_datafeed_analog packet;
+	/* One period of the pattern. */
+	float pattern_data[ANALOG_SAMPLES_PER_PERIOD];
 };
 
 /* Private, per-device-instance driver context. */
@@ -116,16 +118,32 @@ struct dev_context {
 	uint64_t logic_counter;
 	uint64_t analog_counter;
 	int64_t starttime;
-	uint64_t step;
+	/* Samples per packet. */
+	uint64_t buffersize;
+	/* Pace the data to the samplerate, or send it as fast as possible. */
+	gboolean realtime;
 	/* Logic */
 	int32_t num_logic_channels;
 	unsigned int logic_unitsize;
 	/* There is only ever one logic channel group, so its pattern goes here. */
 	uint8_t logic_pattern;
-	unsigned char logic_data[LOGIC_BUFSIZE];
+	/*
+	 * The pattern from sample 0, long enough that every packet is a slice
+	 * of it. Only buffersize samples, refilled for every packet, for
+	 * the random pattern.
+	 */
+	uint8_t *logic_data;
+	uint64_t prng_state;
 	/* Analog */
 	int32_t num_analog_channels;
 	GHashTable *ch_ag;
+	/*
+	 * All enabled analog channels go out in one packet, interleaved like
+	 * logic_data is laid out.
+	 */
+	GSList *analog_channels;
+	unsigned int num_analog_enabled;
+	float *analog_data;
 };
 
 static const uint32_t drvopts[] = {
@@ -144,6 +162,8 @@ static const uint32_t devopts[] = {
 	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
+	SR_CONF_BUFFERSIZE | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_REALTIME | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t devopts_cg_logic[] = {
@@ -183,79 +203,39 @@ static int init(struct sr_context *sr_ctx)
 	return std_init(sr_ctx, di, LOG_PREFIX);
 }
 
-static void generate_analog_pattern(struct analog_gen *ag, uint64_t sample_rate)
+/*
+ * All patterns have a period of ANALOG_SAMPLES_PER_PERIOD samples (the
+ * square wave has half that), at any samplerate.
+ */
+static void generate_analog_pattern(struct analog_gen *ag)
 {
-	double t, frequency;
+	double phase;
 	float value;
-	unsigned int num_samples, i;
-	int last_end;
+	unsigned int i;
 
 	sr_dbg("Generating %s pattern.", analog_pattern_str[ag->pattern]);
 
-	num_samples = ANALOG_BUFSIZE / sizeof(float);
-
-	switch (ag->pattern) {
-	case PATTERN_SQUARE:
-		value = ag->amplitude;
-		last_end = 0;
-		for (i = 0; i < num_samples; i++) {
+	value = ag->amplitude;
+	for (i = 0; i < ANALOG_SAMPLES_PER_PERIOD; i++) {
+		phase = (double)i / ANALOG_SAMPLES_PER_PERIOD;
+		switch (ag->pattern) {
+		case PATTERN_SQUARE:
 			if (i % 5 == 0)
 				value = -value;
-			if (i % 10 == 0)
-				last_end = i;
 			ag->pattern_data[i] = value;
-		}
-		ag->num_samples = last_end;
-		break;
-
-	case PATTERN_SINE:
-		frequency = (double) sample_rate / ANALOG_SAMPLES_PER_PERIOD;
-
-		/* Make sure the number of samples we put out is an integer
-		 * multiple of our period size */
-		/* FIXME we actually need only one period. A ringbuffer would be
-		 * usefull here.*/
-		while (num_samples % ANALOG_SAMPLES_PER_PERIOD != 0)
-			num_samples--;
-
-		for (i = 0; i < num_samples; i++) {
-			t = (double) i / (double) sample_rate;
-			ag->pattern_data[i] = ag->amplitude *
-						sin(2 * M_PI * frequency * t);
-		}
-
-		ag->num_samples = num_samples;
-		break;
-
-	case PATTERN_TRIANGLE:
-		frequency = (double) sample_rate / ANALOG_SAMPLES_PER_PERIOD;
-
-		while (num_samples % ANALOG_SAMPLES_PER_PERIOD != 0)
-			num_samples--;
-
-		for (i = 0; i < num_samples; i++) {
-			t = (double) i / (double) sample_rate;
+			break;
+		case PATTERN_SINE:
+			ag->pattern_data[i] = ag->amplitude * sin(2 * M_PI * phase);
+			break;
+		case PATTERN_TRIANGLE:
 			ag->pattern_data[i] = (2 * ag->amplitude / M_PI) *
-						asin(sin(2 * M_PI * frequency * t));
-		}
-
-		ag->num_samples = num_samples;
-		break;
-
-	case PATTERN_SAWTOOTH:
-		frequency = (double) sample_rate / ANALOG_SAMPLES_PER_PERIOD;
-
-		while (num_samples % ANALOG_SAMPLES_PER_PERIOD != 0)
-			num_samples--;
-
-		for (i = 0; i < num_samples; i++) {
-			t = (double) i / (double) sample_rate;
+					asin(sin(2 * M_PI * phase));
+			break;
+		case PATTERN_SAWTOOTH:
 			ag->pattern_data[i] = 2 * ag->amplitude *
-						((t * frequency) - floor(0.5f + t * frequency));
+					(phase - floor(0.5f + phase));
+			break;
 		}
-
-		ag->num_samples = num_samples;
-		break;
 	}
 }
 
@@ -295,11 +275,13 @@ static GSList *scan(GSList *options)
 	sdi->model = g_strdup("Demo device");
 	sdi->driver = di;
 
-	devc = g_malloc(sizeof(struct dev_context));
+	devc = g_malloc0(sizeof(struct dev_context));
 	devc->cur_samplerate = SR_KHZ(200);
 	devc->limit_samples = 0;
 	devc->limit_msec = 0;
-	devc->step = 0;
+	devc->buffersize = DEFAULT_BUFFERSIZE;
+	devc->realtime = TRUE;
+	devc->prng_state = 0x9e3779b97f4a7c15ULL;
 	devc->continuous = FALSE;
 	devc->num_logic_channels = num_logic_channels;
 	devc->logic_unitsize = (devc->num_logic_channels + 7) / 8;
@@ -341,11 +323,6 @@ static GSList *scan(GSList *options)
 		/* Every channel gets a generator struct. */
 		ag = g_malloc(sizeof(struct analog_gen));
 		ag->amplitude = DEFAULT_ANALOG_AMPLITUDE;
-		ag->packet.channels = cg->channels;
-		ag->packet.mq = 0;
-		ag->packet.mqflags = 0;
-		ag->packet.unit = SR_UNIT_VOLT;
-		ag->packet.data = ag->pattern_data;
 		ag->pattern = pattern;
 		g_hash_table_insert(devc->ch_ag, ch, ag);
 
@@ -422,6 +399,12 @@ static int config_get(uint32_t key, GVariant **data, const struct sr_dev_inst *s
 	case SR_CONF_LIMIT_MSEC:
 		*data = g_variant_new_uint64(devc->limit_msec);
 		break;
+	case SR_CONF_BUFFERSIZE:
+		*data = g_variant_new_uint64(devc->buffersize);
+		break;
+	case SR_CONF_REALTIME:
+		*data = g_variant_new_boolean(devc->realtime);
+		break;
 	case SR_CONF_PATTERN_MODE:
 		if (!cg)
 			return SR_ERR_CHANNEL_GROUP;
@@ -463,6 +446,7 @@ static int config_set(uint32_t key, GVariant *data, const struct sr_dev_inst *sd
 	GSList *l;
 	int logic_pattern, analog_pattern, ret;
 	unsigned int i;
+	uint64_t buffersize;
 	const char *stropt;
 
 	devc = sdi->priv;
@@ -486,6 +470,17 @@ static int config_set(uint32_t key, GVariant *data, const struct sr_dev_inst *sd
 		devc->limit_samples = 0;
 		sr_dbg("Setting time limit to %" PRIu64"ms", devc->limit_msec);
 		break;
+	case SR_CONF_BUFFERSIZE:
+		buffersize = g_variant_get_uint64(data);
+		if (buffersize == 0 || buffersize > MAX_BUFFERSIZE)
+			return SR_ERR_ARG;
+		devc->buffersize = buffersize;
+		sr_dbg("Setting buffer size to %" PRIu64 " samples", buffersize);
+		break;
+	case SR_CONF_REALTIME:
+		devc->realtime = g_variant_get_boolean(data);
+		sr_dbg("Setting real-time pacing %s", devc->realtime ? "on" : "off");
+		break;
 	case SR_CONF_PATTERN_MODE:
 		if (!cg)
 			return SR_ERR_CHANNEL_GROUP;
@@ -513,11 +508,6 @@ static int config_set(uint32_t key, GVariant *data, const struct sr_dev_inst *sd
 				sr_dbg("Setting logic pattern to %s",
 						logic_pattern_str[logic_pattern]);
 				devc->logic_pattern = logic_pattern;
-				/* Might as well do this now, these are static. */
-				if (logic_pattern == PATTERN_ALL_LOW)
-					memset(devc->logic_data, 0x00, LOGIC_BUFSIZE);
-				else if (logic_pattern == PATTERN_ALL_HIGH)
-					memset(devc->logic_data, 0xff, LOGIC_BUFSIZE);
 			} else if (ch->type == SR_CHANNEL_ANALOG) {
 				if (analog_pattern == -1)
 					return SR_ERR_ARG;
@@ -621,45 +611,118 @@ static int config_list(uint32_t key, GVariant **data, const struct sr_dev_inst *
 	return SR_OK;
 }
 
-static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
+/*
+ * Fill the logic pattern buffer. All patterns but "random" are generated
+ * once, with enough samples after a full period that any packet can be
+ * sent straight out of the buffer.
+ */
+static int logic_generator_init(struct dev_context *devc)
 {
-	struct dev_context *devc;
-	uint64_t i, j;
-	uint8_t pat;
-
-	devc = sdi->priv;
+	uint64_t num_samples, s;
+	unsigned int unitsize, j;
+	uint8_t *p;
+
+	unitsize = devc->logic_unitsize;
+	num_samples = devc->buffersize;
+	if (devc->logic_pattern != PATTERN_RANDOM)
+		num_samples += LOGIC_PATTERN_PERIOD;
+	if (!(devc->logic_data = g_try_malloc(num_samples * unitsize))) {
+		sr_err("Logic buffer malloc failed.");
+		return SR_ERR_MALLOC;
+	}
 
+	p = devc->logic_data;
 	switch (devc->logic_pattern) {
 	case PATTERN_SIGROK:
-		memset(devc->logic_data, 0x00, size);
-		for (i = 0; i < size; i += devc->logic_unitsize) {
-			for (j = 0; j < devc->logic_unitsize; j++) {
-				pat = pattern_sigrok[(devc->step + j) % sizeof(pattern_sigrok)] >> 1;
-				devc->logic_data[i + j] = ~pat;
-			}
-			devc->step++;
+		for (s = 0; s < num_samples; s++) {
+			for (j = 0; j < unitsize; j++)
+				*p++ = ~(pattern_sigrok[(s + j) % sizeof(pattern_sigrok)] >> 1);
 		}
 		break;
-	case PATTERN_RANDOM:
-		for (i = 0; i < size; i++)
-			devc->logic_data[i] = (uint8_t)(rand() & 0xff);
-		break;
 	case PATTERN_INC:
-		for (i = 0; i < size; i++) {
-			for (j = 0; j < devc->logic_unitsize; j++) {
-				devc->logic_data[i + j] = devc->step;
-			}
-			devc->step++;
-		}
+		for (s = 0; s < num_samples; s++, p += unitsize)
+			memset(p, s & 0xff, unitsize);
 		break;
 	case PATTERN_ALL_LOW:
+		memset(p, 0x00, num_samples * unitsize);
+		break;
 	case PATTERN_ALL_HIGH:
-		/* These were set when the pattern mode was selected. */
+		memset(p, 0xff, num_samples * unitsize);
+		break;
+	case PATTERN_RANDOM:
+		/* Filled for every packet. */
 		break;
 	default:
 		sr_err("Unknown pattern: %d.", devc->logic_pattern);
-		break;
+		return SR_ERR_BUG;
+	}
+
+	return SR_OK;
+}
+
+/* xorshift64*, 8 bytes of random data per step. */
+static void logic_fill_random(struct dev_context *devc, uint64_t length)
+{
+	uint64_t x, r, i;
+
+	x = devc->prng_state;
+	for (i = 0; i < length; i += sizeof(r)) {
+		x ^= x >> 12;
+		x ^= x << 25;
+		x ^= x >> 27;
+		r = x * 0x2545f4914f6cdd1dULL;
+		memcpy(devc->logic_data + i, &r, MIN(sizeof(r), length - i));
+	}
+	devc->prng_state = x;
+}
+
+/*
+ * Interleave the patterns of all enabled analog channels, with a period
+ * to spare after the first buffersize samples, like the logic patterns.
+ */
+static int analog_generator_init(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	const struct sr_channel_table *table;
+	struct analog_gen *ag;
+	uint64_t num_samples, i;
+	unsigned int num_channels, c;
+
+	devc = sdi->priv;
+	table = sr_dev_inst_channel_table_get(sdi);
+	num_channels = table->num_analog;
+	devc->num_analog_enabled = num_channels;
+	if (num_channels == 0)
+		return SR_OK;
+
+	num_samples = devc->buffersize + ANALOG_SAMPLES_PER_PERIOD;
+	devc->analog_data = g_try_malloc(num_samples * num_channels * sizeof(float));
+	if (!devc->analog_data) {
+		sr_err("Analog buffer malloc failed.");
+		return SR_ERR_MALLOC;
 	}
+
+	for (c = 0; c < num_channels; c++) {
+		ag = g_hash_table_lookup(devc->ch_ag, table->analog[c]);
+		generate_analog_pattern(ag);
+		for (i = 0; i < num_samples; i++)
+			devc->analog_data[i * num_channels + c] =
+					ag->pattern_data[i % ANALOG_SAMPLES_PER_PERIOD];
+		devc->analog_channels = g_slist_append(devc->analog_channels,
+				table->analog[c]);
+	}
+
+	return SR_OK;
+}
+
+static void generators_free(struct dev_context *devc)
+{
+	g_free(devc->logic_data);
+	devc->logic_data = NULL;
+	g_free(devc->analog_data);
+	devc->analog_data = NULL;
+	g_slist_free(devc->analog_channels);
+	devc->analog_channels = NULL;
 }
 
 /* Callback handling data */
@@ -669,11 +732,8 @@ static int prepare_data(int fd, int revents, void *cb_data)
 	struct dev_context *devc;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
-	struct analog_gen *ag;
-	int ag_pattern_pos;
-	GHashTableIter iter;
-	void *value;
-	uint64_t logic_todo, analog_todo, expected_samplenum, analog_sent, sending_now;
+	struct sr_datafeed_analog analog;
+	uint64_t logic_todo, analog_todo, expected_samplenum, sending_now;
 	int64_t time, elapsed;
 
 	(void)fd;
@@ -683,10 +743,16 @@ static int prepare_data(int fd, int revents, void *cb_data)
 	devc = sdi->priv;
 	logic_todo = analog_todo = 0;
 
-	/* How many samples should we have sent by now? */
-	time = g_get_monotonic_time();
-	elapsed = time - devc->starttime;
-	expected_samplenum = elapsed * devc->cur_samplerate / 1000000;
+	if (devc->realtime) {
+		/* How many samples should we have sent by now? */
+		time = g_get_monotonic_time();
+		elapsed = time - devc->starttime;
+		expected_samplenum = elapsed * devc->cur_samplerate / 1000000;
+	} else {
+		/* As many as the session takes, a bit at a time. */
+		expected_samplenum = MAX(devc->logic_counter, devc->analog_counter)
+				+ MAX_RATE_PACKETS * devc->buffersize;
+	}
 
 	/* But never more than the limit, if there is one. */
 	if (!devc->continuous)
@@ -695,50 +761,51 @@ static int prepare_data(int fd, int revents, void *cb_data)
 	/* Of those, how many do we still have to send? */
 	if (devc->num_logic_channels)
 		logic_todo = expected_samplenum - devc->logic_counter;
-	if (devc->num_analog_channels)
+	if (devc->num_analog_enabled)
 		analog_todo = expected_samplenum - devc->analog_counter;
 
+	logic.unitsize = devc->logic_unitsize;
+	analog.channels = devc->analog_channels;
+	analog.mq = 0;
+	analog.mqflags = 0;
+	analog.unit = SR_UNIT_VOLT;
+
 	while (logic_todo || analog_todo) {
 		/* Logic */
 		if (logic_todo > 0) {
-			sending_now = MIN(logic_todo, LOGIC_BUFSIZE / devc->logic_unitsize);
-			logic_generator(sdi, sending_now * devc->logic_unitsize);
+			sending_now = MIN(logic_todo, devc->buffersize);
+			logic.length = sending_now * devc->logic_unitsize;
+			if (devc->logic_pattern == PATTERN_RANDOM) {
+				logic_fill_random(devc, logic.length);
+				logic.data = devc->logic_data;
+			} else {
+				logic.data = devc->logic_data + devc->logic_unitsize
+						* (devc->logic_counter % LOGIC_PATTERN_PERIOD);
+			}
 			packet.type = SR_DF_LOGIC;
 			packet.payload = &logic;
-			logic.length = sending_now * devc->logic_unitsize;
-			logic.unitsize = devc->logic_unitsize;
-			logic.data = devc->logic_data;
 			sr_session_send(sdi, &packet);
 			logic_todo -= sending_now;
 			devc->logic_counter += sending_now;
 		}
 
-		/* Analog, one channel at a time */
+		/* Analog, all channels at once */
 		if (analog_todo > 0) {
-			analog_sent = 0;
-
-			g_hash_table_iter_init(&iter, devc->ch_ag);
-			while (g_hash_table_iter_next(&iter, NULL, &value)) {
-				ag = value;
-				packet.type = SR_DF_ANALOG;
-				packet.payload = &ag->packet;
-				ag_pattern_pos = devc->analog_counter % ag->num_samples;
-				sending_now = MIN(analog_todo, ag->num_samples-ag_pattern_pos);
-				ag->packet.data = ag->pattern_data + ag_pattern_pos;
-				ag->packet.num_samples = sending_now;
-				sr_session_send(sdi, &packet);
-
-				/* Whichever channel group gets there first. */
-				analog_sent = MAX(analog_sent, sending_now);
-			}
-			analog_todo -= analog_sent;
-			devc->analog_counter += analog_sent;
+			sending_now = MIN(analog_todo, devc->buffersize);
+			analog.num_samples = sending_now;
+			analog.data = devc->analog_data + devc->num_analog_enabled
+					* (devc->analog_counter % ANALOG_SAMPLES_PER_PERIOD);
+			packet.type = SR_DF_ANALOG;
+			packet.payload = &analog;
+			sr_session_send(sdi, &packet);
+			analog_todo -= sending_now;
+			devc->analog_counter += sending_now;
 		}
 	}
 
 	if (!devc->continuous
 			&& (!devc->num_logic_channels || devc->logic_counter >= devc->limit_samples)
-			&& (!devc->num_analog_channels || devc->analog_counter >= devc->limit_samples)) {
+			&& (!devc->num_analog_enabled || devc->analog_counter >= devc->limit_samples)) {
 		sr_dbg("Requested number of samples reached.");
 		dev_acquisition_stop(sdi, cb_data);
 		return TRUE;
@@ -750,8 +817,7 @@ static int prepare_data(int fd, int revents, void *cb_data)
 static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 {
 	struct dev_context *devc;
-	GHashTableIter iter;
-	void *value;
+	int ret;
 
 	(void)cb_data;
 
@@ -762,6 +828,12 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 	devc->continuous = !devc->limit_samples;
 	devc->logic_counter = devc->analog_counter = 0;
 
+	if ((ret = logic_generator_init(devc)) != SR_OK
+			|| (ret = analog_generator_init(sdi)) != SR_OK) {
+		generators_free(devc);
+		return ret;
+	}
+
 	/*
 	 * Setting two channels connected by a pipe is a remnant from when the
 	 * demo driver generated data in a thread, and collected and sent the
@@ -771,12 +843,16 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 	 */
 	if (pipe(devc->pipe_fds)) {
 		sr_err("%s: pipe() failed", __func__);
+		generators_free(devc);
 		return SR_ERR;
 	}
 
-	g_hash_table_iter_init(&iter, devc->ch_ag);
-	while (g_hash_table_iter_next(&iter, NULL, &value))
-		generate_analog_pattern(value, devc->cur_samplerate);
+	/*
+	 * Without real-time pacing, keep the pipe readable so the session
+	 * calls back right away instead of after the timeout.
+	 */
+	if (!devc->realtime && write(devc->pipe_fds[1], "", 1) != 1)
+		sr_warn("Failed to write to pipe, falling back to polling.");
 
 	devc->channel = g_io_channel_unix_new(devc->pipe_fds[0]);
 	g_io_channel_set_flags(devc->channel, G_IO_FLAG_NONBLOCK, NULL);
@@ -813,11 +889,14 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi, void *cb_data)
 	g_io_channel_shutdown(devc->channel, FALSE, NULL);
 	g_io_channel_unref(devc->channel);
 	devc->channel = NULL;
+	close(devc->pipe_fds[1]);
 
 	/* Send last packet. */
 	packet.type = SR_DF_END;
 	sr_session_send(sdi, &packet);
 
+	generators_free(devc);
+
 	return SR_OK;
 }
 
@@ -833,6 +912,7 @@ SR_PRIV struct sr_dev_driver demo_driver_info = {
 	.config_get = config_get,
 	.config_set = config_set,
 	.config_list = config_list,
+	.config_cache = TRUE,
 	.dev_open = dev_open,
 	.dev_close = dev_close,
 	.dev_acquisition_start = dev_acquisition_start,
@@ -641,6 +641,7 @@ SR_PRIV struct sr_dev_driver fx2lafw_driver_info = {
 	.config_get = config_get,
 	.config_set = config_set,
 	.config_list = config_list,
+	.config_cache = TRUE,
 	.dev_open = dev_open,
 	.dev_close = dev_close,
 	.dev_acquisition_start = dev_acquisition_start,
@@ -404,7 +404,7 @@ SR_PRIV void fx2lafw_receive_transfer(struct libusb_transfer *transfer)
 		return;
 	}
 
-	sr_info("receive_transfer(): status %d received %d bytes.",
+	sr_spew("receive_transfer(): status %d received %d bytes.",
 		transfer->status, transfer->actual_length);
 
 	/* Save incoming transfer before reusing the transfer struct. */
@@ -426,6 +426,7 @@ SR_PRIV void fx2lafw_receive_transfer(struct libusb_transfer *transfer)
 
 	if (transfer->actual_length == 0 || packet_has_error) {
 		devc->empty_transfer_count++;
+		sr_session_stats_add(sdi, SR_STATS_EMPTY_TRANSFERS, 1);
 		if (devc->empty_transfer_count > MAX_EMPTY_TRANSFERS) {
 			/*
 			 * The FX2 gave up. End the acquisition, the frontend
@@ -136,6 +136,7 @@ static void clear_helper(void *priv)
 
 	g_free(devc->analog_groups);
 	g_free(devc->digital_groups);
+	g_free(devc->samples);
 
 	g_free(devc);
 }
@@ -574,6 +575,7 @@ SR_PRIV int hmo_request_data(const struct sr_dev_inst *sdi)
 	struct sr_channel *ch;
 	struct dev_context *devc;
 	struct scope_config *model;
+	const char *format;
 
 	devc = sdi->priv;
 	model = devc->model_config;
@@ -582,18 +584,29 @@ SR_PRIV int hmo_request_data(const struct sr_dev_inst *sdi)
 
 	switch (ch->type) {
 	case SR_CHANNEL_ANALOG:
+		format = "REAL,32";
 		g_snprintf(command, sizeof(command),
 			   (*model->scpi_dialect)[SCPI_CMD_GET_ANALOG_DATA],
 			   ch->index + 1);
 		break;
 	case SR_CHANNEL_LOGIC:
+		format = "UINT,8";
 		g_snprintf(command, sizeof(command),
 			   (*model->scpi_dialect)[SCPI_CMD_GET_DIG_DATA],
 			   ch->index < 8 ? 1 : 2);
 		break;
 	default:
 		sr_err("Invalid channel type.");
-		break;
+		return SR_ERR;
+	}
+
+	/* Waveforms are transferred as binary blocks, not as text. */
+	if (format != devc->data_format) {
+		if (sr_scpi_send(sdi->conn,
+				(*model->scpi_dialect)[SCPI_CMD_SET_DATA_FORMAT],
+				format) != SR_OK)
+			return SR_ERR;
+		devc->data_format = format;
 	}
 
 	return sr_scpi_send(sdi->conn, command);
@@ -765,6 +778,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 	std_session_send_df_header(cb_data, LOG_PREFIX);
 
 	devc->current_channel = devc->enabled_channels;
+	devc->data_format = NULL;
 
 	return hmo_request_data(sdi);
 }
@@ -789,6 +803,9 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi, void *cb_data)
 	devc->num_frames = 0;
 	g_slist_free(devc->enabled_channels);
 	devc->enabled_channels = NULL;
+	g_free(devc->samples);
+	devc->samples = NULL;
+	devc->samples_size = 0;
 	scpi = sdi->conn;
 	sr_scpi_source_remove(sdi->session, scpi);
 
@@ -807,6 +824,7 @@ SR_PRIV struct sr_dev_driver hameg_hmo_driver_info = {
 	.config_get = config_get,
 	.config_set = config_set,
 	.config_list = config_list,
+	.config_cache = TRUE,
 	.dev_open = dev_open,
 	.dev_close = dev_close,
 	.dev_acquisition_start = dev_acquisition_start,
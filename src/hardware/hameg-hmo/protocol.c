@@ -43,6 +43,7 @@ static const char *hameg_scpi_dialect[] = {
 	[SCPI_CMD_SET_HORIZ_TRIGGERPOS]	    = ":TIM:POS %s",
 	[SCPI_CMD_GET_ANALOG_CHAN_STATE]    = ":CHAN%d:STAT?",
 	[SCPI_CMD_SET_ANALOG_CHAN_STATE]    = ":CHAN%d:STAT %d",
+	[SCPI_CMD_SET_DATA_FORMAT]	    = ":FORM %s;:FORM:BORD LSBF",
 };
 
 static const uint32_t hmo_devopts[] = {
@@ -660,15 +661,44 @@ SR_PRIV int hmo_init_device(struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
+/*
+ * Convert a block of little-endian REAL,32 samples to floats. Returns
+ * the number of samples, or -1 if the buffer couldn't be allocated.
+ */
+static int convert_samples(struct dev_context *devc, GByteArray *data)
+{
+	uint32_t u;
+	size_t i, num_samples;
+
+	num_samples = data->len / sizeof(float);
+	if (devc->samples_size < num_samples) {
+		g_free(devc->samples);
+		devc->samples_size = num_samples;
+		if (!(devc->samples = g_try_malloc(num_samples * sizeof(float)))) {
+			sr_err("Sample buffer malloc failed.");
+			devc->samples_size = 0;
+			return -1;
+		}
+	}
+
+	for (i = 0; i < num_samples; i++) {
+		u = RL32(data->data + i * sizeof(float));
+		memcpy(&devc->samples[i], &u, sizeof(float));
+	}
+
+	return num_samples;
+}
+
 SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 {
 	struct sr_channel *ch;
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 	struct sr_datafeed_packet packet;
-	GArray *data;
+	GByteArray *data;
 	struct sr_datafeed_analog analog;
 	struct sr_datafeed_logic logic;
+	int num_samples;
 
 	(void)fd;
 
@@ -683,10 +713,11 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 
 		switch (ch->type) {
 		case SR_CHANNEL_ANALOG:
-			if (sr_scpi_get_floatv(sdi->conn, NULL, &data) != SR_OK) {
-				if (data)
-					g_array_free(data, TRUE);
+			if (sr_scpi_get_block(sdi->conn, NULL, &data) != SR_OK)
+				return TRUE;
 
+			if ((num_samples = convert_samples(devc, data)) < 0) {
+				g_byte_array_free(data, TRUE);
 				return TRUE;
 			}
 
@@ -694,8 +725,8 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 			sr_session_send(sdi, &packet);
 
 			analog.channels = g_slist_append(NULL, ch);
-			analog.num_samples = data->len;
-			analog.data = (float *) data->data;
+			analog.num_samples = num_samples;
+			analog.data = devc->samples;
 			analog.mq = SR_MQ_VOLTAGE;
 			analog.unit = SR_UNIT_VOLT;
 			analog.mqflags = 0;
@@ -703,14 +734,11 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 			packet.payload = &analog;
 			sr_session_send(cb_data, &packet);
 			g_slist_free(analog.channels);
-			g_array_free(data, TRUE);
+			g_byte_array_free(data, TRUE);
 			break;
 		case SR_CHANNEL_LOGIC:
-			if (sr_scpi_get_uint8v(sdi->conn, NULL, &data) != SR_OK) {
-				if (data)
-					g_free(data);
+			if (sr_scpi_get_block(sdi->conn, NULL, &data) != SR_OK)
 				return TRUE;
-			}
 
 			packet.type = SR_DF_FRAME_BEGIN;
 			sr_session_send(sdi, &packet);
@@ -721,7 +749,7 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 			packet.type = SR_DF_LOGIC;
 			packet.payload = &logic;
 			sr_session_send(cb_data, &packet);
-			g_array_free(data, TRUE);
+			g_byte_array_free(data, TRUE);
 			break;
 		default:
 			sr_err("Invalid channel type.");
@@ -100,6 +100,12 @@ struct dev_context {
 	GSList *current_channel;
 	uint64_t num_frames;
 
+	/* Waveform data format last set on the device, or NULL. */
+	const char *data_format;
+	/* Analog samples converted from the binary waveform data. */
+	float *samples;
+	size_t samples_size;
+
 	uint64_t frame_limit;
 };
 
@@ -27,6 +27,7 @@
 #include <string.h>
 #include <sys/time.h>
 #include <inttypes.h>
+#include <math.h>
 #include <glib.h>
 #include <libusb.h>
 #include "libsigrok.h"
@@ -51,6 +52,8 @@ static const uint32_t drvopts[] = {
 static const uint32_t devopts[] = {
 	SR_CONF_CONTINUOUS | SR_CONF_SET,
 	SR_CONF_LIMIT_FRAMES | SR_CONF_SET,
+	SR_CONF_LIMIT_SAMPLES | SR_CONF_SET,
+	SR_CONF_LIMIT_MSEC | SR_CONF_SET,
 	SR_CONF_CONN | SR_CONF_GET,
 	SR_CONF_TIMEBASE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 	SR_CONF_BUFFERSIZE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
@@ -531,6 +534,15 @@ static int config_set(uint32_t key, GVariant *data, const struct sr_dev_inst *sd
 		case SR_CONF_LIMIT_FRAMES:
 			devc->limit_frames = g_variant_get_uint64(data);
 			break;
+		case SR_CONF_LIMIT_SAMPLES:
+			devc->limit_samples = g_variant_get_uint64(data);
+			break;
+		case SR_CONF_LIMIT_MSEC:
+			devc->limit_msec = g_variant_get_uint64(data);
+			break;
+		case SR_CONF_CONTINUOUS:
+			devc->streaming = g_variant_get_boolean(data);
+			break;
 		case SR_CONF_TRIGGER_SLOPE:
 			tmp_str = g_variant_get_string(data, NULL);
 			if (!tmp_str || !(tmp_str[0] == 'f' || tmp_str[0] == 'r'))
@@ -713,17 +725,30 @@ static int config_list(uint32_t key, GVariant **data, const struct sr_dev_inst *
 	return SR_OK;
 }
 
-static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
-		int num_samples)
+/*
+ * Send num_samples samples from buf. Samples marked in lost, or all of
+ * them if buf is NULL, didn't make it over USB and are sent as NaN, so
+ * the samples after them keep their place in time.
+ */
+static void send_chunk(struct sr_dev_inst *sdi, const unsigned char *buf,
+		const uint8_t *lost, int num_samples)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_analog analog;
 	struct dev_context *devc;
-	float ch1, ch2, range;
-	int num_channels, data_offset, i;
+	float ch1, ch2, range[2];
+	int data_offset, i;
 
 	devc = sdi->priv;
-	num_channels = (devc->ch1_enabled && devc->ch2_enabled) ? 2 : 1;
+	if (devc->limit_samples) {
+		if (devc->num_samples >= devc->limit_samples)
+			return;
+		num_samples = MIN((uint64_t)num_samples,
+				devc->limit_samples - devc->num_samples);
+	}
+	if (num_samples <= 0)
+		return;
+
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &analog;
 	/* TODO: support for 5xxx series 9-bit samples */
@@ -732,8 +757,11 @@ static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
 	analog.mq = SR_MQ_VOLTAGE;
 	analog.unit = SR_UNIT_VOLT;
 	analog.mqflags = 0;
-	/* TODO: Check malloc return value. */
-	analog.data = g_try_malloc(analog.num_samples * sizeof(float) * num_channels);
+	/* Chunks are never bigger than a frame, see dev_acquisition_start(). */
+	analog.data = devc->samplebuf;
+	for (i = 0; i < 2; i++)
+		range[i] = ((float)vdivs[devc->voltage[i]][0]
+				/ vdivs[devc->voltage[i]][1]) * 8;
 	data_offset = 0;
 	for (i = 0; i < analog.num_samples; i++) {
 		/*
@@ -749,49 +777,84 @@ static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
 		 * and 255 = +2V.
 		 */
 		/* TODO: Support for DSO-5xxx series 9-bit samples. */
+		if (!buf || (lost && lost[i])) {
+			if (devc->ch1_enabled)
+				analog.data[data_offset++] = NAN;
+			if (devc->ch2_enabled)
+				analog.data[data_offset++] = NAN;
+			continue;
+		}
 		if (devc->ch1_enabled) {
-			range = ((float)vdivs[devc->voltage[0]][0] / vdivs[devc->voltage[0]][1]) * 8;
-			ch1 = range / 255 * *(buf + i * 2 + 1);
+			ch1 = range[0] / 255 * *(buf + i * 2 + 1);
 			/* Value is centered around 0V. */
-			ch1 -= range / 2;
+			ch1 -= range[0] / 2;
 			analog.data[data_offset++] = ch1;
 		}
 		if (devc->ch2_enabled) {
-			range = ((float)vdivs[devc->voltage[1]][0] / vdivs[devc->voltage[1]][1]) * 8;
-			ch2 = range / 255 * *(buf + i * 2);
-			ch2 -= range / 2;
+			ch2 = range[1] / 255 * *(buf + i * 2);
+			ch2 -= range[1] / 2;
 			analog.data[data_offset++] = ch2;
 		}
 	}
 	sr_session_send(devc->cb_data, &packet);
+	devc->num_samples += num_samples;
+}
+
+static gboolean limits_reached(struct dev_context *devc)
+{
+	if (devc->limit_samples && devc->num_samples >= devc->limit_samples)
+		return TRUE;
+
+	if (devc->limit_msec && (uint64_t)(g_get_monotonic_time()
+			- devc->start_time) / 1000 >= devc->limit_msec)
+		return TRUE;
+
+	return FALSE;
 }
 
 /*
  * Called by libusb (as triggered by handle_event()) when a transfer comes in.
  * Only channel data comes in asynchronously, and all transfers for this are
  * queued up beforehand, so this just needs to chuck the incoming data onto
- * the libsigrok session bus.
+ * the libsigrok session bus. The transfers belong to the device context
+ * and are submitted again for the next frame.
  */
 static void receive_transfer(struct libusb_transfer *transfer)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
-	int num_samples, pre;
+	int num_samples, valid, pre, i;
 
 	sdi = transfer->user_data;
 	devc = sdi->priv;
 	sr_spew("receive_transfer(): status %d received %d bytes.",
 		   transfer->status, transfer->actual_length);
 
-	if (transfer->actual_length == 0)
-		/* Nothing to send to the bus. */
+	devc->transfers_busy--;
+	if (devc->dev_state != FETCH_DATA)
+		/* Cancelled, or left over from an aborted frame. */
 		return;
 
-	num_samples = transfer->actual_length / 2;
+	/*
+	 * Every transfer carries a fixed slice of the frame. One that
+	 * failed or came back short leaves a gap, which is reported and
+	 * filled with NaN; the rest of the frame keeps its place.
+	 */
+	num_samples = transfer->length / 2;
+	valid = 0;
+	if (transfer->status == LIBUSB_TRANSFER_COMPLETED)
+		valid = transfer->actual_length / 2;
+	if (valid < num_samples) {
+		devc->samp_lost += num_samples - valid;
+		sr_session_stats_add(sdi, SR_STATS_LOST_SAMPLES,
+				num_samples - valid);
+		sr_warn("Gap at sample %d of frame, lost %d samples.",
+			devc->samp_received + valid, num_samples - valid);
+	}
 
 	sr_spew("Got %d-%d/%d samples in frame.", devc->samp_received + 1,
-		   devc->samp_received + num_samples, devc->framesize);
+		   devc->samp_received + valid, devc->framesize);
 
 	/*
 	 * The device always sends a full frame, but the beginning of the frame
@@ -802,59 +865,50 @@ static void receive_transfer(struct libusb_transfer *transfer)
 	 * buffer was reached, and it wrapped around to overwrite up until the
 	 * trigger point.
 	 */
-	if (devc->samp_received < devc->trigger_offset) {
-		/* Trigger point not yet reached. */
-		if (devc->samp_received + num_samples < devc->trigger_offset) {
-			/* The entire chunk is before the trigger point. */
-			memcpy(devc->framebuf + devc->samp_buffered * 2,
-					transfer->buffer, num_samples * 2);
-			devc->samp_buffered += num_samples;
-		} else {
-			/*
-			 * This chunk hits or overruns the trigger point.
-			 * Store the part before the trigger fired, and
-			 * send the rest up to the session bus.
-			 */
-			pre = devc->trigger_offset - devc->samp_received;
-			memcpy(devc->framebuf + devc->samp_buffered * 2,
-					transfer->buffer, pre * 2);
-			devc->samp_buffered += pre;
-
-			/* The rest of this chunk starts with the trigger point. */
+	pre = 0;
+	if (devc->samp_received < devc->trigger_offset)
+		pre = MIN(num_samples,
+				(int)(devc->trigger_offset - devc->samp_received));
+	if (pre > 0) {
+		/* Store the part before the trigger fired, gaps included. */
+		memcpy(devc->framebuf + devc->samp_buffered * 2,
+				transfer->buffer, MIN(pre, valid) * 2);
+		for (i = 0; i < pre; i++)
+			devc->framelost[devc->samp_buffered + i] = i >= valid;
+		devc->samp_buffered += pre;
+	}
+	/* Avoid the corner case where the chunk ended at exactly the
+	 * trigger point. */
+	if (num_samples > pre) {
+		if (devc->samp_received + pre == devc->trigger_offset)
 			sr_dbg("Reached trigger point, %d samples buffered.",
 				   devc->samp_buffered);
-
-			/* Avoid the corner case where the chunk ended at
-			 * exactly the trigger point. */
-			if (num_samples > pre)
-				send_chunk(sdi, transfer->buffer + pre * 2,
-						num_samples - pre);
-		}
-	} else {
-		/* Already past the trigger point, just send it all out. */
-		send_chunk(sdi, transfer->buffer,
-				num_samples);
+		if (valid > pre)
+			send_chunk(sdi, transfer->buffer + pre * 2, NULL,
+					valid - pre);
+		send_chunk(sdi, NULL, NULL, num_samples - MAX(pre, valid));
 	}
 
 	devc->samp_received += num_samples;
 
-	/* Everything in this transfer was either copied to the buffer or
-	 * sent to the session bus. */
-	g_free(transfer->buffer);
-	libusb_free_transfer(transfer);
-
 	if (devc->samp_received >= devc->framesize) {
 		/* That was the last chunk in this frame. Send the buffered
 		 * pre-trigger samples out now, in one big chunk. */
 		sr_dbg("End of frame, sending %d pre-trigger buffered samples.",
 			   devc->samp_buffered);
-		send_chunk(sdi, devc->framebuf, devc->samp_buffered);
+		send_chunk(sdi, devc->framebuf, devc->framelost,
+				devc->samp_buffered);
 
-		/* Mark the end of this frame. */
+		/*
+		 * Mark the end of this frame. In streaming mode this also
+		 * marks the re-arm gap before the next one.
+		 */
 		packet.type = SR_DF_FRAME_END;
 		sr_session_send(devc->cb_data, &packet);
 
-		if (devc->limit_frames && ++devc->num_frames == devc->limit_frames) {
+		if (limits_reached(devc)
+				|| (devc->limit_frames
+				&& ++devc->num_frames == devc->limit_frames)) {
 			/* Terminate session */
 			devc->dev_state = STOPPING;
 		} else {
@@ -870,23 +924,46 @@ static int handle_event(int fd, int revents, void *cb_data)
 	struct timeval tv;
 	struct dev_context *devc;
 	struct drv_context *drvc = di->priv;
-	int num_channels;
 	uint32_t trigger_offset;
 	uint8_t capturestate;
+	int i;
 
 	(void)fd;
 	(void)revents;
 
 	sdi = cb_data;
 	devc = sdi->priv;
+
+	/* Always handle pending libusb events. */
+	tv.tv_sec = tv.tv_usec = 0;
+	libusb_handle_events_timeout(drvc->sr_ctx->libusb_ctx, &tv);
+
+	if (devc->dev_state != STOPPING && devc->dev_state != FETCH_DATA
+			&& limits_reached(devc))
+		devc->dev_state = STOPPING;
+
 	if (devc->dev_state == STOPPING) {
 		/* We've been told to wind up the acquisition. */
+		if (devc->transfers_busy) {
+			/* Cancel once, then wait for the transfers to come back. */
+			if (!devc->transfers_cancelled) {
+				for (i = 0; i < devc->num_transfers; i++)
+					libusb_cancel_transfer(devc->transfers[i]);
+				devc->transfers_cancelled = TRUE;
+			}
+			return TRUE;
+		}
 		sr_dbg("Stopping acquisition.");
-		/*
-		 * TODO: Doesn't really cancel pending transfers so they might
-		 * come in after SR_DF_END is sent.
-		 */
+		if (devc->samp_lost)
+			sr_warn("%" PRIu64 " samples lost in total.", devc->samp_lost);
 		usb_source_remove(sdi->session, drvc->sr_ctx);
+		dso_free_transfers(sdi);
+		g_free(devc->framebuf);
+		devc->framebuf = NULL;
+		g_free(devc->samplebuf);
+		devc->samplebuf = NULL;
+		g_free(devc->framelost);
+		devc->framelost = NULL;
 
 		packet.type = SR_DF_END;
 		sr_session_send(sdi, &packet);
@@ -896,18 +973,15 @@ static int handle_event(int fd, int revents, void *cb_data)
 		return TRUE;
 	}
 
-	/* Always handle pending libusb events. */
-	tv.tv_sec = tv.tv_usec = 0;
-	libusb_handle_events_timeout(drvc->sr_ctx->libusb_ctx, &tv);
-
 	/* TODO: ugh */
 	if (devc->dev_state == NEW_CAPTURE) {
 		if (dso_capture_start(sdi) != SR_OK)
 			return TRUE;
 		if (dso_enable_trigger(sdi) != SR_OK)
 			return TRUE;
-//		if (dso_force_trigger(sdi) != SR_OK)
-//			return TRUE;
+		/* Streaming doesn't wait for a trigger event. */
+		if (devc->streaming && dso_force_trigger(sdi) != SR_OK)
+			return TRUE;
 		sr_dbg("Successfully requested next chunk.");
 		devc->dev_state = CAPTURE;
 		return TRUE;
@@ -928,8 +1002,8 @@ static int handle_event(int fd, int revents, void *cb_data)
 				break;
 			if (dso_enable_trigger(sdi) != SR_OK)
 				break;
-//			if (dso_force_trigger(sdi) != SR_OK)
-//				break;
+			if (devc->streaming && dso_force_trigger(sdi) != SR_OK)
+				break;
 			sr_dbg("Successfully requested next chunk.");
 		}
 		break;
@@ -939,10 +1013,6 @@ static int handle_event(int fd, int revents, void *cb_data)
 	case CAPTURE_READY_8BIT:
 		/* Remember where in the captured frame the trigger is. */
 		devc->trigger_offset = trigger_offset;
-
-		num_channels = (devc->ch1_enabled && devc->ch2_enabled) ? 2 : 1;
-		/* TODO: Check malloc return value. */
-		devc->framebuf = g_try_malloc(devc->framesize * num_channels * 2);
 		devc->samp_buffered = devc->samp_received = 0;
 
 		/* Tell the scope to send us the first frame. */
@@ -993,9 +1063,37 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 	if (dso_init(sdi) != SR_OK)
 		return SR_ERR;
 
+	/*
+	 * Buffers for the pre-trigger part of a frame and which of its
+	 * samples were lost, and for the samples of one chunk converted
+	 * to floats. A chunk is never bigger than a frame.
+	 */
+	g_free(devc->framebuf);
+	g_free(devc->framelost);
+	g_free(devc->samplebuf);
+	devc->framebuf = g_try_malloc(devc->framesize * 2);
+	devc->framelost = g_try_malloc(devc->framesize);
+	devc->samplebuf = g_try_malloc(devc->framesize * 2 * sizeof(float));
+	if (!devc->framebuf || !devc->framelost || !devc->samplebuf) {
+		sr_err("Frame buffer malloc failed.");
+		g_free(devc->framebuf);
+		devc->framebuf = NULL;
+		g_free(devc->framelost);
+		devc->framelost = NULL;
+		g_free(devc->samplebuf);
+		devc->samplebuf = NULL;
+		return SR_ERR_MALLOC;
+	}
+
 	if (dso_capture_start(sdi) != SR_OK)
 		return SR_ERR;
+	if (devc->streaming && dso_force_trigger(sdi) != SR_OK)
+		return SR_ERR;
 
+	devc->num_frames = devc->num_samples = devc->samp_lost = 0;
+	devc->transfers_busy = 0;
+	devc->transfers_cancelled = FALSE;
+	devc->start_time = g_get_monotonic_time();
 	devc->dev_state = CAPTURE;
 	usb_source_add(sdi->session, drvc->sr_ctx, TICK, handle_event, (void *)sdi);
 
@@ -1032,6 +1130,7 @@ SR_PRIV struct sr_dev_driver hantek_dso_driver_info = {
 	.config_get = config_get,
 	.config_set = config_set,
 	.config_list = config_list,
+	.config_cache = TRUE,
 	.dev_open = dev_open,
 	.dev_close = dev_close,
 	.dev_acquisition_start = dev_acquisition_start,
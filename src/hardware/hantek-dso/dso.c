@@ -731,20 +731,71 @@ SR_PRIV int dso_capture_start(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
-SR_PRIV int dso_get_channeldata(const struct sr_dev_inst *sdi,
+/*
+ * The transfers for a frame are allocated on the first request, and
+ * submitted again for every following frame.
+ */
+static int alloc_transfers(const struct sr_dev_inst *sdi,
 		libusb_transfer_cb_fn cb)
 {
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
-	struct libusb_transfer *transfer;
-	int num_transfers, ret, i;
-	uint8_t cmdstring[2];
 	unsigned char *buf;
+	int i;
+
+	devc = sdi->priv;
+	usb = sdi->conn;
+
+	/* TODO: DSO-2xxx only. */
+	devc->num_transfers = devc->framesize *
+			sizeof(unsigned short) / devc->epin_maxpacketsize;
+	devc->transfers = g_malloc0(sizeof(struct libusb_transfer *)
+			* devc->num_transfers);
+	for (i = 0; i < devc->num_transfers; i++) {
+		if (!(buf = g_try_malloc(devc->epin_maxpacketsize))) {
+			sr_err("Failed to malloc USB endpoint buffer.");
+			dso_free_transfers(sdi);
+			return SR_ERR_MALLOC;
+		}
+		devc->transfers[i] = libusb_alloc_transfer(0);
+		libusb_fill_bulk_transfer(devc->transfers[i], usb->devhdl,
+				DSO_EP_IN, buf, devc->epin_maxpacketsize, cb,
+				(void *)sdi, 40);
+	}
+
+	return SR_OK;
+}
+
+SR_PRIV void dso_free_transfers(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	int i;
+
+	devc = sdi->priv;
+	for (i = 0; i < devc->num_transfers && devc->transfers; i++) {
+		if (!devc->transfers[i])
+			continue;
+		g_free(devc->transfers[i]->buffer);
+		libusb_free_transfer(devc->transfers[i]);
+	}
+	g_free(devc->transfers);
+	devc->transfers = NULL;
+	devc->num_transfers = 0;
+}
+
+SR_PRIV int dso_get_channeldata(const struct sr_dev_inst *sdi,
+		libusb_transfer_cb_fn cb)
+{
+	struct dev_context *devc;
+	int ret, i;
+	uint8_t cmdstring[2];
 
 	sr_dbg("Sending CMD_GET_CHANNELDATA.");
 
 	devc = sdi->priv;
-	usb = sdi->conn;
+
+	if (!devc->transfers && (ret = alloc_transfers(sdi, cb)) != SR_OK)
+		return ret;
 
 	cmdstring[0] = CMD_GET_CHANNELDATA;
 	cmdstring[1] = 0;
@@ -755,26 +806,14 @@ SR_PRIV int dso_get_channeldata(const struct sr_dev_inst *sdi,
 		return SR_ERR;
 	}
 
-	/* TODO: DSO-2xxx only. */
-	num_transfers = devc->framesize *
-			sizeof(unsigned short) / devc->epin_maxpacketsize;
-	sr_dbg("Queueing up %d transfers.", num_transfers);
-	for (i = 0; i < num_transfers; i++) {
-		if (!(buf = g_try_malloc(devc->epin_maxpacketsize))) {
-			sr_err("Failed to malloc USB endpoint buffer.");
-			return SR_ERR_MALLOC;
-		}
-		transfer = libusb_alloc_transfer(0);
-		libusb_fill_bulk_transfer(transfer, usb->devhdl, DSO_EP_IN, buf,
-				devc->epin_maxpacketsize, cb, (void *)sdi, 40);
-		if ((ret = libusb_submit_transfer(transfer)) != 0) {
+	sr_dbg("Queueing up %d transfers.", devc->num_transfers);
+	for (i = 0; i < devc->num_transfers; i++) {
+		if ((ret = libusb_submit_transfer(devc->transfers[i])) != 0) {
 			sr_err("Failed to submit transfer: %s.",
 			       libusb_error_name(ret));
-			/* TODO: Free them all. */
-			libusb_free_transfer(transfer);
-			g_free(buf);
 			return SR_ERR;
 		}
+		devc->transfers_busy++;
 	}
 
 	return SR_OK;
@@ -165,6 +165,12 @@ struct dev_context {
 	void *cb_data;
 	uint64_t limit_frames;
 	uint64_t num_frames;
+	uint64_t limit_samples;
+	uint64_t limit_msec;
+	uint64_t num_samples;
+	int64_t start_time;
+	/* Re-arm right after each frame, with a forced trigger. */
+	gboolean streaming;
 	GSList *enabled_channels;
 	/* We can't keep track of an FX2-based device after upgrading
 	 * the firmware (it re-enumerates into a different device address
@@ -199,6 +205,16 @@ struct dev_context {
 	unsigned int samp_buffered;
 	unsigned int trigger_offset;
 	unsigned char *framebuf;
+	/* Non-zero for each sample in framebuf that was lost. */
+	uint8_t *framelost;
+	float *samplebuf;
+	/* Transfers for one frame, submitted again for every frame. */
+	struct libusb_transfer **transfers;
+	int num_transfers;
+	int transfers_busy;
+	/* Set once the transfers were cancelled to stop the acquisition. */
+	gboolean transfers_cancelled;
+	uint64_t samp_lost;
 };
 
 SR_PRIV int dso_open(struct sr_dev_inst *sdi);
@@ -211,5 +227,6 @@ SR_PRIV int dso_get_capturestate(const struct sr_dev_inst *sdi,
 SR_PRIV int dso_capture_start(const struct sr_dev_inst *sdi);
 SR_PRIV int dso_get_channeldata(const struct sr_dev_inst *sdi,
 		libusb_transfer_cb_fn cb);
+SR_PRIV void dso_free_transfers(const struct sr_dev_inst *sdi);
 
 #endif
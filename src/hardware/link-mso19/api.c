@@ -25,6 +25,7 @@ static const uint32_t devopts[] = {
 	SR_CONF_OSCILLOSCOPE,
 	SR_CONF_LOGIC_ANALYZER,
 	SR_CONF_LIMIT_SAMPLES | SR_CONF_SET,
+	SR_CONF_CONTINUOUS | SR_CONF_SET,
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 	SR_CONF_TRIGGER_TYPE | SR_CONF_LIST,
 	SR_CONF_TRIGGER_SLOPE | SR_CONF_SET,
@@ -320,16 +321,14 @@ static int config_set(int id, GVariant *data, const struct sr_dev_inst *sdi,
 		ret = SR_OK;
 		break;
 	case SR_CONF_LIMIT_SAMPLES:
+		/* Captures of 1024 samples are repeated until the limit. */
 		num_samples = g_variant_get_uint64(data);
-		if (num_samples != 1024) {
-			sr_err("Only 1024 samples are supported.");
-			ret = SR_ERR_ARG;
-		} else {
-			devc->limit_samples = num_samples;
-			sr_dbg("setting limit_samples to %i\n",
-			       num_samples);
-			ret = SR_OK;
-		}
+		devc->limit_samples = num_samples;
+		sr_dbg("setting limit_samples to %" PRIu64, num_samples);
+		ret = SR_OK;
+		break;
+	case SR_CONF_CONTINUOUS:
+		ret = SR_OK;
 		break;
 	case SR_CONF_CAPTURE_RATIO:
 		ret = SR_OK;
@@ -337,7 +336,7 @@ static int config_set(int id, GVariant *data, const struct sr_dev_inst *sdi,
 	case SR_CONF_TRIGGER_SLOPE:
 		slope = g_variant_get_string(data, NULL);
 
-		if (!slope || !(slope[0] == 'f' || slope[0] == 'r'))
+		if (!slope || !(slope[0] == 'f' || slope[0] == 'r')) {
 			sr_err("Invalid trigger slope");
 			ret = SR_ERR_ARG;
 		} else {
@@ -408,6 +407,8 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 		return SR_ERR_DEV_CLOSED;
 
 	devc = sdi->priv;
+	devc->cb_data = cb_data;
+	devc->num_samples = 0;
 
 	if (mso_configure_channels(sdi) != SR_OK) {
 		sr_err("Failed to configure channels.");
@@ -457,11 +458,8 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 	/* Send header packet to the session bus. */
 	std_session_send_df_header(cb_data, LOG_PREFIX);
 
-	/* Our first channel is analog, the other 8 are of type 'logic'. */
-	/* TODO. */
-
 	serial_source_add(sdi->session, devc->serial, G_IO_IN, -1,
-			mso_receive_data, cb_data);
+			mso_receive_data, (void *)sdi);
 
 	return SR_OK;
 }
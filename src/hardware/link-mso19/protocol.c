@@ -29,9 +29,6 @@
 static const char mso_head[] = { 0x40, 0x4c, 0x44, 0x53, 0x7e };
 static const char mso_foot[] = { 0x7e };
 
-extern SR_PRIV struct sr_dev_driver link_mso19_driver_info;
-static struct sr_dev_driver *di = &link_mso19_driver_info;
-
 SR_PRIV int mso_send_control_message(struct sr_serial_dev_inst *serial,
 				     uint16_t payload[], int n)
 {
@@ -230,7 +227,7 @@ SR_PRIV int mso_parse_serial(const char *iSerial, const char *iProduct,
 		return SR_ERR;
 	devc->hwmodel = u4;
 	devc->hwrev = u5;
-	devc->vbit = u1 / 10000;
+	devc->vbit = u1 / 10000.0;
 	if (devc->vbit == 0)
 		devc->vbit = 4.19195;
 	devc->dac_offset = u2;
@@ -295,6 +292,8 @@ SR_PRIV void stop_acquisition(const struct sr_dev_inst *sdi)
 
 	devc = sdi->priv;
 	serial_source_remove(sdi->session, devc->serial);
+	g_slist_free(devc->analog_channels);
+	devc->analog_channels = NULL;
 
 	/* Terminate session */
 	packet.type = SR_DF_END;
@@ -354,33 +353,70 @@ SR_PRIV int mso_check_trigger(struct sr_serial_dev_inst *serial, uint8_t *info)
 	return ret;
 }
 
-SR_PRIV int mso_receive_data(int fd, int revents, void *cb_data)
+/*
+ * Each sample holds the 10-bit DSO value and the 8 logic channels. The
+ * DSO value is converted with the inverse of mso_calc_raw_from_mv().
+ */
+static void send_buffer(const struct sr_dev_inst *sdi, int num_samples)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
-	struct sr_dev_inst *sdi;
-	GSList *l;
+	struct sr_datafeed_analog2 analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct dev_context *devc;
+	const uint8_t *in;
+	float scale;
+	uint16_t raw;
 	int i;
 
-	struct drv_context *drvc = di->priv;
-
-	/* Find this device's devc struct by its fd. */
-	struct dev_context *devc = NULL;
-	for (l = drvc->instances; l; l = l->next) {
-		sdi = l->data;
-		devc = sdi->priv;
-		if (devc->serial->fd == fd)
-			break;
-		devc = NULL;
+	devc = sdi->priv;
+	in = (const uint8_t *)devc->buffer;
+	scale = devc->vbit * devc->dso_probe_attn / 1000;
+	for (i = 0; i < num_samples; i++, in += 3) {
+		raw = (in[0] & 0x3f) | ((in[1] & 0xf) << 6);
+		devc->analog_out[i] = (0x200 - raw) * scale;
+		devc->logic_out[i] = ((in[1] & 0x30) >> 4) |
+		    ((in[2] & 0x3f) << 2);
 	}
-	if (!devc)
-		/* Shouldn't happen. */
-		return TRUE;
 
-	(void)revents;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.length = num_samples;
+	logic.unitsize = 1;
+	logic.data = devc->logic_out;
+	sr_session_send(devc->cb_data, &packet);
+
+	if (!devc->analog_channels)
+		return;
+
+	sr_analog_init(&analog, &encoding, &meaning, &spec, 3);
+	analog.data = devc->analog_out;
+	analog.num_samples = num_samples;
+	meaning.mq = SR_MQ_VOLTAGE;
+	meaning.unit = SR_UNIT_VOLT;
+	meaning.channels = devc->analog_channels;
+	packet.type = SR_DF_ANALOG2;
+	packet.payload = &analog;
+	sr_session_send(devc->cb_data, &packet);
+}
 
+SR_PRIV int mso_receive_data(int fd, int revents, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
 	uint8_t in[1024];
-	size_t s = serial_read(devc->serial, in, sizeof(in));
+	size_t s;
+	int num_samples;
+
+	(void)fd;
+	(void)revents;
+
+	sdi = cb_data;
+	devc = sdi->priv;
+
+	s = serial_read(devc->serial, in, sizeof(in));
 
 	if (s <= 0)
 		return FALSE;
@@ -398,38 +434,33 @@ SR_PRIV int mso_receive_data(int fd, int revents, void *cb_data)
 		return TRUE;
 	}
 
-	/* the hardware always dumps 1024 samples, 24bits each */
-	if (devc->buffer_n < 3072) {
+	if (devc->buffer_n < BUFFER_SAMPLES * 3) {
 		memcpy(devc->buffer + devc->buffer_n, in, s);
 		devc->buffer_n += s;
 	}
-	if (devc->buffer_n < 3072)
+	if (devc->buffer_n < BUFFER_SAMPLES * 3)
 		return TRUE;
 
-	/* do the conversion */
-	uint8_t logic_out[1024];
-	double analog_out[1024];
-	for (i = 0; i < 1024; i++) {
-		/* FIXME: Need to do conversion to mV */
-		analog_out[i] = (devc->buffer[i * 3] & 0x3f) |
-		    ((devc->buffer[i * 3 + 1] & 0xf) << 6);
-		(void)analog_out;
-		logic_out[i] = ((devc->buffer[i * 3 + 1] & 0x30) >> 4) |
-		    ((devc->buffer[i * 3 + 2] & 0x3f) << 2);
-	}
-
-	packet.type = SR_DF_LOGIC;
-	packet.payload = &logic;
-	logic.length = 1024;
-	logic.unitsize = 1;
-	logic.data = logic_out;
-	sr_session_send(cb_data, &packet);
-
-	devc->num_samples += 1024;
+	num_samples = BUFFER_SAMPLES;
+	if (devc->limit_samples)
+		num_samples = MIN((uint64_t)num_samples,
+				devc->limit_samples - devc->num_samples);
+	send_buffer(sdi, num_samples);
+	devc->num_samples += num_samples;
 
 	if (devc->limit_samples && devc->num_samples >= devc->limit_samples) {
 		sr_info("Requested number of samples reached.");
-		sdi->driver->dev_acquisition_stop(sdi, cb_data);
+		sdi->driver->dev_acquisition_stop(sdi, devc->cb_data);
+		return TRUE;
+	}
+
+	/* Capture the next buffer right away. */
+	devc->trigger_state = 0x00;
+	devc->buffer_n = 0;
+	if (mso_arm(sdi) != SR_OK
+			|| mso_check_trigger(devc->serial, NULL) != SR_OK) {
+		sr_err("Failed to arm the next capture.");
+		sdi->driver->dev_acquisition_stop(sdi, devc->cb_data);
 	}
 
 	return TRUE;
@@ -452,11 +483,20 @@ SR_PRIV int mso_configure_channels(const struct sr_dev_inst *sdi)
 	devc->trigger_chan = 3;	//LA combination trigger
 	devc->use_trigger = FALSE;
 
+	g_slist_free(devc->analog_channels);
+	devc->analog_channels = NULL;
+
 	for (l = sdi->channels; l; l = l->next) {
 		ch = (struct sr_channel *)l->data;
 		if (ch->enabled == FALSE)
 			continue;
 
+		if (ch->type == SR_CHANNEL_ANALOG) {
+			devc->analog_channels =
+			    g_slist_append(devc->analog_channels, ch);
+			continue;
+		}
+
 		int channel_bit = 1 << (ch->index);
 		if (!(ch->trigger))
 			continue;
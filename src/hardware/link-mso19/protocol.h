@@ -41,6 +41,8 @@
 #define SERIALCONN		"/dev/ttyUSB0"
 #define CLOCK_RATE		SR_MHZ(100)
 #define MIN_NUM_SAMPLES		4
+/* The hardware always dumps this many samples, 24 bits each. */
+#define BUFFER_SAMPLES		1024
 
 #define MSO_TRIGGER_UNKNOWN	'!'
 #define MSO_TRIGGER_UNKNOWN1	'1'
@@ -117,8 +119,11 @@ struct dev_context {
 	uint16_t dso_trigger_width;
 	struct mso_prototrig protocol_trigger;
 	void *cb_data;
+	GSList *analog_channels;
 	uint16_t buffer_n;
 	char buffer[4096];
+	uint8_t logic_out[BUFFER_SAMPLES];
+	float analog_out[BUFFER_SAMPLES];
 };
 
 SR_PRIV int mso_parse_serial(const char *iSerial, const char *iProduct,
@@ -466,6 +466,7 @@ static int analog_frame_size(const struct sr_dev_inst *sdi)
 	case DATA_SOURCE_LIVE:
 		return devc->model->series->live_samples;
 	case DATA_SOURCE_MEMORY:
+	case DATA_SOURCE_SEGMENTED:
 		return devc->model->series->buffer_samples / analog_channels;
 	default:
 		return 0;
@@ -480,6 +481,7 @@ static int digital_frame_size(const struct sr_dev_inst *sdi)
 	case DATA_SOURCE_LIVE:
 		return devc->model->series->live_samples * 2;
 	case DATA_SOURCE_MEMORY:
+	case DATA_SOURCE_SEGMENTED:
 		return devc->model->series->buffer_samples * 2;
 	default:
 		return 0;
@@ -900,6 +902,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 	devc = sdi->priv;
 
 	devc->num_frames = 0;
+	devc->num_segments = 0;
 
 	for (l = sdi->channels; l; l = l->next) {
 		ch = l->data;
@@ -945,8 +948,9 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 			return SR_ERR;
 
 	/* Set memory mode. */
-	if (devc->data_source == DATA_SOURCE_SEGMENTED) {
-		sr_err("Data source 'Segmented' not yet supported");
+	if (devc->data_source == DATA_SOURCE_SEGMENTED
+			&& devc->model->series->protocol < PROTOCOL_V3) {
+		sr_err("Data source 'Segmented' not supported on this model");
 		return SR_ERR;
 	}
 
@@ -1018,6 +1022,10 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi, void *cb_data)
 	packet.type = SR_DF_END;
 	sr_session_send(sdi, &packet);
 
+	if (devc->data_source == DATA_SOURCE_SEGMENTED
+			&& devc->model->series->protocol >= PROTOCOL_V3)
+		rigol_ds_config_set(sdi, ":FUNC:WREC:ENAB OFF");
+
 	g_slist_free(devc->enabled_analog_channels);
 	g_slist_free(devc->enabled_digital_channels);
 	devc->enabled_analog_channels = NULL;
@@ -1040,6 +1048,7 @@ SR_PRIV struct sr_dev_driver rigol_ds_driver_info = {
 	.config_get = config_get,
 	.config_set = config_set,
 	.config_list = config_list,
+	.config_cache = TRUE,
 	.dev_open = dev_open,
 	.dev_close = dev_close,
 	.dev_acquisition_start = dev_acquisition_start,
@@ -203,6 +203,56 @@ static int rigol_ds_stop_wait(const struct sr_dev_inst *sdi)
 	return rigol_ds_event_wait(sdi, 'S', 'S');
 }
 
+/*
+ * Wait for the scope to finish recording all frames of a segmented
+ * acquisition, then set up reading them back. Like the other waits, this
+ * gives up after about 3 seconds so as not to block the application.
+ */
+static int rigol_ds_record_wait(const struct sr_dev_inst *sdi)
+{
+	char *buf;
+	struct dev_context *devc;
+	time_t start;
+	int num_frames;
+	gboolean running;
+
+	if (!(devc = sdi->priv))
+		return SR_ERR;
+
+	start = time(NULL);
+
+	do {
+		if (time(NULL) - start >= 3) {
+			sr_dbg("Timeout waiting for recording to finish");
+			return SR_ERR_TIMEOUT;
+		}
+
+		/* "RUN" while recording, "STOP" once done. */
+		if (sr_scpi_get_string(sdi->conn, ":FUNC:WREC:OPER?", &buf) != SR_OK)
+			return SR_ERR;
+		running = buf[0] == 'R';
+		g_free(buf);
+		if (running)
+			g_usleep(100000);
+	} while (running);
+
+	if (sr_scpi_get_int(sdi->conn, ":FUNC:WREP:FEND?", &num_frames) != SR_OK)
+		return SR_ERR;
+	if (num_frames <= 0) {
+		sr_err("No frames were recorded");
+		return SR_ERR;
+	}
+	sr_dbg("Recorded %d frames", num_frames);
+	devc->num_segments = num_frames;
+
+	if (rigol_ds_config_set(sdi, ":FUNC:WREP:FCUR 1") != SR_OK)
+		return SR_ERR;
+
+	rigol_ds_set_wait_event(devc, WAIT_NONE);
+
+	return SR_OK;
+}
+
 /* Check that a single shot acquisition actually succeeded on the DS2000 */
 static int rigol_ds_check_stop(const struct sr_dev_inst *sdi)
 {
@@ -353,9 +403,37 @@ SR_PRIV int rigol_ds_capture_start(const struct sr_dev_inst *sdi)
 		}
 		break;
 	case PROTOCOL_V3:
+		if (devc->data_source == DATA_SOURCE_SEGMENTED
+				&& devc->num_frames > 0) {
+			/*
+			 * All frames were recorded in one go, just select
+			 * the next one for readout.
+			 */
+			if (rigol_ds_config_set(sdi, ":FUNC:WREP:FCUR %" PRIu64,
+					devc->num_frames + 1) != SR_OK)
+				return SR_ERR;
+			return rigol_ds_channel_start(sdi);
+		}
 		if (rigol_ds_config_set(sdi, ":WAV:FORM BYTE") != SR_OK)
 			return SR_ERR;
-		if (devc->data_source == DATA_SOURCE_LIVE) {
+		if (devc->data_source == DATA_SOURCE_SEGMENTED) {
+			/*
+			 * Have the scope record the frames into its own
+			 * memory, re-arming in hardware, and read them back
+			 * afterwards.
+			 */
+			if (rigol_ds_config_set(sdi, ":WAV:MODE RAW") != SR_OK)
+				return SR_ERR;
+			if (rigol_ds_config_set(sdi, ":FUNC:WREC:ENAB ON") != SR_OK)
+				return SR_ERR;
+			if (devc->limit_frames > 0
+					&& rigol_ds_config_set(sdi, ":FUNC:WREC:FEND %" PRIu64,
+						devc->limit_frames) != SR_OK)
+				return SR_ERR;
+			if (rigol_ds_config_set(sdi, ":FUNC:WREC:OPER RUN") != SR_OK)
+				return SR_ERR;
+			rigol_ds_set_wait_event(devc, WAIT_RECORD);
+		} else if (devc->data_source == DATA_SOURCE_LIVE) {
 			if (rigol_ds_config_set(sdi, ":WAV:MODE NORM") != SR_OK)
 				return SR_ERR;
 			rigol_ds_set_wait_event(devc, WAIT_TRIGGER);
@@ -518,6 +596,12 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 			if (rigol_ds_channel_start(sdi) != SR_OK)
 				return TRUE;
 			return TRUE;
+		case WAIT_RECORD:
+			if (rigol_ds_record_wait(sdi) != SR_OK)
+				return TRUE;
+			if (rigol_ds_channel_start(sdi) != SR_OK)
+				return TRUE;
+			return TRUE;
 		default:
 			sr_err("BUG: Unknown event target encountered");
 		}
@@ -676,7 +760,9 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 				packet.type = SR_DF_FRAME_END;
 				sr_session_send(cb_data, &packet);
 
-				if (++devc->num_frames == devc->limit_frames) {
+				if (++devc->num_frames == devc->limit_frames
+						|| (devc->data_source == DATA_SOURCE_SEGMENTED
+						&& devc->num_frames == devc->num_segments)) {
 					/* Last frame, stop capture. */
 					sdi->driver->dev_acquisition_stop(sdi, cb_data);
 				} else {
@@ -83,6 +83,7 @@ enum wait_events {
 	WAIT_TRIGGER, /* Wait for trigger (only live capture) */
 	WAIT_BLOCK,   /* Wait for block data (only when reading sample mem) */
 	WAIT_STOP,    /* Wait for scope stopping (only single shots) */
+	WAIT_RECORD,  /* Wait for the end of recording (only segmented) */
 };
 
 /** Private, per-device-instance driver context. */
@@ -127,6 +128,8 @@ struct dev_context {
 
 	/* Number of frames received in total. */
 	uint64_t num_frames;
+	/* Number of frames recorded by the scope (only segmented). */
+	uint64_t num_segments;
 	/* GSList entry for the current channel. */
 	GSList *channel_entry;
 	/* Number of bytes received for current channel. */
@@ -561,6 +561,7 @@ SR_PRIV int logic16_abort_acquisition(const struct sr_dev_inst *sdi)
 
 	if (devc->fpga_variant == FPGA_VARIANT_ORIGINAL && reg1 & 0x20) {
 		sr_warn("FIFO overflow, capture data may be truncated.");
+		sr_session_stats_add(sdi, SR_STATS_OVERRUNS, 1);
 		return SR_ERR;
 	}
 
@@ -752,6 +753,7 @@ SR_PRIV void logic16_receive_transfer(struct libusb_transfer *transfer)
 
 	if (transfer->actual_length == 0 || packet_has_error) {
 		devc->empty_transfer_count++;
+		sr_session_stats_add(sdi, SR_STATS_EMPTY_TRANSFERS, 1);
 		if (devc->empty_transfer_count > MAX_EMPTY_TRANSFERS) {
 			/*
 			 * The FX2 gave up. End the acquisition, the frontend
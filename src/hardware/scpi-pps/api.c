@@ -252,100 +252,191 @@ static int cleanup(void)
 	return std_dev_clear(di, clear_helper);
 }
 
-static int config_get(uint32_t key, GVariant **data, const struct sr_dev_inst *sdi,
-		const struct sr_channel_group *cg)
+/*
+ * Some options only apply to channel groups with a single channel -- they're
+ * per-channel settings for the device. However some of these take a CG on
+ * one PPS but not on others. Check the device's profile for that, and NULL
+ * out the channel group as needed.
+ */
+static const struct sr_channel_group *key_cg(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg, uint32_t key)
 {
 	struct dev_context *devc;
-	const GVariantType *gvtype;
 	unsigned int i;
-	int cmd, ret;
-
-	if (!sdi)
-		return SR_ERR_ARG;
 
 	devc = sdi->priv;
-
 	if (cg) {
-		/*
-		 * These options only apply to channel groups with a single
-		 * channel -- they're per-channel settings for the device.
-		 */
-
-		/*
-		 * Config keys are handled below depending on whether a channel
-		 * group was provided by the frontend. However some of these
-		 * take a CG on one PPS but not on others. Check the device's
-		 * profile for that here, and NULL out the channel group as needed.
-		 */
 		for (i = 0; i < devc->device->num_devopts; i++) {
-			if (devc->device->devopts[i] == key) {
-				cg = NULL;
-				break;
-			}
+			if (devc->device->devopts[i] == key)
+				return NULL;
 		}
 	}
 
-	gvtype = NULL;
-	cmd = -1;
+	return cg;
+}
+
+/* The query command for a key, and the type of its value. */
+static gboolean key_cmd(uint32_t key, const GVariantType **gvtype, int *cmd)
+{
 	switch (key) {
 	case SR_CONF_OUTPUT_ENABLED:
-		gvtype = G_VARIANT_TYPE_BOOLEAN;
-		cmd = SCPI_CMD_GET_OUTPUT_ENABLED;
+		*gvtype = G_VARIANT_TYPE_BOOLEAN;
+		*cmd = SCPI_CMD_GET_OUTPUT_ENABLED;
 		break;
 	case SR_CONF_OUTPUT_VOLTAGE:
-		gvtype = G_VARIANT_TYPE_DOUBLE;
-		cmd = SCPI_CMD_GET_MEAS_VOLTAGE;
+		*gvtype = G_VARIANT_TYPE_DOUBLE;
+		*cmd = SCPI_CMD_GET_MEAS_VOLTAGE;
 		break;
 	case SR_CONF_OUTPUT_VOLTAGE_TARGET:
-		gvtype = G_VARIANT_TYPE_DOUBLE;
-		cmd = SCPI_CMD_GET_VOLTAGE_TARGET;
+		*gvtype = G_VARIANT_TYPE_DOUBLE;
+		*cmd = SCPI_CMD_GET_VOLTAGE_TARGET;
 		break;
 	case SR_CONF_OUTPUT_CURRENT:
-		gvtype = G_VARIANT_TYPE_DOUBLE;
-		cmd = SCPI_CMD_GET_MEAS_CURRENT;
+		*gvtype = G_VARIANT_TYPE_DOUBLE;
+		*cmd = SCPI_CMD_GET_MEAS_CURRENT;
 		break;
 	case SR_CONF_OUTPUT_CURRENT_LIMIT:
-		gvtype = G_VARIANT_TYPE_DOUBLE;
-		cmd = SCPI_CMD_GET_CURRENT_LIMIT;
+		*gvtype = G_VARIANT_TYPE_DOUBLE;
+		*cmd = SCPI_CMD_GET_CURRENT_LIMIT;
 		break;
 	case SR_CONF_OVER_VOLTAGE_PROTECTION_ENABLED:
-		gvtype = G_VARIANT_TYPE_BOOLEAN;
-		cmd = SCPI_CMD_GET_OVER_VOLTAGE_PROTECTION_ENABLED;
+		*gvtype = G_VARIANT_TYPE_BOOLEAN;
+		*cmd = SCPI_CMD_GET_OVER_VOLTAGE_PROTECTION_ENABLED;
 		break;
 	case SR_CONF_OVER_VOLTAGE_PROTECTION_ACTIVE:
-		gvtype = G_VARIANT_TYPE_BOOLEAN;
-		cmd = SCPI_CMD_GET_OVER_VOLTAGE_PROTECTION_ACTIVE;
+		*gvtype = G_VARIANT_TYPE_BOOLEAN;
+		*cmd = SCPI_CMD_GET_OVER_VOLTAGE_PROTECTION_ACTIVE;
 		break;
 	case SR_CONF_OVER_VOLTAGE_PROTECTION_THRESHOLD:
-		gvtype = G_VARIANT_TYPE_DOUBLE;
-		cmd = SCPI_CMD_GET_OVER_VOLTAGE_PROTECTION_THRESHOLD;
+		*gvtype = G_VARIANT_TYPE_DOUBLE;
+		*cmd = SCPI_CMD_GET_OVER_VOLTAGE_PROTECTION_THRESHOLD;
 		break;
 	case SR_CONF_OVER_CURRENT_PROTECTION_ENABLED:
-		gvtype = G_VARIANT_TYPE_BOOLEAN;
-		cmd = SCPI_CMD_GET_OVER_CURRENT_PROTECTION_ENABLED;
+		*gvtype = G_VARIANT_TYPE_BOOLEAN;
+		*cmd = SCPI_CMD_GET_OVER_CURRENT_PROTECTION_ENABLED;
 		break;
 	case SR_CONF_OVER_CURRENT_PROTECTION_ACTIVE:
-		gvtype = G_VARIANT_TYPE_BOOLEAN;
-		cmd = SCPI_CMD_GET_OVER_CURRENT_PROTECTION_ACTIVE;
+		*gvtype = G_VARIANT_TYPE_BOOLEAN;
+		*cmd = SCPI_CMD_GET_OVER_CURRENT_PROTECTION_ACTIVE;
 		break;
 	case SR_CONF_OVER_CURRENT_PROTECTION_THRESHOLD:
-		gvtype = G_VARIANT_TYPE_DOUBLE;
-		cmd = SCPI_CMD_GET_OVER_CURRENT_PROTECTION_THRESHOLD;
+		*gvtype = G_VARIANT_TYPE_DOUBLE;
+		*cmd = SCPI_CMD_GET_OVER_CURRENT_PROTECTION_THRESHOLD;
 		break;
 	case SR_CONF_OVER_TEMPERATURE_PROTECTION:
-		gvtype = G_VARIANT_TYPE_BOOLEAN;
-		cmd = SCPI_CMD_GET_OVER_TEMPERATURE_PROTECTION;
+		*gvtype = G_VARIANT_TYPE_BOOLEAN;
+		*cmd = SCPI_CMD_GET_OVER_TEMPERATURE_PROTECTION;
 		break;
 	case SR_CONF_OUTPUT_REGULATION:
-		gvtype = G_VARIANT_TYPE_STRING;
-		cmd = SCPI_CMD_GET_OUTPUT_REGULATION;
+		*gvtype = G_VARIANT_TYPE_STRING;
+		*cmd = SCPI_CMD_GET_OUTPUT_REGULATION;
+		break;
+	default:
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static int config_get(uint32_t key, GVariant **data, const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg)
+{
+	const GVariantType *gvtype;
+	int cmd;
+
+	if (!sdi)
+		return SR_ERR_ARG;
+
+	if (!key_cmd(key, &gvtype, &cmd))
+		return SR_ERR_NA;
+
+	if ((cg = key_cg(sdi, cg, key)))
+		select_channel(sdi, cg->channels->data);
+
+	return scpi_cmd_resp(sdi, data, gvtype, cmd);
+}
+
+/*
+ * On devices which support it, query all keys which apply to the same
+ * channel as one compound SCPI message, which saves a round trip per
+ * key. Otherwise, or if the device didn't answer every query, the keys
+ * are queried one by one.
+ */
+static int config_get_multi(GSList *configs, const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg)
+{
+	struct dev_context *devc;
+	struct sr_config *src;
+	const struct sr_channel_group *group;
+	const GVariantType **gvtypes;
+	GVariant **gvars;
+	GSList *l, *batch;
+	unsigned int num, pass, i;
+	int *cmds, ret, err;
+
+	if (!sdi)
+		return SR_ERR_ARG;
+
+	devc = sdi->priv;
+	if (devc->device->features & PPS_COMPOUND) {
+		num = g_slist_length(configs);
+		gvtypes = g_malloc0(sizeof(GVariantType *) * num);
+		gvars = g_malloc0(sizeof(GVariant *) * num);
+		cmds = g_malloc0(sizeof(int) * num);
+
+		/* First the device-wide keys, then those of the channel group. */
+		ret = SR_OK;
+		for (pass = 0; pass < 2 && ret == SR_OK; pass++) {
+			group = pass ? cg : NULL;
+			if (pass && !cg)
+				break;
+			batch = NULL;
+			num = 0;
+			for (l = configs; l; l = l->next) {
+				src = l->data;
+				if (key_cg(sdi, cg, src->key) != group
+						|| !key_cmd(src->key, &gvtypes[num], &cmds[num]))
+					continue;
+				batch = g_slist_append(batch, src);
+				num++;
+			}
+			if (!batch)
+				continue;
+			if (group)
+				select_channel(sdi, group->channels->data);
+			ret = scpi_cmd_resp_multi(sdi, gvars, gvtypes, cmds, num);
+			for (l = batch, i = 0; l && ret == SR_OK; l = l->next, i++) {
+				src = l->data;
+				src->data = gvars[i];
+			}
+			g_slist_free(batch);
+		}
+
+		g_free(gvtypes);
+		g_free(gvars);
+		g_free(cmds);
+
+		if (ret == SR_OK)
+			return SR_OK;
+
+		/* Don't let the single queries read what's left of the answer. */
+		sr_dbg("Compound query failed, querying keys one by one.");
+		if ((ret = scpi_resync(sdi)) != SR_OK)
+			return ret;
+	}
+
+	ret = SR_OK;
+	for (l = configs; l; l = l->next) {
+		src = l->data;
+		if (src->data)
+			continue;
+		if ((err = config_get(src->key, &src->data, sdi, cg)) != SR_OK) {
+			src->data = NULL;
+			/* Keys the device doesn't have aren't an error. */
+			if (err < 0 && err != SR_ERR_NA && ret == SR_OK)
+				ret = err;
+		}
 	}
-	if (gvtype) {
-		if (cg)
-			select_channel(sdi, cg->channels->data);
-		ret = scpi_cmd_resp(sdi, data, gvtype, cmd);
-	} else
-		ret = SR_ERR_NA;
 
 	return ret;
 }
@@ -520,9 +611,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi,
 {
 	struct dev_context *devc;
 	struct sr_scpi_dev_inst *scpi;
-	struct sr_channel *ch;
-	struct pps_channel *pch;
-	int cmd, ret;
+	int ret;
 
 	if (sdi->status != SR_ST_ACTIVE)
 		return SR_ERR_DEV_CLOSED;
@@ -531,25 +620,17 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi,
 	scpi = sdi->conn;
 	devc->cb_data = cb_data;
 
+	if ((ret = scpi_pps_sweep_setup(sdi)) != SR_OK)
+		return ret;
+
 	if ((ret = sr_scpi_source_add(sdi->session, scpi, G_IO_IN, 10,
 			scpi_pps_receive_data, (void *)sdi)) != SR_OK)
 		return ret;
 	std_session_send_df_header(sdi, LOG_PREFIX);
 
-	/* Prime the pipe with the first channel's fetch. */
-	ch = next_enabled_channel(sdi, NULL);
-	pch = ch->priv;
-	if ((ret = select_channel(sdi, ch)) != SR_OK)
+	/* Prime the pipe with the first query of the sweep. */
+	if ((ret = scpi_pps_query_send(sdi)) != SR_OK)
 		return ret;
-	if (pch->mq == SR_MQ_VOLTAGE)
-		cmd = SCPI_CMD_GET_MEAS_VOLTAGE;
-	else if (pch->mq == SR_MQ_CURRENT)
-		cmd = SCPI_CMD_GET_MEAS_CURRENT;
-	else if (pch->mq == SR_MQ_POWER)
-		cmd = SCPI_CMD_GET_MEAS_POWER;
-	else
-		return SR_ERR;
-	scpi_cmd(sdi, cmd, pch->hwname);
 
 	return SR_OK;
 }
@@ -558,7 +639,7 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi, void *cb_data)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_scpi_dev_inst *scpi;
-	float f;
+	char *s;
 
 	(void)cb_data;
 
@@ -572,8 +653,10 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi, void *cb_data)
 	 * to avoid leaving the device in a state where it's not expecting
 	 * commands.
 	 */
-	sr_scpi_get_float(scpi, NULL, &f);
+	if (sr_scpi_get_string(scpi, NULL, &s) == SR_OK)
+		g_free(s);
 	sr_scpi_source_remove(sdi->session, scpi);
+	scpi_pps_sweep_free(sdi->priv);
 
 	packet.type = SR_DF_END;
 	sr_session_send(sdi, &packet);
@@ -593,6 +676,7 @@ SR_PRIV struct sr_dev_driver scpi_pps_driver_info = {
 	.config_get = config_get,
 	.config_set = config_set,
 	.config_list = config_list,
+	.config_get_multi = config_get_multi,
 	.dev_open = dev_open,
 	.dev_close = dev_close,
 	.dev_acquisition_start = dev_acquisition_start,
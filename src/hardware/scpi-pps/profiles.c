@@ -91,6 +91,7 @@ struct scpi_command rigol_dp800_cmd[] = {
 	{ SCPI_CMD_GET_MEAS_VOLTAGE, ":MEAS:VOLT?" },
 	{ SCPI_CMD_GET_MEAS_CURRENT, ":MEAS:CURR?" },
 	{ SCPI_CMD_GET_MEAS_POWER, ":MEAS:POWE?" },
+	{ SCPI_CMD_GET_MEAS_ALL, ":MEAS:ALL? CH%s" },
 	{ SCPI_CMD_GET_VOLTAGE_TARGET, ":SOUR:VOLT?" },
 	{ SCPI_CMD_SET_VOLTAGE_TARGET, ":SOUR:VOLT %.6f" },
 	{ SCPI_CMD_GET_CURRENT_LIMIT, ":SOUR:CURR?" },
@@ -295,7 +296,7 @@ struct scpi_command philips_pm2800_cmd[] = {
 
 SR_PRIV const struct scpi_pps pps_profiles[] = {
 	/* HP 6632B */
-	{ "HP", "6632B", 0,
+	{ "HP", "6632B", PPS_COMPOUND,
 		ARRAY_AND_SIZE(hp_6632b_devopts),
 		ARRAY_AND_SIZE(devopts_none),
 		ARRAY_AND_SIZE(hp_6632b_ch),
@@ -21,6 +21,9 @@
 #include <stdarg.h>
 #include "protocol.h"
 
+/* Responses to drop at most in scpi_resync(). */
+#define MAX_RESYNC_READS 16
+
 SR_PRIV char *scpi_cmd_get(const struct sr_dev_inst *sdi, int command)
 {
 	struct dev_context *devc;
@@ -59,12 +62,56 @@ SR_PRIV int scpi_cmd(const struct sr_dev_inst *sdi, int command, ...)
 	return ret;
 }
 
+/* Convert a response to the GVariant type of the command's config key. */
+static int resp_parse(const char *s, const GVariantType *gvtype, int command,
+		GVariant **gvar)
+{
+	double d;
+
+	/* Non-standard data type responses. */
+	if (command == SCPI_CMD_GET_OUTPUT_REGULATION) {
+		/*
+		 * The Rigol DP800 series return CV/CC/UR, Philips PM2800
+		 * return VOLT/CURR. We always return a GVariant string in
+		 * the Rigol notation.
+		 */
+		if (!strcmp(s, "CV") || !strcmp(s, "VOLT")) {
+			*gvar = g_variant_new_string("CV");
+		} else if (!strcmp(s, "CC") || !strcmp(s, "CURR")) {
+			*gvar = g_variant_new_string("CC");
+		} else if (!strcmp(s, "UR")) {
+			*gvar = g_variant_new_string("UR");
+		} else {
+			sr_dbg("Unknown response to SCPI_CMD_GET_OUTPUT_REGULATION: %s", s);
+			return SR_ERR_DATA;
+		}
+		return SR_OK;
+	}
+
+	/* Straight SCPI getters to GVariant types. */
+	if (g_variant_type_equal(gvtype, G_VARIANT_TYPE_BOOLEAN)) {
+		if (!strcasecmp(s, "ON") || !strcasecmp(s, "1") || !strcasecmp(s, "YES"))
+			*gvar = g_variant_new_boolean(TRUE);
+		else if (!strcasecmp(s, "OFF") || !strcasecmp(s, "0") || !strcasecmp(s, "NO"))
+			*gvar = g_variant_new_boolean(FALSE);
+		else
+			return SR_ERR;
+	} else if (g_variant_type_equal(gvtype, G_VARIANT_TYPE_DOUBLE)) {
+		if (sr_atod(s, &d) != SR_OK)
+			return SR_ERR;
+		*gvar = g_variant_new_double(d);
+	} else if (g_variant_type_equal(gvtype, G_VARIANT_TYPE_STRING)) {
+		*gvar = g_variant_new_string(s);
+	}
+
+	return SR_OK;
+}
+
 SR_PRIV int scpi_cmd_resp(const struct sr_dev_inst *sdi, GVariant **gvar,
 		const GVariantType *gvtype, int command, ...)
 {
 	struct sr_scpi_dev_inst *scpi;
 	va_list args;
-	double d;
 	int ret;
 	char *cmd, *s;
 
@@ -80,57 +127,124 @@ SR_PRIV int scpi_cmd_resp(const struct sr_dev_inst *sdi, GVariant **gvar,
 	if (ret != SR_OK)
 		return ret;
 
-	/* Non-standard data type responses. */
-	if (command == SCPI_CMD_GET_OUTPUT_REGULATION) {
-		/*
-		 * The Rigol DP800 series return CV/CC/UR, Philips PM2800
-		 * return VOLT/CURR. We always return a GVariant string in
-		 * the Rigol notation.
-		 */
-		if ((ret = sr_scpi_get_string(scpi, NULL, &s)) != SR_OK)
-			return ret;
-		if (!strcmp(s, "CV") || !strcmp(s, "VOLT")) {
-			*gvar = g_variant_new_string("CV");
-		} else if (!strcmp(s, "CC") || !strcmp(s, "CURR")) {
-			*gvar = g_variant_new_string("CC");
-		} else if (!strcmp(s, "UR")) {
-			*gvar = g_variant_new_string("UR");
-		} else {
-			sr_dbg("Unknown response to SCPI_CMD_GET_OUTPUT_REGULATION: %s", s);
+	if ((ret = sr_scpi_get_string(scpi, NULL, &s)) != SR_OK)
+		return ret;
+	ret = resp_parse(s, gvtype, command, gvar);
+	g_free(s);
+
+	return ret;
+}
+
+/*
+ * Send several queries as one compound SCPI message, and read all the
+ * responses in one go. gvars[i] is left NULL for commands the device
+ * doesn't implement. Only for profiles with PPS_COMPOUND.
+ *
+ * Returns SR_ERR_DATA if the device didn't answer every query. Parts of
+ * the answer may still be pending then, see scpi_resync().
+ */
+SR_PRIV int scpi_cmd_resp_multi(const struct sr_dev_inst *sdi, GVariant **gvars,
+		const GVariantType **gvtypes, const int *commands, unsigned int num)
+{
+	struct sr_scpi_dev_inst *scpi;
+	GString *msg;
+	char *cmd, *resp, **parts;
+	unsigned int i, n;
+	int ret;
+
+	msg = g_string_sized_new(128);
+	for (i = 0; i < num; i++) {
+		gvars[i] = NULL;
+		if (!(cmd = scpi_cmd_get(sdi, commands[i])))
+			continue;
+		if (msg->len) {
+			/* Start over at the root for every query after the first. */
+			g_string_append_c(msg, ';');
+			if (cmd[0] != ':' && cmd[0] != '*')
+				g_string_append_c(msg, ':');
+		}
+		g_string_append(msg, cmd);
+	}
+	if (!msg->len) {
+		g_string_free(msg, TRUE);
+		return SR_OK;
+	}
+
+	scpi = sdi->conn;
+	ret = sr_scpi_send(scpi, "%s", msg->str);
+	g_string_free(msg, TRUE);
+	if (ret != SR_OK)
+		return ret;
+	if ((ret = sr_scpi_get_string(scpi, NULL, &resp)) != SR_OK)
+		return ret;
+
+	parts = g_strsplit(resp, ";", 0);
+	g_free(resp);
+	for (i = n = 0; i < num; i++) {
+		if (!scpi_cmd_get(sdi, commands[i]))
+			continue;
+		if (!parts[n]) {
 			ret = SR_ERR_DATA;
+			break;
 		}
-		g_free(s);
-	} else {
-		/* Straight SCPI getters to GVariant types. */
-		if (g_variant_type_equal(gvtype, G_VARIANT_TYPE_BOOLEAN)) {
-			if ((ret = sr_scpi_get_string(scpi, NULL, &s)) != SR_OK)
-				return ret;
-			if (!strcasecmp(s, "ON") || !strcasecmp(s, "1") || !strcasecmp(s, "YES"))
-				*gvar = g_variant_new_boolean(TRUE);
-			else if (!strcasecmp(s, "OFF") || !strcasecmp(s, "0") || !strcasecmp(s, "NO"))
-				*gvar = g_variant_new_boolean(FALSE);
-			else
-				ret = SR_ERR;
-			g_free(s);
-		} if (g_variant_type_equal(gvtype, G_VARIANT_TYPE_DOUBLE)) {
-			if ((ret = sr_scpi_get_double(scpi, NULL, &d)) == SR_OK)
-				*gvar = g_variant_new_double(d);
-		} if (g_variant_type_equal(gvtype, G_VARIANT_TYPE_STRING)) {
-			if ((ret = sr_scpi_get_string(scpi, NULL, &s)) == SR_OK)
-				*gvar = g_variant_new_string(s);
+		if (resp_parse(g_strstrip(parts[n++]), gvtypes[i], commands[i],
+				&gvars[i]) != SR_OK)
+			gvars[i] = NULL;
+	}
+	if (ret == SR_OK && parts[n])
+		ret = SR_ERR_DATA;
+	g_strfreev(parts);
+
+	if (ret != SR_OK) {
+		for (i = 0; i < num; i++) {
+			if (gvars[i])
+				g_variant_unref(g_variant_ref_sink(gvars[i]));
+			gvars[i] = NULL;
 		}
 	}
 
 	return ret;
 }
 
+/*
+ * Discard responses still pending from earlier queries, e.g. after a
+ * timeout or a compound query answered in several messages, so the next
+ * query reads its own response. Everything up to the answer to a fresh
+ * *IDN? is dropped.
+ */
+SR_PRIV int scpi_resync(const struct sr_dev_inst *sdi)
+{
+	struct sr_scpi_dev_inst *scpi;
+	char *s;
+	int ret, i;
+
+	scpi = sdi->conn;
+	if ((ret = sr_scpi_send(scpi, "*IDN?")) != SR_OK)
+		return ret;
+
+	for (i = 0; i < MAX_RESYNC_READS; i++) {
+		if ((ret = sr_scpi_get_string(scpi, NULL, &s)) != SR_OK)
+			return ret;
+		ret = strstr(s, sdi->model) ? SR_OK : SR_ERR_DATA;
+		g_free(s);
+		if (ret == SR_OK)
+			return SR_OK;
+		sr_dbg("Dropped stale response.");
+	}
+
+	sr_err("Failed to resync with the device.");
+
+	return SR_ERR;
+}
+
 SR_PRIV int select_channel(const struct sr_dev_inst *sdi, struct sr_channel *ch)
 {
 	struct dev_context *devc;
 	struct pps_channel *cur_pch, *new_pch;
 	int ret;
 
-	if (g_slist_length(sdi->channels) == 1)
+	/* Also used outside of acquisitions, so without the channel table. */
+	if (!sdi->channels->next)
 		return SR_OK;
 
 	devc = sdi->priv;
@@ -153,35 +267,216 @@ SR_PRIV int select_channel(const struct sr_dev_inst *sdi, struct sr_channel *ch)
 	return ret;
 }
 
-SR_PRIV struct sr_channel *next_enabled_channel(const struct sr_dev_inst *sdi,
-		struct sr_channel *cur_channel)
+static const struct {
+	int mq;
+	int unit;
+	int command;
+} meas_info[PPS_NUM_MEAS] = {
+	[PPS_MEAS_VOLTAGE] = { SR_MQ_VOLTAGE, SR_UNIT_VOLT, SCPI_CMD_GET_MEAS_VOLTAGE },
+	[PPS_MEAS_CURRENT] = { SR_MQ_CURRENT, SR_UNIT_AMPERE, SCPI_CMD_GET_MEAS_CURRENT },
+	[PPS_MEAS_POWER] = { SR_MQ_POWER, SR_UNIT_WATT, SCPI_CMD_GET_MEAS_POWER },
+};
+
+static int meas_index(int mq)
 {
-	struct sr_channel *next_channel;
+	int i;
+
+	for (i = 0; i < PPS_NUM_MEAS; i++) {
+		if (meas_info[i].mq == mq)
+			return i;
+	}
+
+	return -1;
+}
+
+/* Packet position of the given output's channel for a quantity, or -1. */
+static int output_packet_pos(const struct sr_dev_inst *sdi,
+		unsigned int output, int mq)
+{
+	struct sr_channel *ch;
+	struct pps_channel *pch;
 	GSList *l;
 
-	next_channel = cur_channel;
-	do {
-		l = g_slist_find(sdi->channels, next_channel);
-		if (l && l->next)
-			next_channel = l->next->data;
-		else
-			next_channel = sdi->channels->data;
-	} while (!next_channel->enabled);
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		pch = ch->priv;
+		if (pch->hw_output_idx == output && pch->mq == mq)
+			return pch->packet_pos;
+	}
 
-	return next_channel;
+	return -1;
 }
 
-SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
+static struct pps_query *query_add(GArray *queries, int command,
+		unsigned int num_values)
+{
+	struct pps_query *q;
+
+	g_array_set_size(queries, queries->len + 1);
+	q = &g_array_index(queries, struct pps_query, queries->len - 1);
+	q->command = command;
+	q->num_values = num_values;
+	q->value_meas = g_malloc(sizeof(enum pps_meas) * num_values);
+	q->value_pos = g_malloc(sizeof(int) * num_values);
+
+	return q;
+}
+
+SR_PRIV void scpi_pps_sweep_free(struct dev_context *devc)
+{
+	unsigned int i;
+
+	for (i = 0; i < devc->num_queries; i++) {
+		g_free(devc->queries[i].arg);
+		g_free(devc->queries[i].value_meas);
+		g_free(devc->queries[i].value_pos);
+	}
+	g_free(devc->queries);
+	devc->queries = NULL;
+	devc->num_queries = 0;
+
+	for (i = 0; i < PPS_NUM_MEAS; i++) {
+		g_slist_free(devc->meas_channels[i]);
+		devc->meas_channels[i] = NULL;
+		g_free(devc->meas_values[i]);
+		devc->meas_values[i] = NULL;
+	}
+}
+
+/*
+ * Work out the queries needed to measure all enabled channels once, using
+ * the combined queries the profile provides. Every sweep ends with one
+ * analog packet per quantity, holding all of its enabled channels.
+ */
+SR_PRIV int scpi_pps_sweep_setup(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_channel *ch;
+	struct pps_channel *pch;
+	struct pps_query *q;
+	GArray *queries;
+	GSList *l;
+	uint64_t outputs_done;
+	int m;
+	unsigned int n;
+
+	devc = sdi->priv;
+	scpi_pps_sweep_free(devc);
+
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		pch = ch->priv;
+		pch->packet_pos = -1;
+		if (!ch->enabled || (m = meas_index(pch->mq)) < 0)
+			continue;
+		pch->packet_pos = g_slist_length(devc->meas_channels[m]);
+		devc->meas_channels[m] = g_slist_append(devc->meas_channels[m], ch);
+	}
+	for (m = 0; m < PPS_NUM_MEAS; m++) {
+		n = g_slist_length(devc->meas_channels[m]);
+		devc->meas_values[m] = n ? g_malloc0(sizeof(float) * n) : NULL;
+	}
+
+	queries = g_array_new(FALSE, TRUE, sizeof(struct pps_query));
+	if (scpi_cmd_get(sdi, SCPI_CMD_GET_MEAS_ALL)) {
+		/* One query per output with any enabled channel. */
+		outputs_done = 0;
+		for (l = sdi->channels; l; l = l->next) {
+			ch = l->data;
+			pch = ch->priv;
+			if (!ch->enabled || pch->hw_output_idx >= 64
+					|| outputs_done & (1ULL << pch->hw_output_idx))
+				continue;
+			outputs_done |= 1ULL << pch->hw_output_idx;
+			q = query_add(queries, SCPI_CMD_GET_MEAS_ALL, PPS_NUM_MEAS);
+			q->arg = g_strdup(pch->hwname);
+			for (m = 0; m < PPS_NUM_MEAS; m++) {
+				q->value_meas[m] = m;
+				q->value_pos[m] = output_packet_pos(sdi,
+						pch->hw_output_idx, meas_info[m].mq);
+			}
+		}
+	} else {
+		for (m = 0; m < PPS_NUM_MEAS; m++) {
+			if (!devc->meas_channels[m])
+				continue;
+			/* Select and measure one channel at a time. */
+			for (l = devc->meas_channels[m]; l; l = l->next) {
+				ch = l->data;
+				pch = ch->priv;
+				q = query_add(queries, meas_info[m].command, 1);
+				q->select = ch;
+				q->value_meas[0] = m;
+				q->value_pos[0] = pch->packet_pos;
+			}
+		}
+	}
+
+	devc->num_queries = queries->len;
+	devc->queries = (struct pps_query *)g_array_free(queries, FALSE);
+	devc->cur_query = 0;
+	devc->sweep_failed = FALSE;
+	if (devc->num_queries == 0) {
+		sr_err("No measurement possible on the enabled channels.");
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+/* Send the current query of the sweep. */
+SR_PRIV int scpi_pps_query_send(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct pps_query *q;
+	int ret;
+
+	devc = sdi->priv;
+	q = &devc->queries[devc->cur_query];
+	if (q->select && (ret = select_channel(sdi, q->select)) != SR_OK) {
+		sr_err("Failed to select channel %s", q->select->name);
+		return ret;
+	}
+
+	if (q->arg)
+		return scpi_cmd(sdi, q->command, q->arg);
+	else
+		return scpi_cmd(sdi, q->command);
+}
+
+static void send_sweep(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_analog analog;
+	int m;
+
+	devc = sdi->priv;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	for (m = 0; m < PPS_NUM_MEAS; m++) {
+		if (!devc->meas_channels[m])
+			continue;
+		memset(&analog, 0, sizeof(struct sr_datafeed_analog));
+		analog.channels = devc->meas_channels[m];
+		analog.num_samples = 1;
+		analog.mq = meas_info[m].mq;
+		analog.unit = meas_info[m].unit;
+		analog.mqflags = SR_MQFLAG_DC;
+		analog.data = devc->meas_values[m];
+		sr_session_send(sdi, &packet);
+	}
+}
+
+SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
+{
+	struct dev_context *devc;
 	const struct sr_dev_inst *sdi;
-	struct sr_channel *next_channel;
 	struct sr_scpi_dev_inst *scpi;
-	struct pps_channel *pch;
-	float f;
-	int cmd;
+	struct pps_query *q;
+	GArray *values;
+	unsigned int i;
+	int ret;
 
 	(void)fd;
 	(void)revents;
@@ -194,44 +489,33 @@ SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
 
 	scpi = sdi->conn;
 
-	/* Retrieve requested value for this state. */
-	if (sr_scpi_get_float(scpi, NULL, &f) == SR_OK) {
-		pch = devc->cur_channel->priv;
-		packet.type = SR_DF_ANALOG;
-		packet.payload = &analog;
-		analog.channels = g_slist_append(NULL, devc->cur_channel);
-		analog.num_samples = 1;
-		analog.mq = pch->mq;
-		if (pch->mq == SR_MQ_VOLTAGE)
-			analog.unit = SR_UNIT_VOLT;
-		else if (pch->mq == SR_MQ_CURRENT)
-			analog.unit = SR_UNIT_AMPERE;
-		else if (pch->mq == SR_MQ_POWER)
-			analog.unit = SR_UNIT_WATT;
-		analog.mqflags = SR_MQFLAG_DC;
-		analog.data = &f;
-		sr_session_send(sdi, &packet);
-		g_slist_free(analog.channels);
+	/* Retrieve the values requested by the current query. */
+	q = &devc->queries[devc->cur_query];
+	values = NULL;
+	ret = sr_scpi_get_floatv(scpi, NULL, &values);
+	if (ret == SR_OK && values->len >= q->num_values) {
+		for (i = 0; i < q->num_values; i++) {
+			if (q->value_pos[i] >= 0)
+				devc->meas_values[q->value_meas[i]][q->value_pos[i]] =
+					g_array_index(values, float, i);
+		}
+	} else {
+		sr_dbg("Invalid response to measurement query.");
+		devc->sweep_failed = TRUE;
 	}
+	if (values)
+		g_array_free(values, TRUE);
 
-	if (g_slist_length(sdi->channels) > 1) {
-		next_channel = next_enabled_channel(sdi, devc->cur_channel);
-		if (select_channel(sdi, next_channel) != SR_OK) {
-			sr_err("Failed to select channel %s", next_channel->name);
-			return FALSE;
-		}
+	if (++devc->cur_query == devc->num_queries) {
+		/* Don't send a mix of old and new values. */
+		if (!devc->sweep_failed)
+			send_sweep(sdi);
+		devc->cur_query = 0;
+		devc->sweep_failed = FALSE;
 	}
 
-	pch = devc->cur_channel->priv;
-	if (pch->mq == SR_MQ_VOLTAGE)
-		cmd = SCPI_CMD_GET_MEAS_VOLTAGE;
-	else if (pch->mq == SR_MQ_CURRENT)
-		cmd = SCPI_CMD_GET_MEAS_CURRENT;
-	else if (pch->mq == SR_MQ_POWER)
-		cmd = SCPI_CMD_GET_MEAS_POWER;
-	else
-		return SR_ERR;
-	scpi_cmd(sdi, cmd);
+	if (scpi_pps_query_send(sdi) != SR_OK)
+		return FALSE;
 
 	return TRUE;
 }
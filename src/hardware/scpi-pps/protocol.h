@@ -37,6 +37,7 @@ enum pps_scpi_cmds {
 	SCPI_CMD_GET_MEAS_VOLTAGE,
 	SCPI_CMD_GET_MEAS_CURRENT,
 	SCPI_CMD_GET_MEAS_POWER,
+	SCPI_CMD_GET_MEAS_ALL,
 	SCPI_CMD_GET_VOLTAGE_TARGET,
 	SCPI_CMD_SET_VOLTAGE_TARGET,
 	SCPI_CMD_GET_CURRENT_LIMIT,
@@ -74,6 +75,8 @@ enum pps_features {
 	PPS_INDEPENDENT   = (1 << 3),
 	PPS_SERIES        = (1 << 4),
 	PPS_PARALLEL      = (1 << 5),
+	/* Answers ';'-joined queries with one ';'-joined response. */
+	PPS_COMPOUND      = (1 << 6),
 };
 
 struct scpi_pps {
@@ -117,6 +120,8 @@ struct pps_channel {
 	int mq;
 	unsigned int hw_output_idx;
 	char *hwname;
+	/* Position in the acquisition's packet for this mq, -1 if disabled. */
+	int packet_pos;
 };
 
 struct pps_channel_instance {
@@ -135,6 +140,33 @@ enum acq_states {
 	STATE_STOP,
 };
 
+/* Measured quantities, one analog packet each per sweep. */
+enum pps_meas {
+	PPS_MEAS_VOLTAGE,
+	PPS_MEAS_CURRENT,
+	PPS_MEAS_POWER,
+	PPS_NUM_MEAS,
+};
+
+/*
+ * A query sent during acquisition, and where the values it returns go.
+ *
+ * Profiles can provide a combined query: SCPI_CMD_GET_MEAS_ALL returns
+ * voltage, current and power of the output named by its %s argument.
+ * Otherwise every channel is selected and measured on its own.
+ */
+struct pps_query {
+	int command;
+	/* Channel to select before sending the command, or NULL. */
+	struct sr_channel *select;
+	/* Argument for the command, or NULL. */
+	char *arg;
+	unsigned int num_values;
+	/* Quantity and packet position of every value, position -1 to skip. */
+	enum pps_meas *value_meas;
+	int *value_pos;
+};
+
 /** Private, per-device-instance driver context. */
 struct dev_context {
 	/* Model-specific information */
@@ -150,6 +182,14 @@ struct dev_context {
 
 	/* Temporary state across callbacks */
 	struct sr_channel *cur_channel;
+
+	/* Measurement sweep, see scpi_pps_sweep_setup(). */
+	struct pps_query *queries;
+	unsigned int num_queries;
+	unsigned int cur_query;
+	gboolean sweep_failed;
+	GSList *meas_channels[PPS_NUM_MEAS];
+	float *meas_values[PPS_NUM_MEAS];
 };
 
 const char *get_vendor(const char *raw_vendor);
@@ -157,9 +197,13 @@ SR_PRIV char *scpi_cmd_get(const struct sr_dev_inst *sdi, int command);
 SR_PRIV int scpi_cmd(const struct sr_dev_inst *sdi, int command, ...);
 SR_PRIV int scpi_cmd_resp(const struct sr_dev_inst *sdi, GVariant **gvar,
 		const GVariantType *gvtype, int command, ...);
+SR_PRIV int scpi_cmd_resp_multi(const struct sr_dev_inst *sdi, GVariant **gvars,
+		const GVariantType **gvtypes, const int *commands, unsigned int num);
+SR_PRIV int scpi_resync(const struct sr_dev_inst *sdi);
 SR_PRIV int select_channel(const struct sr_dev_inst *sdi, struct sr_channel *ch);
-SR_PRIV struct sr_channel *next_enabled_channel(const struct sr_dev_inst *sdi,
-		struct sr_channel *cur_channel);
+SR_PRIV int scpi_pps_sweep_setup(const struct sr_dev_inst *sdi);
+SR_PRIV void scpi_pps_sweep_free(struct dev_context *devc);
+SR_PRIV int scpi_pps_query_send(const struct sr_dev_inst *sdi);
 SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data);
 
 #endif
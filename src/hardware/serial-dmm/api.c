@@ -87,112 +87,128 @@ SR_PRIV struct sr_dev_driver brymen_bm25x_driver_info;
 SR_PRIV struct dmm_info dmms[] = {
 	{
 		"BBC Goertz Metrawatt", "M2110", "1200/7n2", 1200,
-		BBCGM_M2110_PACKET_SIZE, 0, 0, NULL,
+		BBCGM_M2110_PACKET_SIZE, BBCGM_M2110_PACKET_SYNC,
+		0, 0, NULL,
 		sr_m2110_packet_valid, sr_m2110_parse,
 		NULL,
 		&bbcgm_m2110_driver_info, receive_data_BBCGM_M2110,
 	},
 	{
 		"Digitek", "DT4000ZC", "2400/8n1/dtr=1", 2400,
-		FS9721_PACKET_SIZE, 0, 0, NULL,
+		FS9721_PACKET_SIZE, FS9721_PACKET_SYNC,
+		0, 0, NULL,
 		sr_fs9721_packet_valid, sr_fs9721_parse,
 		sr_fs9721_10_temp_c,
 		&digitek_dt4000zc_driver_info, receive_data_DIGITEK_DT4000ZC,
 	},
 	{
 		"TekPower", "TP4000ZC", "2400/8n1/dtr=1", 2400,
-		FS9721_PACKET_SIZE, 0, 0, NULL,
+		FS9721_PACKET_SIZE, FS9721_PACKET_SYNC,
+		0, 0, NULL,
 		sr_fs9721_packet_valid, sr_fs9721_parse,
 		sr_fs9721_10_temp_c,
 		&tekpower_tp4000zc_driver_info, receive_data_TEKPOWER_TP4000ZC,
 	},
 	{
 		"Metex", "ME-31", "600/7n2/rts=0/dtr=1", 600,
-		METEX14_PACKET_SIZE, 0, 0, sr_metex14_packet_request,
+		METEX14_PACKET_SIZE, METEX14_PACKET_SYNC,
+		0, 0, sr_metex14_packet_request,
 		sr_metex14_packet_valid, sr_metex14_parse,
 		NULL,
 		&metex_me31_driver_info, receive_data_METEX_ME31,
 	},
 	{
 		"Peaktech", "3410", "600/7n2/rts=0/dtr=1", 600,
-		METEX14_PACKET_SIZE, 0, 0, sr_metex14_packet_request,
+		METEX14_PACKET_SIZE, METEX14_PACKET_SYNC,
+		0, 0, sr_metex14_packet_request,
 		sr_metex14_packet_valid, sr_metex14_parse,
 		NULL,
 		&peaktech_3410_driver_info, receive_data_PEAKTECH_3410,
 	},
 	{
 		"MASTECH", "MAS345", "600/7n2/rts=0/dtr=1", 600,
-		METEX14_PACKET_SIZE, 0, 0, sr_metex14_packet_request,
+		METEX14_PACKET_SIZE, METEX14_PACKET_SYNC,
+		0, 0, sr_metex14_packet_request,
 		sr_metex14_packet_valid, sr_metex14_parse,
 		NULL,
 		&mastech_mas345_driver_info, receive_data_MASTECH_MAS345,
 	},
 	{
 		"V&A", "VA18B", "2400/8n1", 2400,
-		FS9721_PACKET_SIZE, 0, 0, NULL,
+		FS9721_PACKET_SIZE, FS9721_PACKET_SYNC,
+		0, 0, NULL,
 		sr_fs9721_packet_valid, sr_fs9721_parse,
 		sr_fs9721_01_temp_c,
 		&va_va18b_driver_info, receive_data_VA_VA18B,
 	},
 	{
 		"V&A", "VA40B", "2400/8n1", 2400,
-		FS9721_PACKET_SIZE, 0, 0, NULL,
+		FS9721_PACKET_SIZE, FS9721_PACKET_SYNC,
+		0, 0, NULL,
 		sr_fs9721_packet_valid, sr_fs9721_parse,
 		sr_fs9721_max_c_min,
 		&va_va40b_driver_info, receive_data_VA_VA40B,
 	},
 	{
 		"Metex", "M-3640D", "1200/7n2/rts=0/dtr=1", 1200,
-		METEX14_PACKET_SIZE, 0, 0, sr_metex14_packet_request,
+		METEX14_PACKET_SIZE, METEX14_PACKET_SYNC,
+		0, 0, sr_metex14_packet_request,
 		sr_metex14_packet_valid, sr_metex14_parse,
 		NULL,
 		&metex_m3640d_driver_info, receive_data_METEX_M3640D,
 	},
 	{
 		"Metex", "M-4650CR", "1200/7n2/rts=0/dtr=1", 1200,
-		METEX14_PACKET_SIZE, 0, 0, sr_metex14_packet_request,
+		METEX14_PACKET_SIZE, METEX14_PACKET_SYNC,
+		0, 0, sr_metex14_packet_request,
 		sr_metex14_packet_valid, sr_metex14_parse,
 		NULL,
 		&metex_m4650cr_driver_info, receive_data_METEX_M4650CR,
 	},
 	{
 		"PeakTech", "4370", "1200/7n2/rts=0/dtr=1", 1200,
-		METEX14_PACKET_SIZE, 0, 0, sr_metex14_packet_request,
+		METEX14_PACKET_SIZE, METEX14_PACKET_SYNC,
+		0, 0, sr_metex14_packet_request,
 		sr_metex14_packet_valid, sr_metex14_parse,
 		NULL,
 		&peaktech_4370_driver_info, receive_data_PEAKTECH_4370,
 	},
 	{
 		"PCE", "PCE-DM32", "2400/8n1", 2400,
-		FS9721_PACKET_SIZE, 0, 0, NULL,
+		FS9721_PACKET_SIZE, FS9721_PACKET_SYNC,
+		0, 0, NULL,
 		sr_fs9721_packet_valid, sr_fs9721_parse,
 		sr_fs9721_01_10_temp_f_c,
 		&pce_pce_dm32_driver_info, receive_data_PCE_PCE_DM32,
 	},
 	{
 		"RadioShack", "22-168", "1200/7n2/rts=0/dtr=1", 1200,
-		METEX14_PACKET_SIZE, 0, 0, sr_metex14_packet_request,
+		METEX14_PACKET_SIZE, METEX14_PACKET_SYNC,
+		0, 0, sr_metex14_packet_request,
 		sr_metex14_packet_valid, sr_metex14_parse,
 		NULL,
 		&radioshack_22_168_driver_info, receive_data_RADIOSHACK_22_168,
 	},
 	{
 		"RadioShack", "22-805", "600/7n2/rts=0/dtr=1", 600,
-		METEX14_PACKET_SIZE, 0, 0, sr_metex14_packet_request,
+		METEX14_PACKET_SIZE, METEX14_PACKET_SYNC,
+		0, 0, sr_metex14_packet_request,
 		sr_metex14_packet_valid, sr_metex14_parse,
 		NULL,
 		&radioshack_22_805_driver_info, receive_data_RADIOSHACK_22_805,
 	},
 	{
 		"RadioShack", "22-812", "4800/8n1/rts=0/dtr=1", 4800,
-		RS9LCD_PACKET_SIZE, 0, 0, NULL,
+		RS9LCD_PACKET_SIZE, RS9LCD_PACKET_SYNC,
+		0, 0, NULL,
 		sr_rs9lcd_packet_valid, sr_rs9lcd_parse,
 		NULL,
 		&radioshack_22_812_driver_info, receive_data_RADIOSHACK_22_812,
 	},
 	{
 		"Tecpel", "DMM-8061 (UT-D02 cable)", "2400/8n1/rts=0/dtr=1",
-		2400, FS9721_PACKET_SIZE, 0, 0, NULL,
+		2400, FS9721_PACKET_SIZE, FS9721_PACKET_SYNC,
+		0, 0, NULL,
 		sr_fs9721_packet_valid, sr_fs9721_parse,
 		sr_fs9721_00_temp_c,
 		&tecpel_dmm_8061_ser_driver_info,
@@ -200,35 +216,40 @@ SR_PRIV struct dmm_info dmms[] = {
 	},
 	{
 		"Voltcraft", "M-3650CR", "1200/7n2/rts=0/dtr=1", 1200,
-		METEX14_PACKET_SIZE, 150, 20, sr_metex14_packet_request,
+		METEX14_PACKET_SIZE, METEX14_PACKET_SYNC,
+		150, 20, sr_metex14_packet_request,
 		sr_metex14_packet_valid, sr_metex14_parse,
 		NULL,
 		&voltcraft_m3650cr_driver_info, receive_data_VOLTCRAFT_M3650CR,
 	},
 	{
 		"Voltcraft", "M-3650D", "1200/7n2/rts=0/dtr=1", 1200,
-		METEX14_PACKET_SIZE, 0, 0, sr_metex14_packet_request,
+		METEX14_PACKET_SIZE, METEX14_PACKET_SYNC,
+		0, 0, sr_metex14_packet_request,
 		sr_metex14_packet_valid, sr_metex14_parse,
 		NULL,
 		&voltcraft_m3650d_driver_info, receive_data_VOLTCRAFT_M3650D,
 	},
 	{
 		"Voltcraft", "M-4650CR", "1200/7n2/rts=0/dtr=1", 1200,
-		METEX14_PACKET_SIZE, 0, 0, sr_metex14_packet_request,
+		METEX14_PACKET_SIZE, METEX14_PACKET_SYNC,
+		0, 0, sr_metex14_packet_request,
 		sr_metex14_packet_valid, sr_metex14_parse,
 		NULL,
 		&voltcraft_m4650cr_driver_info, receive_data_VOLTCRAFT_M4650CR,
 	},
 	{
 		"Voltcraft", "ME-42", "600/7n2/rts=0/dtr=1", 600,
-		METEX14_PACKET_SIZE, 250, 60, sr_metex14_packet_request,
+		METEX14_PACKET_SIZE, METEX14_PACKET_SYNC,
+		250, 60, sr_metex14_packet_request,
 		sr_metex14_packet_valid, sr_metex14_parse,
 		NULL,
 		&voltcraft_me42_driver_info, receive_data_VOLTCRAFT_ME42,
 	},
 	{
 		"Voltcraft", "VC-820 (UT-D02 cable)", "2400/8n1/rts=0/dtr=1",
-		2400, FS9721_PACKET_SIZE, 0, 0, NULL,
+		2400, FS9721_PACKET_SIZE, FS9721_PACKET_SYNC,
+		0, 0, NULL,
 		sr_fs9721_packet_valid, sr_fs9721_parse,
 		NULL,
 		&voltcraft_vc820_ser_driver_info,
@@ -241,7 +262,8 @@ SR_PRIV struct dmm_info dmms[] = {
 		 * bit "z1" to indicate "diode mode" and "voltage".
 		 */
 		"Voltcraft", "VC-830 (UT-D02 cable)", "2400/8n1/rts=0/dtr=1",
-		2400, FS9922_PACKET_SIZE, 0, 0, NULL,
+		2400, FS9922_PACKET_SIZE, FS9922_PACKET_SYNC,
+		0, 0, NULL,
 		sr_fs9922_packet_valid, sr_fs9922_parse,
 		&sr_fs9922_z1_diode,
 		&voltcraft_vc830_ser_driver_info,
@@ -249,7 +271,8 @@ SR_PRIV struct dmm_info dmms[] = {
 	},
 	{
 		"Voltcraft", "VC-840 (UT-D02 cable)", "2400/8n1/rts=0/dtr=1",
-		2400, FS9721_PACKET_SIZE, 0, 0, NULL,
+		2400, FS9721_PACKET_SIZE, FS9721_PACKET_SYNC,
+		0, 0, NULL,
 		sr_fs9721_packet_valid, sr_fs9721_parse,
 		sr_fs9721_00_temp_c,
 		&voltcraft_vc840_ser_driver_info,
@@ -257,28 +280,32 @@ SR_PRIV struct dmm_info dmms[] = {
 	},
 	{
 		"Voltcraft", "VC-920 (UT-D02 cable)", "2400/7o1/rts=0/dtr=1",
-		2400, UT71X_PACKET_SIZE, 0, 0, NULL,
+		2400, UT71X_PACKET_SIZE, UT71X_PACKET_SYNC,
+		0, 0, NULL,
 		sr_ut71x_packet_valid, sr_ut71x_parse, NULL,
 		&voltcraft_vc920_ser_driver_info,
 		receive_data_VOLTCRAFT_VC920_SER,
 	},
 	{
 		"Voltcraft", "VC-940 (UT-D02 cable)", "2400/7o1/rts=0/dtr=1",
-		2400, UT71X_PACKET_SIZE, 0, 0, NULL,
+		2400, UT71X_PACKET_SIZE, UT71X_PACKET_SYNC,
+		0, 0, NULL,
 		sr_ut71x_packet_valid, sr_ut71x_parse, NULL,
 		&voltcraft_vc940_ser_driver_info,
 		receive_data_VOLTCRAFT_VC940_SER,
 	},
 	{
 		"Voltcraft", "VC-960 (UT-D02 cable)", "2400/7o1/rts=0/dtr=1",
-		2400, UT71X_PACKET_SIZE, 0, 0, NULL,
+		2400, UT71X_PACKET_SIZE, UT71X_PACKET_SYNC,
+		0, 0, NULL,
 		sr_ut71x_packet_valid, sr_ut71x_parse, NULL,
 		&voltcraft_vc960_ser_driver_info,
 		receive_data_VOLTCRAFT_VC960_SER,
 	},
 	{
 		"UNI-T", "UT60A (UT-D02 cable)", "2400/8n1/rts=0/dtr=1",
-		2400, FS9721_PACKET_SIZE, 0, 0, NULL,
+		2400, FS9721_PACKET_SIZE, FS9721_PACKET_SYNC,
+		0, 0, NULL,
 		sr_fs9721_packet_valid, sr_fs9721_parse,
 		NULL,
 		&uni_t_ut60a_ser_driver_info,
@@ -286,7 +313,8 @@ SR_PRIV struct dmm_info dmms[] = {
 	},
 	{
 		"UNI-T", "UT60E (UT-D02 cable)", "2400/8n1/rts=0/dtr=1",
-		2400, FS9721_PACKET_SIZE, 0, 0, NULL,
+		2400, FS9721_PACKET_SIZE, FS9721_PACKET_SYNC,
+		0, 0, NULL,
 		sr_fs9721_packet_valid, sr_fs9721_parse,
 		sr_fs9721_00_temp_c,
 		&uni_t_ut60e_ser_driver_info,
@@ -295,77 +323,89 @@ SR_PRIV struct dmm_info dmms[] = {
 	{
 		/* Note: ES51986 baudrate is actually 19230! */
 		"UNI-T", "UT60G (UT-D02 cable)", "19200/7o1/rts=0/dtr=1",
-		19200, ES519XX_11B_PACKET_SIZE, 0, 0, NULL,
+		19200, ES519XX_11B_PACKET_SIZE, ES519XX_11B_PACKET_SYNC,
+		0, 0, NULL,
 		sr_es519xx_19200_11b_packet_valid, sr_es519xx_19200_11b_parse,
 		NULL,
 		&uni_t_ut60g_ser_driver_info, receive_data_UNI_T_UT60G_SER,
 	},
 	{
 		"UNI-T", "UT61B (UT-D02 cable)", "2400/8n1/rts=0/dtr=1",
-		2400, FS9922_PACKET_SIZE, 0, 0, NULL,
+		2400, FS9922_PACKET_SIZE, FS9922_PACKET_SYNC,
+		0, 0, NULL,
 		sr_fs9922_packet_valid, sr_fs9922_parse, NULL,
 		&uni_t_ut61b_ser_driver_info, receive_data_UNI_T_UT61B_SER,
 	},
 	{
 		"UNI-T", "UT61C (UT-D02 cable)", "2400/8n1/rts=0/dtr=1",
-		2400, FS9922_PACKET_SIZE, 0, 0, NULL,
+		2400, FS9922_PACKET_SIZE, FS9922_PACKET_SYNC,
+		0, 0, NULL,
 		sr_fs9922_packet_valid, sr_fs9922_parse, NULL,
 		&uni_t_ut61c_ser_driver_info, receive_data_UNI_T_UT61C_SER,
 	},
 	{
 		"UNI-T", "UT61D (UT-D02 cable)", "2400/8n1/rts=0/dtr=1",
-		2400, FS9922_PACKET_SIZE, 0, 0, NULL,
+		2400, FS9922_PACKET_SIZE, FS9922_PACKET_SYNC,
+		0, 0, NULL,
 		sr_fs9922_packet_valid, sr_fs9922_parse, NULL,
 		&uni_t_ut61d_ser_driver_info, receive_data_UNI_T_UT61D_SER,
 	},
 	{
 		/* Note: ES51922 baudrate is actually 19230! */
 		"UNI-T", "UT61E (UT-D02 cable)", "19200/7o1/rts=0/dtr=1",
-		19200, ES519XX_14B_PACKET_SIZE, 0, 0, NULL,
+		19200, ES519XX_14B_PACKET_SIZE, ES519XX_14B_PACKET_SYNC,
+		0, 0, NULL,
 		sr_es519xx_19200_14b_packet_valid, sr_es519xx_19200_14b_parse,
 		NULL,
 		&uni_t_ut61e_ser_driver_info, receive_data_UNI_T_UT61E_SER,
 	},
 	{
 		"UNI-T", "UT71A (UT-D02 cable)", "2400/7o1/rts=0/dtr=1",
-		2400, UT71X_PACKET_SIZE, 0, 0, NULL,
+		2400, UT71X_PACKET_SIZE, UT71X_PACKET_SYNC,
+		0, 0, NULL,
 		sr_ut71x_packet_valid, sr_ut71x_parse, NULL,
 		&uni_t_ut71a_ser_driver_info, receive_data_UNI_T_UT71A_SER,
 	},
 	{
 		"UNI-T", "UT71B (UT-D02 cable)", "2400/7o1/rts=0/dtr=1",
-		2400, UT71X_PACKET_SIZE, 0, 0, NULL,
+		2400, UT71X_PACKET_SIZE, UT71X_PACKET_SYNC,
+		0, 0, NULL,
 		sr_ut71x_packet_valid, sr_ut71x_parse, NULL,
 		&uni_t_ut71b_ser_driver_info, receive_data_UNI_T_UT71B_SER,
 	},
 	{
 		"UNI-T", "UT71C (UT-D02 cable)", "2400/7o1/rts=0/dtr=1",
-		2400, UT71X_PACKET_SIZE, 0, 0, NULL,
+		2400, UT71X_PACKET_SIZE, UT71X_PACKET_SYNC,
+		0, 0, NULL,
 		sr_ut71x_packet_valid, sr_ut71x_parse, NULL,
 		&uni_t_ut71c_ser_driver_info, receive_data_UNI_T_UT71C_SER,
 	},
 	{
 		"UNI-T", "UT71D (UT-D02 cable)", "2400/7o1/rts=0/dtr=1",
-		2400, UT71X_PACKET_SIZE, 0, 0, NULL,
+		2400, UT71X_PACKET_SIZE, UT71X_PACKET_SYNC,
+		0, 0, NULL,
 		sr_ut71x_packet_valid, sr_ut71x_parse, NULL,
 		&uni_t_ut71d_ser_driver_info, receive_data_UNI_T_UT71D_SER,
 	},
 	{
 		"UNI-T", "UT71E (UT-D02 cable)", "2400/7o1/rts=0/dtr=1",
-		2400, UT71X_PACKET_SIZE, 0, 0, NULL,
+		2400, UT71X_PACKET_SIZE, UT71X_PACKET_SYNC,
+		0, 0, NULL,
 		sr_ut71x_packet_valid, sr_ut71x_parse, NULL,
 		&uni_t_ut71e_ser_driver_info, receive_data_UNI_T_UT71E_SER,
 	},
 	{
 		"ISO-TECH", "IDM103N", "2400/7o1/rts=0/dtr=1",
-		2400, ES519XX_11B_PACKET_SIZE, 0, 0, NULL,
+		2400, ES519XX_11B_PACKET_SIZE, ES519XX_11B_PACKET_SYNC,
+		0, 0, NULL,
 		sr_es519xx_2400_11b_packet_valid, sr_es519xx_2400_11b_parse,
 		NULL,
 		&iso_tech_idm103n_driver_info, receive_data_ISO_TECH_IDM103N,
 	},
 	{
 		"Tenma", "72-7745 (UT-D02 cable)", "2400/8n1/rts=0/dtr=1",
-		2400, FS9721_PACKET_SIZE, 0, 0, NULL,
+		2400, FS9721_PACKET_SIZE, FS9721_PACKET_SYNC,
+		0, 0, NULL,
 		sr_fs9721_packet_valid, sr_fs9721_parse,
 		sr_fs9721_00_temp_c,
 		&tenma_72_7745_ser_driver_info, receive_data_TENMA_72_7745_SER,
@@ -373,14 +413,16 @@ SR_PRIV struct dmm_info dmms[] = {
 	{
 		/* Note: ES51986 baudrate is actually 19230! */
 		"Tenma", "72-7750 (UT-D02 cable)", "19200/7o1/rts=0/dtr=1",
-		19200, ES519XX_11B_PACKET_SIZE, 0, 0, NULL,
+		19200, ES519XX_11B_PACKET_SIZE, ES519XX_11B_PACKET_SYNC,
+		0, 0, NULL,
 		sr_es519xx_19200_11b_packet_valid, sr_es519xx_19200_11b_parse,
 		NULL,
 		&tenma_72_7750_ser_driver_info, receive_data_TENMA_72_7750_SER,
 	},
 	{
 		"Brymen", "BM25x", "9600/8n1/rts=1/dtr=1",
-		9600, BRYMEN_BM25X_PACKET_SIZE, 0, 0, NULL,
+		9600, BRYMEN_BM25X_PACKET_SIZE, BRYMEN_BM25X_PACKET_SYNC,
+		0, 0, NULL,
 		sr_brymen_bm25x_packet_valid, sr_brymen_bm25x_parse,
 		NULL,
 		&brymen_bm25x_driver_info, receive_data_BRYMEN_BM25X,
@@ -597,6 +639,10 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi,
 	devc->num_samples = 0;
 	devc->starttime = g_get_monotonic_time();
 
+	serial_packet_buffer_init(&devc->pbuf, devc->buf, DMM_BUFSIZE,
+			dmms[dmm].packet_size, &dmms[dmm].packet_sync,
+			dmms[dmm].packet_valid);
+
 	/* Send header packet to the session bus. */
 	std_session_send_df_header(cb_data, LOG_PREFIX);
 
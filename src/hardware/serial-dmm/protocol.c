@@ -102,45 +102,34 @@ SR_PRIV int req_packet(struct sr_dev_inst *sdi, int dmm)
 static void handle_new_data(struct sr_dev_inst *sdi, int dmm, void *info)
 {
 	struct dev_context *devc;
-	int len, i, offset = 0;
-	struct sr_serial_dev_inst *serial;
+	const uint8_t *pkt;
+	int len;
 
 	devc = sdi->priv;
-	serial = sdi->conn;
 
 	/* Try to get as much data as the buffer can hold. */
-	len = DMM_BUFSIZE - devc->buflen;
-	len = serial_read_nonblocking(serial, devc->buf + devc->buflen, len);
+	len = serial_packet_buffer_fill(&devc->pbuf, sdi->conn);
 	if (len == 0)
 		return; /* No new bytes, nothing to do. */
 	if (len < 0) {
 		sr_err("Serial port read error: %d.", len);
 		return;
 	}
-	devc->buflen += len;
 
 	/* Now look for packets in that data. */
-	while ((devc->buflen - offset) >= dmms[dmm].packet_size) {
-		if (dmms[dmm].packet_valid(devc->buf + offset)) {
-			handle_packet(devc->buf + offset, sdi, dmm, info);
-			offset += dmms[dmm].packet_size;
-
-			/* Request next packet, if required. */
-			if (!dmms[dmm].packet_request)
-				break;
-			if (dmms[dmm].req_timeout_ms || dmms[dmm].req_delay_ms)
-				devc->req_next_at = g_get_monotonic_time() +
-					dmms[dmm].req_delay_ms * 1000;
-			req_packet(sdi, dmm);
-		} else {
-			offset++;
-		}
+	while ((pkt = serial_packet_find(&devc->pbuf))) {
+		handle_packet(pkt, sdi, dmm, info);
+		if (devc->limit_samples && devc->num_samples >= devc->limit_samples)
+			break;
+
+		/* Request next packet, if required. */
+		if (!dmms[dmm].packet_request)
+			continue;
+		if (dmms[dmm].req_timeout_ms || dmms[dmm].req_delay_ms)
+			devc->req_next_at = g_get_monotonic_time() +
+				dmms[dmm].req_delay_ms * 1000;
+		req_packet(sdi, dmm);
 	}
-
-	/* If we have any data left, move it to the beginning of our buffer. */
-	for (i = 0; i < devc->buflen - offset; i++)
-		devc->buf[i] = devc->buf[offset + i];
-	devc->buflen -= offset;
 }
 
 static int receive_data(int fd, int revents, int dmm, void *info, void *cb_data)
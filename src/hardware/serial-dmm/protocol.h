@@ -78,6 +78,8 @@ struct dmm_info {
 	uint32_t baudrate;
 	/** Packet size in bytes. */
 	int packet_size;
+	/** Byte all packets have in common, to find packets quickly. */
+	struct serial_packet_sync packet_sync;
 	/** Request timeout [ms] before request is considered lost and a new
 	 *  one is sent. Used only if device needs polling. */
 	int64_t req_timeout_ms;
@@ -121,8 +123,7 @@ struct dev_context {
 	int64_t starttime;
 
 	uint8_t buf[DMM_BUFSIZE];
-	int bufoffset;
-	int buflen;
+	struct serial_packet_buffer pbuf;
 
 	/** The timestamp [µs] to send the next request.
 	 *  Used only if device needs polling. */
@@ -412,55 +412,137 @@ static void process_capture_status(const struct sr_dev_inst *sdi)
 	}
 }
 
-/* Issue a capture buffer read request as an asynchronous USB transfer.
- * The address and size of the memory area to read are derived from the
- * current acquisition state.
+/* Issue a capture buffer read request on a slot of the read transfer ring,
+ * along with the transfer for its response.  The address and size of the
+ * memory area to read are derived from the current acquisition state.
  */
-static void request_read_mem(const struct sr_dev_inst *sdi)
+static int request_read_mem(const struct sr_dev_inst *sdi, unsigned int slot)
 {
 	struct dev_context *devc;
 	struct acquisition_state *acq;
+	uint16_t *command;
 	size_t count;
 
 	devc = sdi->priv;
 	acq  = devc->acquisition;
 
 	if (acq->mem_addr_next >= acq->mem_addr_stop)
-		return;
+		return SR_OK;
 
 	/* Always read a multiple of 8 device words. */
 	count = (acq->mem_addr_stop - acq->mem_addr_next + 7) / 8 * 8;
 	count = MIN(count, READ_CHUNK_LEN);
 
-	acq->xfer_buf_out[0] = LWLA_WORD(CMD_READ_MEM);
-	acq->xfer_buf_out[1] = LWLA_WORD_0(acq->mem_addr_next);
-	acq->xfer_buf_out[2] = LWLA_WORD_1(acq->mem_addr_next);
-	acq->xfer_buf_out[3] = LWLA_WORD_0(count);
-	acq->xfer_buf_out[4] = LWLA_WORD_1(count);
+	command = acq->read_buf_out[slot];
+	command[0] = LWLA_WORD(CMD_READ_MEM);
+	command[1] = LWLA_WORD_0(acq->mem_addr_next);
+	command[2] = LWLA_WORD_1(acq->mem_addr_next);
+	command[3] = LWLA_WORD_0(count);
+	command[4] = LWLA_WORD_1(count);
+
+	acq->xfer_read_out[slot]->length = 5 * sizeof(uint16_t);
+
+	if (submit_transfer(devc, acq->xfer_read_out[slot]) != SR_OK)
+		return SR_ERR;
+	++acq->read_busy[slot];
+
+	if (submit_transfer(devc, acq->xfer_read_in[slot]) != SR_OK)
+		return SR_ERR;
+	++acq->read_busy[slot];
+
+	acq->mem_addr_next += count;
+
+	return SR_OK;
+}
+
+/* Check whether any read transfers are still in flight.
+ */
+static gboolean reads_busy(struct acquisition_state *acq)
+{
+	unsigned int i;
+
+	for (i = 0; i < READ_XFERS; ++i)
+		if (acq->read_busy[i] > 0)
+			return TRUE;
+
+	return FALSE;
+}
+
+/* Cancel all read transfers in flight, after an error.  Their completion
+ * callbacks still run, and the acquisition ends once they all have.
+ */
+static void cancel_reads(struct acquisition_state *acq)
+{
+	unsigned int i;
+
+	for (i = 0; i < READ_XFERS; ++i) {
+		if (acq->read_busy[i] > 0) {
+			libusb_cancel_transfer(acq->xfer_read_out[i]);
+			libusb_cancel_transfer(acq->xfer_read_in[i]);
+		}
+	}
+}
+
+/* Start reading the capture buffer, with as many requests in flight as
+ * there are slots in the read transfer ring.
+ */
+static void start_read_mem(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct acquisition_state *acq;
+	unsigned int i;
+
+	devc = sdi->priv;
+	acq  = devc->acquisition;
+
+	devc->state = STATE_READ_RESPONSE;
+
+	for (i = 0; i < READ_XFERS; ++i) {
+		if (request_read_mem(sdi, i) != SR_OK) {
+			cancel_reads(acq);
+			return;
+		}
+	}
+}
+
+/* Expand a run of identical samples into the packet buffer.  The first
+ * sample is written, and then copied onto the end of the run doubling the
+ * filled length every time.
+ */
+static void expand_run(uint8_t *out_p, uint64_t sample, size_t count)
+{
+	size_t filled, total, len;
+
+	if (count == 0)
+		return;
 
-	acq->xfer_out->length = 5 * sizeof(uint16_t);
+	out_p[0] =  sample        & 0xFF;
+	out_p[1] = (sample >>  8) & 0xFF;
+	out_p[2] = (sample >> 16) & 0xFF;
+	out_p[3] = (sample >> 24) & 0xFF;
+	out_p[4] = (sample >> 32) & 0xFF;
 
-	if (submit_transfer(devc, acq->xfer_out) == SR_OK) {
-		acq->mem_addr_next += count;
-		devc->state = STATE_READ_REQUEST;
+	total = count * UNIT_SIZE;
+	for (filled = UNIT_SIZE; filled < total; filled += len) {
+		len = MIN(filled, total - filled);
+		memcpy(out_p + filled, out_p, len);
 	}
 }
 
 /* Demangle and decompress incoming sample data from the capture buffer.
- * The data chunk is taken from the acquisition state, and is expected to
+ * The data chunk is taken from the given read transfer, and is expected to
  * contain a multiple of 8 device words.
- * All data currently in the acquisition buffer will be processed.  Packets
+ * All data currently in the transfer buffer will be processed.  Packets
  * of decoded samples are sent off to the session bus whenever the output
  * buffer becomes full while decoding.
  */
-static int process_sample_data(const struct sr_dev_inst *sdi)
+static int process_sample_data(const struct sr_dev_inst *sdi,
+			       struct libusb_transfer *xfer)
 {
-	uint64_t sample;
 	uint64_t high_nibbles;
 	uint64_t word;
 	struct dev_context *devc;
 	struct acquisition_state *acq;
-	uint8_t *out_p;
 	uint32_t *slice;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
@@ -468,7 +550,6 @@ static int process_sample_data(const struct sr_dev_inst *sdi)
 	size_t actual_len;
 	size_t out_max_samples;
 	size_t out_run_samples;
-	size_t ri;
 	size_t in_words_left;
 	size_t si;
 
@@ -482,7 +563,7 @@ static int process_sample_data(const struct sr_dev_inst *sdi)
 	in_words_left = MIN(acq->mem_addr_stop - acq->mem_addr_done,
 			    READ_CHUNK_LEN);
 	expect_len = LWLA1034_MEMBUF_LEN(in_words_left) * sizeof(uint32_t);
-	actual_len = acq->xfer_in->actual_length;
+	actual_len = xfer->actual_length;
 
 	if (actual_len != expect_len) {
 		sr_err("Received size %zu does not match expected size %zu.",
@@ -498,7 +579,7 @@ static int process_sample_data(const struct sr_dev_inst *sdi)
 	logic.unitsize = UNIT_SIZE;
 	logic.data     = acq->out_packet;
 
-	slice = acq->xfer_buf_in;
+	slice = (uint32_t *)xfer->buffer;
 	si = 0; /* word index within slice */
 
 	for (;;) {
@@ -508,17 +589,9 @@ static int process_sample_data(const struct sr_dev_inst *sdi)
 		out_run_samples = MIN(acq->run_len, out_max_samples);
 
 		/* Expand run-length samples into session packet. */
-		sample = acq->sample;
-		out_p = &acq->out_packet[acq->out_index * UNIT_SIZE];
-
-		for (ri = 0; ri < out_run_samples; ++ri) {
-			out_p[0] =  sample        & 0xFF;
-			out_p[1] = (sample >>  8) & 0xFF;
-			out_p[2] = (sample >> 16) & 0xFF;
-			out_p[3] = (sample >> 24) & 0xFF;
-			out_p[4] = (sample >> 32) & 0xFF;
-			out_p += UNIT_SIZE;
-		}
+		expand_run(&acq->out_packet[acq->out_index * UNIT_SIZE],
+			   acq->sample, out_run_samples);
+
 		acq->run_len -= out_run_samples;
 		acq->out_index += out_run_samples;
 		acq->samples_done += out_run_samples;
@@ -569,6 +642,83 @@ static int process_sample_data(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
+/* Called whenever both transfers of a read slot have completed:  Reuse the
+ * slot for the next request, or end the read operation once all slots are
+ * idle and there is nothing left to read.
+ */
+static void read_slot_done(const struct sr_dev_inst *sdi, unsigned int slot)
+{
+	struct dev_context *devc;
+	struct acquisition_state *acq;
+
+	devc = sdi->priv;
+	acq  = devc->acquisition;
+
+	if (devc->transfer_error)
+		return;
+
+	if (acq->samples_done < acq->samples_max
+			&& request_read_mem(sdi, slot) != SR_OK) {
+		cancel_reads(acq);
+		return;
+	}
+
+	if (!reads_busy(acq))
+		issue_read_end(sdi);
+}
+
+/* Find the read ring slot of a transfer.
+ */
+static int read_slot(struct acquisition_state *acq,
+		     struct libusb_transfer *xfer)
+{
+	int i;
+
+	for (i = 0; i < READ_XFERS; ++i)
+		if (acq->xfer_read_out[i] == xfer || acq->xfer_read_in[i] == xfer)
+			return i;
+
+	return -1;
+}
+
+/* Completion callback for both directions of read transfers.  Responses
+ * complete in the order the requests were issued, so sample data is always
+ * processed in sequence.
+ */
+static void receive_transfer_read(struct libusb_transfer *transfer)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	struct acquisition_state *acq;
+	int slot;
+
+	sdi  = transfer->user_data;
+	devc = sdi->priv;
+	acq  = devc->acquisition;
+
+	slot = read_slot(acq, transfer);
+	if (slot < 0)
+		return;
+	--acq->read_busy[slot];
+
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		if (transfer->status != LIBUSB_TRANSFER_CANCELLED)
+			sr_err("Read transfer failed: %d.", transfer->status);
+		devc->transfer_error = TRUE;
+		cancel_reads(acq);
+		return;
+	}
+
+	if (transfer == acq->xfer_read_in[slot] && !devc->transfer_error
+			&& process_sample_data(sdi, transfer) != SR_OK) {
+		cancel_reads(acq);
+		return;
+	}
+
+	if (acq->read_busy[slot] == 0)
+		read_slot_done(sdi, slot);
+}
+
 /* Finish an acquisition session.  This sends the end packet to the session
  * bus and removes the listener for asynchronous USB transfers.
  */
@@ -636,11 +786,7 @@ static void receive_transfer_out(struct libusb_transfer *transfer)
 			submit_transfer(devc, devc->acquisition->xfer_in);
 			break;
 		case STATE_READ_PREPARE:
-			request_read_mem(sdi);
-			break;
-		case STATE_READ_REQUEST:
-			devc->state = STATE_READ_RESPONSE;
-			submit_transfer(devc, devc->acquisition->xfer_in);
+			start_read_mem(sdi);
 			break;
 		case STATE_READ_END:
 			end_acquisition(sdi);
@@ -658,11 +804,9 @@ static void receive_transfer_in(struct libusb_transfer *transfer)
 {
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
-	struct acquisition_state *acq;
 
 	sdi  = transfer->user_data;
 	devc = sdi->priv;
-	acq  = devc->acquisition;
 
 	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
 		sr_err("Transfer from device failed: %d.", transfer->status);
@@ -677,14 +821,6 @@ static void receive_transfer_in(struct libusb_transfer *transfer)
 	case STATE_LENGTH_RESPONSE:
 		process_capture_length(sdi);
 		break;
-	case STATE_READ_RESPONSE:
-		if (process_sample_data(sdi) == SR_OK
-				&& acq->mem_addr_next < acq->mem_addr_stop
-				&& acq->samples_done < acq->samples_max)
-			request_read_mem(sdi);
-		else
-			issue_read_end(sdi);
-		break;
 	default:
 		sr_err("Unexpected device state %d.", devc->state);
 		break;
@@ -907,6 +1043,7 @@ SR_PRIV int lwla_start_acquisition(const struct sr_dev_inst *sdi)
 	struct sr_usb_dev_inst *usb;
 	struct acquisition_state *acq;
 	struct regval_pair *regvals;
+	unsigned int i;
 
 	devc = sdi->priv;
 	usb  = sdi->conn;
@@ -927,6 +1064,21 @@ SR_PRIV int lwla_start_acquisition(const struct sr_dev_inst *sdi)
 				  &receive_transfer_in,
 				  (struct sr_dev_inst *)sdi, USB_TIMEOUT);
 
+	for (i = 0; i < READ_XFERS; ++i) {
+		libusb_fill_bulk_transfer(acq->xfer_read_out[i], usb->devhdl,
+					  EP_COMMAND,
+					  (unsigned char *)acq->read_buf_out[i], 0,
+					  &receive_transfer_read,
+					  (struct sr_dev_inst *)sdi, USB_TIMEOUT);
+
+		libusb_fill_bulk_transfer(acq->xfer_read_in[i], usb->devhdl,
+					  EP_REPLY,
+					  (unsigned char *)acq->read_buf_in[i],
+					  sizeof acq->read_buf_in[i],
+					  &receive_transfer_read,
+					  (struct sr_dev_inst *)sdi, USB_TIMEOUT);
+	}
+
 	regvals = devc->reg_write_seq;
 
 	regvals[0].reg = REG_CMD_CTRL2;
@@ -954,6 +1106,7 @@ SR_PRIV int lwla_start_acquisition(const struct sr_dev_inst *sdi)
 SR_PRIV struct acquisition_state *lwla_alloc_acquisition_state(void)
 {
 	struct acquisition_state *acq;
+	unsigned int i;
 
 	acq = g_try_new0(struct acquisition_state, 1);
 	if (!acq) {
@@ -976,6 +1129,16 @@ SR_PRIV struct acquisition_state *lwla_alloc_acquisition_state(void)
 		return NULL;
 	}
 
+	for (i = 0; i < READ_XFERS; ++i) {
+		acq->xfer_read_out[i] = libusb_alloc_transfer(0);
+		acq->xfer_read_in[i] = libusb_alloc_transfer(0);
+		if (!acq->xfer_read_out[i] || !acq->xfer_read_in[i]) {
+			sr_err("Transfer malloc failed.");
+			lwla_free_acquisition_state(acq);
+			return NULL;
+		}
+	}
+
 	return acq;
 }
 
@@ -983,7 +1146,13 @@ SR_PRIV struct acquisition_state *lwla_alloc_acquisition_state(void)
  */
 SR_PRIV void lwla_free_acquisition_state(struct acquisition_state *acq)
 {
+	unsigned int i;
+
 	if (acq) {
+		for (i = 0; i < READ_XFERS; ++i) {
+			libusb_free_transfer(acq->xfer_read_out[i]);
+			libusb_free_transfer(acq->xfer_read_in[i]);
+		}
 		libusb_free_transfer(acq->xfer_out);
 		libusb_free_transfer(acq->xfer_in);
 		g_free(acq);
@@ -1026,8 +1195,10 @@ SR_PRIV int lwla_receive_data(int fd, int revents, void *cb_data)
 			request_capture_status(sdi);
 	}
 
-	/* Check if an error occurred on a transfer. */
-	if (devc->transfer_error)
+	/* Check if an error occurred on a transfer.  Wait for cancelled
+	 * read transfers to come back before freeing them. */
+	if (devc->transfer_error && !(devc->acquisition
+			&& reads_busy(devc->acquisition)))
 		end_acquisition(sdi);
 
 	return TRUE;
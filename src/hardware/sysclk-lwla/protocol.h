@@ -67,6 +67,14 @@
  */
 #define READ_CHUNK_LEN	(28 * 8)
 
+/** Number of capture memory read requests kept in flight.  Responses to
+ * one chunk are decoded while the following ones are on their way.
+ * This depth has not been measured against real hardware yet, and there
+ * is no recorded device traffic to replay, so the read-out bandwidth
+ * gained over one request at a time is still unknown.
+ */
+#define READ_XFERS	4
+
 /** Calculate the required buffer size in 32-bit units for reading a given
  * number of device memory words.  Rounded to a multiple of 8 device words.
  */
@@ -146,7 +154,6 @@ enum device_state {
 	STATE_LENGTH_RESPONSE,
 
 	STATE_READ_PREPARE,
-	STATE_READ_REQUEST,
 	STATE_READ_RESPONSE,
 	STATE_READ_END,
 };
@@ -186,6 +193,12 @@ struct acquisition_state {
 	struct libusb_transfer *xfer_in;
 	struct libusb_transfer *xfer_out;
 
+	/** Ring of transfers for capture memory read requests and their
+	 * responses, and the number of each slot's transfers in flight. */
+	struct libusb_transfer *xfer_read_out[READ_XFERS];
+	struct libusb_transfer *xfer_read_in[READ_XFERS];
+	unsigned int read_busy[READ_XFERS];
+
 	unsigned int capture_flags;
 
 	enum rle_state rle;
@@ -196,6 +209,8 @@ struct acquisition_state {
 	/* Payload data buffers for incoming and outgoing transfers. */
 	uint32_t xfer_buf_in[MAX_ACQ_RECV_LEN];
 	uint16_t xfer_buf_out[MAX_ACQ_SEND_WORDS];
+	uint32_t read_buf_in[READ_XFERS][MAX_ACQ_RECV_LEN];
+	uint16_t read_buf_out[READ_XFERS][MAX_ACQ_SEND_WORDS];
 
 	/* Payload buffer for sigrok logic packets. */
 	uint8_t out_packet[PACKET_LENGTH * UNIT_SIZE];
@@ -646,6 +646,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 	struct sr_channel *ch;
 	struct dev_context *devc;
 	struct sr_scpi_dev_inst *scpi;
+	int min_record, num_records;
 
 	(void)cb_data;
 
@@ -685,6 +686,24 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 		return SR_ERR;
 	}
 
+	/*
+	 * The scope keeps the frames of past acquisitions in its history
+	 * memory. Only with a frame limit, read up to that many of them,
+	 * oldest first, all in one go without re-arming in between.
+	 * Otherwise just read the latest one: the whole history can be
+	 * thousands of records of millions of points each.
+	 */
+	num_records = 1;
+	if (devc->frame_limit > 1) {
+		if (dlm_history_min_record_get(scpi, &min_record) != SR_OK)
+			min_record = 0;
+		num_records = 1 - MIN(min_record, 0);
+		if ((uint64_t)num_records > devc->frame_limit)
+			num_records = devc->frame_limit;
+	}
+	devc->record = 1 - num_records;
+	sr_dbg("Reading %d history record(s).", num_records);
+
 	/* Request data for the first enabled channel. */
 	devc->current_channel = devc->enabled_channels;
 	dlm_channel_data_request(sdi);
@@ -733,6 +752,7 @@ SR_PRIV struct sr_dev_driver yokogawa_dlm_driver_info = {
 	.config_get = config_get,
 	.config_set = config_set,
 	.config_list = config_list,
+	.config_cache = TRUE,
 	.dev_open = dev_open,
 	.dev_close = dev_close,
 	.dev_acquisition_start = dev_acquisition_start,
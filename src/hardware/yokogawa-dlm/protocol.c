@@ -729,10 +729,11 @@ SR_PRIV int dlm_channel_data_request(const struct sr_dev_inst *sdi)
 
 	switch (ch->type) {
 	case SR_CHANNEL_ANALOG:
-		result = dlm_analog_data_get(sdi->conn, ch->index + 1);
+		result = dlm_analog_data_get(sdi->conn, ch->index + 1,
+				devc->record);
 		break;
 	case SR_CHANNEL_LOGIC:
-		result = dlm_digital_data_get(sdi->conn);
+		result = dlm_digital_data_get(sdi->conn, devc->record);
 		break;
 	default:
 		sr_err("Invalid channel type encountered (%d).",
@@ -993,12 +994,16 @@ SR_PRIV int dlm_data_receive(int fd, int revents, void *cb_data)
 		packet.type = SR_DF_FRAME_END;
 		sr_session_send(sdi, &packet);
 		devc->current_channel = devc->enabled_channels;
+		devc->num_frames++;
 
-		/* As of now we only support importing the current acquisition
-		 * data so we're going to stop at this point.
+		/* Stop once the latest history record has been read,
+		 * otherwise move on to the next one.
 		 */
-		sdi->driver->dev_acquisition_stop(sdi, cb_data);
-		return TRUE;
+		if (devc->record >= 0) {
+			sdi->driver->dev_acquisition_stop(sdi, cb_data);
+			return TRUE;
+		}
+		devc->record++;
 	} else
 		devc->current_channel = devc->current_channel->next;
 
@@ -118,6 +118,9 @@ struct dev_context {
 
 	uint64_t frame_limit;
 
+	/* History record being read, counting up to 0 (the latest one). */
+	int record;
+
 	char receive_buffer[RECEIVE_BUFFER_SIZE];
 	gboolean data_pending;
 };
@@ -325,13 +325,21 @@ int dlm_data_get(struct sr_scpi_dev_inst *scpi, int acquisition_num)
 	return sr_scpi_send(scpi, cmd);
 }
 
-int dlm_analog_data_get(struct sr_scpi_dev_inst *scpi, int channel)
+int dlm_history_min_record_get(struct sr_scpi_dev_inst *scpi, int *response)
+{
+	/* Record 0 is the latest acquisition, older ones are negative. */
+	return sr_scpi_get_int(scpi, ":WAVEFORM:RECORD? MINIMUM", response);
+}
+
+int dlm_analog_data_get(struct sr_scpi_dev_inst *scpi, int channel,
+		int record)
 {
 	gchar cmd[MAX_COMMAND_SIZE];
 	int result;
 
 	result = sr_scpi_send(scpi, ":WAVEFORM:FORMAT BYTE");
-	if (result == SR_OK) result = sr_scpi_send(scpi, ":WAVEFORM:RECORD 0");
+	g_snprintf(cmd, sizeof(cmd), ":WAVEFORM:RECORD %d", record);
+	if (result == SR_OK) result = sr_scpi_send(scpi, cmd);
 	if (result == SR_OK) result = sr_scpi_send(scpi, ":WAVEFORM:START 0");
 	if (result == SR_OK) result = sr_scpi_send(scpi, ":WAVEFORM:END 124999999");
 
@@ -343,12 +351,14 @@ int dlm_analog_data_get(struct sr_scpi_dev_inst *scpi, int channel)
 	return result;
 }
 
-int dlm_digital_data_get(struct sr_scpi_dev_inst *scpi)
+int dlm_digital_data_get(struct sr_scpi_dev_inst *scpi, int record)
 {
+	gchar cmd[MAX_COMMAND_SIZE];
 	int result;
 
 	result = sr_scpi_send(scpi, ":WAVEFORM:FORMAT BYTE");
-	if (result == SR_OK) result = sr_scpi_send(scpi, ":WAVEFORM:RECORD 0");
+	g_snprintf(cmd, sizeof(cmd), ":WAVEFORM:RECORD %d", record);
+	if (result == SR_OK) result = sr_scpi_send(scpi, cmd);
 	if (result == SR_OK) result = sr_scpi_send(scpi, ":WAVEFORM:START 0");
 	if (result == SR_OK) result = sr_scpi_send(scpi, ":WAVEFORM:END 124999999");
 	if (result == SR_OK) result = sr_scpi_send(scpi, ":WAVEFORM:TRACE LOGIC");
@@ -88,19 +88,27 @@ static int gl_read_data(libusb_device_handle *devh)
 	return (ret == 1) ? packet[0] : ret;
 }
 
-SR_PRIV int gl_read_bulk(libusb_device_handle *devh, void *buffer,
-			 unsigned int size)
+static int gl_request_bulk(libusb_device_handle *devh, unsigned int size)
 {
 	unsigned char packet[8] =
 	    { 0, 0, 0, 0, size & 0xff, (size & 0xff00) >> 8,
 	      (size & 0xff0000) >> 16, (size & 0xff000000) >> 24 };
-	int ret, transferred = 0;
+	int ret;
 
 	ret = libusb_control_transfer(devh, CTRL_OUT, 0x4, REQ_READBULK,
 				      0, packet, 8, TIMEOUT);
 	if (ret != 8)
 		sr_err("%s: libusb_control_transfer: %s.", __func__,
 		       libusb_error_name(ret));
+	return ret;
+}
+
+SR_PRIV int gl_read_bulk(libusb_device_handle *devh, void *buffer,
+			 unsigned int size)
+{
+	int ret, transferred = 0;
+
+	gl_request_bulk(devh, size);
 
 	ret = libusb_bulk_transfer(devh, EP1_BULK_IN, buffer, size,
 				   &transferred, TIMEOUT);
@@ -110,6 +118,22 @@ SR_PRIV int gl_read_bulk(libusb_device_handle *devh, void *buffer,
 	return transferred;
 }
 
+static int gl_download_request(struct sr_usb_download *dl, uint64_t offset,
+			       unsigned int len)
+{
+	(void)offset;
+
+	return gl_request_bulk(dl->devhdl, len) == 8 ? SR_OK : SR_ERR;
+}
+
+/* Every chunk of a download is requested before it is read. */
+SR_PRIV void gl_read_bulk_download(struct sr_usb_download *dl)
+{
+	dl->endpoint = EP1_BULK_IN;
+	dl->timeout = TIMEOUT;
+	dl->request = gl_download_request;
+}
+
 SR_PRIV int gl_reg_write(libusb_device_handle *devh, unsigned int reg,
 		 unsigned int val)
 {
@@ -137,3 +137,212 @@ SR_PRIV void set_triggerbar(struct dev_context *devc)
 	sr_dbg("ramsize_triggerbar_address = %d(0x%x)",
 	       ramsize_trigger, ramsize_trigger);
 }
+
+/* Send out a packet of samples from the memory download. */
+static gboolean send_samples(struct sr_usb_download *dl, const uint8_t *buf,
+			     unsigned int len)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.length = len;
+	logic.unitsize = 4;
+	logic.data = (void *)buf;
+	sr_session_send(dl->cb_data, &packet);
+
+	return TRUE;
+}
+
+/*
+ * The capture is done: work out which part of the sample memory is of
+ * interest, and start downloading it.
+ */
+static int start_download(const struct sr_dev_inst *sdi, unsigned int status)
+{
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+	unsigned int stop_address;
+	unsigned int now_address;
+	unsigned int trigger_address;
+	unsigned int triggerbar;
+	unsigned int ramsize_trigger;
+	unsigned int memory_size;
+	unsigned int n;
+	unsigned int discard;
+	unsigned int valid_samples;
+	unsigned int trigger_offset;
+	int trigger_now;
+
+	devc = sdi->priv;
+	usb = sdi->conn;
+
+	stop_address = analyzer_get_stop_address(usb->devhdl);
+	now_address = analyzer_get_now_address(usb->devhdl);
+	trigger_address = analyzer_get_trigger_address(usb->devhdl);
+
+	triggerbar = analyzer_get_triggerbar_address();
+	ramsize_trigger = analyzer_get_ramsize_trigger_address();
+
+	n = get_memory_size(devc->memory_size);
+	memory_size = n / 4;
+
+	sr_info("Status = 0x%x.", status);
+	sr_info("Stop address       = 0x%x.", stop_address);
+	sr_info("Now address        = 0x%x.", now_address);
+	sr_info("Trigger address    = 0x%x.", trigger_address);
+	sr_info("Triggerbar address = 0x%x.", triggerbar);
+	sr_info("Ramsize trigger    = 0x%x.", ramsize_trigger);
+	sr_info("Memory size        = 0x%x.", memory_size);
+
+	/* Check for empty capture */
+	if ((status & STATUS_READY) && !stop_address) {
+		devc->state = STATE_STOP;
+		return SR_OK;
+	}
+
+	/* Check if the trigger is in the samples we are throwing away */
+	trigger_now = now_address == trigger_address ||
+		((now_address + 1) % memory_size) == trigger_address;
+
+	/*
+	 * STATUS_READY doesn't clear until now_address advances past
+	 * addr 0, but for our logic, clear it in that case
+	 */
+	if (!now_address)
+		status &= ~STATUS_READY;
+
+	/* Calculate how much data to discard */
+	discard = 0;
+	if (status & STATUS_READY) {
+		/*
+		 * We haven't wrapped around, we need to throw away data from
+		 * our current position to the end of the buffer.
+		 * Additionally, the first two samples captured are always
+		 * bogus.
+		 */
+		discard += memory_size - now_address + 2;
+		now_address = 2;
+	}
+
+	/* If we have more samples than we need, discard them */
+	valid_samples = (stop_address - now_address) % memory_size;
+	if (valid_samples > ramsize_trigger + triggerbar) {
+		discard += valid_samples - (ramsize_trigger + triggerbar);
+		now_address += valid_samples - (ramsize_trigger + triggerbar);
+	}
+
+	sr_info("Need to discard %d samples.", discard);
+
+	/* Calculate how far in the trigger is */
+	if (trigger_now)
+		trigger_offset = 0;
+	else
+		trigger_offset = (trigger_address - now_address) % memory_size;
+
+	/* Recalculate the number of samples available */
+	valid_samples = (stop_address - now_address) % memory_size;
+
+	/*
+	 * Every chunk needs its own read request, so only one transfer is
+	 * queued. The next one is still under way while a chunk is sent.
+	 */
+	analyzer_read_data_download(&devc->dl);
+	devc->dl.cb_data = devc->cb_data;
+	devc->dl.priv = (void *)sdi;
+	devc->dl.chunk_size = PACKET_SIZE;
+	devc->dl.num_transfers = 1;
+	devc->dl.size = n;
+	devc->dl.skip = discard * 4;
+	devc->dl.length = valid_samples * 4;
+	devc->dl.has_trigger = TRUE;
+	devc->dl.trigger_pos = trigger_offset * 4;
+	devc->dl.convert = send_samples;
+
+	analyzer_read_start(usb->devhdl);
+	devc->state = STATE_DOWNLOAD;
+
+	return sr_usb_download_start(&devc->dl, usb->devhdl);
+}
+
+static void end_acquisition(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+	struct sr_datafeed_packet packet;
+
+	devc = sdi->priv;
+	usb = sdi->conn;
+
+	if (devc->dl.transfers)
+		analyzer_read_stop(usb->devhdl);
+	else
+		analyzer_reset(usb->devhdl);
+
+	usb_source_remove(sdi->session, devc->ctx);
+
+	sr_usb_download_free(&devc->dl);
+	devc->state = STATE_IDLE;
+
+	packet.type = SR_DF_END;
+	sr_session_send(devc->cb_data, &packet);
+}
+
+SR_PRIV void zp_abort_acquisition(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+	if (devc->state == STATE_IDLE)
+		return;
+
+	devc->state = STATE_STOP;
+	sr_usb_download_abort(&devc->dl);
+	if (!devc->dl.busy)
+		end_acquisition(sdi);
+}
+
+SR_PRIV int zp_receive_data(int fd, int revents, void *cb_data)
+{
+	const struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+	struct timeval tv;
+	int status;
+
+	(void)fd;
+	(void)revents;
+
+	sdi = cb_data;
+	devc = sdi->priv;
+	usb = sdi->conn;
+
+	tv.tv_sec = tv.tv_usec = 0;
+	libusb_handle_events_timeout_completed(devc->ctx->libusb_ctx, &tv, NULL);
+
+	if (devc->state == STATE_WAIT_DATA) {
+		status = analyzer_read_status(usb->devhdl);
+		if (status < 0)
+			devc->transfer_error = TRUE;
+		else if (!(status & STATUS_BUSY)
+				&& start_download(sdi, status) != SR_OK)
+			devc->transfer_error = TRUE;
+	}
+
+	if (devc->state == STATE_DOWNLOAD && sr_usb_download_done(&devc->dl)) {
+		if (devc->dl.status != SR_OK)
+			devc->transfer_error = TRUE;
+		devc->state = STATE_STOP;
+	}
+
+	if (devc->transfer_error && devc->state != STATE_IDLE) {
+		devc->state = STATE_STOP;
+		sr_usb_download_abort(&devc->dl);
+	}
+
+	if (devc->state == STATE_STOP && !devc->dl.busy)
+		end_acquisition(sdi);
+
+	return TRUE;
+}
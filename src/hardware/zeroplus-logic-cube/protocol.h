@@ -31,6 +31,21 @@
 
 #define LOG_PREFIX "zeroplus"
 
+#define PACKET_SIZE			2048	/* ?? */
+
+/* Poll interval while the device is capturing (in ms). */
+#define POLL_INTERVAL			10
+
+enum zp_state {
+	STATE_IDLE,
+	/* Capturing, poll until the device has data for us. */
+	STATE_WAIT_DATA,
+	/* Reading the sample memory. */
+	STATE_DOWNLOAD,
+	/* Acquisition is over, waiting for the transfers to return. */
+	STATE_STOP,
+};
+
 /* Private, per-device-instance driver context. */
 struct dev_context {
 	uint64_t cur_samplerate;
@@ -47,6 +62,13 @@ struct dev_context {
 	unsigned int capture_ratio;
 	double cur_threshold;
 	const struct zp_model *prof;
+
+	/* Acquisition state. */
+	struct sr_context *ctx;
+	void *cb_data;
+	enum zp_state state;
+	gboolean transfer_error;
+	struct sr_usb_download dl;
 };
 
 SR_PRIV unsigned int get_memory_size(int type);
@@ -55,5 +77,7 @@ SR_PRIV int set_limit_samples(struct dev_context *devc, uint64_t samples);
 SR_PRIV int set_capture_ratio(struct dev_context *devc, uint64_t ratio);
 SR_PRIV int set_voltage_threshold(struct dev_context *devc, double thresh);
 SR_PRIV void set_triggerbar(struct dev_context *devc);
+SR_PRIV void zp_abort_acquisition(const struct sr_dev_inst *sdi);
+SR_PRIV int zp_receive_data(int fd, int revents, void *cb_data);
 
 #endif
@@ -70,6 +70,8 @@ static struct sr_config_info sr_config_info_data[] = {
 		"Frame limit", NULL},
 	{SR_CONF_CONTINUOUS, SR_T_UINT64, "continuous",
 		"Continuous sampling", NULL},
+	{SR_CONF_REALTIME, SR_T_BOOL, "realtime",
+		"Real-time pacing", NULL},
 
 	/* Scan options */
 	{SR_CONF_CONN, SR_T_STRING, "conn",
@@ -387,6 +389,154 @@ SR_PRIV void sr_hw_cleanup_all(void)
 	}
 }
 
+/* Cached configuration values are looked up by channel group and key. */
+struct config_cache_key {
+	const struct sr_channel_group *cg;
+	uint32_t key;
+};
+
+/* Configuration caches can be used from frontend and session threads. */
+static GMutex config_cache_mutex;
+
+/*
+ * Keys reflecting state which the device changes by itself, rather than
+ * settings. These are always read from the device, even if its driver
+ * allows caching.
+ */
+static const uint32_t volatile_keys[] = {
+	SR_CONF_MEASURED_QUANTITY,
+	SR_CONF_OUTPUT_VOLTAGE,
+	SR_CONF_OUTPUT_CURRENT,
+	SR_CONF_OUTPUT_ENABLED,
+	SR_CONF_OUTPUT_REGULATION,
+	SR_CONF_OVER_VOLTAGE_PROTECTION_ACTIVE,
+	SR_CONF_OVER_CURRENT_PROTECTION_ACTIVE,
+	SR_CONF_OVER_TEMPERATURE_PROTECTION,
+	SR_CONF_DATALOG,
+};
+
+static guint cache_key_hash(gconstpointer p)
+{
+	const struct config_cache_key *k;
+
+	k = p;
+
+	return g_direct_hash(k->cg) ^ (k->key * 2654435761u);
+}
+
+static gboolean cache_key_equal(gconstpointer a, gconstpointer b)
+{
+	const struct config_cache_key *ka, *kb;
+
+	ka = a;
+	kb = b;
+
+	return ka->cg == kb->cg && ka->key == kb->key;
+}
+
+static gboolean is_cacheable(const struct sr_dev_inst *sdi, uint32_t key)
+{
+	unsigned int i;
+
+	/* The option list is fixed for a device, whatever the driver. */
+	if (key == SR_CONF_DEVICE_OPTIONS)
+		return TRUE;
+
+	/* Only drivers whose values change through config_set() alone. */
+	if (!sdi->driver || !sdi->driver->config_cache)
+		return FALSE;
+
+	for (i = 0; i < G_N_ELEMENTS(volatile_keys); i++) {
+		if (volatile_keys[i] == key)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Returns a new reference to the cached value, or NULL. */
+static GVariant *cache_lookup(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg, uint32_t key)
+{
+	struct config_cache_key k;
+	GVariant *data;
+
+	if (!sdi || !is_cacheable(sdi, key))
+		return NULL;
+
+	k.cg = cg;
+	k.key = key;
+	data = NULL;
+	g_mutex_lock(&config_cache_mutex);
+	if (sdi->config_cache && (data = g_hash_table_lookup(sdi->config_cache, &k)))
+		g_variant_ref(data);
+	g_mutex_unlock(&config_cache_mutex);
+
+	return data;
+}
+
+static void cache_store(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg, uint32_t key, GVariant *data)
+{
+	struct sr_dev_inst *dev;
+	struct config_cache_key *k;
+
+	if (!sdi || !is_cacheable(sdi, key))
+		return;
+
+	/* The cache doesn't change the device, so this is fine on a const. */
+	dev = (struct sr_dev_inst *)sdi;
+	k = g_malloc(sizeof(struct config_cache_key));
+	k->cg = cg;
+	k->key = key;
+	g_mutex_lock(&config_cache_mutex);
+	if (!dev->config_cache)
+		dev->config_cache = g_hash_table_new_full(cache_key_hash,
+				cache_key_equal, g_free,
+				(GDestroyNotify)g_variant_unref);
+	g_hash_table_replace(dev->config_cache, k, g_variant_ref(data));
+	g_mutex_unlock(&config_cache_mutex);
+}
+
+/**
+ * Forget all configuration values cached for a device instance.
+ *
+ * Values read with sr_config_get() are cached, for drivers which allow
+ * it, until a value is set, or an acquisition is started. Frontends should call this when they know
+ * the device's settings changed otherwise, e.g. from its front panel.
+ *
+ * @param sdi The device instance.
+ *
+ * @since 0.4.0
+ */
+SR_API void sr_config_cache_clear(const struct sr_dev_inst *sdi)
+{
+	if (!sdi)
+		return;
+
+	g_mutex_lock(&config_cache_mutex);
+	if (sdi->config_cache)
+		g_hash_table_remove_all(sdi->config_cache);
+	g_mutex_unlock(&config_cache_mutex);
+}
+
+/* The device's option list, from the cache where possible. */
+static int device_options_get(const struct sr_dev_driver *driver,
+		const struct sr_dev_inst *sdi, const struct sr_channel_group *cg,
+		GVariant **data)
+{
+	int ret;
+
+	if (sdi && (*data = cache_lookup(sdi, cg, SR_CONF_DEVICE_OPTIONS)))
+		return SR_OK;
+
+	ret = sr_config_list(driver, sdi, cg, SR_CONF_DEVICE_OPTIONS, data);
+	if (ret == SR_OK && sdi)
+		cache_store(sdi, cg, SR_CONF_DEVICE_OPTIONS, *data);
+
+	return ret;
+}
+
 /** Allocate struct sr_config.
  *  A floating reference can be passed in for data.
  *  @private
@@ -445,7 +595,7 @@ static int check_key(const struct sr_dev_driver *driver,
 	sr_spew("sr_config_%s(): key %d (%s) sdi %p cg %s", opstr, key,
 			srci->id, sdi, cg ? cg->name : "NULL");
 
-	if (sr_config_list(driver, sdi, cg, SR_CONF_DEVICE_OPTIONS, &gvar_opts) != SR_OK) {
+	if (device_options_get(driver, sdi, cg, &gvar_opts) != SR_OK) {
 		/* Driver publishes no options. */
 		sr_err("No options available%s.", srci->id, suffix);
 		return SR_ERR_ARG;
@@ -475,6 +625,9 @@ static int check_key(const struct sr_dev_driver *driver,
 /**
  * Query value of a configuration key at the given driver or device instance.
  *
+ * Values read from a device instance are cached if its driver allows it,
+ * see sr_config_cache_clear().
+ *
  * @param[in] driver The sr_dev_driver struct to query.
  * @param[in] sdi (optional) If the key is specific to a device, this must
  *            contain a pointer to the struct sr_dev_inst to be checked.
@@ -512,15 +665,92 @@ SR_API int sr_config_get(const struct sr_dev_driver *driver,
 	if (check_key(driver, sdi, cg, key, SR_CONF_GET) != SR_OK)
 		return SR_ERR_ARG;
 
+	if ((*data = cache_lookup(sdi, cg, key)))
+		return SR_OK;
+
 	if ((ret = driver->config_get(key, data, sdi, cg)) == SR_OK) {
 		/* Got a floating reference from the driver. Sink it here,
 		 * caller will need to unref when done with it. */
 		g_variant_ref_sink(*data);
+		cache_store(sdi, cg, key, *data);
 	}
 
 	return ret;
 }
 
+/**
+ * Query the values of several configuration keys of a device instance.
+ *
+ * Drivers can implement this as a single transaction with the device,
+ * which saves a round trip per key on e.g. SCPI instruments. Cached
+ * values are used where available, see sr_config_get().
+ *
+ * @param[in] sdi The device instance.
+ * @param[in] cg The channel group on the device to query, or NULL.
+ * @param[in,out] configs List of struct sr_config. The key of every entry
+ *             is queried, and its data field set to the value, or to NULL
+ *             if the value isn't available. The caller is given ownership
+ *             of the values, and must unref them after use.
+ *
+ * @retval SR_OK Success, though some values may not be available.
+ * @retval SR_ERR Error. Values which could be read are still set.
+ *
+ * @since 0.4.0
+ */
+SR_API int sr_config_get_multi(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg, GSList *configs)
+{
+	struct sr_config *src;
+	GSList *l, *missing;
+	int ret;
+
+	for (l = configs; l; l = l->next) {
+		src = l->data;
+		src->data = NULL;
+	}
+
+	if (!sdi || !sdi->driver)
+		return SR_ERR;
+
+	if (!sdi->driver->config_get)
+		return SR_OK;
+
+	missing = NULL;
+	for (l = configs; l; l = l->next) {
+		src = l->data;
+		if (check_key(sdi->driver, sdi, cg, src->key, SR_CONF_GET) != SR_OK)
+			continue;
+		if (!(src->data = cache_lookup(sdi, cg, src->key)))
+			missing = g_slist_append(missing, src);
+	}
+	if (!missing)
+		return SR_OK;
+
+	ret = SR_OK;
+	if (sdi->driver->config_get_multi) {
+		ret = sdi->driver->config_get_multi(missing, sdi, cg);
+	} else {
+		for (l = missing; l; l = l->next) {
+			src = l->data;
+			if (sdi->driver->config_get(src->key, &src->data,
+					sdi, cg) != SR_OK)
+				src->data = NULL;
+		}
+	}
+
+	for (l = missing; l; l = l->next) {
+		src = l->data;
+		if (!src->data)
+			continue;
+		/* Floating references from the driver, as in sr_config_get(). */
+		g_variant_ref_sink(src->data);
+		cache_store(sdi, cg, src->key, src->data);
+	}
+	g_slist_free(missing);
+
+	return ret;
+}
+
 /**
  * Set value of a configuration key in a device instance.
  *
@@ -554,14 +784,74 @@ SR_API int sr_config_set(const struct sr_dev_inst *sdi,
 		ret = SR_ERR_ARG;
 	else if (check_key(sdi->driver, sdi, cg, key, SR_CONF_SET) != SR_OK)
 		return SR_ERR_ARG;
-	else if ((ret = sr_variant_type_check(key, data)) == SR_OK)
+	else if ((ret = sr_variant_type_check(key, data)) == SR_OK) {
 		ret = sdi->driver->config_set(key, data, sdi, cg);
+		/* Setting one key can change others, e.g. limits. */
+		sr_config_cache_clear(sdi);
+	}
 
 	g_variant_unref(data);
 
 	return ret;
 }
 
+/**
+ * Set the values of several configuration keys of a device instance.
+ *
+ * Drivers can implement this as a single transaction with the device.
+ * Otherwise the values are set one by one, in list order, stopping at
+ * the first error.
+ *
+ * @param[in] sdi The device instance.
+ * @param[in] cg The channel group on the device to configure, or NULL.
+ * @param[in] configs List of struct sr_config with the keys and values to
+ *            set. The caller keeps ownership of the list and the values.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Error.
+ * @retval SR_ERR_ARG One of the keys isn't applicable to the device, or
+ *          a value has the wrong type. Nothing was set in this case.
+ *
+ * @since 0.4.0
+ */
+SR_API int sr_config_set_multi(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg, GSList *configs)
+{
+	struct sr_config *src;
+	GSList *l;
+	int ret;
+
+	if (!sdi || !sdi->driver)
+		return SR_ERR;
+	if (!sdi->driver->config_set)
+		return SR_ERR_ARG;
+
+	for (l = configs; l; l = l->next) {
+		src = l->data;
+		if (!src->data)
+			return SR_ERR;
+		if (check_key(sdi->driver, sdi, cg, src->key, SR_CONF_SET) != SR_OK)
+			return SR_ERR_ARG;
+		if ((ret = sr_variant_type_check(src->key, src->data)) != SR_OK)
+			return ret;
+	}
+
+	ret = SR_OK;
+	if (sdi->driver->config_set_multi) {
+		ret = sdi->driver->config_set_multi(configs, sdi, cg);
+	} else {
+		for (l = configs; l; l = l->next) {
+			src = l->data;
+			if ((ret = sdi->driver->config_set(src->key, src->data,
+					sdi, cg)) != SR_OK)
+				break;
+		}
+	}
+	sr_config_cache_clear(sdi);
+
+	return ret;
+}
+
 /**
  * Apply configuration settings to the device hardware.
  *
@@ -629,6 +919,40 @@ SR_API int sr_config_list(const struct sr_dev_driver *driver,
 	return ret;
 }
 
+/* Lookup tables for sr_config_info_data, built on first use. */
+struct config_info_tables {
+	GHashTable *by_key;
+	GHashTable *by_name;
+};
+
+static const struct config_info_tables *config_info_tables(void)
+{
+	static struct config_info_tables *tables;
+	struct config_info_tables *t;
+	int i;
+
+	if (g_once_init_enter(&tables)) {
+		t = g_malloc(sizeof(struct config_info_tables));
+		t->by_key = g_hash_table_new(g_direct_hash, g_direct_equal);
+		t->by_name = g_hash_table_new(g_str_hash, g_str_equal);
+		/* Insert backwards, so the first of any duplicates wins. */
+		for (i = 0; sr_config_info_data[i].key; i++)
+			;
+		while (i--) {
+			g_hash_table_insert(t->by_key,
+					GUINT_TO_POINTER(sr_config_info_data[i].key),
+					(gpointer)&sr_config_info_data[i]);
+			if (sr_config_info_data[i].id)
+				g_hash_table_insert(t->by_name,
+						(gpointer)sr_config_info_data[i].id,
+						(gpointer)&sr_config_info_data[i]);
+		}
+		g_once_init_leave(&tables, (gsize)t);
+	}
+
+	return tables;
+}
+
 /**
  * Get information about a configuration key, by key.
  *
@@ -641,14 +965,8 @@ SR_API int sr_config_list(const struct sr_dev_driver *driver,
  */
 SR_API const struct sr_config_info *sr_config_info_get(uint32_t key)
 {
-	int i;
-
-	for (i = 0; sr_config_info_data[i].key; i++) {
-		if (sr_config_info_data[i].key == key)
-			return &sr_config_info_data[i];
-	}
-
-	return NULL;
+	return g_hash_table_lookup(config_info_tables()->by_key,
+			GUINT_TO_POINTER(key));
 }
 
 /**
@@ -663,16 +981,10 @@ SR_API const struct sr_config_info *sr_config_info_get(uint32_t key)
  */
 SR_API const struct sr_config_info *sr_config_info_name_get(const char *optname)
 {
-	int i;
-
-	for (i = 0; sr_config_info_data[i].key; i++) {
-		if (!sr_config_info_data[i].id)
-			continue;
-		if (!strcmp(sr_config_info_data[i].id, optname))
-			return &sr_config_info_data[i];
-	}
+	if (!optname)
+		return NULL;
 
-	return NULL;
+	return g_hash_table_lookup(config_info_tables()->by_name, optname);
 }
 
 /** @} */
@@ -0,0 +1,355 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <glib.h>
+#include "libsigrok.h"
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "input/planar"
+
+#define MAX_CHUNK_SIZE   (1024 * 1024)
+#define MAX_CHANNELS     4096
+#define MAX_CHUNK_SAMPLES (256 * 1024 * 1024)
+
+/* Fixed part of the file header. */
+#define HEADER_SIZE      28
+
+/* See src/planar.c for the file format. */
+struct context {
+	gboolean started;
+	gboolean done;
+	uint64_t samplerate;
+	unsigned int num_channels;
+	int *channel_index;
+	unsigned int unitsize;
+	uint64_t chunk_samples;
+	uint8_t **planes;
+	uint8_t *samples;
+};
+
+static int format_match(GHashTable *metadata)
+{
+	GString *buf;
+
+	buf = g_hash_table_lookup(metadata, GINT_TO_POINTER(SR_INPUT_META_HEADER));
+	if (buf->len < 8 || memcmp(buf->str, SR_PLANAR_MAGIC, 8))
+		return SR_ERR;
+
+	return SR_OK;
+}
+
+static int init(struct sr_input *in, GHashTable *options)
+{
+	(void)options;
+
+	in->sdi = g_malloc0(sizeof(struct sr_dev_inst));
+	in->priv = g_malloc0(sizeof(struct context));
+
+	return SR_OK;
+}
+
+/*
+ * Parse the file header and create the channels.
+ *
+ * Returns SR_ERR_NA if the header isn't complete yet, otherwise the
+ * header is removed from the buffer.
+ */
+static int parse_header(struct sr_input *in)
+{
+	struct context *inc;
+	struct sr_channel *ch;
+	const uint8_t *p, *end;
+	unsigned int i, max_index, len;
+	char *name;
+
+	inc = in->priv;
+	if (in->buf->len < HEADER_SIZE)
+		return SR_ERR_NA;
+
+	p = (const uint8_t *)in->buf->str;
+	end = p + in->buf->len;
+	if (memcmp(p, SR_PLANAR_MAGIC, 8)) {
+		sr_err("Not a planar capture file.");
+		return SR_ERR_DATA;
+	}
+	if (RL32(p + 8) != SR_PLANAR_VERSION) {
+		sr_err("Unsupported planar file version %d.", RL32(p + 8));
+		return SR_ERR_DATA;
+	}
+	inc->num_channels = RL32(p + 12);
+	inc->chunk_samples = RL32(p + 16);
+	inc->samplerate = RL32(p + 20) | (uint64_t)RL32(p + 24) << 32;
+	if (inc->num_channels == 0 || inc->num_channels > MAX_CHANNELS
+			|| inc->chunk_samples == 0 || inc->chunk_samples % 8
+			|| inc->chunk_samples > MAX_CHUNK_SAMPLES) {
+		sr_err("Invalid planar file header.");
+		return SR_ERR_DATA;
+	}
+
+	/* Make sure the whole channel list is there before using it. */
+	p += HEADER_SIZE;
+	for (i = 0; i < inc->num_channels; i++) {
+		if (end - p < 8)
+			return SR_ERR_NA;
+		len = RL32(p + 4);
+		if ((uint64_t)(end - p) < 8 + (uint64_t)len)
+			return SR_ERR_NA;
+		p += 8 + len;
+	}
+
+	inc->channel_index = g_malloc(sizeof(int) * inc->num_channels);
+	p = (const uint8_t *)in->buf->str + HEADER_SIZE;
+	max_index = 0;
+	for (i = 0; i < inc->num_channels; i++) {
+		inc->channel_index[i] = RL32(p);
+		len = RL32(p + 4);
+		if (inc->channel_index[i] < 0
+				|| inc->channel_index[i] >= MAX_CHANNELS) {
+			sr_err("Invalid channel index %d.", inc->channel_index[i]);
+			return SR_ERR_DATA;
+		}
+		max_index = MAX(max_index, (unsigned int)inc->channel_index[i]);
+		name = g_strndup((const char *)p + 8, len);
+		ch = sr_channel_new(inc->channel_index[i], SR_CHANNEL_LOGIC,
+				TRUE, name);
+		in->sdi->channels = g_slist_append(in->sdi->channels, ch);
+		g_free(name);
+		p += 8 + len;
+	}
+	inc->unitsize = max_index / 8 + 1;
+	g_string_erase(in->buf, 0, p - (const uint8_t *)in->buf->str);
+
+	inc->planes = g_malloc0(sizeof(uint8_t *) * inc->num_channels);
+	for (i = 0; i < inc->num_channels; i++) {
+		if (!(inc->planes[i] = g_try_malloc(inc->chunk_samples / 8)))
+			return SR_ERR_MALLOC;
+	}
+	if (!(inc->samples = g_try_malloc(inc->chunk_samples * inc->unitsize)))
+		return SR_ERR_MALLOC;
+
+	return SR_OK;
+}
+
+static void send_samples(struct sr_input *in, uint64_t num_samples)
+{
+	struct context *inc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint64_t length, i, chunk;
+
+	inc = in->priv;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = inc->unitsize;
+	length = num_samples * inc->unitsize;
+	chunk = MAX_CHUNK_SIZE / inc->unitsize * inc->unitsize;
+	for (i = 0; i < length; i += logic.length) {
+		logic.data = inc->samples + i;
+		logic.length = MIN(chunk, length - i);
+		sr_session_send(in->sdi, &packet);
+	}
+}
+
+/*
+ * Decode the chunk at the start of the buffer, if it's complete.
+ *
+ * Returns the number of bytes used, 0 if the chunk isn't complete yet, or
+ * a negative error code.
+ */
+static int64_t process_chunk(struct sr_input *in)
+{
+	struct context *inc;
+	const uint8_t *p, *d;
+	uint64_t num_samples, raw_len, offset, len, chunk_len;
+	unsigned int i, dir_len;
+	int ret;
+
+	inc = in->priv;
+	p = (const uint8_t *)in->buf->str;
+	dir_len = 8 + 12 * inc->num_channels;
+	if (in->buf->len < dir_len)
+		return 0;
+
+	num_samples = RL32(p + 4);
+	if (num_samples == 0 || num_samples > inc->chunk_samples) {
+		sr_err("Invalid number of samples in chunk.");
+		return SR_ERR_DATA;
+	}
+	raw_len = (num_samples + 7) / 8;
+
+	chunk_len = dir_len;
+	for (i = 0; i < inc->num_channels; i++) {
+		d = p + 8 + 12 * i;
+		offset = RL32(d + 4);
+		len = RL32(d + 8);
+		if (offset < dir_len || (RL32(d) == SR_PLANAR_RAW && len != raw_len)) {
+			sr_err("Invalid chunk directory.");
+			return SR_ERR_DATA;
+		}
+		chunk_len = MAX(chunk_len, offset + len);
+	}
+	if (in->buf->len < chunk_len)
+		return 0;
+
+	for (i = 0; i < inc->num_channels; i++) {
+		d = p + 8 + 12 * i;
+		offset = RL32(d + 4);
+		len = RL32(d + 8);
+		switch (RL32(d)) {
+		case SR_PLANAR_RAW:
+			memcpy(inc->planes[i], p + offset, raw_len);
+			break;
+		case SR_PLANAR_RLE:
+			ret = sr_planar_rle_decode(p + offset, len, num_samples,
+					inc->planes[i]);
+			if (ret != SR_OK) {
+				sr_err("Invalid run-length encoding.");
+				return ret;
+			}
+			break;
+		default:
+			sr_err("Unknown plane encoding %d.", RL32(d));
+			return SR_ERR_DATA;
+		}
+	}
+
+	sr_planar_join(inc->planes, inc->channel_index, inc->num_channels,
+			num_samples, inc->unitsize, inc->samples);
+	send_samples(in, num_samples);
+
+	return chunk_len;
+}
+
+static int process_buffer(struct sr_input *in)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_meta meta;
+	struct sr_config *src;
+	struct context *inc;
+	int64_t used;
+
+	inc = in->priv;
+	if (!inc->started) {
+		std_session_send_df_header(in->sdi, LOG_PREFIX);
+
+		if (inc->samplerate) {
+			packet.type = SR_DF_META;
+			packet.payload = &meta;
+			src = sr_config_new(SR_CONF_SAMPLERATE,
+					g_variant_new_uint64(inc->samplerate));
+			meta.config = g_slist_append(NULL, src);
+			sr_session_send(in->sdi, &packet);
+			g_slist_free(meta.config);
+			sr_config_free(src);
+		}
+
+		inc->started = TRUE;
+	}
+
+	while (!inc->done && in->buf->len >= 4) {
+		if (!memcmp(in->buf->str, SR_PLANAR_INDEX_MAGIC, 4)) {
+			/* Only needed for random access, we're done. */
+			inc->done = TRUE;
+			break;
+		}
+		if (memcmp(in->buf->str, SR_PLANAR_CHUNK_MAGIC, 4)) {
+			sr_err("Invalid chunk.");
+			return SR_ERR_DATA;
+		}
+		if ((used = process_chunk(in)) < 0)
+			return used;
+		if (used == 0)
+			break;
+		g_string_erase(in->buf, 0, used);
+	}
+	if (inc->done)
+		g_string_truncate(in->buf, 0);
+
+	return SR_OK;
+}
+
+static int receive(struct sr_input *in, GString *buf)
+{
+	int ret;
+
+	g_string_append_len(in->buf, buf->str, buf->len);
+
+	if (!in->sdi_ready) {
+		if ((ret = parse_header(in)) == SR_ERR_NA)
+			/* Not enough data yet. */
+			return SR_OK;
+		else if (ret != SR_OK)
+			return ret;
+
+		/* sdi is ready, notify frontend. */
+		in->sdi_ready = TRUE;
+		return SR_OK;
+	}
+
+	return process_buffer(in);
+}
+
+static int end(struct sr_input *in)
+{
+	struct context *inc;
+	struct sr_datafeed_packet packet;
+	int ret;
+
+	if (in->sdi_ready)
+		ret = process_buffer(in);
+	else
+		ret = SR_OK;
+
+	inc = in->priv;
+	if (ret == SR_OK && inc->started && !inc->done && in->buf->len)
+		sr_warn("Truncated planar file.");
+
+	if (inc->started) {
+		packet.type = SR_DF_END;
+		sr_session_send(in->sdi, &packet);
+	}
+
+	return ret;
+}
+
+static void cleanup(struct sr_input *in)
+{
+	struct context *inc;
+	unsigned int i;
+
+	inc = in->priv;
+	if (inc->planes) {
+		for (i = 0; i < inc->num_channels; i++)
+			g_free(inc->planes[i]);
+	}
+	g_free(inc->planes);
+	g_free(inc->samples);
+	g_free(inc->channel_index);
+}
+
+SR_PRIV struct sr_input_module input_planar = {
+	.id = "planar",
+	.name = "Planar",
+	.desc = "Logic data stored per channel",
+	.metadata = { SR_INPUT_META_HEADER | SR_INPUT_META_REQUIRED },
+	.format_match = format_match,
+	.init = init,
+	.receive = receive,
+	.end = end,
+	.cleanup = cleanup,
+};
@@ -26,84 +26,6 @@
 
 #define LOG_PREFIX "es51919"
 
-struct dev_buffer {
-	/** Total size of the buffer. */
-	size_t size;
-	/** Amount of data currently in the buffer. */
-	size_t len;
-	/** Offset where the data starts in the buffer. */
-	size_t offset;
-	/** Space for the data. */
-	uint8_t data[];
-};
-
-static struct dev_buffer *dev_buffer_new(size_t size)
-{
-	struct dev_buffer *dbuf;
-
-	if (!(dbuf = g_try_malloc(sizeof(struct dev_buffer) + size))) {
-		sr_err("Dev buffer malloc failed (size=%zu).", size);
-		return NULL;
-	}
-
-	dbuf->size = size;
-	dbuf->len = 0;
-	dbuf->offset = 0;
-
-	return dbuf;
-}
-
-static void dev_buffer_destroy(struct dev_buffer *dbuf)
-{
-	g_free(dbuf);
-}
-
-static int dev_buffer_fill_serial(struct dev_buffer *dbuf,
-				  struct sr_dev_inst *sdi)
-{
-	struct sr_serial_dev_inst *serial;
-	int len;
-
-	serial = sdi->conn;
-
-	/* If we already have data, move it to the beginning of the buffer. */
-	if (dbuf->len > 0 && dbuf->offset > 0)
-		memmove(dbuf->data, dbuf->data + dbuf->offset, dbuf->len);
-
-	dbuf->offset = 0;
-
-	len = dbuf->size - dbuf->len;
-	len = serial_read_nonblocking(serial, dbuf->data + dbuf->len, len);
-	if (len < 0) {
-		sr_err("Serial port read error: %d.", len);
-		return len;
-	}
-
-	dbuf->len += len;
-
-	return SR_OK;
-}
-
-static uint8_t *dev_buffer_packet_find(struct dev_buffer *dbuf,
-				gboolean (*packet_valid)(const uint8_t *),
-				size_t packet_size)
-{
-	size_t offset;
-
-	while (dbuf->len >= packet_size) {
-		if (packet_valid(dbuf->data + dbuf->offset)) {
-			offset = dbuf->offset;
-			dbuf->offset += packet_size;
-			dbuf->len -= packet_size;
-			return dbuf->data + offset;
-		}
-		dbuf->offset++;
-		dbuf->len--;
-	}
-
-	return NULL;
-}
-
 struct dev_sample_counter {
 	/** The current number of already received samples. */
 	uint64_t count;
@@ -279,38 +201,6 @@ static int std_config_list(uint32_t key, GVariant **data,
 	return SR_OK;
 }
 
-static int send_config_update(struct sr_dev_inst *sdi, struct sr_config *cfg)
-{
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_meta meta;
-
-	memset(&meta, 0, sizeof(meta));
-
-	packet.type = SR_DF_META;
-	packet.payload = &meta;
-
-	meta.config = g_slist_append(meta.config, cfg);
-
-	return sr_session_send(sdi, &packet);
-}
-
-static int send_config_update_key(struct sr_dev_inst *sdi, uint32_t key,
-				  GVariant *var)
-{
-	struct sr_config *cfg;
-	int ret;
-
-	cfg = sr_config_new(key, var);
-	if (!cfg)
-		return SR_ERR;
-
-	ret = send_config_update(sdi, cfg);
-	sr_config_free(cfg);
-
-	return ret;
-
-}
-
 /*
  * Cyrustek ES51919 LCR chipset host protocol.
  *
@@ -430,6 +320,16 @@ static const char *const models[] = {
 	"NONE", "PARALLEL", "SERIES", "AUTO",
 };
 
+/* Device settings which are reported in META packets. */
+enum { CONFIG_FREQ, CONFIG_QUANT1, CONFIG_QUANT2, CONFIG_MODEL, NUM_CONFIGS, };
+
+static const uint32_t config_keys[NUM_CONFIGS] = {
+	SR_CONF_OUTPUT_FREQUENCY,
+	SR_CONF_MEASURED_QUANTITY,
+	SR_CONF_MEASURED_2ND_QUANTITY,
+	SR_CONF_EQUIV_CIRCUIT_MODEL,
+};
+
 /** Private, per-device-instance driver context. */
 struct dev_context {
 	/** Opaque pointer passed in by the frontend. */
@@ -442,7 +342,14 @@ struct dev_context {
 	struct dev_time_counter time_count;
 
 	/** Data buffer. */
-	struct dev_buffer *buf;
+	struct serial_packet_buffer pbuf;
+	uint8_t buf[PACKET_SIZE * 8];
+
+	/** Single-channel lists for the analog packets of P1 and P2. */
+	GSList *channel_lists[2];
+
+	/** Configuration values sent in META packets. */
+	struct sr_config configs[NUM_CONFIGS];
 
 	/** The frequency of the test signal (index to frequencies[]). */
 	unsigned int freq;
@@ -613,6 +520,9 @@ static unsigned int parse_model(const uint8_t *pkt)
 
 }
 
+/* Packets end with CR LF, see packet_valid(). */
+static const struct serial_packet_sync packet_sync = { 15, 0xff, 0xd };
+
 static gboolean packet_valid(const uint8_t *pkt)
 {
 	/*
@@ -628,38 +538,62 @@ static gboolean packet_valid(const uint8_t *pkt)
 	return FALSE;
 }
 
-static int do_config_update(struct sr_dev_inst *sdi, uint32_t key,
-			    GVariant *var)
+static GVariant *config_value(unsigned int config, unsigned int val)
 {
-	struct dev_context *devc;
-
-	devc = sdi->priv;
-
-	return send_config_update_key(devc->cb_data, key, var);
+	switch (config) {
+	case CONFIG_FREQ:
+		return g_variant_new_uint64(frequencies[val]);
+	case CONFIG_QUANT1:
+		return g_variant_new_string(quantities1[val]);
+	case CONFIG_QUANT2:
+		return g_variant_new_string(quantities2[val]);
+	default:
+		return g_variant_new_string(models[val]);
+	}
 }
 
-static int send_freq_update(struct sr_dev_inst *sdi, unsigned int freq)
+/*
+ * Send one META packet with all settings which differ from the last
+ * packet, and remember them. Nothing is sent if none changed.
+ */
+static int send_config_updates(struct sr_dev_inst *sdi,
+			       const unsigned int *vals)
 {
-	return do_config_update(sdi, SR_CONF_OUTPUT_FREQUENCY,
-				g_variant_new_uint64(frequencies[freq]));
-}
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_meta meta;
+	struct dev_context *devc;
+	unsigned int *cur[NUM_CONFIGS], i;
+	int ret;
 
-static int send_quant1_update(struct sr_dev_inst *sdi, unsigned int quant)
-{
-	return do_config_update(sdi, SR_CONF_MEASURED_QUANTITY,
-				g_variant_new_string(quantities1[quant]));
-}
+	devc = sdi->priv;
+	cur[CONFIG_FREQ] = &devc->freq;
+	cur[CONFIG_QUANT1] = &devc->quant1;
+	cur[CONFIG_QUANT2] = &devc->quant2;
+	cur[CONFIG_MODEL] = &devc->model;
+
+	meta.config = NULL;
+	for (i = 0; i < NUM_CONFIGS; i++) {
+		if (vals[i] == *cur[i])
+			continue;
+		if (devc->configs[i].data)
+			g_variant_unref(devc->configs[i].data);
+		devc->configs[i].data = g_variant_ref_sink(config_value(i, vals[i]));
+		meta.config = g_slist_append(meta.config, &devc->configs[i]);
+	}
+	if (!meta.config)
+		return SR_OK;
 
-static int send_quant2_update(struct sr_dev_inst *sdi, unsigned int quant)
-{
-	return do_config_update(sdi, SR_CONF_MEASURED_2ND_QUANTITY,
-				g_variant_new_string(quantities2[quant]));
-}
+	packet.type = SR_DF_META;
+	packet.payload = &meta;
+	ret = sr_session_send(devc->cb_data, &packet);
+	g_slist_free(meta.config);
+	if (ret != SR_OK)
+		return ret;
 
-static int send_model_update(struct sr_dev_inst *sdi, unsigned int model)
-{
-	return do_config_update(sdi, SR_CONF_EQUIV_CIRCUIT_MODEL,
-				g_variant_new_string(models[model]));
+	for (i = 0; i < NUM_CONFIGS; i++)
+		*cur[i] = vals[i];
+
+	return SR_OK;
 }
 
 static void handle_packet(struct sr_dev_inst *sdi, const uint8_t *pkt)
@@ -667,43 +601,18 @@ static void handle_packet(struct sr_dev_inst *sdi, const uint8_t *pkt)
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_analog analog;
 	struct dev_context *devc;
-	unsigned int val;
+	unsigned int vals[NUM_CONFIGS];
 	float floatval;
 	int count;
 
 	devc = sdi->priv;
 
-	val = parse_freq(pkt);
-	if (val != devc->freq) {
-		if (send_freq_update(sdi, val) == SR_OK)
-			devc->freq = val;
-		else
-			return;
-	}
-
-	val = parse_quant(pkt, 0);
-	if (val != devc->quant1) {
-		if (send_quant1_update(sdi, val) == SR_OK)
-			devc->quant1 = val;
-		else
-			return;
-	}
-
-	val = parse_quant(pkt, 1);
-	if (val != devc->quant2) {
-		if (send_quant2_update(sdi, val) == SR_OK)
-			devc->quant2 = val;
-		else
-			return;
-	}
-
-	val = parse_model(pkt);
-	if (val != devc->model) {
-		if (send_model_update(sdi, val) == SR_OK)
-			devc->model = val;
-		else
-			return;
-	}
+	vals[CONFIG_FREQ] = parse_freq(pkt);
+	vals[CONFIG_QUANT1] = parse_quant(pkt, 0);
+	vals[CONFIG_QUANT2] = parse_quant(pkt, 1);
+	vals[CONFIG_MODEL] = parse_model(pkt);
+	if (send_config_updates(sdi, vals) != SR_OK)
+		return;
 
 	count = 0;
 
@@ -715,7 +624,7 @@ static void handle_packet(struct sr_dev_inst *sdi, const uint8_t *pkt)
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &analog;
 
-	analog.channels = g_slist_append(NULL, sdi->channels->data);
+	analog.channels = devc->channel_lists[0];
 
 	parse_measurement(pkt, &floatval, &analog, 0);
 	if (analog.mq >= 0) {
@@ -723,7 +632,7 @@ static void handle_packet(struct sr_dev_inst *sdi, const uint8_t *pkt)
 			count++;
 	}
 
-	analog.channels = g_slist_append(NULL, sdi->channels->next->data);
+	analog.channels = devc->channel_lists[1];
 
 	parse_measurement(pkt, &floatval, &analog, 1);
 	if (analog.mq >= 0) {
@@ -738,17 +647,18 @@ static void handle_packet(struct sr_dev_inst *sdi, const uint8_t *pkt)
 static int handle_new_data(struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
-	uint8_t *pkt;
+	const uint8_t *pkt;
 	int ret;
 
 	devc = sdi->priv;
 
-	ret = dev_buffer_fill_serial(devc->buf, sdi);
-	if (ret < 0)
+	ret = serial_packet_buffer_fill(&devc->pbuf, sdi->conn);
+	if (ret < 0) {
+		sr_err("Serial port read error: %d.", ret);
 		return ret;
+	}
 
-	while ((pkt = dev_buffer_packet_find(devc->buf, packet_valid,
-					     PACKET_SIZE)))
+	while ((pkt = serial_packet_find(&devc->pbuf)))
 		handle_packet(sdi, pkt);
 
 	return SR_OK;
@@ -810,11 +720,17 @@ static int setup_channels(struct sr_dev_inst *sdi)
 SR_PRIV void es51919_serial_clean(void *priv)
 {
 	struct dev_context *devc;
+	unsigned int i;
 
 	if (!(devc = priv))
 		return;
 
-	dev_buffer_destroy(devc->buf);
+	for (i = 0; i < ARRAY_SIZE(devc->channel_lists); i++)
+		g_slist_free(devc->channel_lists[i]);
+	for (i = 0; i < NUM_CONFIGS; i++) {
+		if (devc->configs[i].data)
+			g_variant_unref(devc->configs[i].data);
+	}
 	g_free(devc);
 }
 
@@ -825,6 +741,7 @@ SR_PRIV struct sr_dev_inst *es51919_serial_scan(GSList *options,
 	struct sr_serial_dev_inst *serial;
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
+	unsigned int i;
 	int ret;
 
 	serial = NULL;
@@ -846,9 +763,8 @@ SR_PRIV struct sr_dev_inst *es51919_serial_scan(GSList *options,
 	sdi->vendor = g_strdup(vendor);
 	sdi->model = g_strdup(model);
 	devc = g_malloc0(sizeof(struct dev_context));
-
-	if (!(devc->buf = dev_buffer_new(PACKET_SIZE * 8)))
-		goto scan_cleanup;
+	for (i = 0; i < NUM_CONFIGS; i++)
+		devc->configs[i].key = config_keys[i];
 
 	sdi->inst_type = SR_INST_SERIAL;
 	sdi->conn = serial;
@@ -858,6 +774,9 @@ SR_PRIV struct sr_dev_inst *es51919_serial_scan(GSList *options,
 	if (setup_channels(sdi) != SR_OK)
 		goto scan_cleanup;
 
+	devc->channel_lists[0] = g_slist_append(NULL, sdi->channels->data);
+	devc->channel_lists[1] = g_slist_append(NULL, sdi->channels->next->data);
+
 	return sdi;
 
 scan_cleanup:
@@ -1005,6 +924,9 @@ SR_PRIV int es51919_serial_acquisition_start(const struct sr_dev_inst *sdi,
 	dev_sample_counter_start(&devc->sample_count);
 	dev_time_counter_start(&devc->time_count);
 
+	serial_packet_buffer_init(&devc->pbuf, devc->buf, sizeof(devc->buf),
+			PACKET_SIZE, &packet_sync, packet_valid);
+
 	/* Send header packet to the session bus. */
 	std_session_send_df_header(cb_data, LOG_PREFIX);
 
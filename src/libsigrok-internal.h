@@ -428,6 +428,76 @@ struct sr_usb_dev_inst {
 	/** libusb device handle */
 	struct libusb_device_handle *devhdl;
 };
+
+struct sr_usb_download;
+
+/**
+ * Request the next chunk of a download from the device, before it is
+ * read. Returns SR_OK, or an error to abort the download.
+ */
+typedef int (*sr_usb_download_request_cb)(struct sr_usb_download *dl,
+		uint64_t offset, unsigned int len);
+/**
+ * Convert and send a piece of the downloaded data. Pieces come in order,
+ * and never straddle the trigger. Returns FALSE to end the download early.
+ */
+typedef gboolean (*sr_usb_download_convert_cb)(struct sr_usb_download *dl,
+		const uint8_t *buf, unsigned int len);
+
+/** Bulk download of device memory, see sr_usb_download_start(). */
+struct sr_usb_download {
+	/* Set up by the driver. */
+	/** Session callback data, the trigger is sent with it. */
+	void *cb_data;
+	/** Passed on to the callbacks. */
+	void *priv;
+	unsigned char endpoint;
+	/** Bytes per transfer. */
+	unsigned int chunk_size;
+	/** Number of transfers queued at once. */
+	unsigned int num_transfers;
+	/** Transfer timeout in ms. */
+	unsigned int timeout;
+	/** Bytes to read from the device. */
+	uint64_t size;
+	/** Bytes at the start to read and drop. */
+	uint64_t skip;
+	/** Bytes after those to keep, the download ends after them. */
+	uint64_t length;
+	/** Whether SR_DF_TRIGGER is to be sent at trigger_pos. */
+	gboolean has_trigger;
+	/** Offset of the trigger in the kept bytes. */
+	uint64_t trigger_pos;
+	/** Called before each transfer is submitted, may be NULL. */
+	sr_usb_download_request_cb request;
+	sr_usb_download_convert_cb convert;
+
+	/* Statistics. */
+	/** Bytes received from the device. */
+	uint64_t bytes_received;
+	/** Bytes handed to the convert callback. */
+	uint64_t bytes_kept;
+	uint64_t num_chunks;
+	/** Transfers that came back with less than was asked for. */
+	uint64_t short_chunks;
+	int64_t start_time;
+	int64_t end_time;
+
+	/** Set by sr_usb_download_start(). */
+	libusb_device_handle *devhdl;
+
+	/* Private to usb.c. */
+	struct libusb_transfer **transfers;
+	/** Completed buffer, converted while the next transfer runs. */
+	unsigned char *spare;
+	unsigned int busy;
+	uint64_t submitted;
+	/** Time up to which the download time went into the statistics. */
+	int64_t stats_time;
+	gboolean triggered;
+	gboolean finished;
+	int status;
+};
 #endif
 
 #ifdef HAVE_LIBSERIALPORT
@@ -462,6 +532,28 @@ struct drv_context {
 
 /*--- log.c -----------------------------------------------------------------*/
 
+/*
+ * Messages more verbose than this are compiled out, together with the
+ * evaluation of their arguments. Override with e.g.
+ * CPPFLAGS=-DSR_LOG_MAX_LEVEL=SR_LOG_INFO.
+ */
+#ifndef SR_LOG_MAX_LEVEL
+#define SR_LOG_MAX_LEVEL SR_LOG_SPEW
+#endif
+
+/*
+ * Most verbose loglevel passed on to the log callback. This is the
+ * selected loglevel for the built-in callback; custom callbacks get
+ * every message and filter for themselves.
+ */
+extern SR_PRIV int sr_log_filter_level;
+
+/** Whether a message of the given loglevel is passed to the log callback. */
+static inline gboolean sr_log_enabled(int loglevel)
+{
+	return loglevel <= SR_LOG_MAX_LEVEL && loglevel <= sr_log_filter_level;
+}
+
 SR_PRIV int sr_log(int loglevel, const char *format, ...);
 SR_PRIV int sr_spew(const char *format, ...);
 SR_PRIV int sr_dbg(const char *format, ...);
@@ -471,12 +563,19 @@ SR_PRIV int sr_err(const char *format, ...);
 
 /* Message logging helpers with subsystem-specific prefix string. */
 #ifndef NO_LOG_WRAPPERS
-#define sr_log(l, s, args...) sr_log(l, "%s: " s, LOG_PREFIX, ## args)
-#define sr_spew(s, args...) sr_spew("%s: " s, LOG_PREFIX, ## args)
-#define sr_dbg(s, args...) sr_dbg("%s: " s, LOG_PREFIX, ## args)
-#define sr_info(s, args...) sr_info("%s: " s, LOG_PREFIX, ## args)
-#define sr_warn(s, args...) sr_warn("%s: " s, LOG_PREFIX, ## args)
-#define sr_err(s, args...) sr_err("%s: " s, LOG_PREFIX, ## args)
+#define sr_log(l, s, args...) ({ int sr_log_level_ = (l); \
+	sr_log_enabled(sr_log_level_) ? sr_log(sr_log_level_, \
+	"%s: " s, LOG_PREFIX, ## args) : SR_OK; })
+#define sr_spew(s, args...) (sr_log_enabled(SR_LOG_SPEW) ? \
+	sr_spew("%s: " s, LOG_PREFIX, ## args) : SR_OK)
+#define sr_dbg(s, args...) (sr_log_enabled(SR_LOG_DBG) ? \
+	sr_dbg("%s: " s, LOG_PREFIX, ## args) : SR_OK)
+#define sr_info(s, args...) (sr_log_enabled(SR_LOG_INFO) ? \
+	sr_info("%s: " s, LOG_PREFIX, ## args) : SR_OK)
+#define sr_warn(s, args...) (sr_log_enabled(SR_LOG_WARN) ? \
+	sr_warn("%s: " s, LOG_PREFIX, ## args) : SR_OK)
+#define sr_err(s, args...) (sr_log_enabled(SR_LOG_ERR) ? \
+	sr_err("%s: " s, LOG_PREFIX, ## args) : SR_OK)
 #endif
 
 /*--- device.c --------------------------------------------------------------*/
@@ -512,6 +611,10 @@ struct sr_dev_inst {
 	GSList *channels;
 	/** List of sr_channel_group structs */
 	GSList *channel_groups;
+	/** Enabled channels, see sr_dev_inst_channel_table_get(). */
+	struct sr_channel_table *channel_table;
+	/** Configuration values read from the device, see sr_config_get(). */
+	GHashTable *config_cache;
 	/** Device instance connection data (used?) */
 	void *conn;
 	/** Device instance private data (used?) */
@@ -522,6 +625,7 @@ struct sr_dev_inst {
 
 /* Generic device instances */
 SR_PRIV void sr_dev_inst_free(struct sr_dev_inst *sdi);
+SR_PRIV void sr_dev_inst_channel_table_update(struct sr_dev_inst *sdi);
 
 #ifdef HAVE_LIBUSB_1_0
 /* USB-specific instances */
@@ -592,16 +696,176 @@ struct sr_session {
 	GMutex stop_mutex;
 	/** Abort current session. See sr_session_stop(). */
 	gboolean abort_session;
+
+	/**
+	 * Mutex protecting the statistics below and those of the datafeed
+	 * callbacks, which front ends may read from another thread.
+	 */
+	GMutex stats_mutex;
+	/** Statistics of the whole session. */
+	struct sr_session_stats stats;
+	/** Statistics per device, keyed by struct sr_dev_inst pointer. */
+	GHashTable *dev_stats;
+	/** Time datafeed callbacks and event loop iterations. */
+	gboolean stats_timing;
+};
+
+/** Counters drivers can add to, see sr_session_stats_add(). */
+enum {
+	SR_STATS_OVERRUNS,
+	SR_STATS_EMPTY_TRANSFERS,
+	SR_STATS_LOST_SAMPLES,
+	SR_STATS_DOWNLOAD_SIZE,
+	SR_STATS_DOWNLOAD_BYTES,
+	SR_STATS_DOWNLOAD_USEC,
 };
 
 SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		const struct sr_datafeed_packet *packet);
 SR_PRIV int sr_session_stop_sync(struct sr_session *session);
+SR_PRIV void sr_session_stats_add(const struct sr_dev_inst *sdi,
+		int counter, uint64_t n);
 SR_PRIV int sr_sessionfile_check(const char *filename);
+
+/*--- session_file.c --------------------------------------------------------*/
+
+/** Suffix of the sample index entry next to a capture file in a session file. */
+#define SR_SESSIONFILE_INDEX_SUFFIX ".idx"
+
+struct zip;
+
+/** A capture file chunk in a session file archive. */
+struct sr_sessionfile_chunk {
+	/** Chunk number, 0 for an unchunked capture file. */
+	int num;
+	/** Index of the chunk in the zip archive. */
+	uint64_t index;
+};
+
+/**
+ * Sample index entry for one capture file chunk. The masks summarize
+ * the first 64 channels: a channel is constant within the chunk if its
+ * bit is clear in transitions.
+ */
+struct sr_sessionfile_index_entry {
+	int chunk;
+	uint64_t start_sample;
+	uint64_t num_samples;
+	uint64_t byte_offset;
+	uint64_t or_mask;
+	uint64_t and_mask;
+	uint64_t transitions;
+	uint64_t last_sample;
+};
+
+SR_PRIV int sr_sessionfile_chunks_find(struct zip *archive,
+		const char *capturefile, GArray **chunks);
+SR_PRIV uint64_t sr_sessionfile_index_scan(
+		struct sr_sessionfile_index_entry *entry, int chunk,
+		const uint8_t *buf, int unitsize, uint64_t length);
+SR_PRIV void sr_sessionfile_index_append(GArray *index,
+		struct sr_sessionfile_index_entry *entry, uint64_t first,
+		int unitsize);
+SR_PRIV void sr_sessionfile_index_add(GArray *index, int chunk,
+		const uint8_t *buf, int unitsize, uint64_t length);
+SR_PRIV int sr_sessionfile_index_load(struct zip *archive,
+		const char *capturefile, GArray **index);
+SR_PRIV int sr_sessionfile_index_save(struct zip *archive,
+		const char *capturefile, GArray *index);
+SR_PRIV int sr_sessionfile_entry_save(struct zip *archive, const char *name,
+		const void *data, uint64_t length);
 SR_PRIV int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		struct sr_datafeed_packet **copy);
 SR_PRIV void sr_packet_free(struct sr_datafeed_packet *packet);
 
+/*--- summary.c -------------------------------------------------------------*/
+
+/** Suffix of the summary entry next to a capture file in a session file. */
+#define SR_SESSIONFILE_SUMMARY_SUFFIX ".sum"
+
+#define SR_SUMMARY_MAX_LEVELS 32
+
+enum {
+	SR_SUMMARY_LOGIC = 1,
+	SR_SUMMARY_ANALOG,
+};
+
+/** Multi-resolution summary of a logic or analog sample stream. */
+struct sr_summary {
+	int type;
+	/** Number of samples or nodes covered by a node of the next level. */
+	unsigned int factor;
+	/** Unit size for logic data, 1 for analog data. */
+	unsigned int width;
+	unsigned int node_size;
+	uint64_t num_samples;
+	unsigned int num_levels;
+	/** Finished nodes, per level. */
+	GByteArray *levels[SR_SUMMARY_MAX_LEVELS];
+	/** Node being built, per level. */
+	uint8_t *acc[SR_SUMMARY_MAX_LEVELS];
+	unsigned int acc_count[SR_SUMMARY_MAX_LEVELS];
+	uint8_t *last_sample;
+	gboolean finished;
+	char *name;
+};
+
+SR_PRIV struct sr_summary *sr_summary_new(int type, unsigned int width,
+		unsigned int factor, const char *name);
+SR_PRIV void sr_summary_free(struct sr_summary *s);
+SR_PRIV void sr_summary_logic_feed(struct sr_summary *s, const uint8_t *data,
+		uint64_t length);
+SR_PRIV void sr_summary_analog_feed(struct sr_summary *s, const float *data,
+		uint64_t num_samples, unsigned int stride);
+SR_PRIV void sr_summary_finish(struct sr_summary *s);
+SR_PRIV void sr_summary_serialize(struct sr_summary *s, GString *out);
+
+/*--- planar.c --------------------------------------------------------------*/
+
+#define SR_PLANAR_MAGIC "SRPLANAR"
+#define SR_PLANAR_END_MAGIC "SRPLEND1"
+#define SR_PLANAR_CHUNK_MAGIC "PLCH"
+#define SR_PLANAR_INDEX_MAGIC "PLIX"
+#define SR_PLANAR_VERSION 1
+
+/** Encoding of a plane in a planar capture file. */
+enum {
+	SR_PLANAR_RAW,
+	SR_PLANAR_RLE,
+};
+
+SR_PRIV uint64_t sr_transpose8x8(uint64_t x);
+SR_PRIV void sr_planar_split(const uint8_t *data, unsigned int unitsize,
+		uint64_t num_samples, const int *channel_index,
+		unsigned int num_channels, uint8_t **planes);
+SR_PRIV void sr_planar_join(uint8_t * const *planes, const int *channel_index,
+		unsigned int num_channels, uint64_t num_samples,
+		unsigned int unitsize, uint8_t *data);
+SR_PRIV uint64_t sr_planar_rle_encode(const uint8_t *plane, uint64_t num_samples,
+		uint8_t *out, uint64_t max_len);
+SR_PRIV int sr_planar_rle_decode(const uint8_t *src, uint64_t len,
+		uint64_t num_samples, uint8_t *plane);
+
+/*--- output/logic_text.c ---------------------------------------------------*/
+
+struct sr_logic_text_row;
+
+SR_PRIV struct sr_logic_text_row *sr_logic_text_row_new(const int *channel_index,
+		unsigned int num_channels, char zero, char one, const char *sep,
+		const char *end);
+SR_PRIV void sr_logic_text_row_free(struct sr_logic_text_row *row);
+SR_PRIV unsigned int sr_logic_text_row_len(const struct sr_logic_text_row *row);
+SR_PRIV char *sr_logic_text_rows(const struct sr_logic_text_row *row,
+		char *dst, const uint8_t *data, unsigned int unitsize,
+		uint64_t num_samples);
+SR_PRIV void sr_logic_text_transpose(const uint8_t *data, unsigned int unitsize,
+		unsigned int num_samples, const int *channel_index,
+		unsigned int num_channels, uint8_t *out);
+SR_PRIV const char *sr_logic_text_bits(uint8_t group);
+SR_PRIV const char *sr_logic_text_hex(uint8_t group);
+SR_PRIV const char *sr_logic_text_ascii(gboolean prev, uint8_t group);
+SR_PRIV char *sr_logic_text_u64(char *dst, uint64_t value);
+
 /*--- analog.c --------------------------------------------------------------*/
 
 SR_PRIV int sr_analog_init(struct sr_datafeed_analog2 *analog,
@@ -637,6 +901,12 @@ SR_PRIV int sr_atod(const char *str, double *ret);
 SR_PRIV int sr_atof(const char *str, float *ret);
 SR_PRIV int sr_atof_ascii(const char *str, float *ret);
 
+/** Buffer size needed by sr_float_to_str() and sr_float_to_str_fixed(). */
+#define SR_FLOAT_STR_MAXLEN 32
+
+SR_PRIV int sr_float_to_str(float value, char *buf);
+SR_PRIV int sr_float_to_str_fixed(float value, int decimals, char *buf);
+
 /*--- soft-trigger.c --------------------------------------------------------*/
 
 struct soft_trigger_logic {
@@ -656,6 +926,17 @@ SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *st, uint8_t *buf
 
 /*--- hardware/serial.c -----------------------------------------------------*/
 
+/**
+ * A byte every packet of a protocol has in common, used to skip ahead to
+ * possible packet starts in a stream. A packet can only start at offsets
+ * where (byte[offset] & mask) == value. A mask of 0 matches anywhere.
+ */
+struct serial_packet_sync {
+	size_t offset;
+	uint8_t mask;
+	uint8_t value;
+};
+
 #ifdef HAVE_LIBSERIALPORT
 enum {
 	SERIAL_RDWR = 1,
@@ -664,6 +945,20 @@ enum {
 
 typedef gboolean (*packet_valid_callback)(const uint8_t *buf);
 
+/** Buffer splitting a stream of serial data into fixed-size packets. */
+struct serial_packet_buffer {
+	/** Space for the data, and its total size. */
+	uint8_t *data;
+	size_t size;
+	/** Offset where unprocessed data starts in the buffer. */
+	size_t offset;
+	/** Amount of unprocessed data in the buffer. */
+	size_t len;
+	size_t packet_size;
+	struct serial_packet_sync sync;
+	packet_valid_callback packet_valid;
+};
+
 SR_PRIV int serial_open(struct sr_serial_dev_inst *serial, int flags);
 SR_PRIV int serial_close(struct sr_serial_dev_inst *serial);
 SR_PRIV int serial_flush(struct sr_serial_dev_inst *serial);
@@ -687,6 +982,13 @@ SR_PRIV int serial_stream_detect(struct sr_serial_dev_inst *serial,
 				 size_t packet_size,
 				 packet_valid_callback is_valid,
 				 uint64_t timeout_ms, int baudrate);
+SR_PRIV void serial_packet_buffer_init(struct serial_packet_buffer *pbuf,
+		uint8_t *data, size_t size, size_t packet_size,
+		const struct serial_packet_sync *sync,
+		packet_valid_callback packet_valid);
+SR_PRIV int serial_packet_buffer_fill(struct serial_packet_buffer *pbuf,
+		struct sr_serial_dev_inst *serial);
+SR_PRIV const uint8_t *serial_packet_find(struct serial_packet_buffer *pbuf);
 SR_PRIV int sr_serial_extract_options(GSList *options, const char **serial_device,
 				      const char **serial_options);
 SR_PRIV int serial_source_add(struct sr_session *session,
@@ -717,6 +1019,11 @@ SR_PRIV int usb_source_add(struct sr_session *session, struct sr_context *ctx,
 		int timeout, sr_receive_data_callback cb, void *cb_data);
 SR_PRIV int usb_source_remove(struct sr_session *session, struct sr_context *ctx);
 SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len);
+SR_PRIV int sr_usb_download_start(struct sr_usb_download *dl,
+		libusb_device_handle *devhdl);
+SR_PRIV void sr_usb_download_abort(struct sr_usb_download *dl);
+SR_PRIV gboolean sr_usb_download_done(const struct sr_usb_download *dl);
+SR_PRIV void sr_usb_download_free(struct sr_usb_download *dl);
 #endif
 
 /*--- hardware/scpi.c -------------------------------------------------------*/
@@ -748,6 +1055,7 @@ enum {
 	SCPI_CMD_GET_DIG_DATA,
 	SCPI_CMD_GET_SAMPLE_RATE,
 	SCPI_CMD_GET_SAMPLE_RATE_LIVE,
+	SCPI_CMD_SET_DATA_FORMAT,
 };
 
 struct sr_scpi_hw_info {
@@ -772,6 +1080,8 @@ struct sr_scpi_dev_inst {
 	int (*read_begin)(void *priv);
 	int (*read_data)(void *priv, char *buf, int maxlen);
 	int (*read_complete)(void *priv);
+	/* Optional, read_data without any terminator handling. */
+	int (*read_raw)(void *priv, char *buf, int maxlen);
 	int (*close)(void *priv);
 	void (*free)(void *priv);
 	unsigned int read_timeout_ms;
@@ -795,6 +1105,7 @@ SR_PRIV int sr_scpi_send_variadic(struct sr_scpi_dev_inst *scpi,
 SR_PRIV int sr_scpi_read_begin(struct sr_scpi_dev_inst *scpi);
 SR_PRIV int sr_scpi_read_data(struct sr_scpi_dev_inst *scpi, char *buf, int maxlen);
 SR_PRIV int sr_scpi_read_complete(struct sr_scpi_dev_inst *scpi);
+SR_PRIV int sr_scpi_read_raw(struct sr_scpi_dev_inst *scpi, char *buf, int maxlen);
 SR_PRIV int sr_scpi_close(struct sr_scpi_dev_inst *scpi);
 SR_PRIV void sr_scpi_free(struct sr_scpi_dev_inst *scpi);
 
@@ -813,6 +1124,8 @@ SR_PRIV int sr_scpi_get_floatv(struct sr_scpi_dev_inst *scpi,
 			const char *command, GArray **scpi_response);
 SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 			const char *command, GArray **scpi_response);
+SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
+			const char *command, GByteArray **scpi_response);
 SR_PRIV int sr_scpi_get_hw_id(struct sr_scpi_dev_inst *scpi,
 			struct sr_scpi_hw_info **scpi_response);
 SR_PRIV void sr_scpi_hw_info_free(struct sr_scpi_hw_info *hw_info);
@@ -826,6 +1139,10 @@ SR_PRIV void sr_scpi_hw_info_free(struct sr_scpi_hw_info *hw_info);
 #define ES519XX_11B_PACKET_SIZE (11 * 2)
 #define ES519XX_14B_PACKET_SIZE 14
 
+/* Packets end with CR LF. */
+#define ES519XX_11B_PACKET_SYNC { 9, 0xff, '\r' }
+#define ES519XX_14B_PACKET_SYNC { 12, 0xff, '\r' }
+
 struct es519xx_info {
 	gboolean is_judge, is_voltage, is_auto, is_micro, is_current;
 	gboolean is_milli, is_resistance, is_continuity, is_diode;
@@ -865,6 +1182,7 @@ SR_PRIV int sr_es519xx_19200_14b_sel_lpf_parse(const uint8_t *buf,
 /*--- hardware/dmm/fs9922.c -------------------------------------------------*/
 
 #define FS9922_PACKET_SIZE 14
+#define FS9922_PACKET_SYNC { 12, 0xff, '\r' }
 
 struct fs9922_info {
 	gboolean is_auto, is_dc, is_ac, is_rel, is_hold, is_bpn, is_z1, is_z2;
@@ -883,6 +1201,8 @@ SR_PRIV void sr_fs9922_z1_diode(struct sr_datafeed_analog *analog, void *info);
 /*--- hardware/dmm/fs9721.c -------------------------------------------------*/
 
 #define FS9721_PACKET_SIZE 14
+/* The upper nibble of every byte is its position, starting at 1. */
+#define FS9721_PACKET_SYNC { 0, 0xf0, 0x10 }
 
 struct fs9721_info {
 	gboolean is_ac, is_dc, is_auto, is_rs232, is_micro, is_nano, is_kilo;
@@ -903,6 +1223,7 @@ SR_PRIV void sr_fs9721_max_c_min(struct sr_datafeed_analog *analog, void *info);
 /*--- hardware/dmm/m2110.c --------------------------------------------------*/
 
 #define BBCGM_M2110_PACKET_SIZE 9
+#define BBCGM_M2110_PACKET_SYNC { 7, 0xff, '\r' }
 
 SR_PRIV gboolean sr_m2110_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_m2110_parse(const uint8_t *buf, float *floatval,
@@ -911,6 +1232,7 @@ SR_PRIV int sr_m2110_parse(const uint8_t *buf, float *floatval,
 /*--- hardware/dmm/metex14.c ------------------------------------------------*/
 
 #define METEX14_PACKET_SIZE 14
+#define METEX14_PACKET_SYNC { 13, 0xff, '\r' }
 
 struct metex14_info {
 	gboolean is_ac, is_dc, is_resistance, is_capacity, is_temperature;
@@ -930,6 +1252,8 @@ SR_PRIV int sr_metex14_parse(const uint8_t *buf, float *floatval,
 /*--- hardware/dmm/rs9lcd.c -------------------------------------------------*/
 
 #define RS9LCD_PACKET_SIZE 9
+/* Binary packets, nothing to sync on. */
+#define RS9LCD_PACKET_SYNC { 0, 0, 0 }
 
 /* Dummy info struct. The parser does not use it. */
 struct rs9lcd_info { int dummy; };
@@ -941,6 +1265,7 @@ SR_PRIV int sr_rs9lcd_parse(const uint8_t *buf, float *floatval,
 /*--- hardware/dmm/bm25x.c --------------------------------------------------*/
 
 #define BRYMEN_BM25X_PACKET_SIZE 15
+#define BRYMEN_BM25X_PACKET_SYNC { 0, 0xff, 0x02 }
 
 /* Dummy info struct. The parser does not use it. */
 struct bm25x_info { int dummy; };
@@ -952,6 +1277,7 @@ SR_PRIV int sr_brymen_bm25x_parse(const uint8_t *buf, float *floatval,
 /*--- hardware/dmm/ut71x.c --------------------------------------------------*/
 
 #define UT71X_PACKET_SIZE 11
+#define UT71X_PACKET_SYNC { 9, 0xff, '\r' }
 
 struct ut71x_info {
 	gboolean is_voltage, is_resistance, is_capacitance, is_temperature;
@@ -43,6 +43,12 @@
 /* Currently selected libsigrok loglevel. Default: SR_LOG_WARN. */
 static int cur_loglevel = SR_LOG_WARN; /* Show errors+warnings per default. */
 
+/*
+ * Checked by the logging macros before the arguments are evaluated:
+ * cur_loglevel with the built-in log callback, everything otherwise.
+ */
+SR_PRIV int sr_log_filter_level = SR_LOG_WARN;
+
 /* Function prototype. */
 static int sr_logv(void *cb_data, int loglevel, const char *format,
 		   va_list args);
@@ -63,6 +69,38 @@ static void *sr_log_cb_data = NULL;
 /** @endcond */
 static char sr_log_domain[LOGDOMAIN_MAXLEN + 1] = LOGDOMAIN_DEFAULT;
 
+/*
+ * Asynchronous logging: messages are formatted into a ring of fixed-size
+ * slots by the logging thread, and passed to the log callback by a
+ * separate thread. Writers claim a slot by atomically advancing the head,
+ * and mark it ready once the message is in place. The log thread sleeps
+ * on a condition while the ring is empty, and writers only take the
+ * mutex to wake it up when it's waiting.
+ */
+/** @cond PRIVATE */
+#define LOG_RING_SLOTS 1024
+#define LOG_MSG_MAXLEN 256
+/** @endcond */
+
+struct log_slot {
+	volatile gint ready;
+	int loglevel;
+	char msg[LOG_MSG_MAXLEN];
+};
+
+static struct log_slot log_ring[LOG_RING_SLOTS];
+static volatile gint log_ring_head;
+static volatile gint log_ring_tail;
+static volatile gint log_dropped;
+static volatile gint log_async;
+/* Writers between checking log_async and finishing their slot. */
+static volatile gint log_writers;
+static volatile gint log_thread_stop;
+static volatile gint log_thread_waiting;
+static GMutex log_mutex;
+static GCond log_cond;
+static GThread *log_thread;
+
 /**
  * Set the libsigrok loglevel.
  *
@@ -88,6 +126,8 @@ SR_API int sr_log_loglevel_set(int loglevel)
 	}
 
 	cur_loglevel = loglevel;
+	if (sr_log_cb == sr_logv)
+		sr_log_filter_level = loglevel;
 
 	sr_dbg("libsigrok loglevel set to %d.", loglevel);
 
@@ -154,6 +194,10 @@ SR_API char *sr_log_logdomain_get(void)
 /**
  * Set the libsigrok log callback to the specified function.
  *
+ * The callback gets messages of every loglevel and should filter them
+ * itself, e.g. using sr_log_loglevel_get(). Only messages more verbose
+ * than the SR_LOG_MAX_LEVEL libsigrok was built with are left out.
+ *
  * @param cb Function pointer to the log callback function to use.
  *           Must not be NULL.
  * @param cb_data Pointer to private data to be passed on. This can be used by
@@ -177,6 +221,7 @@ SR_API int sr_log_callback_set(sr_log_callback cb, void *cb_data)
 
 	sr_log_cb = cb;
 	sr_log_cb_data = cb_data;
+	sr_log_filter_level = (cb == sr_logv) ? cur_loglevel : SR_LOG_SPEW;
 
 	return SR_OK;
 }
@@ -198,6 +243,7 @@ SR_API int sr_log_callback_set_default(void)
 	 */
 	sr_log_cb = sr_logv;
 	sr_log_cb_data = NULL;
+	sr_log_filter_level = cur_loglevel;
 
 	return SR_OK;
 }
@@ -221,6 +267,148 @@ static int sr_logv(void *cb_data, int loglevel, const char *format, va_list args
 	return ret;
 }
 
+static int log_cb_call(int loglevel, const char *format, ...)
+{
+	int ret;
+	va_list args;
+
+	va_start(args, format);
+	ret = sr_log_cb(sr_log_cb_data, loglevel, format, args);
+	va_end(args);
+
+	return ret;
+}
+
+static gpointer log_thread_run(gpointer data)
+{
+	struct log_slot *slot;
+	guint tail;
+	gint dropped;
+
+	(void)data;
+
+	tail = g_atomic_int_get(&log_ring_tail);
+	while (TRUE) {
+		slot = &log_ring[tail % LOG_RING_SLOTS];
+		if (!g_atomic_int_get(&slot->ready)) {
+			/* Only stop once every claimed slot has been passed on. */
+			if (g_atomic_int_get(&log_thread_stop)
+					&& tail == (guint)g_atomic_int_get(&log_ring_head))
+				break;
+			g_mutex_lock(&log_mutex);
+			g_atomic_int_set(&log_thread_waiting, 1);
+			while (!g_atomic_int_get(&slot->ready)
+					&& !(g_atomic_int_get(&log_thread_stop)
+					&& tail == (guint)g_atomic_int_get(&log_ring_head)))
+				g_cond_wait(&log_cond, &log_mutex);
+			g_atomic_int_set(&log_thread_waiting, 0);
+			g_mutex_unlock(&log_mutex);
+			continue;
+		}
+		log_cb_call(slot->loglevel, "%s", slot->msg);
+		g_atomic_int_set(&slot->ready, 0);
+		g_atomic_int_set(&log_ring_tail, ++tail);
+
+		if ((dropped = g_atomic_int_get(&log_dropped))) {
+			g_atomic_int_add(&log_dropped, -dropped);
+			log_cb_call(SR_LOG_WARN, "log: %d messages dropped.",
+					dropped);
+		}
+	}
+
+	return NULL;
+}
+
+/* Queue a message for the log thread, never blocks. */
+static int log_queue(int loglevel, const char *format, va_list args)
+{
+	struct log_slot *slot;
+	guint head;
+
+	do {
+		head = g_atomic_int_get(&log_ring_head);
+		if (head - (guint)g_atomic_int_get(&log_ring_tail) >= LOG_RING_SLOTS) {
+			g_atomic_int_inc(&log_dropped);
+			return SR_OK;
+		}
+	} while (!g_atomic_int_compare_and_exchange(&log_ring_head,
+			(gint)head, (gint)(head + 1)));
+
+	slot = &log_ring[head % LOG_RING_SLOTS];
+	slot->loglevel = loglevel;
+	vsnprintf(slot->msg, LOG_MSG_MAXLEN, format, args);
+	g_atomic_int_set(&slot->ready, 1);
+
+	if (g_atomic_int_get(&log_thread_waiting)) {
+		g_mutex_lock(&log_mutex);
+		g_cond_signal(&log_cond);
+		g_mutex_unlock(&log_mutex);
+	}
+
+	return SR_OK;
+}
+
+static int log_dispatch(int loglevel, const char *format, va_list args)
+{
+	int ret;
+
+	if (!sr_log_enabled(loglevel))
+		return SR_OK;
+
+	g_atomic_int_inc(&log_writers);
+	if (g_atomic_int_get(&log_async)) {
+		ret = log_queue(loglevel, format, args);
+		g_atomic_int_add(&log_writers, -1);
+		return ret;
+	}
+	g_atomic_int_add(&log_writers, -1);
+
+	return sr_log_cb(sr_log_cb_data, loglevel, format, args);
+}
+
+/**
+ * Enable or disable asynchronous logging.
+ *
+ * When enabled, log messages are formatted into a preallocated ring
+ * buffer on the thread that logs them, and passed to the log callback
+ * from a separate thread. Logging then never blocks on the callback,
+ * at the cost of dropping messages when the ring buffer is full. The
+ * number of dropped messages is reported through the callback.
+ *
+ * Disabling asynchronous logging waits until all queued messages, and
+ * those being queued at the time, have been passed to the log callback.
+ *
+ * @param enable TRUE to enable asynchronous logging, FALSE to disable it.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Failed to start the log thread.
+ *
+ * @since 0.4.0
+ */
+SR_API int sr_log_async_set(gboolean enable)
+{
+	if (enable && !log_thread) {
+		g_atomic_int_set(&log_thread_stop, 0);
+		if (!(log_thread = g_thread_try_new("sr-log", log_thread_run,
+				NULL, NULL)))
+			return SR_ERR;
+		g_atomic_int_set(&log_async, 1);
+	} else if (!enable && log_thread) {
+		g_atomic_int_set(&log_async, 0);
+		/* Let writers which still saw it enabled claim their slots. */
+		while (g_atomic_int_get(&log_writers))
+			g_thread_yield();
+		g_mutex_lock(&log_mutex);
+		g_atomic_int_set(&log_thread_stop, 1);
+		g_cond_signal(&log_cond);
+		g_mutex_unlock(&log_mutex);
+		g_thread_join(log_thread);
+		log_thread = NULL;
+	}
+
+	return SR_OK;
+}
+
 /** @private */
 SR_PRIV int sr_log(int loglevel, const char *format, ...)
 {
@@ -228,7 +416,7 @@ SR_PRIV int sr_log(int loglevel, const char *format, ...)
 	va_list args;
 
 	va_start(args, format);
-	ret = sr_log_cb(sr_log_cb_data, loglevel, format, args);
+	ret = log_dispatch(loglevel, format, args);
 	va_end(args);
 
 	return ret;
@@ -241,7 +429,7 @@ SR_PRIV int sr_spew(const char *format, ...)
 	va_list args;
 
 	va_start(args, format);
-	ret = sr_log_cb(sr_log_cb_data, SR_LOG_SPEW, format, args);
+	ret = log_dispatch(SR_LOG_SPEW, format, args);
 	va_end(args);
 
 	return ret;
@@ -254,7 +442,7 @@ SR_PRIV int sr_dbg(const char *format, ...)
 	va_list args;
 
 	va_start(args, format);
-	ret = sr_log_cb(sr_log_cb_data, SR_LOG_DBG, format, args);
+	ret = log_dispatch(SR_LOG_DBG, format, args);
 	va_end(args);
 
 	return ret;
@@ -267,7 +455,7 @@ SR_PRIV int sr_info(const char *format, ...)
 	va_list args;
 
 	va_start(args, format);
-	ret = sr_log_cb(sr_log_cb_data, SR_LOG_INFO, format, args);
+	ret = log_dispatch(SR_LOG_INFO, format, args);
 	va_end(args);
 
 	return ret;
@@ -280,7 +468,7 @@ SR_PRIV int sr_warn(const char *format, ...)
 	va_list args;
 
 	va_start(args, format);
-	ret = sr_log_cb(sr_log_cb_data, SR_LOG_WARN, format, args);
+	ret = log_dispatch(SR_LOG_WARN, format, args);
 	va_end(args);
 
 	return ret;
@@ -293,7 +481,7 @@ SR_PRIV int sr_err(const char *format, ...)
 	va_list args;
 
 	va_start(args, format);
-	ret = sr_log_cb(sr_log_cb_data, SR_LOG_ERR, format, args);
+	ret = log_dispatch(SR_LOG_ERR, format, args);
 	va_end(args);
 
 	return ret;
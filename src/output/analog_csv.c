@@ -0,0 +1,329 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <glib.h>
+#include "libsigrok.h"
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/analog_csv"
+
+/*
+ * Values buffered per channel before all rows are written out, even if
+ * some channel hasn't caught up.
+ */
+#define MAX_BUFFERED (1024 * 1024)
+
+/*
+ * Rows are written once every channel which has sent data so far has a
+ * value for them. Within a frame, rows are only written at the end of
+ * the frame, so oscilloscopes sending one channel at a time still line
+ * up.
+ */
+struct column {
+	struct sr_channel *ch;
+	GArray *values;
+	gboolean active;
+	/* Decimals for fixed-point output, -1 if unknown. */
+	int digits;
+};
+
+struct context {
+	unsigned int num_columns;
+	struct column *columns;
+	char *separator;
+	unsigned int separator_len;
+	gboolean fixed;
+	gboolean header;
+	gboolean header_done;
+	gboolean in_frame;
+	float *fbuf;
+	uint64_t fbuf_size;
+};
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct context *ctx;
+	struct sr_channel *ch;
+	GSList *l;
+	const char *sep;
+	unsigned int i;
+
+	if (!o || !o->sdi)
+		return SR_ERR_ARG;
+
+	ctx = g_malloc0(sizeof(struct context));
+	o->priv = ctx;
+
+	sep = g_variant_get_string(g_hash_table_lookup(options, "separator"), NULL);
+	if (!strcmp(sep, "tab") || !strcmp(sep, "\\t"))
+		sep = "\t";
+	ctx->separator = g_strdup(sep);
+	ctx->separator_len = strlen(sep);
+	ctx->fixed = g_variant_get_boolean(g_hash_table_lookup(options, "fixed"));
+	ctx->header = g_variant_get_boolean(g_hash_table_lookup(options, "header"));
+
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type == SR_CHANNEL_ANALOG && ch->enabled)
+			ctx->num_columns++;
+	}
+	if (ctx->num_columns == 0) {
+		sr_err("No analog channel enabled.");
+		return SR_ERR;
+	}
+
+	ctx->columns = g_malloc0(sizeof(struct column) * ctx->num_columns);
+	for (i = 0, l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_ANALOG || !ch->enabled)
+			continue;
+		ctx->columns[i].ch = ch;
+		ctx->columns[i].values = g_array_new(FALSE, FALSE, sizeof(float));
+		ctx->columns[i].digits = -1;
+		i++;
+	}
+
+	return SR_OK;
+}
+
+static struct column *find_column(struct context *ctx, struct sr_channel *ch)
+{
+	unsigned int i;
+
+	for (i = 0; i < ctx->num_columns; i++) {
+		if (ctx->columns[i].ch == ch)
+			return &ctx->columns[i];
+	}
+
+	return NULL;
+}
+
+static void gen_header(struct context *ctx, GString *out)
+{
+	unsigned int i;
+
+	for (i = 0; i < ctx->num_columns; i++) {
+		if (i)
+			g_string_append(out, ctx->separator);
+		g_string_append(out, ctx->columns[i].ch->name);
+	}
+	g_string_append_c(out, '\n');
+}
+
+/*
+ * Write out buffered rows. Unless flushing, stop at the first row which
+ * some active channel has no value for yet.
+ */
+static void write_rows(struct context *ctx, GString *out, gboolean flush)
+{
+	struct column *col;
+	uint64_t num_rows, row, offset;
+	unsigned int i;
+	char *dst;
+
+	num_rows = flush ? 0 : G_MAXUINT64;
+	for (i = 0; i < ctx->num_columns; i++) {
+		col = &ctx->columns[i];
+		if (flush)
+			num_rows = MAX(num_rows, col->values->len);
+		else if (col->active)
+			num_rows = MIN(num_rows, col->values->len);
+	}
+	if (num_rows == 0 || num_rows == G_MAXUINT64)
+		return;
+
+	/* Worst case size, cut back to what was written at the end. */
+	offset = out->len;
+	g_string_set_size(out, offset + num_rows * ctx->num_columns
+			* (SR_FLOAT_STR_MAXLEN + ctx->separator_len));
+	dst = out->str + offset;
+
+	for (row = 0; row < num_rows; row++) {
+		for (i = 0; i < ctx->num_columns; i++) {
+			col = &ctx->columns[i];
+			if (i) {
+				memcpy(dst, ctx->separator, ctx->separator_len);
+				dst += ctx->separator_len;
+			}
+			if (row >= col->values->len)
+				continue;
+			if (ctx->fixed && col->digits >= 0)
+				dst += sr_float_to_str_fixed(g_array_index(col->values,
+						float, row), col->digits, dst);
+			else
+				dst += sr_float_to_str(g_array_index(col->values,
+						float, row), dst);
+		}
+		*dst++ = '\n';
+	}
+	g_string_truncate(out, dst - out->str);
+
+	for (i = 0; i < ctx->num_columns; i++) {
+		col = &ctx->columns[i];
+		g_array_remove_range(col->values, 0, MIN(num_rows, col->values->len));
+	}
+}
+
+static gboolean add_values(struct context *ctx, GSList *channels, const float *data,
+		uint64_t num_samples, int digits)
+{
+	struct column *col;
+	GSList *l;
+	uint64_t i;
+	unsigned int num_channels, c;
+	gboolean full;
+
+	num_channels = g_slist_length(channels);
+	full = FALSE;
+	for (l = channels, c = 0; l; l = l->next, c++) {
+		if (!(col = find_column(ctx, l->data)))
+			continue;
+		col->active = TRUE;
+		col->digits = digits;
+		if (num_channels == 1) {
+			g_array_append_vals(col->values, data, num_samples);
+		} else {
+			for (i = 0; i < num_samples; i++)
+				g_array_append_val(col->values,
+						data[i * num_channels + c]);
+		}
+		if (col->values->len > MAX_BUFFERED)
+			full = TRUE;
+	}
+
+	return full;
+}
+
+static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
+		GString **out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_analog2 *analog2;
+	unsigned int num_channels;
+	gboolean full;
+	int digits, ret;
+
+	*out = NULL;
+	if (!o || !o->sdi || !(ctx = o->priv))
+		return SR_ERR_ARG;
+
+	full = FALSE;
+	switch (packet->type) {
+	case SR_DF_FRAME_BEGIN:
+		ctx->in_frame = TRUE;
+		return SR_OK;
+	case SR_DF_FRAME_END:
+		ctx->in_frame = FALSE;
+		full = TRUE;
+		break;
+	case SR_DF_END:
+		full = TRUE;
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		full = add_values(ctx, analog->channels, analog->data,
+				analog->num_samples, -1);
+		break;
+	case SR_DF_ANALOG2:
+		analog2 = packet->payload;
+		num_channels = g_slist_length(analog2->meaning->channels);
+		if (num_channels == 0)
+			return SR_OK;
+		if (ctx->fbuf_size < analog2->num_samples) {
+			g_free(ctx->fbuf);
+			ctx->fbuf_size = analog2->num_samples;
+			if (!(ctx->fbuf = g_try_malloc(ctx->fbuf_size * sizeof(float)))) {
+				ctx->fbuf_size = 0;
+				return SR_ERR_MALLOC;
+			}
+		}
+		if ((ret = sr_analog_to_float(analog2, ctx->fbuf)) != SR_OK)
+			return ret;
+		digits = analog2->encoding->is_digits_decimal ?
+				analog2->encoding->digits : -1;
+		full = add_values(ctx, analog2->meaning->channels, ctx->fbuf,
+				analog2->num_samples / num_channels, digits);
+		break;
+	default:
+		return SR_OK;
+	}
+
+	if (ctx->in_frame && !full)
+		return SR_OK;
+
+	*out = g_string_sized_new(512);
+	if (ctx->header && !ctx->header_done) {
+		gen_header(ctx, *out);
+		ctx->header_done = TRUE;
+	}
+	write_rows(ctx, *out, full);
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_output *o)
+{
+	struct context *ctx;
+	unsigned int i;
+
+	if (!o || !o->sdi)
+		return SR_ERR_ARG;
+
+	if ((ctx = o->priv)) {
+		for (i = 0; i < ctx->num_columns; i++)
+			g_array_free(ctx->columns[i].values, TRUE);
+		g_free(ctx->columns);
+		g_free(ctx->separator);
+		g_free(ctx->fbuf);
+		g_free(ctx);
+	}
+	o->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "separator", "Separator", "Column separator, \"tab\" for TSV", NULL, NULL },
+	{ "fixed", "Fixed-point", "Show the number of decimals given by the "
+			"device, instead of the shortest exact representation",
+			NULL, NULL },
+	{ "header", "Header", "Start with a row of channel names", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_string(","));
+		options[1].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+		options[2].def = g_variant_ref_sink(g_variant_new_boolean(TRUE));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_output_module output_analog_csv = {
+	.id = "analog_csv",
+	.name = "Analog CSV",
+	.desc = "Analog data as comma- or tab-separated columns",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
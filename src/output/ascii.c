@@ -38,7 +38,10 @@ struct context {
 	int *channel_index;
 	char **channel_names;
 	char **line_values;
-	uint8_t *prev_sample;
+	/* Last sample of every channel. */
+	gboolean *prev_bit;
+	/* Up to 8 samples per channel, first sample in the MSB. */
+	uint8_t *groups;
 	gboolean header_done;
 	GString **lines;
 	GString *header;
@@ -70,7 +73,8 @@ static int init(struct sr_output *o, GHashTable *options)
 	ctx->channel_index = g_malloc(sizeof(int) * ctx->num_enabled_channels);
 	ctx->channel_names = g_malloc(sizeof(char *) * ctx->num_enabled_channels);
 	ctx->lines = g_malloc(sizeof(GString *) * ctx->num_enabled_channels);
-	ctx->prev_sample = g_malloc(g_slist_length(o->sdi->channels));
+	ctx->prev_bit = g_malloc0(sizeof(gboolean) * ctx->num_enabled_channels);
+	ctx->groups = g_malloc(ctx->num_enabled_channels);
 
 	j = 0;
 	for (i = 0, l = o->sdi->channels; l; l = l->next, i++) {
@@ -129,9 +133,10 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	const struct sr_config *src;
 	GSList *l;
 	struct context *ctx;
-	int idx, offset, curbit, prevbit;
-	uint64_t i, j;
-	gchar *p, c;
+	int offset;
+	uint64_t num_samples, i, j;
+	unsigned int n;
+	gboolean prev;
 
 	*out = NULL;
 	if (!o || !o->sdi)
@@ -160,24 +165,28 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			*out = g_string_sized_new(512);
 
 		logic = packet->payload;
-		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
-			ctx->spl_cnt++;
+		num_samples = logic->length / logic->unitsize;
+		for (i = 0; i < num_samples; i += n) {
+			/* Groups of 8 samples, which don't cross lines. */
+			n = 8 - (ctx->spl_cnt & 7);
+			if (ctx->spl > 0 && n > (unsigned int)(ctx->spl - ctx->spl_cnt))
+				n = ctx->spl - ctx->spl_cnt;
+			if (n > num_samples - i)
+				n = num_samples - i;
+			sr_logic_text_transpose(logic->data + i * logic->unitsize,
+					logic->unitsize, n, ctx->channel_index,
+					ctx->num_enabled_channels, ctx->groups);
 			for (j = 0; j < ctx->num_enabled_channels; j++) {
-				idx = ctx->channel_index[j];
-				p = logic->data + i + idx / 8;
-				curbit = *p & (1 << (idx % 8));
-				prevbit = (ctx->prev_sample[idx / 8] & ((uint8_t) 1 << (idx % 8)));
-
-				c = curbit ? '"' : '.';
-				if (ctx->spl_cnt > 1) {
-					if (curbit < prevbit)
-						c = '\\';
-					else if (curbit > prevbit)
-						c = '/';
-				}
-				g_string_append_c(ctx->lines[j], c);
-
-				if (ctx->spl_cnt == ctx->spl) {
+				/* No edge on the first sample of a line. */
+				if (ctx->spl_cnt == 0)
+					prev = ctx->groups[j] >> 7;
+				else
+					prev = ctx->prev_bit[j];
+				ctx->prev_bit[j] = (ctx->groups[j] >> (8 - n)) & 1;
+				g_string_append_len(ctx->lines[j],
+						sr_logic_text_ascii(prev, ctx->groups[j]), n);
+
+				if (ctx->spl_cnt + n == (unsigned int)ctx->spl) {
 					/* Flush line buffers. */
 					g_string_append_len(*out, ctx->lines[j]->str, ctx->lines[j]->len);
 					g_string_append_c(*out, '\n');
@@ -189,10 +198,10 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 					g_string_printf(ctx->lines[j], "%s:", ctx->channel_names[j]);
 				}
 			}
+			ctx->spl_cnt += n;
 			if (ctx->spl_cnt == ctx->spl)
 				/* Line buffers were already flushed. */
 				ctx->spl_cnt = 0;
-			memcpy(ctx->prev_sample, logic->data + i, logic->unitsize);
 		}
 		break;
 	case SR_DF_END:
@@ -222,7 +231,8 @@ static int cleanup(struct sr_output *o)
 		return SR_OK;
 
 	g_free(ctx->channel_index);
-	g_free(ctx->prev_sample);
+	g_free(ctx->prev_bit);
+	g_free(ctx->groups);
 	g_free(ctx->channel_names);
 	for (i = 0; i < ctx->num_enabled_channels; i++)
 		g_string_free(ctx->lines[i], TRUE);
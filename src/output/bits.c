@@ -37,6 +37,8 @@ struct context {
 	char **channel_names;
 	gboolean header_done;
 	GString **lines;
+	/* Up to 8 samples per channel, first sample in the MSB. */
+	uint8_t *groups;
 };
 
 static int init(struct sr_output *o, GHashTable *options)
@@ -65,6 +67,7 @@ static int init(struct sr_output *o, GHashTable *options)
 	ctx->channel_index = g_malloc(sizeof(int) * ctx->num_enabled_channels);
 	ctx->channel_names = g_malloc(sizeof(char *) * ctx->num_enabled_channels);
 	ctx->lines = g_malloc(sizeof(GString *) * ctx->num_enabled_channels);
+	ctx->groups = g_malloc(ctx->num_enabled_channels);
 
 	j = 0;
 	for (i = 0, l = o->sdi->channels; l; l = l->next, i++) {
@@ -123,9 +126,9 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	const struct sr_config *src;
 	struct context *ctx;
 	GSList *l;
-	int idx, offset;
-	uint64_t i, j;
-	gchar *p, c;
+	int offset;
+	uint64_t num_samples, i, j;
+	unsigned int n;
 
 	*out = NULL;
 	if (!o || !o->sdi)
@@ -154,13 +157,21 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			*out = g_string_sized_new(512);
 
 		logic = packet->payload;
-		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
-			ctx->spl_cnt++;
+		num_samples = logic->length / logic->unitsize;
+		for (i = 0; i < num_samples; i += n) {
+			/* Up to the next space, or the end of the line. */
+			n = 8 - (ctx->spl_cnt & 7);
+			if (ctx->spl > 0 && n > (unsigned int)(ctx->spl - ctx->spl_cnt))
+				n = ctx->spl - ctx->spl_cnt;
+			if (n > num_samples - i)
+				n = num_samples - i;
+			sr_logic_text_transpose(logic->data + i * logic->unitsize,
+					logic->unitsize, n, ctx->channel_index,
+					ctx->num_enabled_channels, ctx->groups);
+			ctx->spl_cnt += n;
 			for (j = 0; j < ctx->num_enabled_channels; j++) {
-				idx = ctx->channel_index[j];
-				p = logic->data + i + idx / 8;
-				c = (*p & (1 << (idx % 8))) ? '1' : '0';
-				g_string_append_c(ctx->lines[j], c);
+				g_string_append_len(ctx->lines[j],
+						sr_logic_text_bits(ctx->groups[j]), n);
 
 				if (ctx->spl_cnt == ctx->spl) {
 					/* Flush line buffers. */
@@ -210,6 +221,7 @@ static int cleanup(struct sr_output *o)
 
 	g_free(ctx->channel_index);
 	g_free(ctx->channel_names);
+	g_free(ctx->groups);
 	for (i = 0; i < ctx->num_enabled_channels; i++)
 		g_string_free(ctx->lines[i], TRUE);
 	g_free(ctx->lines);
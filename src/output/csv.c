@@ -33,6 +33,7 @@ struct context {
 	char separator;
 	gboolean header_done;
 	int *channel_index;
+	struct sr_logic_text_row *row;
 };
 
 /*
@@ -50,9 +51,8 @@ struct context {
 static int init(struct sr_output *o, GHashTable *options)
 {
 	struct context *ctx;
-	struct sr_channel *ch;
-	GSList *l;
-	int i;
+	const struct sr_channel_table *table;
+	char sep[2];
 
 	(void)options;
 
@@ -63,26 +63,19 @@ static int init(struct sr_output *o, GHashTable *options)
 	o->priv = ctx;
 	ctx->separator = ',';
 
-	/* Get the number of channels, and the unitsize. */
-	for (l = o->sdi->channels; l; l = l->next) {
-		ch = l->data;
-		if (ch->type != SR_CHANNEL_LOGIC)
-			continue;
-		if (!ch->enabled)
-			continue;
-		ctx->num_enabled_channels++;
+	if (!(table = sr_dev_inst_channel_table_get(o->sdi))) {
+		/* Used outside of a session, build the table here. */
+		sr_dev_inst_channel_table_update((struct sr_dev_inst *)o->sdi);
+		table = sr_dev_inst_channel_table_get(o->sdi);
 	}
-	ctx->channel_index = g_malloc(sizeof(int) * ctx->num_enabled_channels);
+	ctx->num_enabled_channels = table->num_logic;
+	ctx->channel_index = g_memdup(table->logic_index,
+			sizeof(int) * table->num_logic);
 
-	/* Once more to map the enabled channels. */
-	for (i = 0, l = o->sdi->channels; l; l = l->next) {
-		ch = l->data;
-		if (ch->type != SR_CHANNEL_LOGIC)
-			continue;
-		if (!ch->enabled)
-			continue;
-		ctx->channel_index[i++] = ch->index;
-	}
+	sep[0] = ctx->separator;
+	sep[1] = '\0';
+	ctx->row = sr_logic_text_row_new(ctx->channel_index,
+			ctx->num_enabled_channels, '0', '1', sep, "\n");
 
 	return SR_OK;
 }
@@ -147,9 +140,7 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	const struct sr_config *src;
 	GSList *l;
 	struct context *ctx;
-	int idx;
-	uint64_t i, j;
-	gchar *p, c;
+	uint64_t num_samples, len, offset;
 
 	*out = NULL;
 	if (!o || !o->sdi)
@@ -169,27 +160,19 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		break;
 	case SR_DF_LOGIC:
 		logic = packet->payload;
+		num_samples = logic->length / logic->unitsize;
+		len = num_samples * sr_logic_text_row_len(ctx->row);
 		if (!ctx->header_done) {
 			*out = gen_header(o);
 			ctx->header_done = TRUE;
 		} else {
-			*out = g_string_sized_new(512);
+			*out = g_string_sized_new(len + 1);
 		}
 
-		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
-			for (j = 0; j < ctx->num_enabled_channels; j++) {
-				idx = ctx->channel_index[j];
-				p = logic->data + i + idx / 8;
-				c = *p & (1 << (idx % 8));
-				g_string_append_c(*out, c ? '1' : '0');
-				g_string_append_c(*out, ctx->separator);
-			}
-			if (j) {
-				/* Drop last separator. */
-				g_string_truncate(*out, (*out)->len - 1);
-			}
-			g_string_append_printf(*out, "\n");
-		}
+		offset = (*out)->len;
+		g_string_set_size(*out, offset + len);
+		sr_logic_text_rows(ctx->row, (*out)->str + offset, logic->data,
+				logic->unitsize, num_samples);
 		break;
 	}
 
@@ -205,6 +188,7 @@ static int cleanup(struct sr_output *o)
 
 	if (o->priv) {
 		ctx = o->priv;
+		sr_logic_text_row_free(ctx->row);
 		g_free(ctx->channel_index);
 		g_free(o->priv);
 		o->priv = NULL;
@@ -34,6 +34,7 @@ struct context {
 	gboolean header_done;
 	uint8_t *prevsample;
 	int *channel_index;
+	struct sr_logic_text_row *row;
 };
 
 static const char *gnuplot_header = "\
@@ -47,9 +48,7 @@ static const char *gnuplot_header2 = "\
 static int init(struct sr_output *o, GHashTable *options)
 {
 	struct context *ctx;
-	struct sr_channel *ch;
-	GSList *l;
-	unsigned int i;
+	const struct sr_channel_table *table;
 
 	(void)options;
 
@@ -58,30 +57,21 @@ static int init(struct sr_output *o, GHashTable *options)
 
 	ctx = g_malloc0(sizeof(struct context));
 	o->priv = ctx;
-	ctx->num_enabled_channels = 0;
-	for (l = o->sdi->channels; l; l = l->next) {
-		ch = l->data;
-		if (ch->type != SR_CHANNEL_LOGIC)
-			continue;
-		if (!ch->enabled)
-			continue;
-		ctx->num_enabled_channels++;
+	if (!(table = sr_dev_inst_channel_table_get(o->sdi))) {
+		/* Used outside of a session, build the table here. */
+		sr_dev_inst_channel_table_update((struct sr_dev_inst *)o->sdi);
+		table = sr_dev_inst_channel_table_get(o->sdi);
 	}
+	ctx->num_enabled_channels = table->num_logic;
 	if (ctx->num_enabled_channels <= 0) {
 		sr_err("No logic channel enabled.");
 		return SR_ERR;
 	}
-	ctx->channel_index = g_malloc(sizeof(int) * ctx->num_enabled_channels);
-
-	/* Once more to map the enabled channels. */
-	for (i = 0, l = o->sdi->channels; l; l = l->next) {
-		ch = l->data;
-		if (ch->type != SR_CHANNEL_LOGIC)
-			continue;
-		if (!ch->enabled)
-			continue;
-		ctx->channel_index[i++] = ch->index;
-	}
+	ctx->channel_index = g_memdup(table->logic_index,
+			sizeof(int) * table->num_logic);
+
+	ctx->row = sr_logic_text_row_new(ctx->channel_index,
+			ctx->num_enabled_channels, '0', '1', " ", " \n");
 
 	return SR_OK;
 }
@@ -141,7 +131,8 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	GSList *l;
 	struct context *ctx;
 	const uint8_t *sample;
-	unsigned int curbit, p, idx, i;
+	uint64_t num_samples, max_len, i, offset;
+	char *dst;
 
 	*out = NULL;
 	if (!o || !o->priv)
@@ -167,38 +158,41 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		ctx->prevsample = g_malloc0(logic->unitsize);
 	}
 
+	/* Every row is a counter, a tab, and the channel values. */
+	num_samples = logic->length / logic->unitsize;
+	max_len = num_samples * (20 + 1 + sr_logic_text_row_len(ctx->row));
 	if (!ctx->header_done) {
 		*out = gen_header(o);
 		ctx->header_done = TRUE;
 	} else {
-		*out = g_string_sized_new(512);
+		*out = g_string_sized_new(max_len + 1);
 	}
+	offset = (*out)->len;
+	g_string_set_size(*out, offset + max_len);
+	dst = (*out)->str + offset;
 
-	for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
-		sample = logic->data + i;
+	for (i = 0; i < num_samples; i++) {
+		sample = logic->data + i * logic->unitsize;
 		ctx->samplecount++;
 
 		/*
 		 * Don't output the same sample multiple times, but make
 		 * sure to output at least the first and last sample.
 		 */
-		if (i > 0 && i < logic->length - logic->unitsize) {
+		if (i > 0 && i < num_samples - 1) {
 			if (!memcmp(sample, ctx->prevsample, logic->unitsize))
 				continue;
 		}
 		memcpy(ctx->prevsample, sample, logic->unitsize);
 
 		/* The first column is a counter (needed for gnuplot). */
-		g_string_append_printf(*out, "%" PRIu64 "\t", ctx->samplecount);
+		dst = sr_logic_text_u64(dst, ctx->samplecount);
+		*dst++ = '\t';
 
 		/* The next columns are the values of all channels. */
-		for (p = 0; p < ctx->num_enabled_channels; p++) {
-			idx = ctx->channel_index[p];
-			curbit = (sample[idx / 8] & ((uint8_t) (1 << (idx % 8)))) >> (idx % 8);
-			g_string_append_printf(*out, "%d ", curbit);
-		}
-		g_string_append_printf(*out, "\n");
+		dst = sr_logic_text_rows(ctx->row, dst, sample, logic->unitsize, 1);
 	}
+	g_string_truncate(*out, dst - (*out)->str);
 
 	return SR_OK;
 }
@@ -210,6 +204,7 @@ static int cleanup(struct sr_output *o)
 	if (!o || !o->priv)
 		return SR_ERR_BUG;
 	ctx = o->priv;
+	sr_logic_text_row_free(ctx->row);
 	g_free(ctx->channel_index);
 	g_free(ctx->prevsample);
 	g_free(ctx);
@@ -38,6 +38,8 @@ struct context {
 	char **channel_names;
 	char **line_values;
 	uint8_t *sample_buf;
+	/* Up to 8 samples per channel, first sample in the MSB. */
+	uint8_t *groups;
 	gboolean header_done;
 	GString **lines;
 };
@@ -69,6 +71,7 @@ static int init(struct sr_output *o, GHashTable *options)
 	ctx->channel_names = g_malloc(sizeof(char *) * ctx->num_enabled_channels);
 	ctx->lines = g_malloc(sizeof(GString *) * ctx->num_enabled_channels);
 	ctx->sample_buf = g_malloc(ctx->num_enabled_channels);
+	ctx->groups = g_malloc(ctx->num_enabled_channels);
 
 	j = 0;
 	for (i = 0, l = o->sdi->channels; l; l = l->next, i++) {
@@ -128,9 +131,9 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	const struct sr_config *src;
 	GSList *l;
 	struct context *ctx;
-	int idx, pos, offset;
-	uint64_t i, j;
-	gchar *p;
+	int offset;
+	uint64_t num_samples, i, j;
+	unsigned int n;
 
 	*out = NULL;
 	if (!o || !o->sdi)
@@ -159,19 +162,26 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			*out = g_string_sized_new(512);
 
 		logic = packet->payload;
-		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
-			ctx->spl_cnt++;
-			pos = ctx->spl_cnt & 7;
+		num_samples = logic->length / logic->unitsize;
+		for (i = 0; i < num_samples; i += n) {
+			/* Up to the next full byte, or the end of the line. */
+			n = 8 - (ctx->spl_cnt & 7);
+			if (ctx->spl > 0 && n > (unsigned int)(ctx->spl - ctx->spl_cnt))
+				n = ctx->spl - ctx->spl_cnt;
+			if (n > num_samples - i)
+				n = num_samples - i;
+			sr_logic_text_transpose(logic->data + i * logic->unitsize,
+					logic->unitsize, n, ctx->channel_index,
+					ctx->num_enabled_channels, ctx->groups);
+			ctx->spl_cnt += n;
 			for (j = 0; j < ctx->num_enabled_channels; j++) {
-				idx = ctx->channel_index[j];
-				p = logic->data + i + idx / 8;
-				ctx->sample_buf[j] <<= 1;
-				if (*p & (1 << (idx % 8)))
-					ctx->sample_buf[j] |= 1;
-				if (ctx->spl_cnt && pos == 0) {
+				ctx->sample_buf[j] = (ctx->sample_buf[j] << n)
+						| (ctx->groups[j] >> (8 - n));
+				if ((ctx->spl_cnt & 7) == 0) {
 					/* Buffered a byte's worth, output hex. */
-					g_string_append_printf(ctx->lines[j], "%.2x ",
-							ctx->sample_buf[j]);
+					g_string_append_len(ctx->lines[j],
+							sr_logic_text_hex(ctx->sample_buf[j]), 2);
+					g_string_append_c(ctx->lines[j], ' ');
 					ctx->sample_buf[j] = 0;
 				}
 
@@ -223,6 +233,7 @@ static int cleanup(struct sr_output *o)
 
 	g_free(ctx->channel_index);
 	g_free(ctx->sample_buf);
+	g_free(ctx->groups);
 	g_free(ctx->channel_names);
 	for (i = 0; i < ctx->num_enabled_channels; i++)
 		g_string_free(ctx->lines[i], TRUE);
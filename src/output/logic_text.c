@@ -0,0 +1,298 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <glib.h>
+#include "libsigrok.h"
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/logic_text"
+
+/*
+ * Formatting helpers shared by the text-based logic output modules.
+ *
+ * Row-oriented formats (one sample per line, e.g. CSV) use a precomputed
+ * row layout: the enabled channels are split into runs of consecutive
+ * columns coming from the same sample byte, and every run has a lookup
+ * table from that byte's value to the run's characters, separators
+ * included. Formatting a sample is then one copy of the row template,
+ * plus one copy per run.
+ *
+ * Column-oriented formats (one line per channel, e.g. bits) work on
+ * groups of up to 8 samples: the groups are transposed into one byte per
+ * channel, which is then looked up in a table of characters.
+ */
+
+/* A run of output columns taken from the same sample byte. */
+struct sr_logic_text_run {
+	unsigned int byte;
+	unsigned int offset;
+	unsigned int len;
+	/* 256 entries of len characters. */
+	char *lut;
+};
+
+struct sr_logic_text_row {
+	char *tmpl;
+	unsigned int row_len;
+	unsigned int num_runs;
+	struct sr_logic_text_run *runs;
+};
+
+static char bits_lut[256][8];
+static char hex_lut[256][2];
+/* Indexed by the previous sample's bit (bit 8) and the group. */
+static char ascii_lut[512][8];
+
+static void luts_init(void)
+{
+	static gsize done = 0;
+	static const char hexdigits[] = "0123456789abcdef";
+	unsigned int v, i, cur, prev;
+
+	if (!g_once_init_enter(&done))
+		return;
+
+	for (v = 0; v < 256; v++) {
+		for (i = 0; i < 8; i++)
+			bits_lut[v][i] = (v & (0x80 >> i)) ? '1' : '0';
+		hex_lut[v][0] = hexdigits[v >> 4];
+		hex_lut[v][1] = hexdigits[v & 0x0f];
+	}
+
+	for (v = 0; v < 512; v++) {
+		prev = v >> 8;
+		for (i = 0; i < 8; i++) {
+			cur = (v & (0x80 >> i)) ? 1 : 0;
+			if (cur == prev)
+				ascii_lut[v][i] = cur ? '"' : '.';
+			else
+				ascii_lut[v][i] = cur ? '/' : '\\';
+			prev = cur;
+		}
+	}
+
+	g_once_init_leave(&done, 1);
+}
+
+/**
+ * Create the layout for formatting one sample per row: a character per
+ * channel, separated by sep, followed by end.
+ *
+ * @param channel_index Bit index within the sample of every column.
+ * @param num_channels Number of columns.
+ * @param zero Character for a low channel.
+ * @param one Character for a high channel.
+ * @param sep Separator between columns.
+ * @param end Appended to every row.
+ *
+ * @private
+ */
+SR_PRIV struct sr_logic_text_row *sr_logic_text_row_new(const int *channel_index,
+		unsigned int num_channels, char zero, char one, const char *sep,
+		const char *end)
+{
+	struct sr_logic_text_row *row;
+	struct sr_logic_text_run *run;
+	unsigned int seplen, stride, first, last, j, k, v;
+	char *p;
+
+	seplen = strlen(sep);
+	stride = 1 + seplen;
+
+	row = g_malloc0(sizeof(struct sr_logic_text_row));
+	row->row_len = (num_channels ? num_channels * stride - seplen : 0)
+			+ strlen(end);
+	row->tmpl = g_malloc(row->row_len);
+	p = row->tmpl;
+	for (j = 0; j < num_channels; j++) {
+		*p++ = zero;
+		if (j < num_channels - 1) {
+			memcpy(p, sep, seplen);
+			p += seplen;
+		}
+	}
+	memcpy(p, end, strlen(end));
+
+	row->runs = g_malloc0(sizeof(struct sr_logic_text_run) * num_channels);
+	for (first = 0; first < num_channels; first = last + 1) {
+		last = first;
+		while (last + 1 < num_channels && channel_index[last + 1] / 8
+				== channel_index[first] / 8)
+			last++;
+		run = &row->runs[row->num_runs++];
+		run->byte = channel_index[first] / 8;
+		run->offset = first * stride;
+		run->len = (last - first) * stride + 1;
+		run->lut = g_malloc(256 * run->len);
+		for (v = 0; v < 256; v++) {
+			p = run->lut + v * run->len;
+			memcpy(p, row->tmpl + run->offset, run->len);
+			for (k = first; k <= last; k++) {
+				p[(k - first) * stride] =
+					(v & (1 << (channel_index[k] % 8))) ? one : zero;
+			}
+		}
+	}
+
+	return row;
+}
+
+/** @private */
+SR_PRIV void sr_logic_text_row_free(struct sr_logic_text_row *row)
+{
+	unsigned int i;
+
+	if (!row)
+		return;
+
+	for (i = 0; i < row->num_runs; i++)
+		g_free(row->runs[i].lut);
+	g_free(row->runs);
+	g_free(row->tmpl);
+	g_free(row);
+}
+
+/** @private */
+SR_PRIV unsigned int sr_logic_text_row_len(const struct sr_logic_text_row *row)
+{
+	return row->row_len;
+}
+
+/**
+ * Format samples, one per row.
+ *
+ * @param row The row layout.
+ * @param dst Output buffer, with room for num_samples rows.
+ * @param data The samples.
+ * @param unitsize Size of a sample in bytes.
+ * @param num_samples Number of samples to format.
+ *
+ * @return The end of the output written.
+ *
+ * @private
+ */
+SR_PRIV char *sr_logic_text_rows(const struct sr_logic_text_row *row,
+		char *dst, const uint8_t *data, unsigned int unitsize,
+		uint64_t num_samples)
+{
+	const struct sr_logic_text_run *run;
+	uint64_t i;
+	unsigned int r;
+
+	for (i = 0; i < num_samples; i++, data += unitsize) {
+		memcpy(dst, row->tmpl, row->row_len);
+		for (r = 0; r < row->num_runs; r++) {
+			run = &row->runs[r];
+			memcpy(dst + run->offset, run->lut + data[run->byte] * run->len,
+					run->len);
+		}
+		dst += row->row_len;
+	}
+
+	return dst;
+}
+
+/**
+ * Collect up to 8 consecutive samples of every channel into a byte, the
+ * first sample in the most significant bit. Unused bits are zero.
+ *
+ * @param data The samples.
+ * @param unitsize Size of a sample in bytes.
+ * @param num_samples Number of samples, 1 to 8.
+ * @param channel_index Bit index within the sample of every channel.
+ * @param num_channels Number of channels.
+ * @param out One byte per channel.
+ *
+ * @private
+ */
+SR_PRIV void sr_logic_text_transpose(const uint8_t *data, unsigned int unitsize,
+		unsigned int num_samples, const int *channel_index,
+		unsigned int num_channels, uint8_t *out)
+{
+	uint64_t x;
+	unsigned int j, k;
+	int idx, lane;
+
+	lane = -1;
+	x = 0;
+	for (j = 0; j < num_channels; j++) {
+		idx = channel_index[j];
+		if (idx / 8 != lane) {
+			lane = idx / 8;
+			x = 0;
+			for (k = 0; k < num_samples; k++)
+				x |= (uint64_t)data[k * unitsize + lane] << (8 * (7 - k));
+			x = sr_transpose8x8(x);
+		}
+		out[j] = x >> (8 * (idx % 8));
+	}
+}
+
+/** The 8 characters '0' and '1' for a group of 8 samples. @private */
+SR_PRIV const char *sr_logic_text_bits(uint8_t group)
+{
+	luts_init();
+
+	return bits_lut[group];
+}
+
+/** The 2 hex digits for a group of 8 samples. @private */
+SR_PRIV const char *sr_logic_text_hex(uint8_t group)
+{
+	luts_init();
+
+	return hex_lut[group];
+}
+
+/**
+ * The 8 characters of the ascii output for a group of 8 samples: '.' and
+ * '"' for low and high, '/' and '\\' for rising and falling edges.
+ *
+ * @param prev The previous sample, to detect an edge on the first sample.
+ * @param group The samples.
+ *
+ * @private
+ */
+SR_PRIV const char *sr_logic_text_ascii(gboolean prev, uint8_t group)
+{
+	luts_init();
+
+	return ascii_lut[(prev ? 0x100 : 0) | group];
+}
+
+/**
+ * Write an unsigned integer in decimal, without terminating it.
+ *
+ * @return The end of the output written.
+ *
+ * @private
+ */
+SR_PRIV char *sr_logic_text_u64(char *dst, uint64_t value)
+{
+	char buf[20];
+	int i;
+
+	i = sizeof(buf);
+	do {
+		buf[--i] = '0' + value % 10;
+		value /= 10;
+	} while (value);
+	memcpy(dst, buf + i, sizeof(buf) - i);
+
+	return dst + sizeof(buf) - i;
+}
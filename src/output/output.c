@@ -60,8 +60,11 @@ extern SR_PRIV struct sr_output_module output_gnuplot;
 extern SR_PRIV struct sr_output_module output_chronovu_la8;
 extern SR_PRIV struct sr_output_module output_csv;
 extern SR_PRIV struct sr_output_module output_analog;
+extern SR_PRIV struct sr_output_module output_analog_csv;
 extern SR_PRIV struct sr_output_module output_srzip;
 extern SR_PRIV struct sr_output_module output_wav;
+extern SR_PRIV struct sr_output_module output_summary;
+extern SR_PRIV struct sr_output_module output_planar;
 /* @endcond */
 
 static const struct sr_output_module *output_module_list[] = {
@@ -75,8 +78,11 @@ static const struct sr_output_module *output_module_list[] = {
 	&output_vcd,
 	&output_chronovu_la8,
 	&output_analog,
+	&output_analog_csv,
 	&output_srzip,
 	&output_wav,
+	&output_summary,
+	&output_planar,
 	NULL,
 };
 
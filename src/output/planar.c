@@ -0,0 +1,325 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <glib.h>
+#include "libsigrok.h"
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/planar"
+
+#define DEFAULT_CHUNK_SAMPLES (1024 * 1024)
+
+/* See src/planar.c for the file format. */
+struct context {
+	unsigned int num_channels;
+	int *channel_index;
+	char **channel_names;
+	uint64_t samplerate;
+	gboolean rle;
+	gboolean header_done;
+	unsigned int unitsize;
+	/* Samples of the chunk being collected. */
+	uint64_t chunk_samples;
+	uint8_t *buf;
+	uint64_t buf_samples;
+	uint8_t **planes;
+	uint8_t *rle_buf;
+	/* Bytes output so far, and the file offset of every chunk. */
+	uint64_t offset;
+	GArray *chunk_offsets;
+};
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct context *ctx;
+	const struct sr_channel_table *table;
+	struct sr_channel *ch;
+	GSList *l;
+	unsigned int i;
+
+	if (!o || !o->sdi)
+		return SR_ERR_ARG;
+
+	ctx = g_malloc0(sizeof(struct context));
+	o->priv = ctx;
+	ctx->rle = g_variant_get_boolean(g_hash_table_lookup(options, "rle"));
+	ctx->chunk_samples = g_variant_get_uint32(g_hash_table_lookup(options,
+			"chunksize"));
+	if (ctx->chunk_samples < 8 || ctx->chunk_samples % 8) {
+		sr_err("Chunk size must be a non-zero multiple of 8 samples.");
+		return SR_ERR_ARG;
+	}
+
+	if (!(table = sr_dev_inst_channel_table_get(o->sdi))) {
+		/* Used outside of a session, build the table here. */
+		sr_dev_inst_channel_table_update((struct sr_dev_inst *)o->sdi);
+		table = sr_dev_inst_channel_table_get(o->sdi);
+	}
+	ctx->num_channels = table->num_logic;
+	if (ctx->num_channels == 0) {
+		sr_err("No logic channel enabled.");
+		return SR_ERR;
+	}
+
+	ctx->channel_index = g_memdup(table->logic_index,
+			sizeof(int) * table->num_logic);
+	ctx->channel_names = g_malloc0(sizeof(char *) * ctx->num_channels);
+	ctx->planes = g_malloc0(sizeof(uint8_t *) * ctx->num_channels);
+	for (i = 0, l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_LOGIC || !ch->enabled)
+			continue;
+		ctx->channel_names[i] = g_strdup(ch->name);
+		ctx->planes[i] = g_malloc(ctx->chunk_samples / 8);
+		i++;
+	}
+	ctx->rle_buf = g_malloc(ctx->chunk_samples / 8);
+	ctx->chunk_offsets = g_array_new(FALSE, FALSE, sizeof(uint64_t));
+
+	return SR_OK;
+}
+
+static void append_u32(GString *out, uint32_t v)
+{
+	uint8_t buf[4];
+
+	WL32(buf, v);
+	g_string_append_len(out, (const char *)buf, 4);
+}
+
+static void append_u64(GString *out, uint64_t v)
+{
+	append_u32(out, v & 0xffffffff);
+	append_u32(out, v >> 32);
+}
+
+static void gen_header(const struct sr_output *o, GString *out)
+{
+	struct context *ctx;
+	GVariant *gvar;
+	unsigned int i;
+
+	ctx = o->priv;
+	if (ctx->samplerate == 0) {
+		if (sr_config_get(o->sdi->driver, o->sdi, NULL, SR_CONF_SAMPLERATE,
+				&gvar) == SR_OK) {
+			ctx->samplerate = g_variant_get_uint64(gvar);
+			g_variant_unref(gvar);
+		}
+	}
+
+	g_string_append_len(out, SR_PLANAR_MAGIC, 8);
+	append_u32(out, SR_PLANAR_VERSION);
+	append_u32(out, ctx->num_channels);
+	append_u32(out, ctx->chunk_samples);
+	append_u64(out, ctx->samplerate);
+	for (i = 0; i < ctx->num_channels; i++) {
+		append_u32(out, ctx->channel_index[i]);
+		append_u32(out, strlen(ctx->channel_names[i]));
+		g_string_append(out, ctx->channel_names[i]);
+	}
+	ctx->header_done = TRUE;
+}
+
+/*
+ * Write the collected samples as a chunk. The directory is filled in
+ * once the planes have been written, since the length of a run-length
+ * encoded plane isn't known up front.
+ */
+static void write_chunk(struct context *ctx, GString *out)
+{
+	uint64_t chunk_offset, raw_len, len;
+	unsigned int i, encoding;
+	gsize start, dir;
+	uint8_t *d;
+
+	if (ctx->buf_samples == 0)
+		return;
+
+	start = out->len;
+	chunk_offset = ctx->offset + start;
+	g_array_append_val(ctx->chunk_offsets, chunk_offset);
+
+	g_string_append_len(out, SR_PLANAR_CHUNK_MAGIC, 4);
+	append_u32(out, ctx->buf_samples);
+	dir = out->len;
+	g_string_set_size(out, dir + ctx->num_channels * 12);
+
+	sr_planar_split(ctx->buf, ctx->unitsize, ctx->buf_samples,
+			ctx->channel_index, ctx->num_channels, ctx->planes);
+
+	raw_len = (ctx->buf_samples + 7) / 8;
+	for (i = 0; i < ctx->num_channels; i++) {
+		len = 0;
+		if (ctx->rle)
+			len = sr_planar_rle_encode(ctx->planes[i], ctx->buf_samples,
+					ctx->rle_buf, raw_len - 1);
+		d = (uint8_t *)out->str + dir + i * 12;
+		if (len) {
+			encoding = SR_PLANAR_RLE;
+		} else {
+			encoding = SR_PLANAR_RAW;
+			len = raw_len;
+		}
+		WL32(d, encoding);
+		WL32(d + 4, out->len - start);
+		WL32(d + 8, len);
+		g_string_append_len(out, encoding == SR_PLANAR_RLE ?
+				(const char *)ctx->rle_buf : (const char *)ctx->planes[i],
+				len);
+	}
+
+	ctx->buf_samples = 0;
+}
+
+static void write_index(struct context *ctx, GString *out)
+{
+	uint64_t index_offset;
+	unsigned int i;
+
+	index_offset = ctx->offset + out->len;
+	g_string_append_len(out, SR_PLANAR_INDEX_MAGIC, 4);
+	append_u32(out, ctx->chunk_offsets->len);
+	for (i = 0; i < ctx->chunk_offsets->len; i++)
+		append_u64(out, g_array_index(ctx->chunk_offsets, uint64_t, i));
+	append_u64(out, index_offset);
+	g_string_append_len(out, SR_PLANAR_END_MAGIC, 8);
+}
+
+static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
+		GString **out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_meta *meta;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_config *src;
+	const uint8_t *data;
+	uint64_t num_samples, n;
+	GSList *l;
+
+	*out = NULL;
+	if (!o || !o->sdi || !(ctx = o->priv))
+		return SR_ERR_ARG;
+
+	switch (packet->type) {
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key == SR_CONF_SAMPLERATE)
+				ctx->samplerate = g_variant_get_uint64(src->data);
+		}
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		if (!ctx->buf) {
+			ctx->unitsize = logic->unitsize;
+			if (!(ctx->buf = g_try_malloc(ctx->chunk_samples * ctx->unitsize))) {
+				sr_err("Chunk buffer malloc failed.");
+				return SR_ERR_MALLOC;
+			}
+		}
+		if (logic->unitsize != ctx->unitsize) {
+			sr_err("Unit size changed during acquisition.");
+			return SR_ERR_DATA;
+		}
+		*out = g_string_sized_new(512);
+		if (!ctx->header_done)
+			gen_header(o, *out);
+		data = logic->data;
+		num_samples = logic->length / logic->unitsize;
+		while (num_samples) {
+			n = MIN(num_samples, ctx->chunk_samples - ctx->buf_samples);
+			memcpy(ctx->buf + ctx->buf_samples * ctx->unitsize, data,
+					n * ctx->unitsize);
+			ctx->buf_samples += n;
+			data += n * ctx->unitsize;
+			num_samples -= n;
+			if (ctx->buf_samples == ctx->chunk_samples)
+				write_chunk(ctx, *out);
+		}
+		break;
+	case SR_DF_END:
+		*out = g_string_sized_new(512);
+		if (!ctx->header_done)
+			gen_header(o, *out);
+		write_chunk(ctx, *out);
+		write_index(ctx, *out);
+		break;
+	}
+
+	if (*out)
+		ctx->offset += (*out)->len;
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_output *o)
+{
+	struct context *ctx;
+	unsigned int i;
+
+	if (!o || !o->sdi)
+		return SR_ERR_ARG;
+
+	if ((ctx = o->priv)) {
+		for (i = 0; i < ctx->num_channels && ctx->planes; i++) {
+			g_free(ctx->planes[i]);
+			g_free(ctx->channel_names[i]);
+		}
+		g_free(ctx->planes);
+		g_free(ctx->channel_names);
+		g_free(ctx->channel_index);
+		g_free(ctx->rle_buf);
+		g_free(ctx->buf);
+		if (ctx->chunk_offsets)
+			g_array_free(ctx->chunk_offsets, TRUE);
+		g_free(ctx);
+	}
+	o->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "rle", "Run-length encoding", "Run-length encode channels where "
+			"that is smaller", NULL, NULL },
+	{ "chunksize", "Chunk size", "Number of samples per chunk, "
+			"a multiple of 8", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_boolean(TRUE));
+		options[1].def = g_variant_ref_sink(g_variant_new_uint32(DEFAULT_CHUNK_SAMPLES));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_output_module output_planar = {
+	.id = "planar",
+	.name = "Planar",
+	.desc = "Logic data stored per channel, for fast single-channel access",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -24,17 +24,82 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <zip.h>
+#include <zlib.h>
 #include "libsigrok.h"
 #include "libsigrok-internal.h"
 
 #define LOG_PREFIX "output/srzip"
 
+/* Decimation factor of the stored logic summary. */
+#define SUMMARY_FACTOR 16
+
+/* Logic data is collected into chunks of this size before compression. */
+#define CHUNK_SIZE (4 * 1024 * 1024)
+
+#define DEFAULT_COMPRESSION 6
+#define DEFAULT_THREADS 4
+
+/* Chunks waiting for compression or commit, per worker thread. */
+#define MAX_PENDING_PER_THREAD 2
+
+struct out_context;
+
+/*
+ * A chunk of logic data. It gets compressed in memory on a worker thread,
+ * which also scans it for the sample index. It is then added to the
+ * session file as already compressed data, which libzip copies into the
+ * archive as it is when the session file is written.
+ */
+struct chunk_job {
+	struct out_context *outc;
+	int num;
+	uint8_t *data;
+	uint64_t length;
+	/* Raw deflate stream of the data, and its CRC. */
+	uint8_t *comp;
+	uint64_t comp_length;
+	uint32_t crc;
+	/* Index entry, and the chunk's first sample for the entry after it. */
+	struct sr_sessionfile_index_entry entry;
+	uint64_t first;
+	/* Read position while libzip copies the compressed data. */
+	uint64_t pos;
+	int ret;
+	gboolean done;
+};
+
 struct out_context {
 	gboolean zip_created;
 	uint64_t samplerate;
 	char *filename;
+	/*
+	 * The session file, open for the whole capture. libzip rewrites
+	 * the whole archive on every zip_close(), so it's only written
+	 * once, at the end. Until then it holds the compressed chunks.
+	 */
+	struct zip *archive;
+	/* Sample index of the chunks added so far. */
+	GArray *index;
+	/* Multi-resolution summary of the logic data, if enabled. */
+	gboolean want_summary;
+	struct sr_summary *summary;
+	/* 0 means store only. */
+	unsigned int compression;
+	unsigned int threads;
+	int unitsize;
+	/* Chunk being filled. */
+	uint8_t *chunk;
+	uint64_t chunk_len;
+	int next_chunk_num;
+	/* Chunks handed to the worker pool, in chunk order. */
+	GThreadPool *pool;
+	GQueue *pending;
+	GMutex mutex;
+	GCond cond;
 };
 
+static void compress_chunk(gpointer data, gpointer user_data);
+
 static int init(struct sr_output *o, GHashTable *options)
 {
 	struct out_context *outc;
@@ -44,21 +109,74 @@ static int init(struct sr_output *o, GHashTable *options)
 	outc->filename = g_strdup(g_variant_get_string(g_hash_table_lookup(options, "filename"), NULL));
 	if (strlen(outc->filename) == 0)
 		return SR_ERR_ARG;
+	outc->index = g_array_new(FALSE, FALSE,
+			sizeof(struct sr_sessionfile_index_entry));
+	outc->want_summary = g_variant_get_boolean(g_hash_table_lookup(options,
+			"summary"));
+	outc->compression = g_variant_get_uint32(g_hash_table_lookup(options,
+			"compression"));
+	if (outc->compression > 9) {
+		sr_err("Compression level must be between 0 and 9.");
+		return SR_ERR_ARG;
+	}
+	outc->threads = g_variant_get_uint32(g_hash_table_lookup(options,
+			"threads"));
+	if (outc->threads == 0)
+		outc->threads = 1;
+	outc->next_chunk_num = 1;
+	outc->pending = g_queue_new();
+	g_mutex_init(&outc->mutex);
+	g_cond_init(&outc->cond);
+	outc->pool = g_thread_pool_new(compress_chunk, NULL, outc->threads,
+			FALSE, NULL);
 
 	return SR_OK;
 }
 
-static int zip_create(const struct sr_output *o)
+/* Drop all changes made to an archive, and free it. */
+static void archive_discard(struct zip *archive)
+{
+	zip_unchange_all(archive);
+	zip_close(archive);
+}
+
+static void chunk_job_free(struct chunk_job *job)
+{
+	g_free(job->data);
+	g_free(job->comp);
+	g_free(job);
+}
+
+/* Write out the session file. */
+static int archive_write(struct out_context *outc)
+{
+	int ret;
+
+	if (!outc->archive)
+		return SR_OK;
+
+	ret = SR_OK;
+	if (zip_close(outc->archive) == -1) {
+		sr_err("Error saving session file: %s.",
+				zip_strerror(outc->archive));
+		archive_discard(outc->archive);
+		ret = SR_ERR;
+	}
+	outc->archive = NULL;
+
+	return ret;
+}
+
+static int zip_create(const struct sr_output *o, int unitsize)
 {
 	struct out_context *outc;
 	struct sr_channel *ch;
-	FILE *meta;
 	struct zip *zipfile;
-	struct zip_source *versrc, *metasrc;
 	GVariant *gvar;
+	GString *meta;
 	GSList *l;
-	int tmpfile, ret;
-	char version[1], metafile[32], *s;
+	int ret;
+	char *s;
 
 	outc = o->priv;
 	if (outc->samplerate == 0) {
@@ -75,27 +193,21 @@ static int zip_create(const struct sr_output *o)
 		return SR_ERR;
 
 	/* "version" */
-	version[0] = '2';
-	if (!(versrc = zip_source_buffer(zipfile, version, 1, 0)))
-		return SR_ERR;
-	if (zip_add(zipfile, "version", versrc) == -1) {
-		sr_info("Error saving version into zipfile: %s.",
-			zip_strerror(zipfile));
+	if (sr_sessionfile_entry_save(zipfile, "version", "2", 1) != SR_OK) {
+		archive_discard(zipfile);
 		return SR_ERR;
 	}
 
-	/* init "metadata" */
-	strcpy(metafile, "sigrok-meta-XXXXXX");
-	if ((tmpfile = g_mkstemp(metafile)) == -1)
-		return SR_ERR;
-	close(tmpfile);
-	meta = g_fopen(metafile, "wb");
-	fprintf(meta, "[global]\n");
-	fprintf(meta, "sigrok version = %s\n", PACKAGE_VERSION);
-	fprintf(meta, "[device 1]\ncapturefile = logic-1\n");
-	fprintf(meta, "total probes = %d\n", g_slist_length(o->sdi->channels));
+	/* "metadata" */
+	meta = g_string_sized_new(256);
+	g_string_append(meta, "[global]\n");
+	g_string_append_printf(meta, "sigrok version = %s\n", PACKAGE_VERSION);
+	g_string_append(meta, "[device 1]\ncapturefile = logic-1\n");
+	g_string_append_printf(meta, "unitsize = %d\n", unitsize);
+	g_string_append_printf(meta, "total probes = %d\n",
+			g_slist_length(o->sdi->channels));
 	s = sr_samplerate_string(outc->samplerate);
-	fprintf(meta, "samplerate = %s\n", s);
+	g_string_append_printf(meta, "samplerate = %s\n", s);
 	g_free(s);
 
 	for (l = o->sdi->channels; l; l = l->next) {
@@ -104,146 +216,267 @@ static int zip_create(const struct sr_output *o)
 			continue;
 		if (!ch->enabled)
 			continue;
-		fprintf(meta, "probe%d = %s\n", ch->index + 1, ch->name);
+		g_string_append_printf(meta, "probe%d = %s\n", ch->index + 1,
+				ch->name);
 	}
-	fclose(meta);
-
-	if (!(metasrc = zip_source_file(zipfile, metafile, 0, -1))) {
-		unlink(metafile);
-		return SR_ERR;
-	}
-	if (zip_add(zipfile, "metadata", metasrc) == -1) {
-		unlink(metafile);
-		return SR_ERR;
-	}
-
-	if ((ret = zip_close(zipfile)) == -1) {
-		sr_info("Error saving zipfile: %s.", zip_strerror(zipfile));
-		unlink(metafile);
+	ret = sr_sessionfile_entry_save(zipfile, "metadata", meta->str,
+			meta->len);
+	g_string_free(meta, TRUE);
+	if (ret != SR_OK) {
+		archive_discard(zipfile);
 		return SR_ERR;
 	}
 
-	unlink(metafile);
+	/* Everything is written out at the end of the capture. */
+	outc->archive = zipfile;
 
 	return SR_OK;
 }
 
-static int zip_append(const struct sr_output *o, unsigned char *buf,
-		int unitsize, int length)
+/* Runs on a worker thread. */
+static void compress_chunk(gpointer data, gpointer user_data)
 {
+	struct chunk_job *job;
 	struct out_context *outc;
-	struct zip *archive;
-	struct zip_source *logicsrc;
-	zip_int64_t num_files;
-	struct zip_file *zf;
-	struct zip_stat zs;
-	struct zip_source *metasrc;
-	GKeyFile *kf;
-	GError *error;
-	gsize len;
-	int chunk_num, next_chunk_num, tmpfile, ret, i;
-	const char *entry_name;
-	char *metafile, tmpname[32], chunkname[16];
+	z_stream zs;
+	uLong bound;
+	int ret;
 
-	outc = o->priv;
-	if (!(archive = zip_open(outc->filename, 0, &ret)))
-		return SR_ERR;
+	(void)user_data;
+
+	job = data;
+	outc = job->outc;
+
+	job->first = sr_sessionfile_index_scan(&job->entry, job->num,
+			job->data, outc->unitsize, job->length);
+	job->crc = crc32(crc32(0, Z_NULL, 0), job->data, job->length);
+
+	/* A raw deflate stream, as stored in a zip archive. */
+	ret = SR_ERR;
+	memset(&zs, 0, sizeof(zs));
+	if (deflateInit2(&zs, outc->compression, Z_DEFLATED, -MAX_WBITS,
+			8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		sr_err("Failed to set up compression of chunk %d.", job->num);
+	} else {
+		bound = deflateBound(&zs, job->length);
+		if (!(job->comp = g_try_malloc(bound))) {
+			sr_err("Compression buffer malloc failed.");
+		} else {
+			zs.next_in = job->data;
+			zs.avail_in = job->length;
+			zs.next_out = job->comp;
+			zs.avail_out = bound;
+			if (deflate(&zs, Z_FINISH) == Z_STREAM_END) {
+				job->comp_length = zs.total_out;
+				ret = SR_OK;
+			} else {
+				sr_err("Failed to compress chunk %d.", job->num);
+			}
+		}
+		deflateEnd(&zs);
+	}
 
-	if (zip_stat(archive, "metadata", 0, &zs) == -1)
-		return SR_ERR;
+	/* The data isn't needed anymore, don't keep it around until commit. */
+	g_free(job->data);
+	job->data = NULL;
 
-	metafile = g_malloc(zs.size);
-	zf = zip_fopen_index(archive, zs.index, 0);
-	zip_fread(zf, metafile, zs.size);
-	zip_fclose(zf);
+	g_mutex_lock(&outc->mutex);
+	job->ret = ret;
+	job->done = TRUE;
+	g_cond_broadcast(&outc->cond);
+	g_mutex_unlock(&outc->mutex);
+}
 
-	/*
-	 * If the file was only initialized but doesn't yet have any
-	 * data it in, it won't have a unitsize field in metadata yet.
-	 */
-	error = NULL;
-	kf = g_key_file_new();
-	if (!g_key_file_load_from_data(kf, metafile, zs.size, 0, &error)) {
-		sr_err("Failed to parse metadata: %s.", error->message);
-		return SR_ERR;
+/*
+ * libzip source for a compressed chunk. It reports the data as deflated,
+ * so libzip copies it into the archive without recompressing it. The
+ * chunk is freed along with the source.
+ */
+static zip_int64_t chunk_source(void *state, void *data, zip_uint64_t len,
+		enum zip_source_cmd cmd)
+{
+	struct chunk_job *job;
+	struct zip_stat *st;
+
+	job = state;
+	switch (cmd) {
+	case ZIP_SOURCE_OPEN:
+		job->pos = 0;
+		return 0;
+	case ZIP_SOURCE_READ:
+		len = MIN(len, job->comp_length - job->pos);
+		memcpy(data, job->comp + job->pos, len);
+		job->pos += len;
+		return len;
+	case ZIP_SOURCE_CLOSE:
+		return 0;
+	case ZIP_SOURCE_STAT:
+		if (len < sizeof(*st))
+			return -1;
+		st = data;
+		zip_stat_init(st);
+		st->valid = ZIP_STAT_SIZE | ZIP_STAT_COMP_SIZE
+				| ZIP_STAT_COMP_METHOD | ZIP_STAT_CRC;
+		st->size = job->length;
+		st->comp_size = job->comp_length;
+		st->comp_method = ZIP_CM_DEFLATE;
+		st->crc = job->crc;
+		return sizeof(*st);
+	case ZIP_SOURCE_ERROR:
+		if (len < 2 * sizeof(int))
+			return -1;
+		((int *)data)[0] = ((int *)data)[1] = 0;
+		return 2 * sizeof(int);
+	case ZIP_SOURCE_FREE:
+		chunk_job_free(job);
+		return 0;
+	default:
+		return -1;
 	}
-	g_free(metafile);
-	tmpname[0] = '\0';
-	if (!g_key_file_has_key(kf, "device 1", "unitsize", &error)) {
-		if (error && error->code != G_KEY_FILE_ERROR_KEY_NOT_FOUND) {
-			sr_err("Failed to check unitsize key: %s", error ? error->message : "?");
-			return SR_ERR;
-		}
-		/* Add unitsize field. */
-		g_key_file_set_integer(kf, "device 1", "unitsize", unitsize);
-		metafile = g_key_file_to_data(kf, &len, &error);
-		strcpy(tmpname, "sigrok-meta-XXXXXX");
-		if ((tmpfile = g_mkstemp(tmpname)) == -1)
-			return SR_ERR;
-		if (write(tmpfile, metafile, len) < 0) {
-			sr_dbg("Failed to create new metadata: %s", strerror(errno));
-			g_free(metafile);
-			unlink(tmpname);
-			return SR_ERR;
+}
+
+/*
+ * Add compressed chunks to the session file, in chunk order. If
+ * wait_all is set, wait for all pending chunks. Otherwise, only wait
+ * if too many chunks are in flight, so memory use stays bounded.
+ */
+static int commit_chunks(struct out_context *outc, gboolean wait_all)
+{
+	struct chunk_job *job;
+	struct zip_source *src;
+	GSList *jobs, *l;
+	unsigned int max_pending;
+	char chunkname[16];
+	int ret;
+
+	max_pending = outc->threads * MAX_PENDING_PER_THREAD;
+	jobs = NULL;
+	g_mutex_lock(&outc->mutex);
+	while ((job = g_queue_peek_head(outc->pending))) {
+		if (!job->done) {
+			if (!wait_all && g_queue_get_length(outc->pending) <= max_pending)
+				break;
+			g_cond_wait(&outc->cond, &outc->mutex);
+			continue;
 		}
-		close(tmpfile);
-		if (!(metasrc = zip_source_file(archive, tmpname, 0, -1))) {
-			sr_err("Failed to create zip source for metadata.");
-			g_free(metafile);
-			unlink(tmpname);
-			return SR_ERR;
+		g_queue_pop_head(outc->pending);
+		jobs = g_slist_append(jobs, job);
+	}
+	g_mutex_unlock(&outc->mutex);
+
+	ret = outc->archive ? SR_OK : SR_ERR;
+	for (l = jobs; l; l = l->next) {
+		job = l->data;
+		if (ret != SR_OK || (ret = job->ret) != SR_OK) {
+			chunk_job_free(job);
+			continue;
 		}
-		if (zip_replace(archive, zs.index, metasrc) == -1) {
-			sr_err("Failed to replace metadata file.");
-			g_free(metafile);
-			unlink(tmpname);
-			return SR_ERR;
+		sr_sessionfile_index_append(outc->index, &job->entry, job->first,
+				outc->unitsize);
+		snprintf(chunkname, sizeof(chunkname), "logic-1-%d", job->num);
+		if (!(src = zip_source_function(outc->archive, chunk_source, job))) {
+			chunk_job_free(job);
+			ret = SR_ERR;
+		} else if (zip_add(outc->archive, chunkname, src) == -1) {
+			/* Frees the job as well. */
+			zip_source_free(src);
+			ret = SR_ERR;
 		}
-		g_free(metafile);
+		if (ret != SR_OK)
+			sr_err("Failed to add chunk to session file: %s.",
+					zip_strerror(outc->archive));
 	}
-	g_key_file_free(kf);
+	g_slist_free(jobs);
 
-	next_chunk_num = 1;
-	num_files = zip_get_num_entries(archive, 0);
-	for (i = 0; i < num_files; i++) {
-		entry_name = zip_get_name(archive, i, 0);
-		if (strncmp(entry_name, "logic-1", 7))
-			continue;
-		if (strlen(entry_name) == 7) {
-			/* This file has no extra chunks, just a single "logic-1".
-			 * Rename it to "logic-1-1" * and continue with chunk 2. */
-			if (zip_rename(archive, i, "logic-1-1") == -1) {
-				sr_err("Failed to rename 'logic-1' to 'logic-1-1'.");
-				unlink(tmpname);
-				return SR_ERR;
+	return ret;
+}
+
+/* Hand the current chunk over to the worker pool. */
+static int chunk_flush(struct out_context *outc)
+{
+	struct chunk_job *job;
+
+	if (outc->chunk_len == 0)
+		return SR_OK;
+
+	job = g_malloc0(sizeof(struct chunk_job));
+	job->outc = outc;
+	job->num = outc->next_chunk_num++;
+	job->data = outc->chunk;
+	job->length = outc->chunk_len;
+	outc->chunk = NULL;
+	outc->chunk_len = 0;
+
+	g_mutex_lock(&outc->mutex);
+	g_queue_push_tail(outc->pending, job);
+	g_mutex_unlock(&outc->mutex);
+	g_thread_pool_push(outc->pool, job, NULL);
+
+	return commit_chunks(outc, FALSE);
+}
+
+static int zip_append(struct out_context *outc, const uint8_t *buf,
+		uint64_t length)
+{
+	uint64_t chunk_size, n;
+	int ret;
+
+	/* Chunks always hold whole samples. */
+	chunk_size = CHUNK_SIZE / outc->unitsize * outc->unitsize;
+	while (length > 0) {
+		if (!outc->chunk) {
+			if (!(outc->chunk = g_try_malloc(chunk_size))) {
+				sr_err("Chunk buffer malloc failed.");
+				return SR_ERR_MALLOC;
 			}
-			next_chunk_num = 2;
-			break;
-		} else if (strlen(entry_name) > 8 && entry_name[7] == '-') {
-			chunk_num = strtoull(entry_name + 8, NULL, 10);
-			if (chunk_num >= next_chunk_num)
-				next_chunk_num = chunk_num + 1;
+		}
+		n = MIN(length, chunk_size - outc->chunk_len);
+		memcpy(outc->chunk + outc->chunk_len, buf, n);
+		outc->chunk_len += n;
+		buf += n;
+		length -= n;
+		if (outc->chunk_len == chunk_size) {
+			if ((ret = chunk_flush(outc)) != SR_OK)
+				return ret;
 		}
 	}
-	snprintf(chunkname, 15, "logic-1-%d", next_chunk_num);
-	if (!(logicsrc = zip_source_buffer(archive, buf, length, FALSE))) {
-		unlink(tmpname);
-		return SR_ERR;
-	}
-	if (zip_add(archive, chunkname, logicsrc) == -1) {
-		unlink(tmpname);
-		return SR_ERR;
-	}
-	if ((ret = zip_close(archive)) == -1) {
-		sr_info("error saving session file: %s", zip_strerror(archive));
-		unlink(tmpname);
-		return SR_ERR;
-	}
-	unlink(tmpname);
 
 	return SR_OK;
 }
 
+static int summary_save(struct out_context *outc, struct zip *archive)
+{
+	GString *s;
+	int ret;
+
+	s = g_string_sized_new(1024);
+	sr_summary_serialize(outc->summary, s);
+	ret = sr_sessionfile_entry_save(archive,
+			"logic-1" SR_SESSIONFILE_SUMMARY_SUFFIX, s->str, s->len);
+	g_string_free(s, TRUE);
+
+	return ret;
+}
+
+/* Add the last chunks, the index and summary, and write the session file. */
+static int capture_end(struct out_context *outc)
+{
+	int ret;
+
+	ret = chunk_flush(outc);
+	if (commit_chunks(outc, TRUE) != SR_OK || ret != SR_OK)
+		ret = SR_ERR;
+	if (ret == SR_OK && outc->index->len > 0)
+		ret = sr_sessionfile_index_save(outc->archive, "logic-1",
+				outc->index);
+	if (ret == SR_OK && outc->summary)
+		ret = summary_save(outc, outc->archive);
+	if (archive_write(outc) != SR_OK)
+		ret = SR_ERR;
+
+	return ret;
+}
+
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
 		GString **out)
 {
@@ -270,13 +503,31 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		}
 		break;
 	case SR_DF_LOGIC:
+		logic = packet->payload;
 		if (!outc->zip_created) {
-			if ((ret = zip_create(o)) != SR_OK)
+			if ((ret = zip_create(o, logic->unitsize)) != SR_OK)
 				return ret;
 			outc->zip_created = TRUE;
+			outc->unitsize = logic->unitsize;
+		}
+		if (logic->unitsize != outc->unitsize) {
+			sr_err("Unit size changed during acquisition.");
+			return SR_ERR_DATA;
+		}
+		if ((ret = zip_append(outc, logic->data, logic->length)) != SR_OK)
+			return ret;
+		if (outc->want_summary) {
+			if (!outc->summary)
+				outc->summary = sr_summary_new(SR_SUMMARY_LOGIC,
+						logic->unitsize, SUMMARY_FACTOR, NULL);
+			if (outc->summary->width == (unsigned int)logic->unitsize)
+				sr_summary_logic_feed(outc->summary, logic->data,
+						logic->length);
 		}
-		logic = packet->payload;
-		ret = zip_append(o, logic->data, logic->unitsize, logic->length);
+		break;
+	case SR_DF_END:
+		if (outc->zip_created)
+			return capture_end(outc);
 		break;
 	}
 
@@ -288,6 +539,19 @@ static int cleanup(struct sr_output *o)
 	struct out_context *outc;
 
 	outc = o->priv;
+	if (outc->pool) {
+		/* Let the workers finish, then drop whatever wasn't committed. */
+		g_thread_pool_free(outc->pool, FALSE, TRUE);
+		g_queue_free_full(outc->pending, (GDestroyNotify)chunk_job_free);
+		g_mutex_clear(&outc->mutex);
+		g_cond_clear(&outc->cond);
+	}
+	/* Without an SR_DF_END, keep what was captured so far. */
+	archive_write(outc);
+	g_free(outc->chunk);
+	if (outc->index)
+		g_array_free(outc->index, TRUE);
+	sr_summary_free(outc->summary);
 	g_free(outc->filename);
 	g_free(outc);
 	o->priv = NULL;
@@ -297,13 +561,22 @@ static int cleanup(struct sr_output *o)
 
 static struct sr_option options[] = {
 	{ "filename", "Filename", "File to write", NULL, NULL },
+	{ "summary", "Summary", "Store a multi-resolution summary of the "
+			"logic data", NULL, NULL },
+	{ "compression", "Compression", "Compression level, 1 (fastest) "
+			"to 9 (smallest), or 0 to store only", NULL, NULL },
+	{ "threads", "Threads", "Number of compression threads", NULL, NULL },
 	ALL_ZERO
 };
 
 static const struct sr_option *get_options(void)
 {
-	if (!options[0].def)
+	if (!options[0].def) {
 		options[0].def = g_variant_ref_sink(g_variant_new_string(""));
+		options[1].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+		options[2].def = g_variant_ref_sink(g_variant_new_uint32(DEFAULT_COMPRESSION));
+		options[3].def = g_variant_ref_sink(g_variant_new_uint32(DEFAULT_THREADS));
+	}
 
 	return options;
 }
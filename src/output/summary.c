@@ -0,0 +1,199 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <glib.h>
+#include "libsigrok.h"
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/summary"
+
+#define DEFAULT_FACTOR 16
+
+struct context {
+	unsigned int factor;
+	struct sr_summary *logic;
+	/* Enabled analog channels, and their summaries. */
+	GPtrArray *channels;
+	GPtrArray *summaries;
+	float *fbuf;
+	uint64_t fbuf_size;
+};
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct context *ctx;
+	struct sr_channel *ch;
+	GSList *l;
+
+	if (!o || !o->sdi)
+		return SR_ERR_ARG;
+
+	ctx = g_malloc0(sizeof(struct context));
+	o->priv = ctx;
+	ctx->factor = g_variant_get_uint32(g_hash_table_lookup(options, "factor"));
+	if (ctx->factor < 2) {
+		sr_err("Summary factor must be at least 2.");
+		return SR_ERR_ARG;
+	}
+
+	ctx->channels = g_ptr_array_new();
+	ctx->summaries = g_ptr_array_new_with_free_func(
+			(GDestroyNotify)sr_summary_free);
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_ANALOG || !ch->enabled)
+			continue;
+		g_ptr_array_add(ctx->channels, ch);
+		g_ptr_array_add(ctx->summaries, sr_summary_new(SR_SUMMARY_ANALOG,
+				1, ctx->factor, ch->name));
+	}
+
+	return SR_OK;
+}
+
+static struct sr_summary *channel_summary(struct context *ctx,
+		struct sr_channel *ch)
+{
+	unsigned int i;
+
+	for (i = 0; i < ctx->channels->len; i++) {
+		if (g_ptr_array_index(ctx->channels, i) == ch)
+			return g_ptr_array_index(ctx->summaries, i);
+	}
+
+	return NULL;
+}
+
+static void analog_feed(struct context *ctx, GSList *channels,
+		const float *data, uint64_t num_samples)
+{
+	GSList *l;
+	unsigned int num_channels, c;
+
+	num_channels = g_slist_length(channels);
+	for (l = channels, c = 0; l; l = l->next, c++)
+		sr_summary_analog_feed(channel_summary(ctx, l->data), data + c,
+				num_samples, num_channels);
+}
+
+static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
+		GString **out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_analog2 *analog2;
+	unsigned int num_channels, i;
+	int ret;
+
+	*out = NULL;
+	if (!o || !o->sdi || !(ctx = o->priv))
+		return SR_ERR_ARG;
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		if (!ctx->logic)
+			ctx->logic = sr_summary_new(SR_SUMMARY_LOGIC,
+					logic->unitsize, ctx->factor, NULL);
+		if (ctx->logic->width != logic->unitsize) {
+			sr_err("Unit size changed during acquisition.");
+			return SR_ERR_DATA;
+		}
+		sr_summary_logic_feed(ctx->logic, logic->data, logic->length);
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		analog_feed(ctx, analog->channels, analog->data,
+				analog->num_samples);
+		break;
+	case SR_DF_ANALOG2:
+		analog2 = packet->payload;
+		num_channels = g_slist_length(analog2->meaning->channels);
+		if (num_channels == 0)
+			break;
+		if (ctx->fbuf_size < analog2->num_samples) {
+			g_free(ctx->fbuf);
+			ctx->fbuf_size = analog2->num_samples;
+			if (!(ctx->fbuf = g_try_malloc(ctx->fbuf_size * sizeof(float)))) {
+				ctx->fbuf_size = 0;
+				return SR_ERR_MALLOC;
+			}
+		}
+		if ((ret = sr_analog_to_float(analog2, ctx->fbuf)) != SR_OK)
+			return ret;
+		analog_feed(ctx, analog2->meaning->channels, ctx->fbuf,
+				analog2->num_samples / num_channels);
+		break;
+	case SR_DF_END:
+		*out = g_string_sized_new(1024);
+		if (ctx->logic)
+			sr_summary_serialize(ctx->logic, *out);
+		for (i = 0; i < ctx->summaries->len; i++)
+			sr_summary_serialize(g_ptr_array_index(ctx->summaries, i),
+					*out);
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_output *o)
+{
+	struct context *ctx;
+
+	if (!o || !o->sdi)
+		return SR_ERR_ARG;
+
+	if ((ctx = o->priv)) {
+		sr_summary_free(ctx->logic);
+		if (ctx->channels)
+			g_ptr_array_free(ctx->channels, TRUE);
+		if (ctx->summaries)
+			g_ptr_array_free(ctx->summaries, TRUE);
+		g_free(ctx->fbuf);
+		g_free(ctx);
+	}
+	o->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "factor", "Factor", "Samples per node of the finest level, "
+			"and nodes per node of the levels above", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_uint32(DEFAULT_FACTOR));
+
+	return options;
+}
+
+SR_PRIV struct sr_output_module output_summary = {
+	.id = "summary",
+	.name = "Summary",
+	.desc = "Multi-resolution min/max summary for fast zooming",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -42,21 +42,17 @@ struct context {
 static int init(struct sr_output *o, GHashTable *options)
 {
 	struct context *ctx;
-	struct sr_channel *ch;
-	GSList *l;
-	int num_enabled_channels, i;
+	const struct sr_channel_table *table;
+	int num_enabled_channels;
 
 	(void)options;
 
-	num_enabled_channels = 0;
-	for (l = o->sdi->channels; l; l = l->next) {
-		ch = l->data;
-		if (ch->type != SR_CHANNEL_LOGIC)
-			continue;
-		if (!ch->enabled)
-			continue;
-		num_enabled_channels++;
+	if (!(table = sr_dev_inst_channel_table_get(o->sdi))) {
+		/* Used outside of a session, build the table here. */
+		sr_dev_inst_channel_table_update((struct sr_dev_inst *)o->sdi);
+		table = sr_dev_inst_channel_table_get(o->sdi);
 	}
+	num_enabled_channels = table->num_logic;
 	if (num_enabled_channels > 94) {
 		sr_err("VCD only supports 94 channels.");
 		return SR_ERR;
@@ -65,17 +61,8 @@ static int init(struct sr_output *o, GHashTable *options)
 	ctx = g_malloc0(sizeof(struct context));
 	o->priv = ctx;
 	ctx->num_enabled_channels = num_enabled_channels;
-	ctx->channel_index = g_malloc(sizeof(int) * ctx->num_enabled_channels);
-
-	/* Once more to map the enabled channels. */
-	for (i = 0, l = o->sdi->channels; l; l = l->next) {
-		ch = l->data;
-		if (ch->type != SR_CHANNEL_LOGIC)
-			continue;
-		if (!ch->enabled)
-			continue;
-		ctx->channel_index[i++] = ch->index;
-	}
+	ctx->channel_index = g_memdup(table->logic_index,
+			sizeof(int) * table->num_logic);
 
 	return SR_OK;
 }
@@ -0,0 +1,552 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include "libsigrok.h"
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "planar"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Per-channel bit planes of logic data, as used by the "planar" input and
+ * output modules.
+ *
+ * A plane holds one channel: sample i is bit (i % 8) of byte (i / 8).
+ * Unused bits in the last byte are zero. A plane is stored either as is
+ * (SR_PLANAR_RAW), or run-length encoded (SR_PLANAR_RLE): one byte with
+ * the level of the first sample, followed by the lengths of the runs of
+ * alternating levels, each as an unsigned LEB128 varint.
+ *
+ * File format, all integers little-endian:
+ *
+ *   magic         8 bytes, "SRPLANAR"
+ *   version       uint32, SR_PLANAR_VERSION
+ *   num_channels  uint32
+ *   chunk_samples uint32, samples per chunk, all but the last chunk are full
+ *   samplerate    2 * uint32, low word first, 0 if unknown
+ *
+ * followed by, for every channel:
+ *
+ *   index         uint32, the channel's index
+ *   name_len      uint32, followed by name_len bytes of channel name
+ *
+ * followed by any number of chunks:
+ *
+ *   magic         4 bytes, "PLCH"
+ *   num_samples   uint32
+ *   directory     num_channels * 3 uint32: encoding, offset from the start
+ *                 of the chunk, and length of every channel's plane
+ *   planes
+ *
+ * and finally the chunk index:
+ *
+ *   magic         4 bytes, "PLIX"
+ *   num_chunks    uint32
+ *   offsets       num_chunks * 2 uint32, file offset of every chunk
+ *   index_offset  2 * uint32, file offset of the chunk index
+ *   end magic     8 bytes, "SRPLEND1"
+ *
+ * A reader can find the chunk index from the last 16 bytes of the file,
+ * and with it the location of every plane without touching the others;
+ * sr_planar_read_channel() does just that.
+ */
+
+/* Sanity limits, as in the input module. */
+#define MAX_CHANNELS     4096
+#define MAX_CHUNK_SAMPLES (256 * 1024 * 1024)
+
+/* Fixed part of the file header. */
+#define HEADER_BYTES     28
+
+/**
+ * Transpose an 8x8 bit matrix, held as 8 bytes of 8 bits: bit c of byte r
+ * ends up as bit r of byte c. The transpose is its own inverse.
+ *
+ * @private
+ */
+SR_PRIV uint64_t sr_transpose8x8(uint64_t x)
+{
+	uint64_t t;
+
+	t = (x ^ (x >> 7)) & 0x00aa00aa00aa00aaULL;
+	x = x ^ t ^ (t << 7);
+	t = (x ^ (x >> 14)) & 0x0000cccc0000ccccULL;
+	x = x ^ t ^ (t << 14);
+	t = (x ^ (x >> 28)) & 0x00000000f0f0f0f0ULL;
+	x = x ^ t ^ (t << 28);
+
+	return x;
+}
+
+/**
+ * Split logic samples into per-channel planes.
+ *
+ * Every group of 8 samples of a sample byte is transposed at once, so the
+ * cost is a handful of 64-bit operations per 8 samples and byte, rather
+ * than a shift and mask per sample and channel.
+ *
+ * @param data The samples.
+ * @param unitsize Size of a sample in bytes.
+ * @param num_samples Number of samples.
+ * @param channel_index Bit index within the sample of every channel.
+ * @param num_channels Number of channels.
+ * @param planes One plane per channel, (num_samples + 7) / 8 bytes each.
+ *
+ * @private
+ */
+SR_PRIV void sr_planar_split(const uint8_t *data, unsigned int unitsize,
+		uint64_t num_samples, const int *channel_index,
+		unsigned int num_channels, uint8_t **planes)
+{
+	const uint8_t *p;
+	uint64_t g, num_groups, x;
+	unsigned int j, k, n;
+	int idx, lane;
+
+	num_groups = (num_samples + 7) / 8;
+	for (g = 0; g < num_groups; g++) {
+		p = data + g * 8 * unitsize;
+		n = MIN(8, num_samples - g * 8);
+		lane = -1;
+		x = 0;
+		for (j = 0; j < num_channels; j++) {
+			idx = channel_index[j];
+			if (idx / 8 != lane) {
+				lane = idx / 8;
+				x = 0;
+				for (k = 0; k < n; k++)
+					x |= (uint64_t)p[k * unitsize + lane] << (8 * k);
+				x = sr_transpose8x8(x);
+			}
+			planes[j][g] = x >> (8 * (idx % 8));
+		}
+	}
+}
+
+/**
+ * Join per-channel planes into logic samples, the inverse of
+ * sr_planar_split(). Bits of the samples not covered by any channel are
+ * zero.
+ *
+ * @param planes One plane per channel.
+ * @param channel_index Bit index within the sample of every channel.
+ * @param num_channels Number of channels.
+ * @param num_samples Number of samples.
+ * @param unitsize Size of a sample in bytes.
+ * @param data Output buffer of num_samples * unitsize bytes.
+ *
+ * @private
+ */
+SR_PRIV void sr_planar_join(uint8_t * const *planes, const int *channel_index,
+		unsigned int num_channels, uint64_t num_samples,
+		unsigned int unitsize, uint8_t *data)
+{
+	uint8_t *p;
+	uint64_t g, num_groups, x;
+	unsigned int j, k, s, n;
+	int idx, lane;
+
+	memset(data, 0, num_samples * unitsize);
+	num_groups = (num_samples + 7) / 8;
+	for (g = 0; g < num_groups; g++) {
+		p = data + g * 8 * unitsize;
+		n = MIN(8, num_samples - g * 8);
+		for (j = 0; j < num_channels; j = k) {
+			lane = channel_index[j] / 8;
+			x = 0;
+			for (k = j; k < num_channels; k++) {
+				idx = channel_index[k];
+				if (idx / 8 != lane)
+					break;
+				x |= (uint64_t)planes[k][g] << (8 * (idx % 8));
+			}
+			x = sr_transpose8x8(x);
+			for (s = 0; s < n; s++)
+				p[s * unitsize + lane] |= x >> (8 * s);
+		}
+	}
+}
+
+/* Append an unsigned LEB128 varint, return the number of bytes written. */
+static unsigned int varint_put(uint8_t *out, uint64_t v)
+{
+	unsigned int len;
+
+	len = 0;
+	while (v >= 0x80) {
+		out[len++] = (v & 0x7f) | 0x80;
+		v >>= 7;
+	}
+	out[len++] = v;
+
+	return len;
+}
+
+/**
+ * Run-length encode a plane.
+ *
+ * Runs are found a byte at a time where the plane is all-0 or all-1, so
+ * slow channels are cheap to encode.
+ *
+ * @param plane The plane.
+ * @param num_samples Number of samples in the plane.
+ * @param out Output buffer of at least max_len bytes.
+ * @param max_len Give up once the encoding gets this long.
+ *
+ * @return The length of the encoding, or 0 if it would be longer than
+ *         max_len.
+ *
+ * @private
+ */
+SR_PRIV uint64_t sr_planar_rle_encode(const uint8_t *plane, uint64_t num_samples,
+		uint8_t *out, uint64_t max_len)
+{
+	uint64_t i, start, len;
+	uint8_t level, fill;
+
+	if (num_samples == 0 || max_len < 1)
+		return 0;
+
+	level = plane[0] & 1;
+	len = 0;
+	out[len++] = level;
+	i = 0;
+	while (i < num_samples) {
+		start = i;
+		fill = level ? 0xff : 0x00;
+		while (i < num_samples) {
+			if ((i & 7) == 0) {
+				while (i + 8 <= num_samples && plane[i >> 3] == fill)
+					i += 8;
+				if (i == num_samples)
+					break;
+			}
+			if (((plane[i >> 3] >> (i & 7)) & 1) != level)
+				break;
+			i++;
+		}
+		/* A varint of up to 64 bits takes at most 10 bytes. */
+		if (len + 10 > max_len)
+			return 0;
+		len += varint_put(out + len, i - start);
+		level ^= 1;
+	}
+
+	return len;
+}
+
+/* Set bits start..end - 1 of a plane. */
+static void plane_set(uint8_t *plane, uint64_t start, uint64_t end)
+{
+	uint64_t first, last;
+
+	if (start == end)
+		return;
+	first = start >> 3;
+	last = (end - 1) >> 3;
+	if (first == last) {
+		plane[first] |= (0xff << (start & 7)) & (0xff >> (7 - ((end - 1) & 7)));
+		return;
+	}
+	plane[first] |= 0xff << (start & 7);
+	memset(plane + first + 1, 0xff, last - first - 1);
+	plane[last] |= 0xff >> (7 - ((end - 1) & 7));
+}
+
+/**
+ * Decode a run-length encoded plane.
+ *
+ * @param src The encoding.
+ * @param len Length of the encoding.
+ * @param num_samples Number of samples in the plane.
+ * @param plane Output buffer of (num_samples + 7) / 8 bytes.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_DATA The encoding is invalid.
+ *
+ * @private
+ */
+SR_PRIV int sr_planar_rle_decode(const uint8_t *src, uint64_t len,
+		uint64_t num_samples, uint8_t *plane)
+{
+	uint64_t pos, i, run;
+	unsigned int shift;
+	uint8_t level;
+
+	memset(plane, 0, (num_samples + 7) / 8);
+	if (len < 1 || src[0] > 1)
+		return SR_ERR_DATA;
+
+	level = src[0];
+	pos = 1;
+	i = 0;
+	while (i < num_samples) {
+		run = 0;
+		shift = 0;
+		do {
+			if (pos == len || shift > 63)
+				return SR_ERR_DATA;
+			run |= (uint64_t)(src[pos] & 0x7f) << shift;
+			shift += 7;
+		} while (src[pos++] & 0x80);
+		if (run == 0 || run > num_samples - i)
+			return SR_ERR_DATA;
+		if (level)
+			plane_set(plane, i, i + run);
+		i += run;
+		level ^= 1;
+	}
+
+	return pos == len ? SR_OK : SR_ERR_DATA;
+}
+
+/* Read len bytes at the given file offset. */
+static int file_read_at(FILE *f, uint64_t offset, void *buf, size_t len)
+{
+	if (offset > G_MAXINT64 || fseeko(f, (off_t)offset, SEEK_SET) < 0
+			|| fread(buf, 1, len, f) != len)
+		return SR_ERR_DATA;
+
+	return SR_OK;
+}
+
+/* Copy n bits from bit src_bit of src to bit dst_bit of dst, zero-filled. */
+static void plane_copy(uint8_t *dst, uint64_t dst_bit, const uint8_t *src,
+		uint64_t src_bit, uint64_t n)
+{
+	uint64_t i;
+
+	i = 0;
+	if (!(dst_bit & 7) && !(src_bit & 7)) {
+		memcpy(dst + dst_bit / 8, src + src_bit / 8, n / 8);
+		i = n & ~7ULL;
+	}
+	for (; i < n; i++) {
+		if ((src[(src_bit + i) >> 3] >> ((src_bit + i) & 7)) & 1)
+			dst[(dst_bit + i) >> 3] |= 1 << ((dst_bit + i) & 7);
+	}
+}
+
+/**
+ * Read a range of samples of a single channel from a planar capture file.
+ *
+ * Only the file header, the chunk index, and the directory entries and
+ * planes of this channel in the chunks overlapping the range are read;
+ * the other channels' planes are never touched.
+ *
+ * @param filename The planar capture file.
+ * @param channel_index Index of the channel, as stored in the file header.
+ * @param start_sample First sample to read.
+ * @param num_samples Number of samples to read. The range is truncated at
+ *                    the end of the capture.
+ * @param plane Will be set to a newly allocated plane holding the samples
+ *              read, sample i of the range being bit (i % 8) of byte
+ *              (i / 8), or NULL if no samples were read. The caller must
+ *              g_free() it.
+ * @param samples_read Will be set to the number of samples read.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid arguments, or no such channel in the file.
+ * @retval SR_ERR_DATA The file is not a valid planar capture file.
+ * @retval SR_ERR_MALLOC Memory allocation failed.
+ * @retval SR_ERR The file could not be opened.
+ *
+ * @since 0.4.0
+ */
+SR_API int sr_planar_read_channel(const char *filename, int channel_index,
+		uint64_t start_sample, uint64_t num_samples, uint8_t **plane,
+		uint64_t *samples_read)
+{
+	FILE *f;
+	uint8_t hdr[HEADER_BYTES], buf[16], *offsets, *src, *chunk, *out;
+	uint64_t pos, file_size, index_offset, chunk_samples, total, end;
+	uint64_t chunk_start, first, n, from, to, k, num_chunks;
+	unsigned int num_channels, j, i, len, offset, encoding, raw_len;
+	off_t size;
+	int ret;
+
+	if (!filename || !plane || !samples_read)
+		return SR_ERR_ARG;
+	*plane = NULL;
+	*samples_read = 0;
+
+	if (!(f = g_fopen(filename, "rb"))) {
+		sr_err("Failed to open '%s': %s.", filename, g_strerror(errno));
+		return SR_ERR;
+	}
+	offsets = src = chunk = out = NULL;
+
+	/* File header and channel list. */
+	ret = file_read_at(f, 0, hdr, HEADER_BYTES);
+	if (ret != SR_OK || memcmp(hdr, SR_PLANAR_MAGIC, 8)
+			|| RL32(hdr + 8) != SR_PLANAR_VERSION) {
+		sr_err("'%s' is not a planar capture file.", filename);
+		ret = SR_ERR_DATA;
+		goto done;
+	}
+	num_channels = RL32(hdr + 12);
+	chunk_samples = RL32(hdr + 16);
+	if (num_channels == 0 || num_channels > MAX_CHANNELS
+			|| chunk_samples == 0 || chunk_samples % 8
+			|| chunk_samples > MAX_CHUNK_SAMPLES) {
+		sr_err("Invalid planar file header.");
+		ret = SR_ERR_DATA;
+		goto done;
+	}
+	pos = HEADER_BYTES;
+	j = num_channels;
+	for (i = 0; i < num_channels; i++) {
+		if ((ret = file_read_at(f, pos, buf, 8)) != SR_OK)
+			goto done;
+		if ((int)RL32(buf) == channel_index)
+			j = i;
+		pos += 8 + (uint64_t)RL32(buf + 4);
+	}
+	if (j == num_channels) {
+		sr_err("No channel with index %d in '%s'.", channel_index, filename);
+		ret = SR_ERR_ARG;
+		goto done;
+	}
+
+	/* Chunk index, found through the trailer. */
+	if (fseeko(f, 0, SEEK_END) < 0 || (size = ftello(f)) < 0
+			|| (file_size = size) < pos + 24
+			|| (ret = file_read_at(f, file_size - 16, buf, 16)) != SR_OK
+			|| memcmp(buf + 8, SR_PLANAR_END_MAGIC, 8)) {
+		sr_err("Missing planar file trailer.");
+		ret = SR_ERR_DATA;
+		goto done;
+	}
+	index_offset = RL32(buf) | (uint64_t)RL32(buf + 4) << 32;
+	if (index_offset > file_size - 24
+			|| (ret = file_read_at(f, index_offset, buf, 8)) != SR_OK
+			|| memcmp(buf, SR_PLANAR_INDEX_MAGIC, 4)
+			|| (num_chunks = RL32(buf + 4)) > (file_size - 24 - index_offset) / 8) {
+		sr_err("Invalid planar chunk index.");
+		ret = SR_ERR_DATA;
+		goto done;
+	}
+	if (num_chunks == 0) {
+		ret = SR_OK;
+		goto done;
+	}
+	if (!(offsets = g_try_malloc(num_chunks * 8))) {
+		ret = SR_ERR_MALLOC;
+		goto done;
+	}
+	if ((ret = file_read_at(f, index_offset + 8, offsets, num_chunks * 8)) != SR_OK)
+		goto done;
+
+	/* All chunks but the last are full, so its header gives the total. */
+	pos = RL32(offsets + (num_chunks - 1) * 8)
+			| (uint64_t)RL32(offsets + (num_chunks - 1) * 8 + 4) << 32;
+	if ((ret = file_read_at(f, pos, buf, 8)) != SR_OK
+			|| memcmp(buf, SR_PLANAR_CHUNK_MAGIC, 4)
+			|| RL32(buf + 4) > chunk_samples) {
+		sr_err("Invalid planar chunk.");
+		ret = SR_ERR_DATA;
+		goto done;
+	}
+	total = (num_chunks - 1) * chunk_samples + RL32(buf + 4);
+	if (start_sample >= total || num_samples == 0) {
+		ret = SR_OK;
+		goto done;
+	}
+	num_samples = MIN(num_samples, total - start_sample);
+	end = start_sample + num_samples;
+
+	raw_len = chunk_samples / 8;
+	src = g_try_malloc(raw_len);
+	chunk = g_try_malloc(raw_len);
+	out = g_try_malloc0((num_samples + 7) / 8);
+	if (!src || !chunk || !out) {
+		ret = SR_ERR_MALLOC;
+		goto done;
+	}
+
+	first = start_sample / chunk_samples;
+	for (k = first; k * chunk_samples < end; k++) {
+		chunk_start = k * chunk_samples;
+		pos = RL32(offsets + k * 8) | (uint64_t)RL32(offsets + k * 8 + 4) << 32;
+		if ((ret = file_read_at(f, pos, buf, 8)) != SR_OK
+				|| (ret = file_read_at(f, pos + 8 + 12 * j, buf + 8, 8)) != SR_OK
+				|| memcmp(buf, SR_PLANAR_CHUNK_MAGIC, 4)) {
+			sr_err("Invalid planar chunk.");
+			ret = SR_ERR_DATA;
+			goto done;
+		}
+		n = RL32(buf + 4);
+		if (n == 0 || n > chunk_samples || (k < num_chunks - 1 && n != chunk_samples)) {
+			sr_err("Invalid planar chunk.");
+			ret = SR_ERR_DATA;
+			goto done;
+		}
+		encoding = RL32(buf + 8);
+		offset = RL32(buf + 12);
+		if ((ret = file_read_at(f, pos + 16 + 12 * j, buf, 4)) != SR_OK)
+			goto done;
+		len = RL32(buf);
+		if (offset < 8 + 12 * num_channels || len > raw_len
+				|| (encoding == SR_PLANAR_RAW && len != (n + 7) / 8)
+				|| (ret = file_read_at(f, pos + offset, src, len)) != SR_OK) {
+			sr_err("Invalid plane in chunk %" PRIu64 ".", k);
+			ret = SR_ERR_DATA;
+			goto done;
+		}
+		switch (encoding) {
+		case SR_PLANAR_RAW:
+			memcpy(chunk, src, len);
+			break;
+		case SR_PLANAR_RLE:
+			if ((ret = sr_planar_rle_decode(src, len, n, chunk)) != SR_OK) {
+				sr_err("Invalid run-length encoding in chunk %" PRIu64 ".", k);
+				goto done;
+			}
+			break;
+		default:
+			sr_err("Unknown plane encoding %d.", encoding);
+			ret = SR_ERR_DATA;
+			goto done;
+		}
+		from = MAX(start_sample, chunk_start) - chunk_start;
+		to = MIN(end, chunk_start + n) - chunk_start;
+		plane_copy(out, chunk_start + from - start_sample, chunk, from, to - from);
+	}
+
+	*plane = out;
+	*samples_read = num_samples;
+	out = NULL;
+	ret = SR_OK;
+
+done:
+	fclose(f);
+	g_free(offsets);
+	g_free(src);
+	g_free(chunk);
+	g_free(out);
+
+	return ret;
+}
@@ -330,6 +330,29 @@ SR_PRIV int sr_scpi_read_data(struct sr_scpi_dev_inst *scpi,
 	return scpi->read_data(scpi->priv, buf, maxlen);
 }
 
+/**
+ * Read part of a response from SCPI device, as is.
+ *
+ * Unlike sr_scpi_read_data(), no bytes are held back or dropped as
+ * terminators, so this can be used for binary data which may contain
+ * them, when the caller knows how much to read.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param buf Buffer to store result.
+ * @param maxlen Maximum number of bytes to read.
+ *
+ * @return Number of bytes read, or SR_ERR upon failure.
+ */
+SR_PRIV int sr_scpi_read_raw(struct sr_scpi_dev_inst *scpi,
+			char *buf, int maxlen)
+{
+	/* Transports without terminator handling don't need their own. */
+	if (!scpi->read_raw)
+		return scpi->read_data(scpi->priv, buf, maxlen);
+
+	return scpi->read_raw(scpi->priv, buf, maxlen);
+}
+
 /**
  * Check whether a complete SCPI response has been received.
  *
@@ -697,6 +720,123 @@ SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 	return ret;
 }
 
+/*
+ * Read exactly len bytes of a response into buf. Returns SR_OK, or SR_ERR
+ * if the response ends early, the read fails or times out.
+ *
+ * With raw set the bytes are read with sr_scpi_read_raw(), and the end
+ * of the response isn't checked for: binary data may contain bytes that
+ * look like terminators.
+ */
+static int scpi_read_bytes(struct sr_scpi_dev_inst *scpi, char *buf,
+			   unsigned int len, gboolean raw, gint64 start)
+{
+	unsigned int done, elapsed_ms;
+	int ret;
+
+	done = 0;
+	while (done < len) {
+		if (raw) {
+			ret = sr_scpi_read_raw(scpi, buf + done, len - done);
+		} else {
+			if (sr_scpi_read_complete(scpi)) {
+				sr_err("SCPI response ended early.");
+				return SR_ERR;
+			}
+			ret = sr_scpi_read_data(scpi, buf + done, len - done);
+		}
+		if (ret < 0)
+			return SR_ERR;
+		done += ret;
+		elapsed_ms = (g_get_monotonic_time() - start) / 1000;
+		if (done < len && elapsed_ms >= scpi->read_timeout_ms) {
+			sr_err("Timed out waiting for SCPI response.");
+			return SR_ERR;
+		}
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Send a SCPI command, and read the reply as an IEEE 488.2 definite length
+ * arbitrary block ("#<n><length><data>"), as used for binary waveform
+ * data.
+ *
+ * The data is read straight into the result, without any parsing, and
+ * without terminator handling, so it may contain newlines. Anything
+ * following the block, such as the terminating newline, is discarded.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param command The SCPI command to send to the device (can be NULL).
+ * @param scpi_response Pointer where to store the block's data. It must
+ *                      be freed by the caller upon SR_OK.
+ *
+ * @return SR_OK on success, SR_ERR on failure.
+ */
+SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
+			      const char *command, GByteArray **scpi_response)
+{
+	char buf[256];
+	GByteArray *response;
+	gint64 start;
+	unsigned int i, num_digits, len, elapsed_ms;
+
+	*scpi_response = NULL;
+
+	if (command)
+		if (sr_scpi_send(scpi, command) != SR_OK)
+			return SR_ERR;
+
+	if (sr_scpi_read_begin(scpi) != SR_OK)
+		return SR_ERR;
+
+	start = g_get_monotonic_time();
+
+	if (scpi_read_bytes(scpi, buf, 2, FALSE, start) != SR_OK)
+		return SR_ERR;
+	if (buf[0] != '#' || !g_ascii_isdigit(buf[1]) || buf[1] == '0') {
+		sr_err("Expected a definite length block, got '%c%c'.",
+		       buf[0], buf[1]);
+		return SR_ERR;
+	}
+	num_digits = buf[1] - '0';
+
+	if (scpi_read_bytes(scpi, buf, num_digits, FALSE, start) != SR_OK)
+		return SR_ERR;
+	len = 0;
+	for (i = 0; i < num_digits; i++) {
+		if (!g_ascii_isdigit(buf[i])) {
+			sr_err("Invalid block length.");
+			return SR_ERR;
+		}
+		len = len * 10 + buf[i] - '0';
+	}
+
+	response = g_byte_array_sized_new(len);
+	g_byte_array_set_size(response, len);
+	if (scpi_read_bytes(scpi, (char *)response->data, len, TRUE,
+			start) != SR_OK) {
+		g_byte_array_free(response, TRUE);
+		return SR_ERR;
+	}
+
+	/* Discard the terminator. */
+	while (!sr_scpi_read_complete(scpi)) {
+		if (sr_scpi_read_data(scpi, buf, sizeof(buf)) < 0)
+			break;
+		elapsed_ms = (g_get_monotonic_time() - start) / 1000;
+		if (elapsed_ms >= scpi->read_timeout_ms)
+			break;
+	}
+
+	sr_spew("Got a block of %u bytes.", len);
+
+	*scpi_response = response;
+
+	return SR_OK;
+}
+
 /**
  * Send the *IDN? SCPI command, receive the reply, parse it and store the
  * reply as a sr_scpi_hw_info structure in the supplied scpi_response pointer.
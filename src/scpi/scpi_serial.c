@@ -163,7 +163,7 @@ static int scpi_serial_read_data(void *priv, char *buf, int maxlen)
 
 	/* Try to read new data into the buffer if there is space. */
 	if (len > 0) {
-		ret = serial_read_nonblocking(sscpi->serial, sscpi->buffer + sscpi->read,
+		ret = serial_read_nonblocking(sscpi->serial, sscpi->buffer + sscpi->count,
 				BUFFER_SIZE - sscpi->count);
 
 		if (ret < 0)
@@ -196,6 +196,28 @@ static int scpi_serial_read_data(void *priv, char *buf, int maxlen)
 	return 0;
 }
 
+static int scpi_serial_read_raw(void *priv, char *buf, int maxlen)
+{
+	struct scpi_serial *sscpi = priv;
+	int len;
+
+	/* Hand out what's buffered first, newlines included. */
+	if (sscpi->read < sscpi->count) {
+		len = sscpi->count - sscpi->read;
+		if (len > maxlen)
+			len = maxlen;
+		memcpy(buf, sscpi->buffer + sscpi->read, len);
+		sscpi->read += len;
+		if (sscpi->read == sscpi->count) {
+			sscpi->count = 0;
+			sscpi->read = 0;
+		}
+		return len;
+	}
+
+	return serial_read_nonblocking(sscpi->serial, buf, maxlen);
+}
+
 static int scpi_serial_read_complete(void *priv)
 {
 	struct scpi_serial *sscpi = priv;
@@ -236,6 +258,7 @@ SR_PRIV const struct sr_scpi_dev_inst scpi_serial_dev = {
 	.read_begin    = scpi_serial_read_begin,
 	.read_data     = scpi_serial_read_data,
 	.read_complete = scpi_serial_read_complete,
+	.read_raw      = scpi_serial_read_raw,
 	.close         = scpi_serial_close,
 	.free          = scpi_serial_free,
 };
@@ -697,6 +697,124 @@ SR_PRIV int serial_stream_detect(struct sr_serial_dev_inst *serial,
 	return SR_ERR;
 }
 
+/**
+ * Set up a buffer for splitting serial data into packets.
+ *
+ * @param pbuf The buffer to set up.
+ * @param data Space for the data.
+ * @param[in] size Size of the data space, at least twice the packet size.
+ * @param[in] packet_size Size, in bytes, of a packet.
+ * @param[in] sync Byte every packet has in common, or NULL if there is
+ *                 none. Saves calling packet_valid at every offset.
+ * @param packet_valid Callback that assesses whether a packet is valid.
+ */
+SR_PRIV void serial_packet_buffer_init(struct serial_packet_buffer *pbuf,
+		uint8_t *data, size_t size, size_t packet_size,
+		const struct serial_packet_sync *sync,
+		packet_valid_callback packet_valid)
+{
+	pbuf->data = data;
+	pbuf->size = size;
+	pbuf->offset = 0;
+	pbuf->len = 0;
+	pbuf->packet_size = packet_size;
+	if (sync)
+		pbuf->sync = *sync;
+	else
+		memset(&pbuf->sync, 0, sizeof(struct serial_packet_sync));
+	pbuf->packet_valid = packet_valid;
+}
+
+/**
+ * Read whatever is available from a serial port into a packet buffer.
+ *
+ * Unprocessed data is only moved to the start of the buffer once less
+ * than half of it is left free, so with packets being found as data
+ * comes in, that's rare, and only ever moves a partial packet.
+ *
+ * @param pbuf The packet buffer.
+ * @param serial Previously initialized serial port structure.
+ *
+ * @return The number of bytes read, or a negative error code.
+ */
+SR_PRIV int serial_packet_buffer_fill(struct serial_packet_buffer *pbuf,
+		struct sr_serial_dev_inst *serial)
+{
+	int len;
+
+	if (pbuf->len == 0) {
+		pbuf->offset = 0;
+	} else if (pbuf->offset && pbuf->size - pbuf->offset - pbuf->len
+			< pbuf->size / 2) {
+		memmove(pbuf->data, pbuf->data + pbuf->offset, pbuf->len);
+		pbuf->offset = 0;
+	}
+
+	len = pbuf->size - pbuf->offset - pbuf->len;
+	if (len == 0) {
+		/* Full of data without a single packet, drop it. */
+		pbuf->offset = pbuf->len = 0;
+		len = pbuf->size;
+	}
+
+	len = serial_read_nonblocking(serial,
+			pbuf->data + pbuf->offset + pbuf->len, len);
+	if (len > 0)
+		pbuf->len += len;
+
+	return len;
+}
+
+/**
+ * Find the next valid packet in a packet buffer.
+ *
+ * Data before the packet is dropped, and the packet itself is consumed.
+ *
+ * @param pbuf The packet buffer.
+ *
+ * @return A pointer to the packet within the buffer, valid until the next
+ *         call to serial_packet_buffer_fill(), or NULL if there is no
+ *         complete packet in the buffer.
+ */
+SR_PRIV const uint8_t *serial_packet_find(struct serial_packet_buffer *pbuf)
+{
+	const struct serial_packet_sync *sync;
+	const uint8_t *p, *q;
+	size_t i, n;
+
+	sync = &pbuf->sync;
+	while (pbuf->len >= pbuf->packet_size) {
+		if (sync->mask) {
+			/* Skip to the next offset which can start a packet. */
+			p = pbuf->data + pbuf->offset + sync->offset;
+			n = pbuf->len - pbuf->packet_size + 1;
+			if (sync->mask == 0xff) {
+				q = memchr(p, sync->value, n);
+				i = q ? (size_t)(q - p) : n;
+			} else {
+				for (i = 0; i < n; i++) {
+					if ((p[i] & sync->mask) == sync->value)
+						break;
+				}
+			}
+			pbuf->offset += i;
+			pbuf->len -= i;
+			if (i == n)
+				break;
+		}
+		p = pbuf->data + pbuf->offset;
+		if (pbuf->packet_valid(p)) {
+			pbuf->offset += pbuf->packet_size;
+			pbuf->len -= pbuf->packet_size;
+			return p;
+		}
+		pbuf->offset++;
+		pbuf->len--;
+	}
+
+	return NULL;
+}
+
 /**
  * Extract the serial device and options from the options linked list.
  *
@@ -61,8 +61,31 @@ struct source {
 struct datafeed_callback {
 	sr_datafeed_callback cb;
 	void *cb_data;
+	/* Statistics, the time is only counted with stats_timing set. */
+	uint64_t num_calls;
+	uint64_t usec;
 };
 
+/* Every packet type needs its slot in struct sr_session_stats. */
+G_STATIC_ASSERT(SR_DF_ANALOG2 - SR_DF_HEADER < SR_STATS_PACKET_TYPES);
+
+/*
+ * Get the statistics of a device, creating them if the device was never
+ * added with sr_session_dev_add(). Call with stats_mutex held.
+ */
+static struct sr_session_stats *dev_stats_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi)
+{
+	struct sr_session_stats *stats;
+
+	if (!(stats = g_hash_table_lookup(session->dev_stats, sdi))) {
+		stats = g_malloc0(sizeof(struct sr_session_stats));
+		g_hash_table_insert(session->dev_stats, (gpointer)sdi, stats);
+	}
+
+	return stats;
+}
+
 /**
  * Create a new session.
  *
@@ -88,6 +111,9 @@ SR_API int sr_session_new(struct sr_session **new_session)
 	session->running = FALSE;
 	session->abort_session = FALSE;
 	g_mutex_init(&session->stop_mutex);
+	g_mutex_init(&session->stats_mutex);
+	session->dev_stats = g_hash_table_new_full(g_direct_hash,
+			g_direct_equal, NULL, g_free);
 
 	*new_session = session;
 
@@ -114,10 +140,12 @@ SR_API int sr_session_destroy(struct sr_session *session)
 
 	sr_session_dev_remove_all(session);
 	g_mutex_clear(&session->stop_mutex);
+	g_mutex_clear(&session->stats_mutex);
 	if (session->trigger)
 		sr_trigger_free(session->trigger);
 
 	g_slist_free_full(session->owned_devs, (GDestroyNotify)sr_dev_inst_free);
+	g_hash_table_destroy(session->dev_stats);
 
 	g_free(session);
 
@@ -154,6 +182,9 @@ SR_API int sr_session_dev_remove_all(struct sr_session *session)
 
 	g_slist_free(session->devs);
 	session->devs = NULL;
+	g_mutex_lock(&session->stats_mutex);
+	g_hash_table_remove_all(session->dev_stats);
+	g_mutex_unlock(&session->stats_mutex);
 
 	return SR_OK;
 }
@@ -193,6 +224,16 @@ SR_API int sr_session_dev_add(struct sr_session *session,
 		return SR_ERR_ARG;
 	}
 
+	sr_dev_inst_channel_table_update(sdi);
+
+	/*
+	 * Create the device's statistics now, so the session thread only
+	 * ever updates them in place.
+	 */
+	g_mutex_lock(&session->stats_mutex);
+	dev_stats_get(session, sdi);
+	g_mutex_unlock(&session->stats_mutex);
+
 	/* If sdi->driver is NULL, this is a virtual device. */
 	if (!sdi->driver) {
 		/* Just add the device, don't run dev_open(). */
@@ -334,6 +375,44 @@ SR_API int sr_session_trigger_set(struct sr_session *session, struct sr_trigger
 	return SR_OK;
 }
 
+static uint64_t payload_size(const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_analog2 *analog2;
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		return logic->length;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		return (uint64_t)analog->num_samples
+				* g_slist_length(analog->channels) * sizeof(float);
+	case SR_DF_ANALOG2:
+		analog2 = packet->payload;
+		return (uint64_t)analog2->num_samples * analog2->encoding->unitsize;
+	default:
+		return 0;
+	}
+}
+
+/* Count an event loop iteration, and its time if it was started at start. */
+static void iteration_done(struct sr_session *session, int64_t start)
+{
+	unsigned int bucket;
+	int64_t usec;
+
+	g_mutex_lock(&session->stats_mutex);
+	session->stats.iterations++;
+	if (session->stats_timing && start) {
+		usec = g_get_monotonic_time() - start;
+		bucket = usec > 0 ? g_bit_storage(usec) : 0;
+		session->stats.latency[MIN(bucket, SR_STATS_LATENCY_BUCKETS - 1)]++;
+	}
+	g_mutex_unlock(&session->stats_mutex);
+}
+
 /**
  * Call every device in the current session's callback.
  *
@@ -355,10 +434,12 @@ SR_API int sr_session_trigger_set(struct sr_session *session, struct sr_trigger
 static int sr_session_iteration(struct sr_session *session, gboolean block)
 {
 	unsigned int i;
+	int64_t start;
 	int ret;
 
 	ret = g_poll(session->pollfds, session->num_sources,
 			block ? session->source_timeout : 0);
+	start = session->stats_timing ? g_get_monotonic_time() : 0;
 	for (i = 0; i < session->num_sources; i++) {
 		if (session->pollfds[i].revents > 0 || (ret == 0
 			&& session->source_timeout == session->sources[i].timeout)) {
@@ -387,6 +468,7 @@ static int sr_session_iteration(struct sr_session *session, gboolean block)
 		}
 		g_mutex_unlock(&session->stop_mutex);
 	}
+	iteration_done(session, start);
 
 	return SR_OK;
 }
@@ -440,9 +522,9 @@ static int verify_trigger(struct sr_trigger *trigger)
 SR_API int sr_session_start(struct sr_session *session)
 {
 	struct sr_dev_inst *sdi;
-	struct sr_channel *ch;
-	GSList *l, *c;
-	int enabled_channels, ret;
+	const struct sr_channel_table *table;
+	GSList *l;
+	int ret;
 
 	if (!session) {
 		sr_err("%s: session was NULL", __func__);
@@ -460,18 +542,20 @@ SR_API int sr_session_start(struct sr_session *session)
 
 	sr_info("Starting.");
 
+	sr_session_stats_reset(session);
+
 	ret = SR_OK;
 	for (l = session->devs; l; l = l->next) {
 		sdi = l->data;
-		enabled_channels = 0;
-		for (c = sdi->channels; c; c = c->next) {
-			ch = c->data;
-			if (ch->enabled) {
-				enabled_channels++;
-				break;
-			}
-		}
-		if (enabled_channels == 0) {
+		/*
+		 * Frontends and drivers may have changed channels or
+		 * settings behind our back, start the acquisition with a
+		 * fresh table and without cached configuration values.
+		 */
+		sr_dev_inst_channel_table_update(sdi);
+		sr_config_cache_clear(sdi);
+		table = sr_dev_inst_channel_table_get(sdi);
+		if (table->num_enabled == 0) {
 			ret = SR_ERR;
 			sr_err("%s using connection %s has no enabled channels!",
 					sdi->driver->name, sdi->connection_id);
@@ -507,6 +591,8 @@ SR_API int sr_session_start(struct sr_session *session)
  */
 SR_API int sr_session_run(struct sr_session *session)
 {
+	int64_t start;
+
 	if (!session) {
 		sr_err("%s: session was NULL", __func__);
 		return SR_ERR_ARG;
@@ -522,11 +608,15 @@ SR_API int sr_session_run(struct sr_session *session)
 
 	sr_info("Running.");
 
-	/* Do we have real sources? */
-	if (session->num_sources == 1 && session->pollfds[0].fd == -1) {
+	/* Do we have real sources? A dummy source with a timeout is polled. */
+	if (session->num_sources == 1 && session->pollfds[0].fd == -1
+			&& session->sources[0].timeout <= 0) {
 		/* Dummy source, freewheel over it. */
-		while (session->num_sources)
+		while (session->num_sources) {
+			start = session->stats_timing ? g_get_monotonic_time() : 0;
 			session->sources[0].cb(-1, 0, session->sources[0].cb_data);
+			iteration_done(session, start);
+		}
 	} else {
 		/* Real sources, use g_poll() main loop. */
 		while (session->num_sources)
@@ -675,8 +765,13 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
 SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		const struct sr_datafeed_packet *packet)
 {
+	struct sr_session *session;
 	GSList *l;
 	struct datafeed_callback *cb_struct;
+	struct sr_session_stats *stats;
+	int64_t start, now, usec;
+	uint64_t size;
+	unsigned int type;
 
 	if (!sdi) {
 		sr_err("%s: sdi was NULL", __func__);
@@ -693,16 +788,252 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		return SR_ERR_BUG;
 	}
 
-	for (l = sdi->session->datafeed_callbacks; l; l = l->next) {
-		if (sr_log_loglevel_get() >= SR_LOG_DBG)
-			datafeed_dump(packet);
+	if (sr_log_loglevel_get() >= SR_LOG_DBG)
+		datafeed_dump(packet);
+
+	session = sdi->session;
+	type = packet->type - SR_DF_HEADER;
+	size = type < SR_STATS_PACKET_TYPES ? payload_size(packet) : 0;
+
+	if (!session->stats_timing) {
+		for (l = session->datafeed_callbacks; l; l = l->next) {
+			cb_struct = l->data;
+			cb_struct->cb(sdi, packet, cb_struct->cb_data);
+		}
+		usec = -1;
+	} else {
+		start = now = g_get_monotonic_time();
+		for (l = session->datafeed_callbacks; l; l = l->next) {
+			cb_struct = l->data;
+			cb_struct->cb(sdi, packet, cb_struct->cb_data);
+			usec = g_get_monotonic_time();
+			g_mutex_lock(&session->stats_mutex);
+			cb_struct->usec += usec - now;
+			g_mutex_unlock(&session->stats_mutex);
+			now = usec;
+		}
+		usec = now - start;
+	}
+
+	/* Front ends may read the statistics from another thread. */
+	g_mutex_lock(&session->stats_mutex);
+	stats = dev_stats_get(session, sdi);
+	if (type < SR_STATS_PACKET_TYPES) {
+		session->stats.packets[type]++;
+		session->stats.bytes[type] += size;
+		stats->packets[type]++;
+		stats->bytes[type] += size;
+	}
+	for (l = session->datafeed_callbacks; l; l = l->next) {
 		cb_struct = l->data;
-		cb_struct->cb(sdi, packet, cb_struct->cb_data);
+		cb_struct->num_calls++;
 	}
+	if (usec >= 0) {
+		session->stats.callback_usec += usec;
+		session->stats.callback_max_usec =
+				MAX(session->stats.callback_max_usec, (uint64_t)usec);
+		stats->callback_usec += usec;
+		stats->callback_max_usec = MAX(stats->callback_max_usec, (uint64_t)usec);
+	}
+	g_mutex_unlock(&session->stats_mutex);
 
 	return SR_OK;
 }
 
+/**
+ * Add to a driver-reported statistics counter of a device and its session.
+ *
+ * @param sdi The device instance. Nothing is counted if it isn't in a
+ *            session.
+ * @param counter SR_STATS_OVERRUNS, SR_STATS_EMPTY_TRANSFERS, ...
+ * @param n The amount to add.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_stats_add(const struct sr_dev_inst *sdi,
+		int counter, uint64_t n)
+{
+	struct sr_session_stats *stats[2];
+	unsigned int i;
+
+	if (!sdi || !sdi->session)
+		return;
+
+	g_mutex_lock(&sdi->session->stats_mutex);
+	stats[0] = &sdi->session->stats;
+	stats[1] = dev_stats_get(sdi->session, sdi);
+	for (i = 0; i < 2; i++) {
+		switch (counter) {
+		case SR_STATS_OVERRUNS:
+			stats[i]->overruns += n;
+			break;
+		case SR_STATS_EMPTY_TRANSFERS:
+			stats[i]->empty_transfers += n;
+			break;
+		case SR_STATS_LOST_SAMPLES:
+			stats[i]->lost_samples += n;
+			break;
+		case SR_STATS_DOWNLOAD_SIZE:
+			stats[i]->download_size += n;
+			break;
+		case SR_STATS_DOWNLOAD_BYTES:
+			stats[i]->download_bytes += n;
+			break;
+		case SR_STATS_DOWNLOAD_USEC:
+			stats[i]->download_usec += n;
+			break;
+		default:
+			sr_err("%s: unknown counter %d", __func__, counter);
+			g_mutex_unlock(&sdi->session->stats_mutex);
+			return;
+		}
+	}
+	g_mutex_unlock(&sdi->session->stats_mutex);
+}
+
+/**
+ * Get the acquisition statistics of a session.
+ *
+ * This can be called from any thread, also while the session is running.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param sdi Get the statistics of this device only. If NULL, get the
+ *            totals of the session.
+ * @param stats Filled in with the statistics. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.4.0
+ */
+SR_API int sr_session_stats_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi, struct sr_session_stats *stats)
+{
+	struct sr_session_stats *dev_stats;
+
+	if (!session || !stats)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&session->stats_mutex);
+	if (!sdi)
+		*stats = session->stats;
+	else if ((dev_stats = g_hash_table_lookup(session->dev_stats, sdi)))
+		*stats = *dev_stats;
+	else
+		memset(stats, 0, sizeof(struct sr_session_stats));
+	g_mutex_unlock(&session->stats_mutex);
+
+	return SR_OK;
+}
+
+/**
+ * Reset the acquisition statistics of a session and its devices.
+ *
+ * This is done automatically by sr_session_start().
+ *
+ * @param session The session to use. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.4.0
+ */
+SR_API int sr_session_stats_reset(struct sr_session *session)
+{
+	struct datafeed_callback *cb_struct;
+	GHashTableIter iter;
+	gpointer dev_stats;
+	GSList *l;
+
+	if (!session)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&session->stats_mutex);
+	memset(&session->stats, 0, sizeof(struct sr_session_stats));
+	/* Keep the devices' entries, they may be in use right now. */
+	g_hash_table_iter_init(&iter, session->dev_stats);
+	while (g_hash_table_iter_next(&iter, NULL, &dev_stats))
+		memset(dev_stats, 0, sizeof(struct sr_session_stats));
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		cb_struct->num_calls = 0;
+		cb_struct->usec = 0;
+	}
+	g_mutex_unlock(&session->stats_mutex);
+
+	return SR_OK;
+}
+
+/**
+ * Enable or disable timing of datafeed callbacks and event loop
+ * iterations.
+ *
+ * Packets are always counted. Timing reads the clock for every callback
+ * and packet, so it is off by default.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param enable TRUE to collect timings.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.4.0
+ */
+SR_API int sr_session_stats_timing_set(struct sr_session *session,
+		gboolean enable)
+{
+	if (!session)
+		return SR_ERR_ARG;
+
+	session->stats_timing = enable;
+
+	return SR_OK;
+}
+
+/**
+ * Get the statistics of a datafeed callback.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param cb The callback, as passed to sr_session_datafeed_callback_add().
+ * @param cb_data The callback data, as passed to
+ *                sr_session_datafeed_callback_add().
+ * @param num_calls Filled in with the number of packets passed to the
+ *                  callback. Can be NULL.
+ * @param usec Filled in with the time spent in the callback, in
+ *             microseconds. Only counted while timing is enabled, see
+ *             sr_session_stats_timing_set(). Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or no such callback.
+ *
+ * @since 0.4.0
+ */
+SR_API int sr_session_datafeed_callback_stats_get(struct sr_session *session,
+		sr_datafeed_callback cb, void *cb_data, uint64_t *num_calls,
+		uint64_t *usec)
+{
+	struct datafeed_callback *cb_struct;
+	GSList *l;
+
+	if (!session)
+		return SR_ERR_ARG;
+
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		if (cb_struct->cb != cb || cb_struct->cb_data != cb_data)
+			continue;
+		g_mutex_lock(&session->stats_mutex);
+		if (num_calls)
+			*num_calls = cb_struct->num_calls;
+		if (usec)
+			*usec = cb_struct->usec;
+		g_mutex_unlock(&session->stats_mutex);
+		return SR_OK;
+	}
+
+	return SR_ERR_ARG;
+}
+
 /**
  * Add an event source for a file descriptor.
  *
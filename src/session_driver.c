@@ -33,131 +33,250 @@
 #define CHUNKSIZE (512 * 1024)
 /** @endcond */
 
+/* Number of buffers cycled between the read-ahead thread and the session. */
+#define NUM_REPLAY_BUFS 2
+
+/* Interval at which the source is run in real-time mode, in milliseconds. */
+#define PACING_INTERVAL_MS 10
+
 SR_PRIV struct sr_dev_driver session_driver_info;
 static struct sr_dev_driver *di = &session_driver_info;
 
+struct replay_buf {
+	uint8_t *data;
+	int length;
+	int offset;
+	gboolean full;
+};
+
 struct session_vdev {
 	char *sessionfile;
 	char *capturefile;
 	struct zip *archive;
-	struct zip_file *capfile;
-	int bytes_read;
+	uint64_t bytes_read;
 	uint64_t samplerate;
 	int unitsize;
 	int num_channels;
-	int cur_chunk;
+	gboolean realtime;
 	gboolean finished;
+
+	/* Archive indices of the capture file chunks, in replay order. */
+	GArray *chunks;
+
+	/*
+	 * The read-ahead thread decompresses into these buffers, the
+	 * session callback sends them out in the same order. The mutex
+	 * protects the "full" flags and the reader_* fields below.
+	 */
+	struct replay_buf bufs[NUM_REPLAY_BUFS];
+	int cur_buf;
+	GThread *reader;
+	GMutex mutex;
+	GCond cond;
+	gboolean reader_done;
+	gboolean reader_stop;
+
+	int64_t start_time;
 };
 
 static const uint32_t devopts[] = {
 	SR_CONF_CAPTUREFILE,
 	SR_CONF_CAPTURE_UNITSIZE,
 	SR_CONF_SAMPLERATE,
+	SR_CONF_REALTIME | SR_CONF_GET | SR_CONF_SET,
 };
 
+static int find_chunks(struct session_vdev *vdev)
+{
+	if (sr_sessionfile_chunks_find(vdev->archive, vdev->capturefile,
+			&vdev->chunks) != SR_OK) {
+		sr_err("No capture file '%s' in session file '%s'.",
+				vdev->capturefile, vdev->sessionfile);
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Read-ahead thread: decompresses the capture file chunks into the
+ * replay buffers, waiting for the session to hand each buffer back
+ * before refilling it.
+ */
+static gpointer reader_thread(gpointer data)
+{
+	struct session_vdev *vdev;
+	struct sr_sessionfile_chunk *entry;
+	struct replay_buf *buf;
+	struct zip_file *zf;
+	unsigned int i;
+	int slot, ret, readsize;
+	gboolean stop;
+
+	vdev = data;
+	slot = 0;
+	stop = FALSE;
+	readsize = CHUNKSIZE / vdev->unitsize * vdev->unitsize;
+	for (i = 0; i < vdev->chunks->len && !stop; i++) {
+		entry = &g_array_index(vdev->chunks, struct sr_sessionfile_chunk, i);
+		if (!(zf = zip_fopen_index(vdev->archive, entry->index, 0))) {
+			sr_err("Failed to open capture file chunk %d: %s.",
+					entry->num, zip_strerror(vdev->archive));
+			break;
+		}
+		sr_dbg("Opened %s.", zip_get_name(vdev->archive, entry->index, 0));
+		while (1) {
+			buf = &vdev->bufs[slot];
+			g_mutex_lock(&vdev->mutex);
+			while (buf->full && !vdev->reader_stop)
+				g_cond_wait(&vdev->cond, &vdev->mutex);
+			stop = vdev->reader_stop;
+			g_mutex_unlock(&vdev->mutex);
+			if (stop)
+				break;
+
+			if ((ret = zip_fread(zf, buf->data, readsize)) <= 0)
+				break;
+			if (ret % vdev->unitsize != 0)
+				sr_warn("Read size %d not a multiple of the"
+					" unit size %d.", ret, vdev->unitsize);
+
+			g_mutex_lock(&vdev->mutex);
+			buf->length = ret;
+			buf->offset = 0;
+			buf->full = TRUE;
+			g_cond_signal(&vdev->cond);
+			g_mutex_unlock(&vdev->mutex);
+			slot = (slot + 1) % NUM_REPLAY_BUFS;
+		}
+		zip_fclose(zf);
+	}
+
+	g_mutex_lock(&vdev->mutex);
+	vdev->reader_done = TRUE;
+	g_cond_signal(&vdev->cond);
+	g_mutex_unlock(&vdev->mutex);
+
+	return NULL;
+}
+
+static void replay_cleanup(struct session_vdev *vdev)
+{
+	int i;
+
+	if (vdev->reader) {
+		g_mutex_lock(&vdev->mutex);
+		vdev->reader_stop = TRUE;
+		g_cond_broadcast(&vdev->cond);
+		g_mutex_unlock(&vdev->mutex);
+		g_thread_join(vdev->reader);
+		vdev->reader = NULL;
+	}
+
+	for (i = 0; i < NUM_REPLAY_BUFS; i++) {
+		g_free(vdev->bufs[i].data);
+		vdev->bufs[i].data = NULL;
+	}
+
+	if (vdev->chunks) {
+		g_array_free(vdev->chunks, TRUE);
+		vdev->chunks = NULL;
+	}
+
+	if (vdev->archive) {
+		zip_close(vdev->archive);
+		vdev->archive = NULL;
+	}
+}
+
+static void replay_end(const struct sr_dev_inst *sdi)
+{
+	struct session_vdev *vdev;
+	struct sr_datafeed_packet packet;
+
+	vdev = sdi->priv;
+	replay_cleanup(vdev);
+	vdev->finished = TRUE;
+
+	packet.type = SR_DF_END;
+	sr_session_send(sdi, &packet);
+	sr_session_source_remove(sdi->session, -1);
+}
+
+/*
+ * In real-time mode, returns the number of bytes that may be sent
+ * right now without getting ahead of the samplerate. If nothing is due
+ * yet, the source timeout brings us back a little later.
+ */
+static uint64_t pacing_budget(struct session_vdev *vdev)
+{
+	uint64_t elapsed, due, sent;
+
+	elapsed = g_get_monotonic_time() - vdev->start_time;
+	due = (elapsed / G_USEC_PER_SEC) * vdev->samplerate
+		+ (elapsed % G_USEC_PER_SEC) * vdev->samplerate / G_USEC_PER_SEC;
+	sent = vdev->bytes_read / vdev->unitsize;
+	if (due > sent)
+		return (due - sent) * vdev->unitsize;
+
+	return 0;
+}
+
 static int receive_data(int fd, int revents, void *cb_data)
 {
 	struct sr_dev_inst *sdi;
 	struct session_vdev *vdev;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
-	struct zip_stat zs;
-	int ret, got_data;
-	char capturefile[16];
-	void *buf;
+	struct replay_buf *buf;
+	uint64_t len, budget;
+	gboolean full;
 
 	(void)fd;
 	(void)revents;
 
 	sdi = cb_data;
-	got_data = FALSE;
 	vdev = sdi->priv;
-	if (!vdev->finished) {
-		if (!vdev->capfile) {
-			/* No capture file opened yet, or finished with the last
-			 * chunked one. */
-			if (vdev->cur_chunk == 0) {
-				/* capturefile is always the unchunked base name. */
-				if (zip_stat(vdev->archive, vdev->capturefile, 0, &zs) != -1) {
-					/* No chunks, just a single capture file. */
-					vdev->cur_chunk = 0;
-					if (!(vdev->capfile = zip_fopen(vdev->archive,
-							vdev->capturefile, 0)))
-						return FALSE;
-						sr_dbg("Opened %s.", vdev->capturefile);
-				} else {
-					/* Try as first chunk filename. */
-					snprintf(capturefile, 15, "%s-1", vdev->capturefile);
-					if (zip_stat(vdev->archive, capturefile, 0, &zs) != -1) {
-						vdev->cur_chunk = 1;
-						if (!(vdev->capfile = zip_fopen(vdev->archive,
-								capturefile, 0)))
-							return FALSE;
-						sr_dbg("Opened %s.", capturefile);
-					} else {
-						sr_err("No capture file '%s' in " "session file '%s'.",
-								vdev->capturefile, vdev->sessionfile);
-						return FALSE;
-					}
-				}
-			} else {
-				/* Capture data is chunked, advance to the next chunk. */
-				vdev->cur_chunk++;
-				snprintf(capturefile, 15, "%s-%d", vdev->capturefile,
-						vdev->cur_chunk);
-				if (zip_stat(vdev->archive, capturefile, 0, &zs) != -1) {
-					if (!(vdev->capfile = zip_fopen(vdev->archive,
-							capturefile, 0)))
-						return FALSE;
-					sr_dbg("Opened %s.", capturefile);
-				} else {
-					/* We got all the chunks, finish up. */
-					vdev->finished = TRUE;
-					return TRUE;
-				}
-			}
-		}
-
-		if (!(buf = g_try_malloc(CHUNKSIZE))) {
-			sr_err("%s: buf malloc failed", __func__);
-			return FALSE;
-		}
+	if (vdev->finished)
+		return TRUE;
+
+	/* Wait for the read-ahead thread to fill the next buffer. */
+	buf = &vdev->bufs[vdev->cur_buf];
+	g_mutex_lock(&vdev->mutex);
+	while (!buf->full && !vdev->reader_done)
+		g_cond_wait(&vdev->cond, &vdev->mutex);
+	full = buf->full;
+	g_mutex_unlock(&vdev->mutex);
+
+	if (!full) {
+		/* We got all the chunks, finish up. */
+		replay_end(sdi);
+		return TRUE;
+	}
 
-		ret = zip_fread(vdev->capfile, buf,
-				CHUNKSIZE / vdev->unitsize * vdev->unitsize);
-		if (ret > 0) {
-			if (ret % vdev->unitsize != 0)
-				sr_warn("Read size %d not a multiple of the"
-					" unit size %d.", ret, vdev->unitsize);
-			got_data = TRUE;
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-			logic.length = ret;
-			logic.unitsize = vdev->unitsize;
-			logic.data = buf;
-			vdev->bytes_read += ret;
-			sr_session_send(sdi, &packet);
-		} else {
-			/* done with this capture file */
-			zip_fclose(vdev->capfile);
-			vdev->capfile = NULL;
-			if (vdev->cur_chunk == 0) {
-				/* It was the only file. */
-				vdev->finished = TRUE;
-			} else {
-				/* There might be more chunks, so don't fall through
-				 * to the SR_DF_END here. */
-				g_free(buf);
-				return TRUE;
-			}
-		}
-		g_free(buf);
+	len = buf->length - buf->offset;
+	if (vdev->realtime && vdev->samplerate) {
+		if ((budget = pacing_budget(vdev)) == 0)
+			return TRUE;
+		len = MIN(len, budget);
 	}
 
-	if (!got_data) {
-		packet.type = SR_DF_END;
-		sr_session_send(sdi, &packet);
-		sr_session_source_remove(sdi->session, -1);
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.length = len;
+	logic.unitsize = vdev->unitsize;
+	logic.data = buf->data + buf->offset;
+	sr_session_send(sdi, &packet);
+	vdev->bytes_read += len;
+	buf->offset += len;
+
+	if (buf->offset == buf->length) {
+		/* Hand the buffer back to the reader. */
+		g_mutex_lock(&vdev->mutex);
+		buf->full = FALSE;
+		g_cond_signal(&vdev->cond);
+		g_mutex_unlock(&vdev->mutex);
+		vdev->cur_buf = (vdev->cur_buf + 1) % NUM_REPLAY_BUFS;
 	}
 
 	return TRUE;
@@ -191,6 +310,8 @@ static int dev_open(struct sr_dev_inst *sdi)
 
 	drvc = di->priv;
 	vdev = g_malloc0(sizeof(struct session_vdev));
+	g_mutex_init(&vdev->mutex);
+	g_cond_init(&vdev->cond);
 	sdi->priv = vdev;
 	drvc->instances = g_slist_append(drvc->instances, sdi);
 
@@ -199,7 +320,12 @@ static int dev_open(struct sr_dev_inst *sdi)
 
 static int dev_close(struct sr_dev_inst *sdi)
 {
-	const struct session_vdev *const vdev = sdi->priv;
+	struct session_vdev *vdev;
+
+	vdev = sdi->priv;
+	replay_cleanup(vdev);
+	g_mutex_clear(&vdev->mutex);
+	g_cond_clear(&vdev->cond);
 	g_free(vdev->sessionfile);
 	g_free(vdev->capturefile);
 
@@ -228,6 +354,9 @@ static int config_get(uint32_t key, GVariant **data, const struct sr_dev_inst *s
 	case SR_CONF_CAPTURE_UNITSIZE:
 		*data = g_variant_new_uint64(vdev->unitsize);
 		break;
+	case SR_CONF_REALTIME:
+		*data = g_variant_new_boolean(vdev->realtime);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -265,6 +394,9 @@ static int config_set(uint32_t key, GVariant *data, const struct sr_dev_inst *sd
 	case SR_CONF_NUM_LOGIC_CHANNELS:
 		vdev->num_channels = g_variant_get_uint64(data);
 		break;
+	case SR_CONF_REALTIME:
+		vdev->realtime = g_variant_get_boolean(data);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -293,14 +425,16 @@ static int config_list(uint32_t key, GVariant **data, const struct sr_dev_inst *
 static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 {
 	struct session_vdev *vdev;
-	int ret;
+	int ret, i;
 
 	(void)cb_data;
 
 	vdev = sdi->priv;
 	vdev->bytes_read = 0;
-	vdev->cur_chunk = 0;
+	vdev->cur_buf = 0;
 	vdev->finished = FALSE;
+	vdev->reader_done = FALSE;
+	vdev->reader_stop = FALSE;
 
 	sr_info("Opening archive %s file %s", vdev->sessionfile,
 		vdev->capturefile);
@@ -311,11 +445,49 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi, void *cb_data)
 		return SR_ERR;
 	}
 
+	if (find_chunks(vdev) != SR_OK) {
+		replay_cleanup(vdev);
+		return SR_ERR;
+	}
+
+	for (i = 0; i < NUM_REPLAY_BUFS; i++) {
+		if (!(vdev->bufs[i].data = g_try_malloc(CHUNKSIZE))) {
+			sr_err("%s: buf malloc failed", __func__);
+			replay_cleanup(vdev);
+			return SR_ERR_MALLOC;
+		}
+		vdev->bufs[i].full = FALSE;
+	}
+
+	vdev->reader = g_thread_new("session-reader", reader_thread, vdev);
+
 	/* Send header packet to the session bus. */
 	std_session_send_df_header(sdi, LOG_PREFIX);
+	vdev->start_time = g_get_monotonic_time();
+
+	/*
+	 * Freewheeling source, or one run periodically by the session's
+	 * main loop when pacing to the samplerate.
+	 */
+	if (vdev->realtime && vdev->samplerate)
+		sr_session_source_add(sdi->session, -1, 0, PACING_INTERVAL_MS,
+				receive_data, (void *)sdi);
+	else
+		sr_session_source_add(sdi->session, -1, 0, 0,
+				receive_data, (void *)sdi);
+
+	return SR_OK;
+}
+
+static int dev_acquisition_stop(struct sr_dev_inst *sdi, void *cb_data)
+{
+	struct session_vdev *vdev;
 
-	/* freewheeling source */
-	sr_session_source_add(sdi->session, -1, 0, 0, receive_data, (void *)sdi);
+	(void)cb_data;
+
+	vdev = sdi->priv;
+	if (!vdev->finished)
+		replay_end(sdi);
 
 	return SR_OK;
 }
@@ -336,6 +508,6 @@ SR_PRIV struct sr_dev_driver session_driver = {
 	.dev_open = dev_open,
 	.dev_close = dev_close,
 	.dev_acquisition_start = dev_acquisition_start,
-	.dev_acquisition_stop = NULL,
+	.dev_acquisition_stop = dev_acquisition_stop,
 	.priv = NULL,
 };
@@ -49,6 +49,16 @@
 extern SR_PRIV struct sr_dev_driver session_driver;
 static int session_driver_initialized = 0;
 
+static gint chunk_cmp(gconstpointer a, gconstpointer b)
+{
+	const struct sr_sessionfile_chunk *ca, *cb;
+
+	ca = a;
+	cb = b;
+
+	return ca->num - cb->num;
+}
+
 
 /** @private */
 SR_PRIV int sr_sessionfile_check(const char *filename)
@@ -103,6 +113,285 @@ SR_PRIV int sr_sessionfile_check(const char *filename)
 	return SR_OK;
 }
 
+/** @private */
+SR_PRIV int sr_sessionfile_chunks_find(struct zip *archive,
+		const char *capturefile, GArray **chunks)
+{
+	struct sr_sessionfile_chunk entry;
+	zip_int64_t num_files, i;
+	const char *name;
+	char *end;
+	size_t len;
+
+	*chunks = g_array_new(FALSE, FALSE, sizeof(struct sr_sessionfile_chunk));
+	len = strlen(capturefile);
+	num_files = zip_get_num_entries(archive, 0);
+	for (i = 0; i < num_files; i++) {
+		if (!(name = zip_get_name(archive, i, 0)))
+			continue;
+		if (strncmp(name, capturefile, len))
+			continue;
+		if (name[len] == '\0') {
+			/* No chunks, just a single capture file. */
+			g_array_set_size(*chunks, 0);
+			entry.num = 0;
+			entry.index = i;
+			g_array_append_val(*chunks, entry);
+			break;
+		} else if (name[len] == '-') {
+			entry.num = strtol(name + len + 1, &end, 10);
+			if (*end || entry.num <= 0)
+				continue;
+			entry.index = i;
+			g_array_append_val(*chunks, entry);
+		}
+	}
+
+	if ((*chunks)->len == 0) {
+		g_array_free(*chunks, TRUE);
+		*chunks = NULL;
+		return SR_ERR_DATA;
+	}
+	g_array_sort(*chunks, chunk_cmp);
+
+	return SR_OK;
+}
+
+static uint64_t sample_bits(const uint8_t *p, int unitsize)
+{
+	uint64_t v;
+	int i;
+
+	v = 0;
+	for (i = 0; i < unitsize && i < 8; i++)
+		v |= (uint64_t)p[i] << (8 * i);
+
+	return v;
+}
+
+/**
+ * Fill in the summary of a capture file chunk for its session file index
+ * entry: the sample count, masks and last sample. Transitions are only
+ * counted within the chunk, see sr_sessionfile_index_append().
+ *
+ * Summaries cover the first 64 channels only.
+ *
+ * @return The first sample of the chunk.
+ *
+ * @private
+ */
+SR_PRIV uint64_t sr_sessionfile_index_scan(
+		struct sr_sessionfile_index_entry *entry, int chunk,
+		const uint8_t *buf, int unitsize, uint64_t length)
+{
+	uint64_t num_samples, i, v, first, last;
+
+	memset(entry, 0, sizeof(*entry));
+	entry->chunk = chunk;
+	entry->and_mask = ~(uint64_t)0;
+	num_samples = length / unitsize;
+	first = last = num_samples ? sample_bits(buf, unitsize) : 0;
+	for (i = 0; i < num_samples; i++) {
+		v = sample_bits(buf + i * unitsize, unitsize);
+		entry->or_mask |= v;
+		entry->and_mask &= v;
+		entry->transitions |= v ^ last;
+		last = v;
+	}
+	if (num_samples == 0)
+		entry->and_mask = 0;
+	entry->num_samples = num_samples;
+	entry->last_sample = last;
+
+	return first;
+}
+
+/**
+ * Append a scanned entry to a session file index.
+ *
+ * The entry's start sample and byte offset follow on from the last entry
+ * in the index, and the transition from that entry's last sample to the
+ * given first sample of this one is added.
+ *
+ * @private
+ */
+SR_PRIV void sr_sessionfile_index_append(GArray *index,
+		struct sr_sessionfile_index_entry *entry, uint64_t first,
+		int unitsize)
+{
+	struct sr_sessionfile_index_entry *prev;
+
+	if (index->len > 0) {
+		prev = &g_array_index(index, struct sr_sessionfile_index_entry,
+				index->len - 1);
+		entry->start_sample = prev->start_sample + prev->num_samples;
+		entry->byte_offset = prev->byte_offset + prev->num_samples * unitsize;
+		if (entry->num_samples > 0)
+			entry->transitions |= first ^ prev->last_sample;
+		else
+			entry->last_sample = prev->last_sample;
+	}
+
+	g_array_append_val(index, *entry);
+}
+
+/**
+ * Append an entry for a newly written chunk to a session file index.
+ *
+ * @private
+ */
+SR_PRIV void sr_sessionfile_index_add(GArray *index, int chunk,
+		const uint8_t *buf, int unitsize, uint64_t length)
+{
+	struct sr_sessionfile_index_entry entry;
+	uint64_t first;
+
+	first = sr_sessionfile_index_scan(&entry, chunk, buf, unitsize, length);
+	sr_sessionfile_index_append(index, &entry, first, unitsize);
+}
+
+/**
+ * Load a session file index.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_NA The session file has no index for this capture file.
+ * @retval SR_ERR_DATA The index is malformed.
+ *
+ * @private
+ */
+SR_PRIV int sr_sessionfile_index_load(struct zip *archive,
+		const char *capturefile, GArray **index)
+{
+	struct sr_sessionfile_index_entry entry;
+	struct zip_file *zf;
+	struct zip_stat zs;
+	char *name, *data, **lines;
+	int i, ret;
+
+	name = g_strdup_printf("%s%s", capturefile, SR_SESSIONFILE_INDEX_SUFFIX);
+	ret = zip_stat(archive, name, 0, &zs);
+	g_free(name);
+	if (ret == -1)
+		return SR_ERR_NA;
+
+	data = g_malloc(zs.size + 1);
+	if (!(zf = zip_fopen_index(archive, zs.index, 0))) {
+		g_free(data);
+		return SR_ERR_DATA;
+	}
+	ret = zip_fread(zf, data, zs.size);
+	zip_fclose(zf);
+	if (ret < 0 || (zip_uint64_t)ret != zs.size) {
+		g_free(data);
+		return SR_ERR_DATA;
+	}
+	data[zs.size] = '\0';
+
+	ret = SR_OK;
+	*index = g_array_new(FALSE, FALSE, sizeof(struct sr_sessionfile_index_entry));
+	lines = g_strsplit(data, "\n", 0);
+	for (i = 0; lines[i]; i++) {
+		if (lines[i][0] == '#' || lines[i][0] == '\0')
+			continue;
+		if (sscanf(lines[i], "%d %" SCNu64 " %" SCNu64 " %" SCNu64
+				" %" SCNx64 " %" SCNx64 " %" SCNx64 " %" SCNx64,
+				&entry.chunk, &entry.start_sample,
+				&entry.num_samples, &entry.byte_offset,
+				&entry.or_mask, &entry.and_mask,
+				&entry.transitions, &entry.last_sample) != 8) {
+			sr_err("Malformed session file index line: '%s'.", lines[i]);
+			ret = SR_ERR_DATA;
+			break;
+		}
+		g_array_append_val(*index, entry);
+	}
+	g_strfreev(lines);
+	g_free(data);
+
+	if (ret != SR_OK) {
+		g_array_free(*index, TRUE);
+		*index = NULL;
+	}
+
+	return ret;
+}
+
+/**
+ * Add a named entry to an open session file, replacing any entry of the
+ * same name already there. The data is copied, and written out by the
+ * caller's zip_close().
+ *
+ * @private
+ */
+SR_PRIV int sr_sessionfile_entry_save(struct zip *archive, const char *name,
+		const void *data, uint64_t length)
+{
+	struct zip_source *src;
+	struct zip_stat zs;
+	void *copy;
+	int ret;
+
+	/* libzip frees the buffer with free() once it's written. */
+	if (!(copy = malloc(MAX(length, 1))))
+		return SR_ERR_MALLOC;
+	memcpy(copy, data, length);
+
+	ret = SR_OK;
+	if (!(src = zip_source_buffer(archive, copy, length, 1))) {
+		free(copy);
+		ret = SR_ERR;
+	} else if (zip_stat(archive, name, 0, &zs) != -1) {
+		if (zip_replace(archive, zs.index, src) == -1)
+			ret = SR_ERR;
+	} else if (zip_add(archive, name, src) == -1) {
+		ret = SR_ERR;
+	}
+	if (ret != SR_OK) {
+		sr_err("Failed to store %s in session file: %s.", name,
+				zip_strerror(archive));
+		if (src)
+			zip_source_free(src);
+	}
+
+	return ret;
+}
+
+/**
+ * Add a session file index to an open session file, replacing any index
+ * already there.
+ *
+ * @private
+ */
+SR_PRIV int sr_sessionfile_index_save(struct zip *archive,
+		const char *capturefile, GArray *index)
+{
+	struct sr_sessionfile_index_entry *entry;
+	GString *s;
+	char *name;
+	unsigned int i;
+	int ret;
+
+	s = g_string_sized_new(64 + index->len * 64);
+	g_string_append(s, "# chunk start_sample num_samples byte_offset "
+			"or_mask and_mask transitions last_sample\n");
+	for (i = 0; i < index->len; i++) {
+		entry = &g_array_index(index, struct sr_sessionfile_index_entry, i);
+		g_string_append_printf(s, "%d %" PRIu64 " %" PRIu64 " %" PRIu64
+				" %" PRIx64 " %" PRIx64 " %" PRIx64 " %" PRIx64 "\n",
+				entry->chunk, entry->start_sample,
+				entry->num_samples, entry->byte_offset,
+				entry->or_mask, entry->and_mask,
+				entry->transitions, entry->last_sample);
+	}
+
+	name = g_strdup_printf("%s%s", capturefile, SR_SESSIONFILE_INDEX_SUFFIX);
+	ret = sr_sessionfile_entry_save(archive, name, s->str, s->len);
+	g_free(name);
+	g_string_free(s, TRUE);
+
+	return ret;
+}
+
 /**
  * Load the session from the specified filename.
  *
@@ -425,6 +714,7 @@ SR_API int sr_session_append(struct sr_session *session, const char *filename,
 	GKeyFile *kf;
 	GError *error;
 	gsize len;
+	GArray *index;
 	int chunk_num, next_chunk_num, tmpfile, ret, i;
 	const char *entry_name;
 	char *metafile, tmpname[32], chunkname[16];
@@ -440,8 +730,11 @@ SR_API int sr_session_append(struct sr_session *session, const char *filename,
 	if (zip_stat(archive, "metadata", 0, &zs) == -1)
 		return SR_ERR;
 
+	if (!(zf = zip_fopen_index(archive, zs.index, 0))) {
+		zip_close(archive);
+		return SR_ERR;
+	}
 	metafile = g_malloc(zs.size);
-	zf = zip_fopen_index(archive, zs.index, 0);
 	zip_fread(zf, metafile, zs.size);
 	zip_fclose(zf);
 
@@ -522,6 +815,36 @@ SR_API int sr_session_append(struct sr_session *session, const char *filename,
 		unlink(tmpname);
 		return SR_ERR;
 	}
+
+	/*
+	 * Only keep the sample index up to date if it covers all chunks
+	 * written so far, otherwise its offsets would be wrong.
+	 */
+	ret = sr_sessionfile_index_load(archive, "logic-1", &index);
+	if (ret == SR_ERR_NA && next_chunk_num == 1) {
+		index = g_array_new(FALSE, FALSE,
+				sizeof(struct sr_sessionfile_index_entry));
+	} else if (ret == SR_OK && index->len != (guint)next_chunk_num - 1) {
+		g_array_free(index, TRUE);
+		index = NULL;
+	} else if (ret != SR_OK) {
+		index = NULL;
+	}
+
+	/* The index goes into the same archive, so it's only written once. */
+	if (index) {
+		sr_sessionfile_index_add(index, next_chunk_num, buf, unitsize,
+				(uint64_t)units * unitsize);
+		ret = sr_sessionfile_index_save(archive, "logic-1", index);
+		g_array_free(index, TRUE);
+		if (ret != SR_OK) {
+			zip_unchange_all(archive);
+			zip_close(archive);
+			unlink(tmpname);
+			return ret;
+		}
+	}
+
 	if ((ret = zip_close(archive)) == -1) {
 		sr_info("error saving session file: %s", zip_strerror(archive));
 		unlink(tmpname);
@@ -532,4 +855,345 @@ SR_API int sr_session_append(struct sr_session *session, const char *filename,
 	return SR_OK;
 }
 
+static gint index_entry_cmp(gconstpointer a, gconstpointer b)
+{
+	const struct sr_sessionfile_index_entry *ea, *eb;
+
+	ea = a;
+	eb = b;
+
+	if (ea->start_sample != eb->start_sample)
+		return ea->start_sample < eb->start_sample ? -1 : 1;
+
+	return 0;
+}
+
+/* Find a chunk by its number, the chunks are sorted by number. */
+static struct sr_sessionfile_chunk *chunk_find(GArray *chunks, int num)
+{
+	struct sr_sessionfile_chunk *chunk;
+	unsigned int lo, hi, mid;
+
+	lo = 0;
+	hi = chunks->len;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		chunk = &g_array_index(chunks, struct sr_sessionfile_chunk, mid);
+		if (chunk->num == num)
+			return chunk;
+		if (chunk->num < num)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return NULL;
+}
+
+/*
+ * Check that every index entry refers to a chunk in the archive, and
+ * that the entries, sorted by their first sample, cover the capture
+ * without holes.
+ */
+static gboolean index_valid(GArray *index, GArray *chunks, int unitsize)
+{
+	struct sr_sessionfile_index_entry *entry;
+	uint64_t pos;
+	unsigned int i;
+
+	g_array_sort(index, index_entry_cmp);
+	pos = 0;
+	for (i = 0; i < index->len; i++) {
+		entry = &g_array_index(index, struct sr_sessionfile_index_entry, i);
+		if (!chunk_find(chunks, entry->chunk)
+				|| entry->start_sample != pos
+				|| entry->byte_offset != pos * unitsize)
+			return FALSE;
+		pos += entry->num_samples;
+	}
+
+	return TRUE;
+}
+
+/* Find the position of the index entry holding the given sample. */
+static gboolean index_find(GArray *index, uint64_t sample, unsigned int *pos)
+{
+	struct sr_sessionfile_index_entry *entry;
+	unsigned int lo, hi, mid;
+
+	lo = 0;
+	hi = index->len;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		entry = &g_array_index(index, struct sr_sessionfile_index_entry, mid);
+		if (sample < entry->start_sample) {
+			hi = mid;
+		} else if (sample >= entry->start_sample + entry->num_samples) {
+			lo = mid + 1;
+		} else {
+			*pos = mid;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/*
+ * Read len bytes from offset on of a capture file chunk into buf.
+ * Returns the number of bytes read, or -1 on error.
+ */
+static int64_t chunk_read(struct zip *archive,
+		const struct sr_sessionfile_chunk *chunk, uint64_t offset,
+		uint8_t *buf, uint64_t len)
+{
+	struct zip_file *zf;
+	zip_int64_t n;
+	uint64_t skip;
+
+	if (!(zf = zip_fopen_index(archive, chunk->index, 0)))
+		return -1;
+
+	skip = offset;
+#ifdef HAVE_ZIP_FSEEK
+	/* Only works on entries libzip can seek in, i.e. stored ones. */
+	if (skip > 0 && zip_fseek(zf, skip, SEEK_SET) == 0)
+		skip = 0;
+#endif
+	/* Otherwise decompress and discard everything before the offset. */
+	while (skip > 0) {
+		n = zip_fread(zf, buf, MIN(skip, len));
+		if (n <= 0) {
+			zip_fclose(zf);
+			return n < 0 ? -1 : 0;
+		}
+		skip -= n;
+	}
+
+	n = zip_fread(zf, buf, len);
+	zip_fclose(zf);
+
+	return n;
+}
+
+/*
+ * Fill buf with num_samples copies of a sample, given as the value of
+ * its first 64 channels.
+ */
+static void samples_fill(uint8_t *buf, uint64_t value, int unitsize,
+		uint64_t num_samples)
+{
+	uint64_t i;
+	int j;
+
+	for (i = 0; i < num_samples; i++)
+		for (j = 0; j < unitsize; j++)
+			buf[i * unitsize + j] = value >> (8 * j);
+}
+
+/**
+ * Read a range of samples from a session file.
+ *
+ * Only the capture file chunks covering the requested range are
+ * decompressed. If the session file has a sample index, it is used to
+ * find the chunks and the position of the range in them, and chunks in
+ * which all samples are the same aren't decompressed at all. Otherwise the
+ * chunk sizes are taken from the archive.
+ *
+ * @param filename The name of the session file to read from.
+ *                 Must not be NULL.
+ * @param start_sample The first sample to read.
+ * @param num_samples The number of samples to read.
+ * @param buf Will be set to a newly allocated buffer holding the samples
+ *            that were read, which must be freed with g_free() by the
+ *            caller, or to NULL if num_samples is 0. Must not be NULL.
+ * @param samples_read Will be set to the number of samples actually read,
+ *                     which is less than num_samples if the capture ends
+ *                     before the end of the range. Must not be NULL.
+ * @param unitsize Will be set to the number of bytes per sample.
+ *                 Must not be NULL.
+ *
+ * @retval SR_OK Success
+ * @retval SR_ERR_ARG Invalid arguments
+ * @retval SR_ERR_MALLOC Memory allocation error
+ * @retval SR_ERR_DATA Malformed session file
+ * @retval SR_ERR Other errors
+ *
+ * @since 0.4.0
+ */
+SR_API int sr_session_read_samples(const char *filename,
+		uint64_t start_sample, uint64_t num_samples, uint8_t **buf,
+		uint64_t *samples_read, int *unitsize)
+{
+	struct sr_sessionfile_chunk *chunk;
+	struct sr_sessionfile_index_entry *entry;
+	struct zip *archive;
+	struct zip_file *zf;
+	struct zip_stat zs;
+	GKeyFile *kf;
+	GArray *chunks, *index;
+	uint64_t pos, got, chunk_samples, first, want;
+	int64_t n;
+	unsigned int i;
+	int ret, unit;
+	char *metafile, *capturefile;
+
+	if (!filename || !buf || !samples_read || !unitsize)
+		return SR_ERR_ARG;
+
+	if ((ret = sr_sessionfile_check(filename)) != SR_OK)
+		return ret;
+
+	if (!(archive = zip_open(filename, 0, &ret)))
+		return SR_ERR;
+
+	if (zip_stat(archive, "metadata", 0, &zs) == -1) {
+		zip_close(archive);
+		return SR_ERR_DATA;
+	}
+	if (!(zf = zip_fopen_index(archive, zs.index, 0))) {
+		zip_close(archive);
+		return SR_ERR_DATA;
+	}
+	metafile = g_malloc(zs.size);
+	zip_fread(zf, metafile, zs.size);
+	zip_fclose(zf);
+
+	kf = g_key_file_new();
+	if (!g_key_file_load_from_data(kf, metafile, zs.size, 0, NULL)) {
+		sr_dbg("Failed to parse metadata.");
+		g_key_file_free(kf);
+		g_free(metafile);
+		zip_close(archive);
+		return SR_ERR_DATA;
+	}
+	g_free(metafile);
+	unit = g_key_file_get_integer(kf, "device 1", "unitsize", NULL);
+	capturefile = g_key_file_get_string(kf, "device 1", "capturefile", NULL);
+	g_key_file_free(kf);
+	if (unit <= 0 || !capturefile) {
+		sr_err("Session file '%s' has no capture data.", filename);
+		g_free(capturefile);
+		zip_close(archive);
+		return SR_ERR_DATA;
+	}
+
+	if ((ret = sr_sessionfile_chunks_find(archive, capturefile,
+			&chunks)) != SR_OK) {
+		sr_err("No capture file '%s' in session file '%s'.",
+				capturefile, filename);
+		g_free(capturefile);
+		zip_close(archive);
+		return ret;
+	}
+	index = NULL;
+	if (sr_sessionfile_index_load(archive, capturefile, &index) == SR_OK
+			&& !index_valid(index, chunks, unit)) {
+		sr_dbg("Ignoring stale session file index.");
+		g_array_free(index, TRUE);
+		index = NULL;
+	} else if (!index) {
+		sr_dbg("No session file index, using chunk sizes.");
+	}
+	g_free(capturefile);
+
+	if (num_samples == 0) {
+		*buf = NULL;
+		*samples_read = 0;
+		*unitsize = unit;
+		ret = SR_OK;
+		goto done;
+	}
+	if (num_samples > G_MAXSIZE / unit) {
+		sr_err("%s: too many samples requested", __func__);
+		ret = SR_ERR_ARG;
+		goto done;
+	}
+	if (!(*buf = g_try_malloc(num_samples * unit))) {
+		sr_err("%s: buf malloc failed", __func__);
+		ret = SR_ERR_MALLOC;
+		goto done;
+	}
+
+	ret = SR_OK;
+	got = 0;
+	if (index) {
+		if (!index_find(index, start_sample, &i))
+			i = index->len;
+		for (; i < index->len && got < num_samples; i++) {
+			entry = &g_array_index(index,
+					struct sr_sessionfile_index_entry, i);
+			first = start_sample + got - entry->start_sample;
+			want = MIN(num_samples - got, entry->num_samples - first);
+			if (entry->or_mask == entry->and_mask && unit <= 8) {
+				/* All samples are the same, no need to decompress. */
+				samples_fill(*buf + got * unit, entry->and_mask,
+						unit, want);
+				got += want;
+				continue;
+			}
+			chunk = chunk_find(chunks, entry->chunk);
+			sr_spew("Reading chunk %d for samples %" PRIu64 "-%" PRIu64 ".",
+					chunk->num, start_sample + got,
+					start_sample + got + want - 1);
+			n = chunk_read(archive, chunk,
+					(start_sample + got) * unit - entry->byte_offset,
+					*buf + got * unit, want * unit);
+			if (n < 0) {
+				ret = SR_ERR_DATA;
+				break;
+			}
+			got += n / unit;
+			if ((uint64_t)n < want * unit)
+				break;
+		}
+	} else {
+		pos = 0;
+		for (i = 0; i < chunks->len && got < num_samples; i++) {
+			chunk = &g_array_index(chunks, struct sr_sessionfile_chunk, i);
+			if (zip_stat_index(archive, chunk->index, 0, &zs) == -1) {
+				ret = SR_ERR_DATA;
+				break;
+			}
+			chunk_samples = zs.size / unit;
+			if (pos + chunk_samples <= start_sample + got) {
+				/* This chunk ends before the range starts. */
+				pos += chunk_samples;
+				continue;
+			}
+			first = start_sample + got - pos;
+			want = MIN(num_samples - got, chunk_samples - first);
+			sr_spew("Reading chunk %d for samples %" PRIu64 "-%" PRIu64 ".",
+					chunk->num, start_sample + got,
+					start_sample + got + want - 1);
+			n = chunk_read(archive, chunk, first * unit,
+					*buf + got * unit, want * unit);
+			if (n < 0) {
+				ret = SR_ERR_DATA;
+				break;
+			}
+			got += n / unit;
+			if ((uint64_t)n < want * unit)
+				break;
+			pos += chunk_samples;
+		}
+	}
+
+	if (ret == SR_OK) {
+		*samples_read = got;
+		*unitsize = unit;
+	} else {
+		g_free(*buf);
+		*buf = NULL;
+	}
+
+done:
+	g_array_free(chunks, TRUE);
+	if (index)
+		g_array_free(index, TRUE);
+	zip_close(archive);
+
+	return ret;
+}
+
 /** @} */
@@ -29,11 +29,18 @@ SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 		const struct sr_dev_inst *sdi, struct sr_trigger *trigger)
 {
 	struct soft_trigger_logic *stl;
+	const struct sr_channel_table *table;
+	int num_channels;
+
+	if ((table = sr_dev_inst_channel_table_get(sdi)))
+		num_channels = table->num_channels;
+	else
+		num_channels = g_slist_length(sdi->channels);
 
 	stl = g_malloc0(sizeof(struct soft_trigger_logic));
 	stl->sdi = sdi;
 	stl->trigger = trigger;
-	stl->unitsize = (g_slist_length(sdi->channels) + 7) / 8;
+	stl->unitsize = (num_channels + 7) / 8;
 	stl->prev_sample = g_malloc0(stl->unitsize);
 
 	return stl;
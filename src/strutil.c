@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <math.h>
 #include "libsigrok.h"
 #include "libsigrok-internal.h"
 
@@ -219,6 +220,183 @@ SR_PRIV int sr_atof_ascii(const char *str, float *ret)
 	return SR_OK;
 }
 
+/* Exact powers of ten in double precision. */
+static const double pow10_tab[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/* Write a decimal integer, return the number of characters written. */
+static int u64_to_str(uint64_t v, char *buf)
+{
+	char tmp[20];
+	int i, len;
+
+	i = sizeof(tmp);
+	do {
+		tmp[--i] = '0' + v % 10;
+		v /= 10;
+	} while (v);
+	len = sizeof(tmp) - i;
+	memcpy(buf, tmp + i, len);
+
+	return len;
+}
+
+/*
+ * Write mantissa * 10^-k in positional notation, return the number of
+ * characters written.
+ */
+static int decimal_to_str(uint64_t mantissa, int k, char *buf)
+{
+	char digits[20];
+	int len, pos;
+
+	while (k > 0 && mantissa && mantissa % 10 == 0) {
+		mantissa /= 10;
+		k--;
+	}
+	len = u64_to_str(mantissa, digits);
+	pos = 0;
+	if (k <= 0) {
+		memcpy(buf, digits, len);
+		pos = len;
+		if (mantissa) {
+			memset(buf + pos, '0', -k);
+			pos += -k;
+		}
+	} else if (len > k) {
+		memcpy(buf, digits, len - k);
+		pos = len - k;
+		buf[pos++] = '.';
+		memcpy(buf + pos, digits + len - k, k);
+		pos += k;
+	} else {
+		buf[pos++] = '0';
+		buf[pos++] = '.';
+		memset(buf + pos, '0', k - len);
+		pos += k - len;
+		memcpy(buf + pos, digits, len);
+		pos += len;
+	}
+
+	return pos;
+}
+
+/**
+ * Convert a float to the shortest string which converts back to the
+ * same float, without going through printf().
+ *
+ * @param value The value to convert.
+ * @param buf Buffer of at least SR_FLOAT_STR_MAXLEN bytes. The string is
+ *            NUL-terminated.
+ *
+ * @return The length of the string.
+ *
+ * @private
+ */
+SR_PRIV int sr_float_to_str(float value, char *buf)
+{
+	double d, p;
+	uint64_t mantissa;
+	int e, n, k, pos;
+
+	if (isnan(value))
+		return g_strlcpy(buf, "nan", SR_FLOAT_STR_MAXLEN);
+	if (isinf(value))
+		return g_strlcpy(buf, value < 0 ? "-inf" : "inf", SR_FLOAT_STR_MAXLEN);
+	if (value == 0)
+		return g_strlcpy(buf, "0", SR_FLOAT_STR_MAXLEN);
+
+	pos = 0;
+	if (value < 0) {
+		buf[pos++] = '-';
+		value = -value;
+	}
+	d = value;
+
+	/* Decimal exponent, i.e. 10^e <= d < 10^(e + 1). */
+	e = floor(log10(d));
+	if (e < -13 || e > 13) {
+		/* Scaling isn't exact anymore, 9 digits always round-trip. */
+		g_ascii_formatd(buf + pos, SR_FLOAT_STR_MAXLEN - pos, "%.9g", d);
+		return strlen(buf);
+	}
+
+	/* Find the fewest significant digits which convert back exactly. */
+	mantissa = 0;
+	k = 0;
+	for (n = 1; n <= 9; n++) {
+		k = n - 1 - e;
+		if (k >= 0) {
+			p = pow10_tab[k];
+			mantissa = (uint64_t)(d * p + 0.5);
+			if ((float)(mantissa / p) == value)
+				break;
+		} else {
+			p = pow10_tab[-k];
+			mantissa = (uint64_t)(d / p + 0.5);
+			if ((float)(mantissa * p) == value)
+				break;
+		}
+	}
+
+	pos += decimal_to_str(mantissa, k, buf + pos);
+	buf[pos] = '\0';
+
+	return pos;
+}
+
+/**
+ * Convert a float to a string with a fixed number of decimals, without
+ * going through printf().
+ *
+ * @param value The value to convert.
+ * @param decimals Number of digits after the decimal point, 0 to 9.
+ * @param buf Buffer of at least SR_FLOAT_STR_MAXLEN bytes. The string is
+ *            NUL-terminated.
+ *
+ * @return The length of the string.
+ *
+ * @private
+ */
+SR_PRIV int sr_float_to_str_fixed(float value, int decimals, char *buf)
+{
+	double d;
+	uint64_t mantissa;
+	int pos, len, i;
+
+	d = fabs(value);
+	if (decimals < 0 || decimals > 9 || isnan(value) || isinf(value)
+			|| d * pow10_tab[decimals] >= 1e18)
+		return sr_float_to_str(value, buf);
+
+	mantissa = (uint64_t)(d * pow10_tab[decimals] + 0.5);
+	pos = 0;
+	if (value < 0 && mantissa)
+		buf[pos++] = '-';
+
+	/* Like decimal_to_str(), but keeping trailing zeros. */
+	len = u64_to_str(mantissa, buf + pos);
+	if (decimals > 0) {
+		if (len <= decimals) {
+			/* Pad with leading zeros, e.g. 5 -> 0.05 */
+			memmove(buf + pos + decimals + 1 - len, buf + pos, len);
+			for (i = 0; i < decimals + 1 - len; i++)
+				buf[pos + i] = '0';
+			len = decimals + 1;
+		}
+		memmove(buf + pos + len - decimals + 1, buf + pos + len - decimals,
+				decimals);
+		buf[pos + len - decimals] = '.';
+		len++;
+	}
+	pos += len;
+	buf[pos] = '\0';
+
+	return pos;
+}
+
 /**
  * Convert a numeric value value to its "natural" string representation
  * in SI units.
@@ -0,0 +1,364 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <string.h>
+#include <glib.h>
+#include "libsigrok.h"
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "summary"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Multi-resolution summaries of logic and analog sample streams.
+ *
+ * A summary consists of a number of levels. Every node in level 0 covers
+ * "factor" samples, every node in level n covers "factor" nodes of level
+ * n - 1. For logic data, a node holds the OR and AND of all samples it
+ * covers, and a mask of the channels that changed state. The transition
+ * from the sample preceding a node to its first sample is counted in that
+ * node. For analog data, a node holds the minimum and maximum value.
+ * NaN samples, as sent for lost samples, are left out of those. A node
+ * covering only NaN samples holds NaN.
+ *
+ * The summary is built incrementally as data comes in, so a frontend can
+ * render any zoom level by looking at a number of nodes proportional to
+ * the number of pixels, rather than the number of samples.
+ *
+ * Serialized format, all integers little-endian:
+ *
+ *   magic       8 bytes, "SRSUMM01"
+ *   type        uint32, SR_SUMMARY_LOGIC or SR_SUMMARY_ANALOG
+ *   factor      uint32
+ *   width       uint32, unitsize for logic, 1 for analog
+ *   num_levels  uint32
+ *   num_samples 2 * uint32, low word first
+ *   name_len    uint32, followed by name_len bytes of channel name
+ *
+ * followed by, for every level:
+ *
+ *   num_nodes   uint32
+ *   nodes       num_nodes * node size bytes
+ *
+ * Logic nodes are the OR, AND and transition masks, each "width" bytes.
+ * Analog nodes are the minimum and maximum, as little-endian IEEE 754
+ * single-precision floats.
+ */
+
+/** @cond PRIVATE */
+#define SUMMARY_MAGIC "SRSUMM01"
+/** @endcond */
+
+/**
+ * Create a new summary builder.
+ *
+ * @param type SR_SUMMARY_LOGIC or SR_SUMMARY_ANALOG.
+ * @param width Unit size in bytes for logic data, ignored for analog data.
+ * @param factor Decimation factor between levels, at least 2.
+ * @param name Name stored with the summary, e.g. the channel name of an
+ *             analog summary. Can be NULL.
+ *
+ * @private
+ */
+SR_PRIV struct sr_summary *sr_summary_new(int type, unsigned int width,
+		unsigned int factor, const char *name)
+{
+	struct sr_summary *s;
+
+	if (factor < 2 || (type == SR_SUMMARY_LOGIC && width == 0))
+		return NULL;
+
+	s = g_malloc0(sizeof(struct sr_summary));
+	s->type = type;
+	s->factor = factor;
+	s->name = g_strdup(name ? name : "");
+	if (type == SR_SUMMARY_LOGIC) {
+		s->width = width;
+		s->node_size = 3 * width;
+	} else {
+		s->width = 1;
+		s->node_size = 2 * sizeof(float);
+	}
+	s->last_sample = g_malloc0(s->width);
+
+	return s;
+}
+
+/** @private */
+SR_PRIV void sr_summary_free(struct sr_summary *s)
+{
+	unsigned int i;
+
+	if (!s)
+		return;
+
+	for (i = 0; i < s->num_levels; i++) {
+		g_byte_array_free(s->levels[i], TRUE);
+		g_free(s->acc[i]);
+	}
+	g_free(s->last_sample);
+	g_free(s->name);
+	g_free(s);
+}
+
+/* Merge a finished node into the pending node of the given level. */
+static void acc_merge(struct sr_summary *s, unsigned int level,
+		const uint8_t *node)
+{
+	uint8_t *acc;
+	float *facc;
+	const float *fnode;
+	unsigned int i, w;
+
+	acc = s->acc[level];
+	if (s->acc_count[level] == 0) {
+		memcpy(acc, node, s->node_size);
+		return;
+	}
+
+	if (s->type == SR_SUMMARY_LOGIC) {
+		w = s->width;
+		for (i = 0; i < w; i++) {
+			acc[i] |= node[i];
+			acc[w + i] &= node[w + i];
+			acc[2 * w + i] |= node[2 * w + i];
+		}
+	} else {
+		facc = (float *)acc;
+		fnode = (const float *)node;
+		if (isnan(facc[0])) {
+			memcpy(acc, node, s->node_size);
+		} else if (!isnan(fnode[0])) {
+			if (fnode[0] < facc[0])
+				facc[0] = fnode[0];
+			if (fnode[1] > facc[1])
+				facc[1] = fnode[1];
+		}
+	}
+}
+
+static void level_add(struct sr_summary *s, unsigned int level)
+{
+	s->levels[level] = g_byte_array_new();
+	s->acc[level] = g_malloc0(s->node_size);
+	s->acc_count[level] = 0;
+	s->num_levels = level + 1;
+}
+
+/*
+ * Close the pending node of a level: store it, and propagate it to the
+ * level above. That level is only created once this one holds a second
+ * node, since a level of one node is the top. Returns TRUE if the
+ * pending node of the level above is now full.
+ */
+static gboolean node_close(struct sr_summary *s, unsigned int level)
+{
+	unsigned int up;
+
+	g_byte_array_append(s->levels[level], s->acc[level], s->node_size);
+	s->acc_count[level] = 0;
+
+	up = level + 1;
+	if (up == SR_SUMMARY_MAX_LEVELS)
+		return FALSE;
+	if (up == s->num_levels) {
+		if (s->levels[level]->len < 2 * s->node_size)
+			return FALSE;
+		/* Pick up the first node as well. */
+		level_add(s, up);
+		acc_merge(s, up, s->levels[level]->data);
+		s->acc_count[up]++;
+	}
+	acc_merge(s, up, s->acc[level]);
+
+	return ++s->acc_count[up] == s->factor;
+}
+
+static void level_emit(struct sr_summary *s, unsigned int level)
+{
+	while (node_close(s, level))
+		level++;
+}
+
+/**
+ * Feed logic data into a summary.
+ *
+ * @param s The summary, created with type SR_SUMMARY_LOGIC.
+ * @param data The samples.
+ * @param length Length of the data in bytes, a multiple of the summary's
+ *               unit size.
+ *
+ * @private
+ */
+SR_PRIV void sr_summary_logic_feed(struct sr_summary *s, const uint8_t *data,
+		uint64_t length)
+{
+	const uint8_t *sample;
+	uint8_t *acc, *last;
+	uint64_t num_samples, i;
+	unsigned int b, w;
+
+	if (!s || s->type != SR_SUMMARY_LOGIC)
+		return;
+
+	if (s->num_levels == 0)
+		level_add(s, 0);
+
+	w = s->width;
+	acc = s->acc[0];
+	last = s->last_sample;
+	num_samples = length / w;
+	for (i = 0; i < num_samples; i++) {
+		sample = data + i * w;
+		if (s->acc_count[0] == 0) {
+			for (b = 0; b < w; b++) {
+				acc[b] = acc[w + b] = sample[b];
+				acc[2 * w + b] = s->num_samples ? sample[b] ^ last[b] : 0;
+				last[b] = sample[b];
+			}
+		} else {
+			for (b = 0; b < w; b++) {
+				acc[b] |= sample[b];
+				acc[w + b] &= sample[b];
+				acc[2 * w + b] |= sample[b] ^ last[b];
+				last[b] = sample[b];
+			}
+		}
+		s->num_samples++;
+		if (++s->acc_count[0] == s->factor)
+			level_emit(s, 0);
+	}
+}
+
+/**
+ * Feed analog data into a summary.
+ *
+ * @param s The summary, created with type SR_SUMMARY_ANALOG.
+ * @param data The sample values.
+ * @param num_samples Number of samples to take from data.
+ * @param stride Distance between consecutive samples in data, e.g. the
+ *               number of channels in an interleaved packet.
+ *
+ * @private
+ */
+SR_PRIV void sr_summary_analog_feed(struct sr_summary *s, const float *data,
+		uint64_t num_samples, unsigned int stride)
+{
+	float *acc, v;
+	uint64_t i;
+
+	if (!s || s->type != SR_SUMMARY_ANALOG)
+		return;
+
+	if (s->num_levels == 0)
+		level_add(s, 0);
+
+	acc = (float *)s->acc[0];
+	for (i = 0; i < num_samples; i++) {
+		v = data[i * stride];
+		if (s->acc_count[0] == 0 || isnan(acc[0])) {
+			acc[0] = acc[1] = v;
+		} else if (!isnan(v)) {
+			if (v < acc[0])
+				acc[0] = v;
+			if (v > acc[1])
+				acc[1] = v;
+		}
+		s->num_samples++;
+		if (++s->acc_count[0] == s->factor)
+			level_emit(s, 0);
+	}
+}
+
+/**
+ * Close all partially filled nodes, so that the summary covers all
+ * samples fed into it. No more data can be fed into the summary after
+ * this. The top level of a finished summary consists of a single node.
+ *
+ * @private
+ */
+SR_PRIV void sr_summary_finish(struct sr_summary *s)
+{
+	unsigned int level;
+
+	if (!s || s->finished)
+		return;
+	s->finished = TRUE;
+
+	/* Levels are created as they're needed, so this ends at one node. */
+	for (level = 0; level < s->num_levels; level++) {
+		if (s->acc_count[level] > 0)
+			node_close(s, level);
+	}
+}
+
+static void append_u32(GString *out, uint32_t v)
+{
+	uint8_t buf[4];
+
+	WL32(buf, v);
+	g_string_append_len(out, (const char *)buf, 4);
+}
+
+/**
+ * Append the serialized summary to a string.
+ *
+ * The summary is finished first, if it wasn't already.
+ *
+ * @private
+ */
+SR_PRIV void sr_summary_serialize(struct sr_summary *s, GString *out)
+{
+	GByteArray *level;
+	const float *f;
+	unsigned int i, j;
+	union {
+		float f;
+		uint32_t u;
+	} conv;
+
+	sr_summary_finish(s);
+
+	g_string_append_len(out, SUMMARY_MAGIC, 8);
+	append_u32(out, s->type);
+	append_u32(out, s->factor);
+	append_u32(out, s->width);
+	append_u32(out, s->num_levels);
+	append_u32(out, s->num_samples & 0xffffffff);
+	append_u32(out, s->num_samples >> 32);
+	append_u32(out, strlen(s->name));
+	g_string_append(out, s->name);
+
+	for (i = 0; i < s->num_levels; i++) {
+		level = s->levels[i];
+		append_u32(out, level->len / s->node_size);
+		if (s->type == SR_SUMMARY_LOGIC) {
+			g_string_append_len(out, (const char *)level->data,
+					level->len);
+		} else {
+			f = (const float *)level->data;
+			for (j = 0; j < level->len / sizeof(float); j++) {
+				conv.f = f[j];
+				append_u32(out, conv.u);
+			}
+		}
+	}
+}
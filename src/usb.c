@@ -286,3 +286,262 @@ SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len)
 
 	return SR_OK;
 }
+
+static void download_transfer_done(struct libusb_transfer *transfer);
+
+static int download_submit(struct sr_usb_download *dl,
+		struct libusb_transfer *transfer)
+{
+	unsigned int len;
+	int ret;
+
+	len = MIN(dl->chunk_size, dl->size - dl->submitted);
+	if (dl->request && (ret = dl->request(dl, dl->submitted, len)) != SR_OK)
+		return ret;
+
+	libusb_fill_bulk_transfer(transfer, dl->devhdl, dl->endpoint,
+			transfer->buffer, len, download_transfer_done, dl,
+			dl->timeout);
+	if ((ret = libusb_submit_transfer(transfer)) != 0) {
+		sr_err("Failed to submit download transfer: %s.",
+		       libusb_error_name(ret));
+		return SR_ERR;
+	}
+	dl->submitted += len;
+	dl->busy++;
+
+	return SR_OK;
+}
+
+/* Add the download time since the last update to the session statistics. */
+static void download_stats_time(struct sr_usb_download *dl, int64_t now)
+{
+	sr_session_stats_add(dl->cb_data, SR_STATS_DOWNLOAD_USEC,
+			now - dl->stats_time);
+	dl->stats_time = now;
+}
+
+static void download_finish(struct sr_usb_download *dl)
+{
+	unsigned int i;
+
+	if (!dl->finished) {
+		dl->finished = TRUE;
+		dl->end_time = g_get_monotonic_time();
+		download_stats_time(dl, dl->end_time);
+	}
+	if (!dl->busy)
+		return;
+	for (i = 0; i < dl->num_transfers; i++)
+		libusb_cancel_transfer(dl->transfers[i]);
+}
+
+/*
+ * Hand the bytes received at the given offset to the convert callback,
+ * leaving out those to skip and split at the trigger. Returns FALSE
+ * once nothing more is wanted.
+ */
+static gboolean download_keep(struct sr_usb_download *dl, const uint8_t *buf,
+		uint64_t offset, uint64_t len)
+{
+	struct sr_datafeed_packet packet;
+	uint64_t pre;
+
+	if (offset + len <= dl->skip)
+		return TRUE;
+	if (offset < dl->skip) {
+		buf += dl->skip - offset;
+		len -= dl->skip - offset;
+	}
+	len = MIN(len, dl->length - dl->bytes_kept);
+
+	if (dl->has_trigger && !dl->triggered
+			&& dl->bytes_kept + len > dl->trigger_pos) {
+		pre = dl->trigger_pos - dl->bytes_kept;
+		if (pre && !dl->convert(dl, buf, pre))
+			return FALSE;
+		dl->bytes_kept += pre;
+		buf += pre;
+		len -= pre;
+		packet.type = SR_DF_TRIGGER;
+		packet.payload = NULL;
+		sr_session_send(dl->cb_data, &packet);
+		dl->triggered = TRUE;
+	}
+	if (len && !dl->convert(dl, buf, len))
+		return FALSE;
+	dl->bytes_kept += len;
+
+	return dl->bytes_kept < dl->length;
+}
+
+static void download_transfer_done(struct libusb_transfer *transfer)
+{
+	struct sr_usb_download *dl;
+	unsigned char *buf;
+	uint64_t offset;
+	gboolean more;
+
+	dl = transfer->user_data;
+	dl->busy--;
+	if (dl->finished)
+		/* Cancelled. */
+		return;
+
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		sr_err("Download transfer failed: %s.",
+		       libusb_error_name(transfer->status));
+		dl->status = SR_ERR;
+		download_finish(dl);
+		return;
+	}
+
+	dl->num_chunks++;
+	if (transfer->actual_length < transfer->length)
+		dl->short_chunks++;
+	offset = dl->bytes_received;
+	dl->bytes_received += transfer->actual_length;
+	sr_session_stats_add(dl->cb_data, SR_STATS_DOWNLOAD_BYTES,
+			transfer->actual_length);
+	download_stats_time(dl, g_get_monotonic_time());
+
+	/*
+	 * Put the transfer back on the spare buffer first, so the device
+	 * is kept busy while this chunk is being converted.
+	 */
+	buf = transfer->buffer;
+	transfer->buffer = dl->spare;
+	dl->spare = buf;
+	if (dl->submitted < dl->size
+			&& (dl->status = download_submit(dl, transfer)) != SR_OK) {
+		download_finish(dl);
+		return;
+	}
+
+	more = download_keep(dl, buf, offset, transfer->actual_length);
+	if (!more || (dl->submitted >= dl->size && !dl->busy))
+		download_finish(dl);
+}
+
+/**
+ * Start downloading device memory with asynchronous bulk transfers.
+ *
+ * The fields the driver sets up are described in struct sr_usb_download.
+ * Up to num_transfers transfers are kept queued. The data of interest is
+ * passed to the convert callback in order, with SR_DF_TRIGGER sent at
+ * the trigger position if there is one. The progress is added to the
+ * session statistics as the transfers come in. libusb events must be handled until
+ * sr_usb_download_done() returns TRUE, after which dl->status holds the
+ * outcome and sr_usb_download_free() is to be called. The same applies
+ * if this function fails.
+ *
+ * @param dl The download.
+ * @param devhdl The device to read from.
+ *
+ * @retval SR_OK The download was started.
+ * @retval SR_ERR_ARG Invalid download parameters.
+ * @retval SR_ERR_MALLOC Out of memory.
+ * @retval SR_ERR Submitting a transfer failed.
+ *
+ * @private
+ */
+SR_PRIV int sr_usb_download_start(struct sr_usb_download *dl,
+		libusb_device_handle *devhdl)
+{
+	unsigned int i;
+
+	if (!dl->chunk_size || !dl->num_transfers || !dl->convert)
+		return SR_ERR_ARG;
+
+	dl->devhdl = devhdl;
+	dl->bytes_received = dl->bytes_kept = 0;
+	dl->num_chunks = dl->short_chunks = 0;
+	dl->busy = 0;
+	dl->submitted = 0;
+	dl->triggered = FALSE;
+	dl->finished = FALSE;
+	dl->status = SR_OK;
+	dl->start_time = dl->end_time = g_get_monotonic_time();
+	dl->stats_time = dl->start_time;
+	if (dl->size > dl->skip + dl->length)
+		dl->size = dl->skip + dl->length;
+	sr_session_stats_add(dl->cb_data, SR_STATS_DOWNLOAD_SIZE, dl->size);
+
+	dl->transfers = g_malloc0(sizeof(struct libusb_transfer *)
+			* dl->num_transfers);
+	for (i = 0; i < dl->num_transfers; i++) {
+		if (!(dl->transfers[i] = libusb_alloc_transfer(0)))
+			break;
+		if (!(dl->transfers[i]->buffer = g_try_malloc(dl->chunk_size)))
+			break;
+	}
+	if (i < dl->num_transfers || !(dl->spare = g_try_malloc(dl->chunk_size))) {
+		sr_err("Download buffer malloc failed.");
+		dl->status = SR_ERR_MALLOC;
+		download_finish(dl);
+		return dl->status;
+	}
+
+	for (i = 0; i < dl->num_transfers && dl->submitted < dl->size; i++) {
+		if ((dl->status = download_submit(dl, dl->transfers[i])) != SR_OK) {
+			download_finish(dl);
+			return dl->status;
+		}
+	}
+	if (!dl->busy)
+		download_finish(dl);
+
+	return SR_OK;
+}
+
+/**
+ * Stop a download, cancelling the outstanding transfers.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_download_abort(struct sr_usb_download *dl)
+{
+	if (dl->transfers)
+		download_finish(dl);
+}
+
+/**
+ * Check whether a download has ended, and no more transfers are pending.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_usb_download_done(const struct sr_usb_download *dl)
+{
+	return dl->finished && !dl->busy;
+}
+
+/**
+ * Log the statistics of a download, and free its transfers and buffers.
+ *
+ * @private
+ */
+SR_PRIV void sr_usb_download_free(struct sr_usb_download *dl)
+{
+	uint64_t usec;
+	unsigned int i;
+
+	if (!dl->transfers)
+		return;
+
+	usec = MAX(dl->end_time - dl->start_time, 1);
+	sr_info("Downloaded %" PRIu64 " bytes in %" PRIu64 " transfers "
+		"(%" PRIu64 " short) in %.1f ms, %.1f KiB/s.",
+		dl->bytes_received, dl->num_chunks, dl->short_chunks,
+		usec / 1000.0, dl->bytes_received * 1000000.0 / usec / 1024);
+
+	for (i = 0; i < dl->num_transfers; i++) {
+		if (!dl->transfers[i])
+			continue;
+		g_free(dl->transfers[i]->buffer);
+		libusb_free_transfer(dl->transfers[i]);
+	}
+	g_free(dl->transfers);
+	dl->transfers = NULL;
+	g_free(dl->spare);
+	dl->spare = NULL;
+}
@@ -0,0 +1,716 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Throughput benchmarks. Not part of the test suite, build and run with:
+ *
+ *   make tests/benchmark && ./tests/benchmark [name...]
+ *
+ * Every result is printed as a single line of key=value pairs: the data
+ * rate and the process's peak RSS so far.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <glib.h>
+#include "../include/libsigrok/libsigrok.h"
+#include "libsigrok-internal.h"
+
+#define PACKET_SIZE (64 * 1024)
+
+struct benchmark {
+	const char *name;
+	void (*run)(void);
+};
+
+/* Start of a timed run, see report(). */
+struct run {
+	gint64 start;
+};
+
+/*
+ * Counts what comes out of a session, and passes it on to an output,
+ * optionally keeping what the output produces.
+ */
+struct feed {
+	const struct sr_output *o;
+	GString *file;
+	uint64_t bytes;
+	uint64_t samples;
+	uint64_t packets;
+	uint64_t out_bytes;
+};
+
+static struct sr_context *ctx;
+
+static struct sr_dev_inst *logic_device_new(int num_channels)
+{
+	struct sr_dev_inst *sdi;
+	char name[8];
+	int i;
+
+	sdi = sr_dev_inst_user_new("Benchmark", "Logic", NULL);
+	for (i = 0; i < num_channels; i++) {
+		snprintf(name, sizeof(name), "D%d", i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+
+	return sdi;
+}
+
+/*
+ * Fill a buffer with logic data that compresses roughly like real
+ * captures: slow channels, a clock, and some noise on the top bits.
+ */
+static void logic_pattern(uint8_t *buf, uint64_t length, uint64_t offset)
+{
+	uint64_t i, x;
+
+	for (i = 0; i < length; i++) {
+		x = offset + i;
+		buf[i] = (x & 1) | ((x >> 6) & 0x0e) | ((x >> 12) & 0x30);
+		if (((x * 2654435761u) >> 7) % 17 == 0)
+			buf[i] |= 0xc0;
+	}
+}
+
+static struct sr_dev_inst *analog_device_new(int num_channels)
+{
+	struct sr_dev_inst *sdi;
+	char name[8];
+	int i;
+
+	sdi = sr_dev_inst_user_new("Benchmark", "Analog", NULL);
+	for (i = 0; i < num_channels; i++) {
+		snprintf(name, sizeof(name), "A%d", i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_ANALOG, name);
+	}
+
+	return sdi;
+}
+
+/* Fill a buffer with interleaved sine waves, one per channel. */
+static void analog_pattern(float *buf, uint64_t num_samples,
+		unsigned int num_channels, uint64_t offset)
+{
+	uint64_t i;
+	unsigned int c;
+
+	for (i = 0; i < num_samples; i++) {
+		for (c = 0; c < num_channels; c++)
+			buf[i * num_channels + c] = (c + 1) *
+					sin((offset + i) * (c + 1) * 0.001);
+	}
+}
+
+static void run_start(struct run *r)
+{
+	r->start = g_get_monotonic_time();
+}
+
+static void report(const struct run *r, const char *name, const char *params,
+		uint64_t bytes, uint64_t samples, uint64_t packets)
+{
+	struct rusage usage;
+	double secs;
+
+	secs = (g_get_monotonic_time() - r->start) / 1000000.0;
+	if (secs <= 0)
+		secs = 1e-6;
+	if (getrusage(RUSAGE_SELF, &usage))
+		usage.ru_maxrss = 0;
+
+	printf("benchmark=%s %s bytes=%" PRIu64 " samples=%" PRIu64
+			" packets=%" PRIu64 " seconds=%.3f mbps=%.1f"
+			" samples_per_sec=%.0f peak_rss_kb=%ld\n",
+			name, params, bytes, samples, packets, secs,
+			bytes / secs / (1024 * 1024), samples / secs,
+			usage.ru_maxrss);
+	fflush(stdout);
+}
+
+static void feed_in(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct feed *feed;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	GString *out;
+
+	(void)sdi;
+
+	feed = cb_data;
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		feed->bytes += logic->length;
+		feed->samples += logic->length / logic->unitsize;
+		feed->packets++;
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		feed->bytes += analog->num_samples * sizeof(float)
+				* g_slist_length(analog->channels);
+		feed->samples += analog->num_samples;
+		feed->packets++;
+		break;
+	}
+
+	if (feed->o && sr_output_send(feed->o, packet, &out) == SR_OK && out) {
+		feed->out_bytes += out->len;
+		if (feed->file)
+			g_string_append_len(feed->file, out->str, out->len);
+		g_string_free(out, TRUE);
+	}
+}
+
+/* Output to a session with only the given device, and a feed into it. */
+static struct sr_session *output_session_new(struct sr_dev_inst *sdi,
+		char *format, GHashTable *params, struct feed *feed)
+{
+	struct sr_session *session;
+
+	if (!(feed->o = sr_output_new(sr_output_find(format), params, sdi))) {
+		fprintf(stderr, "Couldn't create '%s' output.\n", format);
+		return NULL;
+	}
+	sr_session_new(&session);
+	sr_session_dev_add(session, sdi);
+	sr_session_datafeed_callback_add(session, feed_in, feed);
+
+	return session;
+}
+
+static void output_session_free(struct sr_session *session,
+		struct sr_dev_inst *sdi, struct feed *feed)
+{
+	sr_session_destroy(session);
+	sr_output_free(feed->o);
+	sr_dev_inst_free(sdi);
+}
+
+static void run_srzip(unsigned int compression, unsigned int threads)
+{
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct feed feed;
+	GHashTable *params;
+	uint8_t *buf;
+	uint64_t total, sent;
+	struct run r;
+	char *filename, *desc;
+
+	filename = g_strdup_printf("benchmark-%d.sr", getpid());
+	params = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(params, g_strdup("filename"),
+			g_variant_ref_sink(g_variant_new_string(filename)));
+	g_hash_table_insert(params, g_strdup("compression"),
+			g_variant_ref_sink(g_variant_new_uint32(compression)));
+	g_hash_table_insert(params, g_strdup("threads"),
+			g_variant_ref_sink(g_variant_new_uint32(threads)));
+
+	memset(&feed, 0, sizeof(feed));
+	sdi = logic_device_new(8);
+	if (!(session = output_session_new(sdi, "srzip", params, &feed))) {
+		sr_dev_inst_free(sdi);
+		g_hash_table_destroy(params);
+		g_free(filename);
+		return;
+	}
+
+	total = 256 * 1024 * 1024;
+	buf = g_malloc(PACKET_SIZE);
+	logic.unitsize = 1;
+	logic.length = PACKET_SIZE;
+	logic.data = buf;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+
+	run_start(&r);
+	for (sent = 0; sent < total; sent += PACKET_SIZE) {
+		logic_pattern(buf, PACKET_SIZE, sent);
+		sr_session_send(sdi, &packet);
+	}
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	sr_session_send(sdi, &packet);
+
+	desc = g_strdup_printf("compression=%u threads=%u", compression, threads);
+	report(&r, "srzip", desc, feed.bytes, feed.samples, feed.packets);
+	g_free(desc);
+
+	output_session_free(session, sdi, &feed);
+	g_hash_table_destroy(params);
+	g_free(buf);
+	unlink(filename);
+	g_free(filename);
+}
+
+static void bench_srzip(void)
+{
+	static const unsigned int compression[] = { 0, 1, 6 };
+	static const unsigned int threads[] = { 1, 2, 4, 8 };
+	unsigned int c, t;
+
+	for (c = 0; c < G_N_ELEMENTS(compression); c++)
+		for (t = 0; t < G_N_ELEMENTS(threads); t++)
+			run_srzip(compression[c], threads[t]);
+}
+
+/*
+ * Send 16MB of logic or analog data through the session into an output
+ * module, and report the run as name if that's not NULL.
+ */
+static int output_data(const char *name, char *format, int num_channels,
+		gboolean analog, struct feed *feed)
+{
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog_packet;
+	uint8_t *buf;
+	uint64_t total, sent, unitsize;
+	struct run r;
+	char *desc;
+
+	if (analog) {
+		sdi = analog_device_new(num_channels);
+		unitsize = num_channels * sizeof(float);
+	} else {
+		sdi = logic_device_new(num_channels);
+		unitsize = (num_channels + 7) / 8;
+	}
+	if (!(session = output_session_new(sdi, format, NULL, feed))) {
+		sr_dev_inst_free(sdi);
+		return SR_ERR;
+	}
+
+	total = 16 * 1024 * 1024 / unitsize * unitsize;
+	buf = g_malloc(PACKET_SIZE);
+	logic.unitsize = unitsize;
+	logic.length = PACKET_SIZE / unitsize * unitsize;
+	logic.data = buf;
+	analog_packet.channels = sr_dev_inst_channels_get(sdi);
+	analog_packet.num_samples = PACKET_SIZE / unitsize;
+	analog_packet.mq = SR_MQ_VOLTAGE;
+	analog_packet.unit = SR_UNIT_VOLT;
+	analog_packet.mqflags = 0;
+	analog_packet.data = (float *)buf;
+	packet.type = analog ? SR_DF_ANALOG : SR_DF_LOGIC;
+	packet.payload = analog ? (void *)&analog_packet : (void *)&logic;
+
+	run_start(&r);
+	for (sent = 0; sent < total; sent += logic.length) {
+		if (analog)
+			analog_pattern(analog_packet.data, analog_packet.num_samples,
+					num_channels, sent / unitsize);
+		else
+			logic_pattern(buf, logic.length, sent);
+		sr_session_send(sdi, &packet);
+	}
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	sr_session_send(sdi, &packet);
+
+	if (name) {
+		desc = g_strdup_printf("format=%s channels=%d output_bytes=%" PRIu64,
+				format, num_channels, feed->out_bytes);
+		report(&r, name, desc, feed->bytes, feed->samples, feed->packets);
+		g_free(desc);
+	}
+
+	output_session_free(session, sdi, feed);
+	g_free(buf);
+
+	return SR_OK;
+}
+
+static void run_output(const char *name, char *format, int num_channels,
+		gboolean analog)
+{
+	struct feed feed;
+
+	memset(&feed, 0, sizeof(feed));
+	output_data(name, format, num_channels, analog, &feed);
+}
+
+static void bench_text(void)
+{
+	static char *formats[] = { "csv", "bits", "ascii", "hex", "gnuplot" };
+	unsigned int f;
+
+	for (f = 0; f < G_N_ELEMENTS(formats); f++) {
+		run_output("text", formats[f], 8, FALSE);
+		run_output("text", formats[f], 32, FALSE);
+	}
+}
+
+static void bench_output(void)
+{
+	static char *logic_formats[] = {
+		"vcd", "binary", "ols", "chronovu-la8", "planar",
+	};
+	static char *analog_formats[] = { "analog", "analog_csv", "wav" };
+	unsigned int f;
+
+	for (f = 0; f < G_N_ELEMENTS(logic_formats); f++) {
+		run_output("output", logic_formats[f], 8, FALSE);
+		run_output("output", logic_formats[f], 32, FALSE);
+	}
+	for (f = 0; f < G_N_ELEMENTS(analog_formats); f++) {
+		run_output("output", analog_formats[f], 1, TRUE);
+		run_output("output", analog_formats[f], 4, TRUE);
+	}
+}
+
+/* Write 16MB of data with an output module, as input for run_input(). */
+static GString *output_file(char *format, int num_channels, gboolean analog)
+{
+	struct feed feed;
+
+	memset(&feed, 0, sizeof(feed));
+	feed.file = g_string_sized_new(16 * 1024 * 1024);
+	if (output_data(NULL, format, num_channels, analog, &feed) != SR_OK) {
+		g_string_free(feed.file, TRUE);
+		return NULL;
+	}
+
+	return feed.file;
+}
+
+/* Read a file written by the matching output module, in 1MB pieces. */
+static void run_input(char *format, int num_channels, gboolean analog)
+{
+	const struct sr_input_module *imod;
+	struct sr_input *in;
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct feed feed;
+	GString *file, *piece;
+	gsize offset, len;
+	struct run r;
+	char *desc;
+	int ret;
+
+	if (!(imod = sr_input_find(format)) || !(file = output_file(format,
+			num_channels, analog))) {
+		fprintf(stderr, "No '%s' input or output.\n", format);
+		return;
+	}
+
+	memset(&feed, 0, sizeof(feed));
+	sr_session_new(&session);
+	sr_session_datafeed_callback_add(session, feed_in, &feed);
+	piece = g_string_sized_new(1024 * 1024);
+	sdi = NULL;
+	ret = SR_OK;
+
+	run_start(&r);
+	in = sr_input_new(imod, NULL);
+	for (offset = 0; in && ret == SR_OK && offset < file->len; offset += len) {
+		len = MIN(1024 * 1024, file->len - offset);
+		g_string_truncate(piece, 0);
+		g_string_append_len(piece, file->str + offset, len);
+		ret = sr_input_send(in, piece);
+		if (!sdi && (sdi = sr_input_dev_inst_get(in)))
+			sr_session_dev_add(session, sdi);
+	}
+	if (in && ret == SR_OK)
+		ret = sr_input_end(in);
+
+	if (in && ret == SR_OK) {
+		desc = g_strdup_printf("format=%s channels=%d", format,
+				num_channels);
+		report(&r, "input", desc, file->len, feed.samples, feed.packets);
+		g_free(desc);
+	} else {
+		fprintf(stderr, "Reading '%s' input failed.\n", format);
+	}
+
+	if (in)
+		sr_input_free(in);
+	sr_session_destroy(session);
+	g_string_free(piece, TRUE);
+	g_string_free(file, TRUE);
+}
+
+static void bench_input(void)
+{
+	static char *logic_formats[] = {
+		"binary", "vcd", "csv", "chronovu-la8", "planar",
+	};
+	unsigned int f;
+
+	for (f = 0; f < G_N_ELEMENTS(logic_formats); f++) {
+		run_input(logic_formats[f], 8, FALSE);
+		run_input(logic_formats[f], 32, FALSE);
+	}
+	run_input("wav", 1, TRUE);
+	run_input("wav", 4, TRUE);
+}
+
+/*
+ * Run the demo driver as fast as it goes, through the session into an
+ * output module (or none), for 64MB of data.
+ */
+static void run_session(struct sr_dev_driver *driver, char *format,
+		int num_logic, int num_analog)
+{
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct sr_config src[2];
+	struct feed feed;
+	GSList *options, *devices;
+	uint64_t samples;
+	struct run r;
+	char *desc;
+
+	src[0].key = SR_CONF_NUM_LOGIC_CHANNELS;
+	src[0].data = g_variant_new_int32(num_logic);
+	src[1].key = SR_CONF_NUM_ANALOG_CHANNELS;
+	src[1].data = g_variant_new_int32(num_analog);
+	options = g_slist_append(g_slist_append(NULL, &src[0]), &src[1]);
+	devices = sr_driver_scan(driver, options);
+	g_slist_free(options);
+	g_variant_unref(src[0].data);
+	g_variant_unref(src[1].data);
+	if (!devices) {
+		fprintf(stderr, "No demo device.\n");
+		return;
+	}
+	sdi = devices->data;
+	g_slist_free(devices);
+
+	samples = 64 * 1024 * 1024 / ((num_logic + 7) / 8
+			+ num_analog * sizeof(float));
+	sr_dev_open(sdi);
+	sr_config_set(sdi, NULL, SR_CONF_REALTIME, g_variant_new_boolean(FALSE));
+	sr_config_set(sdi, NULL, SR_CONF_BUFFERSIZE, g_variant_new_uint64(16384));
+	sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES, g_variant_new_uint64(samples));
+
+	memset(&feed, 0, sizeof(feed));
+	if (format && !(feed.o = sr_output_new(sr_output_find(format), NULL, sdi))) {
+		fprintf(stderr, "Couldn't create '%s' output.\n", format);
+		sr_dev_close(sdi);
+		return;
+	}
+	sr_session_new(&session);
+	sr_session_dev_add(session, sdi);
+	sr_session_datafeed_callback_add(session, feed_in, &feed);
+
+	run_start(&r);
+	if (sr_session_start(session) == SR_OK)
+		sr_session_run(session);
+
+	desc = g_strdup_printf("format=%s logic=%d analog=%d output_bytes=%" PRIu64,
+			format ? format : "none", num_logic, num_analog,
+			feed.out_bytes);
+	report(&r, "session", desc, feed.bytes, feed.samples, feed.packets);
+	g_free(desc);
+
+	sr_session_destroy(session);
+	if (feed.o)
+		sr_output_free(feed.o);
+	sr_dev_close(sdi);
+}
+
+static void bench_session(void)
+{
+	static char *logic_formats[] = { NULL, "binary", "vcd", "csv" };
+	static char *analog_formats[] = { NULL, "analog_csv", "wav" };
+	struct sr_dev_driver **drivers, *driver;
+	unsigned int f;
+	int i;
+
+	driver = NULL;
+	drivers = sr_driver_list();
+	for (i = 0; drivers && drivers[i]; i++) {
+		if (!strcmp(drivers[i]->name, "demo"))
+			driver = drivers[i];
+	}
+	if (!driver || sr_driver_init(ctx, driver) != SR_OK) {
+		fprintf(stderr, "No demo driver.\n");
+		return;
+	}
+
+	for (f = 0; f < G_N_ELEMENTS(logic_formats); f++) {
+		run_session(driver, logic_formats[f], 8, 0);
+		run_session(driver, logic_formats[f], 32, 0);
+	}
+	for (f = 0; f < G_N_ELEMENTS(analog_formats); f++)
+		run_session(driver, analog_formats[f], 0, 4);
+}
+
+/*
+ * Run the soft trigger over 256MB of data it never fires on: D6 and D7
+ * are always set together in logic_pattern(). With two stages the first
+ * one, on the clock in D0, matches every other sample.
+ */
+static void run_trigger(int num_channels, int num_stages)
+{
+	struct sr_dev_inst *sdi;
+	struct sr_trigger *trigger;
+	struct sr_trigger_stage *stage;
+	struct soft_trigger_logic *stl;
+	GSList *channels;
+	uint8_t *buf;
+	uint64_t total, sent, length, unitsize;
+	struct run r;
+	char *desc;
+
+	sdi = logic_device_new(num_channels);
+	channels = sr_dev_inst_channels_get(sdi);
+	trigger = sr_trigger_new(NULL);
+	if (num_stages > 1) {
+		stage = sr_trigger_stage_add(trigger);
+		sr_trigger_match_add(stage, g_slist_nth_data(channels, 0),
+				SR_TRIGGER_ONE, 0);
+	}
+	stage = sr_trigger_stage_add(trigger);
+	sr_trigger_match_add(stage, g_slist_nth_data(channels, 6),
+			SR_TRIGGER_ONE, 0);
+	sr_trigger_match_add(stage, g_slist_nth_data(channels, 7),
+			SR_TRIGGER_ZERO, 0);
+	stl = soft_trigger_logic_new(sdi, trigger);
+
+	unitsize = (num_channels + 7) / 8;
+	total = 256 * 1024 * 1024 / unitsize * unitsize;
+	length = PACKET_SIZE / unitsize * unitsize;
+	buf = g_malloc(length);
+	logic_pattern(buf, length, 0);
+
+	run_start(&r);
+	for (sent = 0; sent < total; sent += length)
+		soft_trigger_logic_check(stl, buf, length);
+
+	desc = g_strdup_printf("channels=%d stages=%d", num_channels, num_stages);
+	report(&r, "trigger", desc, sent, sent / unitsize, sent / length);
+	g_free(desc);
+
+	soft_trigger_logic_free(stl);
+	sr_trigger_free(trigger);
+	sr_dev_inst_free(sdi);
+	g_free(buf);
+}
+
+static void bench_trigger(void)
+{
+	run_trigger(8, 1);
+	run_trigger(8, 2);
+	run_trigger(32, 1);
+	run_trigger(32, 2);
+}
+
+/*
+ * Converting analog data to float, and floats to strings. Only native
+ * floats are supported by sr_analog_to_float() so far.
+ */
+static void bench_analog(void)
+{
+	struct sr_datafeed_analog2 analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	float *in, *out;
+	uint64_t total, sent, i, num_samples;
+	struct run r;
+	char *str;
+
+	num_samples = PACKET_SIZE / sizeof(float);
+	in = g_malloc(PACKET_SIZE);
+	out = g_malloc(PACKET_SIZE);
+	analog_pattern(in, num_samples, 1, 0);
+	memset(&encoding, 0, sizeof(encoding));
+	encoding.unitsize = sizeof(float);
+	encoding.is_signed = TRUE;
+	encoding.is_float = TRUE;
+	encoding.is_bigendian = G_BYTE_ORDER == G_BIG_ENDIAN;
+	encoding.scale.p = encoding.scale.q = 1;
+	encoding.offset.q = 1;
+	memset(&meaning, 0, sizeof(meaning));
+	memset(&spec, 0, sizeof(spec));
+	analog.data = in;
+	analog.num_samples = num_samples;
+	analog.encoding = &encoding;
+	analog.meaning = &meaning;
+	analog.spec = &spec;
+
+	total = 256 * 1024 * 1024;
+	run_start(&r);
+	for (sent = 0; sent < total; sent += PACKET_SIZE)
+		sr_analog_to_float(&analog, out);
+	report(&r, "analog", "kernel=to_float", sent, sent / sizeof(float),
+			sent / PACKET_SIZE);
+
+	total = 4 * 1024 * 1024;
+	run_start(&r);
+	for (sent = 0; sent < total; sent += PACKET_SIZE) {
+		for (i = 0; i < num_samples; i++) {
+			sr_analog_float_to_string(in[i], 3, &str);
+			g_free(str);
+		}
+	}
+	report(&r, "analog", "kernel=float_to_string", sent,
+			sent / sizeof(float), sent / PACKET_SIZE);
+
+	g_free(in);
+	g_free(out);
+}
+
+static const struct benchmark benchmarks[] = {
+	{ "srzip", bench_srzip },
+	{ "text", bench_text },
+	{ "output", bench_output },
+	{ "input", bench_input },
+	{ "session", bench_session },
+	{ "trigger", bench_trigger },
+	{ "analog", bench_analog },
+	{ NULL, NULL },
+};
+
+int main(int argc, char **argv)
+{
+	const struct benchmark *b;
+	int i;
+
+	if (sr_init(&ctx) != SR_OK)
+		return 1;
+
+	for (b = benchmarks; b->name; b++) {
+		if (argc > 1) {
+			for (i = 1; i < argc; i++)
+				if (!strcmp(argv[i], b->name))
+					break;
+			if (i == argc)
+				continue;
+		}
+		b->run();
+	}
+
+	sr_exit(ctx);
+
+	return 0;
+}
@@ -162,6 +162,28 @@ START_TEST(test_exit_null)
 }
 END_TEST
 
+/* Check looking up configuration keys by key and by name. */
+START_TEST(test_config_info)
+{
+	const struct sr_config_info *info;
+
+	info = sr_config_info_get(SR_CONF_SAMPLERATE);
+	fail_unless(info != NULL, "SR_CONF_SAMPLERATE not found.");
+	fail_unless(info->key == SR_CONF_SAMPLERATE, "Wrong key %d.", info->key);
+	fail_unless(sr_config_info_name_get(info->id) == info,
+			"Lookup by name of '%s' failed.", info->id);
+
+	info = sr_config_info_name_get("limit_samples");
+	fail_unless(info != NULL && info->key == SR_CONF_LIMIT_SAMPLES,
+			"Lookup of 'limit_samples' failed.");
+
+	fail_unless(sr_config_info_get(0xdeadbeef) == NULL,
+			"Unknown key found.");
+	fail_unless(sr_config_info_name_get("nonexistent") == NULL,
+			"Unknown name found.");
+}
+END_TEST
+
 Suite *suite_core(void)
 {
 	Suite *s;
@@ -179,5 +201,9 @@ Suite *suite_core(void)
 	tcase_add_test(tc, test_exit_null);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("config_info");
+	tcase_add_test(tc, test_config_info);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
@@ -61,6 +61,51 @@ START_TEST(test_channel_add)
 }
 END_TEST
 
+START_TEST(test_channel_table)
+{
+	struct sr_dev_inst *sdi;
+	struct sr_session *session;
+	const struct sr_channel_table *table;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	sr_dev_inst_channel_add(sdi, 0, SR_CHANNEL_LOGIC, "D0");
+	sr_dev_inst_channel_add(sdi, 1, SR_CHANNEL_LOGIC, "D1");
+	sr_dev_inst_channel_add(sdi, 2, SR_CHANNEL_ANALOG, "A0");
+	sr_dev_inst_channel_add(sdi, 70, SR_CHANNEL_LOGIC, "D70");
+
+	table = sr_dev_inst_channel_table_get(sdi);
+	fail_unless(table != NULL, "No channel table.");
+	fail_unless(table == sr_dev_inst_channel_table_get(sdi),
+			"Channel table wasn't cached.");
+	fail_unless(table->num_channels == 4 && table->num_enabled == 4);
+	fail_unless(table->num_logic == 3 && table->num_analog == 1);
+	fail_unless(table->logic_index[2] == 70);
+	fail_unless(table->mask_words == 2);
+	fail_unless(table->enabled_mask[0] == 0x7 && table->enabled_mask[1] == 0x40);
+
+	/* Disabling a channel rebuilds the table. */
+	sr_dev_channel_enable(sdi, 1, FALSE);
+	table = sr_dev_inst_channel_table_get(sdi);
+	fail_unless(table->num_enabled == 3 && table->num_logic == 2,
+			"Channel table not updated after disabling a channel.");
+	fail_unless(table->logic_index[0] == 0 && table->logic_index[1] == 70);
+	fail_unless(table->enabled_mask[0] == 0x5);
+
+	/* So does renaming one. */
+	sr_dev_channel_name_set(sdi, 2, "A1");
+	table = sr_dev_inst_channel_table_get(sdi);
+	fail_unless(!strcmp(table->analog[0]->name, "A1"));
+
+	/* Channels changed directly are picked up by the session. */
+	((struct sr_channel *)sr_dev_inst_channels_get(sdi)->data)->enabled = FALSE;
+	sr_session_new(&session);
+	sr_session_dev_add(session, sdi);
+	table = sr_dev_inst_channel_table_get(sdi);
+	fail_unless(table->num_enabled == 2 && table->logic_index[0] == 70);
+	sr_session_destroy(session);
+}
+END_TEST
+
 Suite *suite_device(void)
 {
 	Suite *s;
@@ -73,6 +118,7 @@ Suite *suite_device(void)
 
 	tc = tcase_create("sr_dev_inst_channel_add");
 	tcase_add_test(tc, test_channel_add);
+	tcase_add_test(tc, test_channel_table);
 
 	suite_add_tcase(s, tc);
 
@@ -0,0 +1,231 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <check.h>
+#include "../include/libsigrok/libsigrok.h"
+#include "../src/libsigrok-internal.h"
+#include "lib.h"
+
+#define NUM_CHANNELS 12
+#define UNITSIZE 2
+#define NUM_SAMPLES 1001
+
+static GByteArray *received;
+
+static void datafeed_in(const struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+
+	(void)sdi;
+	(void)cb_data;
+
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	logic = packet->payload;
+	fail_unless(logic->unitsize == UNITSIZE, "Wrong unitsize %d.",
+			logic->unitsize);
+	g_byte_array_append(received, logic->data, logic->length);
+}
+
+/*
+ * Fill a buffer with a mix of channels that compress well and channels
+ * that don't: slow, constant, a clock, and pseudo-random noise.
+ */
+static void fill_samples(uint8_t *buf)
+{
+	unsigned int i;
+	uint16_t v;
+
+	for (i = 0; i < NUM_SAMPLES; i++) {
+		v = (i & 1) | ((i / 100) & 1) << 1 | 1 << 2;
+		v |= (((i * 2654435761u) >> 9) & 0xff) << 3;
+		v |= (i > 500) << 11;
+		buf[i * UNITSIZE] = v & 0xff;
+		buf[i * UNITSIZE + 1] = v >> 8;
+	}
+}
+
+/*
+ * Read single channels back from the file at random ranges, including
+ * unaligned ones and ones crossing chunk boundaries or the end.
+ */
+static void check_read_channel(const GString *file, const uint8_t *samples)
+{
+	const char *filename = "check-input-planar.planar";
+	static const uint64_t ranges[][2] = {
+		{ 0, NUM_SAMPLES }, { 0, 8 }, { 3, 250 }, { 255, 2 },
+		{ 600, 1000 }, { NUM_SAMPLES - 1, 1 }, { NUM_SAMPLES, 10 },
+	};
+	uint8_t *plane;
+	uint64_t samples_read, s, n;
+	unsigned int i, r, bit;
+	int ch, ret;
+
+	fail_unless(g_file_set_contents(filename, file->str, file->len, NULL),
+			"Couldn't write planar file.");
+	for (ch = 0; ch < NUM_CHANNELS; ch += 5) {
+		for (r = 0; r < G_N_ELEMENTS(ranges); r++) {
+			ret = sr_planar_read_channel(filename, ch, ranges[r][0],
+					ranges[r][1], &plane, &samples_read);
+			fail_unless(ret == SR_OK, "sr_planar_read_channel() error: %d", ret);
+			n = MIN(ranges[r][1], NUM_SAMPLES - MIN(ranges[r][0], NUM_SAMPLES));
+			fail_unless(samples_read == n, "Channel %d range %u: read %"
+					PRIu64 " samples.", ch, r, samples_read);
+			fail_unless((n == 0) == (plane == NULL), "Unexpected plane.");
+			for (i = 0; i < n; i++) {
+				s = ranges[r][0] + i;
+				bit = (samples[s * UNITSIZE + ch / 8] >> (ch % 8)) & 1;
+				fail_unless(((plane[i / 8] >> (i % 8)) & 1) == bit,
+						"Channel %d sample %" PRIu64 " differs.", ch, s);
+			}
+			g_free(plane);
+		}
+	}
+
+	ret = sr_planar_read_channel(filename, NUM_CHANNELS, 0, 1, &plane,
+			&samples_read);
+	fail_unless(ret == SR_ERR_ARG, "Read a nonexistent channel.");
+	unlink(filename);
+}
+
+/* Write samples with the 'planar' output and read them back. */
+static void check_roundtrip(gboolean rle, uint32_t chunksize)
+{
+	const struct sr_output *o;
+	const struct sr_input *in;
+	struct sr_dev_inst *sdi;
+	struct sr_session *session;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	GHashTable *params;
+	GString *out, *file, *empty;
+	uint8_t samples[NUM_SAMPLES * UNITSIZE];
+	char name[8];
+	unsigned int i;
+	int ret;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	for (i = 0; i < NUM_CHANNELS; i++) {
+		snprintf(name, sizeof(name), "D%d", i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+
+	params = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(params, g_strdup("rle"),
+			g_variant_ref_sink(g_variant_new_boolean(rle)));
+	g_hash_table_insert(params, g_strdup("chunksize"),
+			g_variant_ref_sink(g_variant_new_uint32(chunksize)));
+	o = sr_output_new(sr_output_find("planar"), params, sdi);
+	fail_unless(o != NULL, "Couldn't create 'planar' output.");
+
+	/* Send in two uneven packets, to cross chunk boundaries. */
+	fill_samples(samples);
+	file = g_string_new(NULL);
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = UNITSIZE;
+	logic.data = samples;
+	logic.length = 333 * UNITSIZE;
+	ret = sr_output_send(o, &packet, &out);
+	fail_unless(ret == SR_OK && out != NULL, "No planar output.");
+	g_string_append_len(file, out->str, out->len);
+	g_string_free(out, TRUE);
+	logic.data = samples + 333 * UNITSIZE;
+	logic.length = (NUM_SAMPLES - 333) * UNITSIZE;
+	ret = sr_output_send(o, &packet, &out);
+	fail_unless(ret == SR_OK && out != NULL, "No planar output.");
+	g_string_append_len(file, out->str, out->len);
+	g_string_free(out, TRUE);
+
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	ret = sr_output_send(o, &packet, &out);
+	fail_unless(ret == SR_OK && out != NULL, "No planar output.");
+	g_string_append_len(file, out->str, out->len);
+	g_string_free(out, TRUE);
+	sr_output_free(o);
+	g_hash_table_destroy(params);
+	sr_dev_inst_free(sdi);
+
+	fail_unless(!memcmp(file->str + file->len - 8, "SRPLEND1", 8),
+			"Missing planar file end marker.");
+
+	/* The whole file is buffered by the matching input module. */
+	ret = sr_input_scan_buffer(file, &in);
+	fail_unless(ret == SR_OK && in != NULL, "Planar file not recognized.");
+	empty = g_string_new(NULL);
+	ret = sr_input_send(in, empty);
+	fail_unless(ret == SR_OK, "sr_input_send() error: %d", ret);
+	g_string_free(empty, TRUE);
+	fail_unless(sr_input_dev_inst_get(in) != NULL, "Header not parsed.");
+
+	received = g_byte_array_new();
+	sr_session_new(&session);
+	sr_session_datafeed_callback_add(session, datafeed_in, NULL);
+	sr_session_dev_add(session, sr_input_dev_inst_get(in));
+	ret = sr_input_end(in);
+	fail_unless(ret == SR_OK, "sr_input_end() error: %d", ret);
+
+	fail_unless(g_slist_length(sr_dev_inst_channels_get(
+			sr_input_dev_inst_get(in))) == NUM_CHANNELS,
+			"Wrong number of channels.");
+	fail_unless(received->len == sizeof(samples),
+			"Expected %zu bytes, got %u.", sizeof(samples), received->len);
+	fail_unless(!memcmp(received->data, samples, sizeof(samples)),
+			"Samples differ after reading back.");
+
+	check_read_channel(file, samples);
+
+	sr_input_free(in);
+	sr_session_destroy(session);
+	g_byte_array_free(received, TRUE);
+	g_string_free(file, TRUE);
+}
+
+START_TEST(test_input_planar_raw)
+{
+	check_roundtrip(FALSE, 256);
+}
+END_TEST
+
+START_TEST(test_input_planar_rle)
+{
+	check_roundtrip(TRUE, 256);
+	check_roundtrip(TRUE, 8);
+	check_roundtrip(TRUE, 1024 * 1024);
+}
+END_TEST
+
+Suite *suite_input_planar(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("input-planar");
+
+	tc = tcase_create("roundtrip");
+	tcase_add_test(tc, test_input_planar_raw);
+	tcase_add_test(tc, test_input_planar_rle);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -18,7 +18,10 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
  */
 
+#include <math.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <check.h>
 #include "../include/libsigrok/libsigrok.h"
 #include "lib.h"
@@ -96,6 +99,257 @@ START_TEST(test_output_options)
 }
 END_TEST
 
+static uint32_t read_u32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static float read_float(const uint8_t *p)
+{
+	union {
+		float f;
+		uint32_t u;
+	} conv;
+
+	conv.u = read_u32(p);
+
+	return conv.f;
+}
+
+/* Check the level structure of a logic summary generated by 'summary'. */
+START_TEST(test_output_summary)
+{
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	GHashTable *params;
+	GString *out;
+	uint8_t data[100];
+	const uint8_t *p;
+	unsigned int i;
+	int ret;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	for (i = 0; i < 8; i++)
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, "D");
+
+	params = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(params, g_strdup("factor"),
+			g_variant_ref_sink(g_variant_new_uint32(10)));
+	o = sr_output_new(sr_output_find("summary"), params, sdi);
+	fail_unless(o != NULL, "Couldn't create 'summary' output.");
+
+	/* Bit 0 toggles every sample, bit 1 is only set in sample 42. */
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = 0x80 | (i & 1) | (i == 42 ? 0x02 : 0);
+	logic.length = sizeof(data);
+	logic.unitsize = 1;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	ret = sr_output_send(o, &packet, &out);
+	fail_unless(ret == SR_OK, "Failed to send logic packet.");
+
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	ret = sr_output_send(o, &packet, &out);
+	fail_unless(ret == SR_OK && out != NULL, "No summary output.");
+
+	/* 100 samples with factor 10: 10 nodes, then 1 node. */
+	p = (const uint8_t *)out->str;
+	fail_unless(!memcmp(p, "SRSUMM01", 8), "Wrong summary magic.");
+	fail_unless(read_u32(p + 20) == 2, "Wrong number of levels.");
+	fail_unless(read_u32(p + 24) == 100, "Wrong number of samples.");
+	p += 36;
+	fail_unless(read_u32(p) == 10, "Wrong number of level 0 nodes.");
+	/* Node 4 covers samples 40..49: OR, AND, transitions. */
+	fail_unless(p[4 + 4 * 3] == 0x83, "Wrong OR mask.");
+	fail_unless(p[4 + 4 * 3 + 1] == 0x80, "Wrong AND mask.");
+	fail_unless(p[4 + 4 * 3 + 2] == 0x03, "Wrong transition mask.");
+	p += 4 + 10 * 3;
+	fail_unless(read_u32(p) == 1, "Wrong number of level 1 nodes.");
+	fail_unless(p[4] == 0x83 && p[5] == 0x80 && p[6] == 0x03,
+			"Wrong top level node.");
+
+	g_string_free(out, TRUE);
+	sr_output_free(o);
+	g_hash_table_destroy(params);
+}
+END_TEST
+
+/*
+ * Check that NaN samples are left out of the minimum and maximum of an
+ * analog summary, and don't spread to the levels above.
+ */
+START_TEST(test_output_summary_nan)
+{
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	GHashTable *params;
+	GString *out;
+	float data[100];
+	const uint8_t *p;
+	unsigned int i;
+	int ret;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	sr_dev_inst_channel_add(sdi, 0, SR_CHANNEL_ANALOG, "A0");
+
+	params = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(params, g_strdup("factor"),
+			g_variant_ref_sink(g_variant_new_uint32(10)));
+	o = sr_output_new(sr_output_find("summary"), params, sdi);
+	fail_unless(o != NULL, "Couldn't create 'summary' output.");
+
+	/* NaN as the first sample of a node, inside one, and a whole node. */
+	for (i = 0; i < 100; i++)
+		data[i] = (i == 0 || i == 45 || i >= 90) ? NAN : i;
+	memset(&analog, 0, sizeof(analog));
+	analog.channels = sr_dev_inst_channels_get(sdi);
+	analog.num_samples = 100;
+	analog.data = data;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	ret = sr_output_send(o, &packet, &out);
+	fail_unless(ret == SR_OK, "Failed to send analog packet.");
+
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	ret = sr_output_send(o, &packet, &out);
+	fail_unless(ret == SR_OK && out != NULL, "No summary output.");
+
+	p = (const uint8_t *)out->str;
+	fail_unless(read_u32(p + 20) == 2, "Wrong number of levels.");
+	p += 36 + 2;
+	fail_unless(read_u32(p) == 10, "Wrong number of level 0 nodes.");
+	fail_unless(read_float(p + 4) == 1 && read_float(p + 8) == 9,
+			"Wrong node 0.");
+	fail_unless(read_float(p + 4 + 4 * 8) == 40
+			&& read_float(p + 8 + 4 * 8) == 49, "Wrong node 4.");
+	fail_unless(isnan(read_float(p + 4 + 9 * 8))
+			&& isnan(read_float(p + 8 + 9 * 8)), "Node 9 isn't NaN.");
+	p += 4 + 10 * 8;
+	fail_unless(read_u32(p) == 1, "Wrong number of level 1 nodes.");
+	fail_unless(read_float(p + 4) == 1 && read_float(p + 8) == 89,
+			"Wrong top level node.");
+
+	g_string_free(out, TRUE);
+	sr_output_free(o);
+	g_hash_table_destroy(params);
+}
+END_TEST
+
+/*
+ * Write more than two chunks with 'srzip', and read back a range across
+ * a chunk boundary.
+ */
+START_TEST(test_output_srzip)
+{
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	GHashTable *params;
+	GString *out;
+	const char *filename = "check-output-srzip.sr";
+	uint8_t data[4096], *buf;
+	uint64_t samples_read, i;
+	int ret, unitsize;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	for (i = 0; i < 16; i++)
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, "D");
+
+	params = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(params, g_strdup("filename"),
+			g_variant_ref_sink(g_variant_new_string(filename)));
+	g_hash_table_insert(params, g_strdup("threads"),
+			g_variant_ref_sink(g_variant_new_uint32(2)));
+	o = sr_output_new(sr_output_find("srzip"), params, sdi);
+	fail_unless(o != NULL, "Couldn't create 'srzip' output.");
+
+	/* 10 MiB of 16-bit samples counting up: three 4 MiB chunks. */
+	logic.length = sizeof(data);
+	logic.unitsize = 2;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	for (i = 0; i < 10 * 1024 * 1024 / 2; i++) {
+		data[(i * 2) % sizeof(data)] = i & 0xff;
+		data[(i * 2) % sizeof(data) + 1] = (i >> 8) & 0xff;
+		if ((i * 2 + 2) % sizeof(data))
+			continue;
+		ret = sr_output_send(o, &packet, &out);
+		fail_unless(ret == SR_OK, "Failed to send logic packet.");
+	}
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	ret = sr_output_send(o, &packet, &out);
+	fail_unless(ret == SR_OK, "Failed to write session file.");
+	sr_output_free(o);
+	g_hash_table_destroy(params);
+
+	/* Chunk 1 ends at sample 2M. */
+	ret = sr_session_read_samples(filename, 2 * 1024 * 1024 - 10, 20,
+			&buf, &samples_read, &unitsize);
+	fail_unless(ret == SR_OK, "sr_session_read_samples() failed: %d.", ret);
+	fail_unless(unitsize == 2 && samples_read == 20, "Wrong sample count.");
+	for (i = 0; i < 20; i++)
+		fail_unless(buf[i * 2] == ((2 * 1024 * 1024 - 10 + i) & 0xff)
+				&& buf[i * 2 + 1] == (((2 * 1024 * 1024 - 10 + i)
+				>> 8) & 0xff), "Wrong sample %d.", (int)i);
+	g_free(buf);
+
+	unlink(filename);
+}
+END_TEST
+
+/* Check the columns and number formatting of 'analog_csv'. */
+START_TEST(test_output_analog_csv)
+{
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	GHashTable *params;
+	GString *out;
+	float data[] = { 1.5, -0.25, 3.3, 1e-3, 0.1, 100 };
+	int ret;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	sr_dev_inst_channel_add(sdi, 0, SR_CHANNEL_ANALOG, "A0");
+	sr_dev_inst_channel_add(sdi, 1, SR_CHANNEL_ANALOG, "A1");
+
+	params = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+			(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(params, g_strdup("separator"),
+			g_variant_ref_sink(g_variant_new_string("tab")));
+	o = sr_output_new(sr_output_find("analog_csv"), params, sdi);
+	fail_unless(o != NULL, "Couldn't create 'analog_csv' output.");
+
+	memset(&analog, 0, sizeof(analog));
+	analog.channels = sr_dev_inst_channels_get(sdi);
+	analog.num_samples = 3;
+	analog.data = data;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	ret = sr_output_send(o, &packet, &out);
+	fail_unless(ret == SR_OK && out != NULL, "No analog_csv output.");
+	fail_unless(!strcmp(out->str, "A0\tA1\n1.5\t-0.25\n3.3\t0.001\n"
+			"0.1\t100\n"), "Wrong analog_csv output: %s", out->str);
+
+	g_string_free(out, TRUE);
+	sr_output_free(o);
+	g_hash_table_destroy(params);
+}
+END_TEST
+
 Suite *suite_output_all(void)
 {
 	Suite *s;
@@ -112,5 +366,18 @@ Suite *suite_output_all(void)
 	tcase_add_test(tc, test_output_options);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("summary");
+	tcase_add_test(tc, test_output_summary);
+	tcase_add_test(tc, test_output_summary_nan);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("srzip");
+	tcase_add_test(tc, test_output_srzip);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("analog_csv");
+	tcase_add_test(tc, test_output_analog_csv);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
@@ -0,0 +1,210 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* For posix_openpt() and friends. */
+#define _XOPEN_SOURCE 600
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <check.h>
+#include "../include/libsigrok/libsigrok.h"
+#include "../src/libsigrok-internal.h"
+#include "lib.h"
+
+/*
+ * A transport replaying a canned response in small pieces, with the
+ * newline handling of the serial transport: read_data() holds back a
+ * trailing newline, and read_complete() consumes it.
+ */
+struct mock_scpi {
+	const char *response;
+	int len;
+	int pos;
+};
+
+static int mock_send(void *priv, const char *command)
+{
+	(void)priv;
+	(void)command;
+
+	return SR_OK;
+}
+
+static int mock_read_begin(void *priv)
+{
+	(void)priv;
+
+	return SR_OK;
+}
+
+static int mock_read_data(void *priv, char *buf, int maxlen)
+{
+	struct mock_scpi *m;
+	int len;
+
+	m = priv;
+	len = MIN(MIN(maxlen, 7), m->len - m->pos);
+	if (len > 0 && m->response[m->pos + len - 1] == '\n')
+		len--;
+	memcpy(buf, m->response + m->pos, len);
+	m->pos += len;
+
+	return len;
+}
+
+static int mock_read_complete(void *priv)
+{
+	struct mock_scpi *m;
+
+	m = priv;
+	if (m->pos < m->len && m->response[m->pos] == '\n') {
+		m->pos++;
+		return 1;
+	}
+
+	return m->pos == m->len;
+}
+
+static int mock_read_raw(void *priv, char *buf, int maxlen)
+{
+	struct mock_scpi *m;
+	int len;
+
+	m = priv;
+	len = MIN(MIN(maxlen, 7), m->len - m->pos);
+	memcpy(buf, m->response + m->pos, len);
+	m->pos += len;
+
+	return len;
+}
+
+/* A binary block with newlines in it, also as its last data byte. */
+START_TEST(test_get_block_newlines)
+{
+	static const char response[] = "#220\n0123\n\n45678\n\n\n9abc\n\n";
+	struct sr_scpi_dev_inst scpi;
+	struct mock_scpi mock;
+	GByteArray *block;
+	int ret;
+
+	memset(&scpi, 0, sizeof(scpi));
+	scpi.send = mock_send;
+	scpi.read_begin = mock_read_begin;
+	scpi.read_data = mock_read_data;
+	scpi.read_complete = mock_read_complete;
+	scpi.read_raw = mock_read_raw;
+	scpi.read_timeout_ms = 1000;
+	scpi.priv = &mock;
+	mock.response = response;
+	mock.len = sizeof(response) - 1;
+	mock.pos = 0;
+
+	ret = sr_scpi_get_block(&scpi, NULL, &block);
+	fail_unless(ret == SR_OK, "sr_scpi_get_block() failed: %d.", ret);
+	fail_unless(block->len == 20, "Wrong block length %u.", block->len);
+	fail_unless(!memcmp(block->data, response + 4, 20),
+			"Block data differs.");
+	fail_unless(mock.pos == mock.len, "Terminator not consumed.");
+	g_byte_array_free(block, TRUE);
+}
+END_TEST
+
+#ifdef HAVE_LIBSERIALPORT
+
+struct pty_writer {
+	int fd;
+	const char *data;
+	size_t len;
+};
+
+static gpointer pty_write_late(gpointer data)
+{
+	struct pty_writer *w;
+
+	w = data;
+	g_usleep(100 * 1000);
+	if (write(w->fd, w->data, w->len) != (ssize_t)w->len)
+		return GINT_TO_POINTER(1);
+
+	return NULL;
+}
+
+/*
+ * The same block through the serial transport over a pty. It arrives in
+ * two pieces, so the transport appends to data it has already buffered,
+ * and hands the block out of its buffer without newline handling.
+ */
+START_TEST(test_get_block_serial)
+{
+	static const char response[] = "#220\n0123\n\n45678\n\n\n9abc\n\n";
+	struct sr_scpi_dev_inst *scpi;
+	struct pty_writer writer;
+	GByteArray *block;
+	GThread *thread;
+	char *name;
+	int fd, ret;
+
+	fd = posix_openpt(O_RDWR | O_NOCTTY);
+	fail_unless(fd >= 0, "Failed to open a pty.");
+	fail_unless(grantpt(fd) == 0 && unlockpt(fd) == 0);
+	name = ptsname(fd);
+	fail_unless(name != NULL);
+
+	scpi = scpi_dev_inst_new(NULL, name, "115200/8n1");
+	fail_unless(scpi != NULL, "No SCPI device for %s.", name);
+	fail_unless(sr_scpi_open(scpi) == SR_OK, "Failed to open %s.", name);
+
+	fail_unless(write(fd, response, 3) == 3);
+	writer.fd = fd;
+	writer.data = response + 3;
+	writer.len = sizeof(response) - 1 - 3;
+	thread = g_thread_new("pty", pty_write_late, &writer);
+
+	ret = sr_scpi_get_block(scpi, NULL, &block);
+	fail_unless(g_thread_join(thread) == NULL, "Writing to the pty failed.");
+	fail_unless(ret == SR_OK, "sr_scpi_get_block() failed: %d.", ret);
+	fail_unless(block->len == 20, "Wrong block length %u.", block->len);
+	fail_unless(!memcmp(block->data, response + 4, 20),
+			"Block data differs.");
+	g_byte_array_free(block, TRUE);
+
+	sr_scpi_close(scpi);
+	sr_scpi_free(scpi);
+	close(fd);
+}
+END_TEST
+
+#endif
+
+Suite *suite_scpi(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("scpi");
+
+	tc = tcase_create("get_block");
+	tcase_add_test(tc, test_get_block_newlines);
+#ifdef HAVE_LIBSERIALPORT
+	tcase_add_test(tc, test_get_block_serial);
+#endif
+	suite_add_tcase(s, tc);
+
+	return s;
+}
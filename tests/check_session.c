@@ -19,8 +19,12 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
 #include <check.h>
 #include "../include/libsigrok/libsigrok.h"
+#include "../src/libsigrok-internal.h"
 #include "lib.h"
 
 /*
@@ -118,6 +122,198 @@ START_TEST(test_session_destroy_bogus)
 }
 END_TEST
 
+/*
+ * Check whether sr_session_read_samples() returns the right samples for
+ * ranges spanning chunks of a session file, including a chunk in which
+ * no channel changes.
+ */
+START_TEST(test_session_read_samples)
+{
+	int ret, unitsize, i;
+	struct sr_session *sess;
+	char *channels[] = { "D0", "D1", "D2", "D3", NULL };
+	const char *filename = "check-session-read.sr";
+	uint8_t data[150], *buf;
+	uint64_t samples_read;
+
+	for (i = 0; i < 100; i++)
+		data[i] = i;
+	memset(data + 100, 0x55, 50);
+
+	sr_session_new(&sess);
+	ret = sr_session_save_init(sess, filename, SR_MHZ(1), channels);
+	fail_unless(ret == SR_OK, "sr_session_save_init() failed: %d.", ret);
+	ret = sr_session_append(sess, filename, data, 1, 50);
+	fail_unless(ret == SR_OK, "sr_session_append() 1 failed: %d.", ret);
+	ret = sr_session_append(sess, filename, data + 50, 1, 50);
+	fail_unless(ret == SR_OK, "sr_session_append() 2 failed: %d.", ret);
+	ret = sr_session_append(sess, filename, data + 100, 1, 50);
+	fail_unless(ret == SR_OK, "sr_session_append() 3 failed: %d.", ret);
+
+	ret = sr_session_read_samples(filename, 40, 20, &buf,
+			&samples_read, &unitsize);
+	fail_unless(ret == SR_OK, "sr_session_read_samples() failed: %d.", ret);
+	fail_unless(unitsize == 1, "Wrong unitsize %d.", unitsize);
+	fail_unless(samples_read == 20, "Wrong sample count.");
+	for (i = 0; i < 20; i++)
+		fail_unless(buf[i] == 40 + i, "Wrong sample %d.", i);
+	g_free(buf);
+
+	ret = sr_session_read_samples(filename, 90, 30, &buf,
+			&samples_read, &unitsize);
+	fail_unless(ret == SR_OK, "sr_session_read_samples() failed: %d.", ret);
+	fail_unless(samples_read == 30, "Wrong sample count.");
+	fail_unless(!memcmp(buf, data + 90, 30), "Wrong constant samples.");
+	g_free(buf);
+
+	/* A range reaching past the end is truncated. */
+	ret = sr_session_read_samples(filename, 140, 20, &buf,
+			&samples_read, &unitsize);
+	fail_unless(ret == SR_OK, "sr_session_read_samples() failed: %d.", ret);
+	fail_unless(samples_read == 10, "Wrong truncated sample count.");
+	g_free(buf);
+
+	/* An empty range reads nothing, and isn't an error. */
+	ret = sr_session_read_samples(filename, 10, 0, &buf,
+			&samples_read, &unitsize);
+	fail_unless(ret == SR_OK, "Empty read failed: %d.", ret);
+	fail_unless(samples_read == 0 && buf == NULL, "Empty read returned data.");
+
+	sr_session_destroy(sess);
+	unlink(filename);
+}
+END_TEST
+
+static void datafeed_count(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	(void)sdi;
+	(void)packet;
+
+	(*(int *)cb_data)++;
+}
+
+/*
+ * Check whether sr_session_stats_get() counts the packets sent by a
+ * device, in total and per device.
+ */
+START_TEST(test_session_stats)
+{
+	int ret, calls;
+	struct sr_session *sess;
+	struct sr_session_stats stats, dev_stats;
+	const struct sr_input *in;
+	struct sr_dev_inst *sdi;
+	GString *gbuf;
+	uint64_t num_calls;
+	unsigned int i, logic;
+
+	sr_session_new(&sess);
+	ret = sr_session_stats_get(sess, NULL, &stats);
+	fail_unless(ret == SR_OK, "sr_session_stats_get() failed: %d.", ret);
+	for (i = 0; i < SR_STATS_PACKET_TYPES; i++)
+		fail_unless(stats.packets[i] == 0, "New session has packets.");
+
+	in = sr_input_new(sr_input_find("binary"), NULL);
+	fail_unless(in != NULL, "Failed to create input instance.");
+	sdi = sr_input_dev_inst_get(in);
+	calls = 0;
+	sr_session_datafeed_callback_add(sess, datafeed_count, &calls);
+	sr_session_dev_add(sess, sdi);
+	sr_session_stats_timing_set(sess, TRUE);
+
+	gbuf = g_string_new(NULL);
+	g_string_set_size(gbuf, 1000);
+	memset(gbuf->str, 0x55, gbuf->len);
+	ret = sr_input_send(in, gbuf);
+	fail_unless(ret == SR_OK, "sr_input_send() error: %d", ret);
+	g_string_free(gbuf, TRUE);
+
+	sr_session_stats_get(sess, NULL, &stats);
+	sr_session_stats_get(sess, sdi, &dev_stats);
+	logic = SR_DF_LOGIC - SR_DF_HEADER;
+	fail_unless(stats.packets[logic] > 0, "No logic packets counted.");
+	fail_unless(stats.bytes[logic] == 1000, "Wrong logic byte count.");
+	fail_unless(!memcmp(&stats, &dev_stats, sizeof(stats)),
+			"Device and session statistics differ.");
+
+	ret = sr_session_datafeed_callback_stats_get(sess, datafeed_count,
+			&calls, &num_calls, NULL);
+	fail_unless(ret == SR_OK, "No callback statistics: %d.", ret);
+	fail_unless(num_calls == (uint64_t)calls, "Wrong callback count.");
+
+	sr_session_stats_reset(sess);
+	sr_session_stats_get(sess, sdi, &dev_stats);
+	fail_unless(dev_stats.packets[logic] == 0, "Statistics not reset.");
+
+	sr_input_free(in);
+	sr_session_destroy(sess);
+}
+END_TEST
+
+struct freewheel {
+	struct sr_session *session;
+	int calls;
+};
+
+static int freewheel_source(int fd, int revents, void *cb_data)
+{
+	struct freewheel *fw;
+
+	(void)fd;
+	(void)revents;
+
+	fw = cb_data;
+	if (++fw->calls == 100)
+		sr_session_source_remove(fw->session, -1);
+
+	return TRUE;
+}
+
+static gpointer stats_poll(gpointer data)
+{
+	struct sr_session_stats stats;
+	int i;
+
+	for (i = 0; i < 1000; i++)
+		sr_session_stats_get(data, NULL, &stats);
+
+	return NULL;
+}
+
+/*
+ * Iterations over a dummy source are counted too, and the statistics can
+ * be read from another thread while the session runs.
+ */
+START_TEST(test_session_stats_freewheel)
+{
+	struct sr_session *sess;
+	struct sr_session_stats stats;
+	struct sr_dev_inst *sdi;
+	struct freewheel fw;
+	GThread *thread;
+
+	sr_session_new(&sess);
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	sr_session_dev_add(sess, sdi);
+	fw.session = sess;
+	fw.calls = 0;
+	sr_session_source_add(sess, -1, 0, 0, freewheel_source, &fw);
+
+	thread = g_thread_new("stats", stats_poll, sess);
+	sr_session_run(sess);
+	g_thread_join(thread);
+
+	sr_session_stats_get(sess, NULL, &stats);
+	fail_unless(fw.calls == 100, "Source called %d times.", fw.calls);
+	fail_unless(stats.iterations == 100, "Counted %" PRIu64 " iterations.",
+			stats.iterations);
+
+	sr_session_destroy(sess);
+	sr_dev_inst_free(sdi);
+}
+END_TEST
+
 Suite *suite_session(void)
 {
 	Suite *s;
@@ -134,5 +330,16 @@ Suite *suite_session(void)
 	tcase_add_test(tc, test_session_destroy_bogus);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("file");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_read_samples);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("stats");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_stats);
+	tcase_add_test(tc, test_session_stats_freewheel);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
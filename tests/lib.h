@@ -44,7 +44,9 @@ Suite *suite_core(void);
 Suite *suite_driver_all(void);
 Suite *suite_input_all(void);
 Suite *suite_input_binary(void);
+Suite *suite_input_planar(void);
 Suite *suite_output_all(void);
+Suite *suite_scpi(void);
 Suite *suite_session(void);
 Suite *suite_strutil(void);
 Suite *suite_version(void);